@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_AESKERNELS_H
+#define SHAREMIND_LIBRANDOM_AESKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace sharemind {
+
+/** The round keys of AES-128. */
+using AesRoundKeys = std::uint8_t[11u][16u];
+
+/**
+ * \brief Expands the given 16-byte AES-128 key into the round keys.
+ * \note The memory access pattern does not depend on the key.
+ */
+void aesExpandKey(void const * key, AesRoundKeys & roundKeys) noexcept;
+
+/** \brief Encrypts a block in place using aesBlocksKernelGeneric(). */
+void aesEncryptBlock(AesRoundKeys const & roundKeys, std::uint8_t * block)
+        noexcept;
+
+/**
+ * \brief Encrypts count blocks of 16 bytes with AES-128 in ECB mode. The
+ *        output may equal the input.
+ */
+using AesBlocksKernel = void (*)(AesRoundKeys const & roundKeys,
+                                 std::uint8_t const * in,
+                                 std::size_t count,
+                                 std::uint8_t * out);
+
+/**
+ * \brief Encrypts the blocks with the AES of Crypto++, which is keyed with
+ *        the first round key on every call.
+ */
+void aesBlocksKernelGeneric(AesRoundKeys const & roundKeys,
+                            std::uint8_t const * in,
+                            std::size_t count,
+                            std::uint8_t * out) noexcept;
+
+#if defined(__x86_64__) || defined(__i386__)
+void aesBlocksKernelAesni(AesRoundKeys const & roundKeys,
+                          std::uint8_t const * in,
+                          std::size_t count,
+                          std::uint8_t * out) noexcept;
+#endif
+
+/** \returns whether the host supports AES-NI. */
+bool aesHardwareSupported() noexcept;
+
+/**
+ * \returns the AES-NI kernel if hardwareAes is set and the host supports it,
+ *          and the generic kernel otherwise.
+ */
+AesBlocksKernel aesBlocksKernel(bool hardwareAes) noexcept;
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_AESKERNELS_H */
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/* Compiled with -maes on x86, see CMakeLists.txt. */
+
+#if defined(__x86_64__) || defined(__i386__)
+#ifndef __AES__
+#error This file must be compiled with AES-NI support enabled!
+#endif
+
+#include "AesKernels.h"
+
+#include <wmmintrin.h>
+
+
+namespace sharemind {
+
+namespace {
+
+/** The number of blocks whose encryptions are interleaved in the pipeline. */
+constexpr std::size_t const Chunk = 8u;
+
+template <std::size_t N>
+inline void encrypt(__m128i const (&rk)[11u],
+                    std::uint8_t const * const in,
+                    std::uint8_t * const out) noexcept
+{
+    __m128i x[N];
+    for (std::size_t i = 0u; i < N; ++i)
+        x[i] = _mm_xor_si128(
+                   _mm_loadu_si128(
+                       reinterpret_cast<__m128i const *>(in + i * 16u)),
+                   rk[0u]);
+    for (std::size_t round = 1u; round < 10u; ++round)
+        for (std::size_t i = 0u; i < N; ++i)
+            x[i] = _mm_aesenc_si128(x[i], rk[round]);
+    for (std::size_t i = 0u; i < N; ++i)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 16u),
+                         _mm_aesenclast_si128(x[i], rk[10u]));
+}
+
+} // anonymous namespace
+
+void aesBlocksKernelAesni(AesRoundKeys const & roundKeys,
+                          std::uint8_t const * const in,
+                          std::size_t const count,
+                          std::uint8_t * const out) noexcept
+{
+    __m128i rk[11u];
+    for (std::size_t round = 0u; round < 11u; ++round)
+        rk[round] = _mm_loadu_si128(
+                        reinterpret_cast<__m128i const *>(roundKeys[round]));
+
+    std::size_t i = 0u;
+    for (; i + Chunk <= count; i += Chunk)
+        encrypt<Chunk>(rk, in + i * 16u, out + i * 16u);
+    for (; i < count; ++i)
+        encrypt<1u>(rk, in + i * 16u, out + i * 16u);
+}
+
+} /* namespace sharemind { */
+
+#endif
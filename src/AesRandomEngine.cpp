@@ -25,6 +25,7 @@
 #include <sharemind/PotentiallyVoidTypeInfo.h>
 #include <cryptopp/aes.h>
 #include <cryptopp/modes.h>
+#include "RandomEngineState.h"
 
 
 namespace sharemind {
@@ -45,6 +46,28 @@ constexpr static std::size_t const AES_INTERNAL_BUFFER =
 // This number has been selected to achieve less than 2^{-80} advantage.
 constexpr static std::size_t const AES_COUNTER_LIMIT = (1u << 24u);
 
+constexpr static std::size_t const AES_KEY_SIZE =
+        CryptoPP::AES::DEFAULT_KEYLENGTH;
+
+/* The state consists of the key and the next counter block of the outer
+   generator, the key and the initial counter block of the inner generator,
+   the number of blocks generated by the inner generator and the number of
+   bytes consumed from the current buffer. The buffer itself is recomputed on
+   restore: */
+constexpr static std::size_t const AES_STATE_PAYLOAD_SIZE =
+        2u * (AES_KEY_SIZE + AES_BLOCK_SIZE) + 8u + 4u;
+
+/** \brief Adds n to the given big-endian CTR mode counter block. */
+void addToCounter(std::uint8_t (&counter)[AES_BLOCK_SIZE], std::uint64_t n)
+        noexcept
+{
+    for (std::size_t i = AES_BLOCK_SIZE; i > 0u && n > 0u; --i) {
+        auto const sum = counter[i - 1u] + (n & 0xffu);
+        counter[i - 1u] = static_cast<std::uint8_t>(sum);
+        n = (n >> 8u) + (sum >> 8u);
+    }
+}
+
 struct Inner {
 
     inline Inner(void const * const memptr_) noexcept
@@ -55,17 +78,26 @@ struct Inner {
         using namespace CryptoPP;
 
         auto const key = static_cast<byte const *>(memptr_);
-        m_oPrng.SetKeyWithIV(key,
-                             AES::DEFAULT_KEYLENGTH,
-                             key + AES::DEFAULT_KEYLENGTH,
-                             AES::BLOCKSIZE);
+        std::memcpy(m_outerKey, key, sizeof(m_outerKey));
+        std::memcpy(m_outerCounter,
+                    key + AES::DEFAULT_KEYLENGTH,
+                    sizeof(m_outerCounter));
+        m_oPrng.SetKeyWithIV(m_outerKey,
+                             sizeof(m_outerKey),
+                             m_outerCounter,
+                             sizeof(m_outerCounter));
         aesReseedInner();
     }
 
     ~Inner() noexcept = default;
 
     void aesReseedInner() noexcept;
-    void aesNextBlock() noexcept;
+
+    /** \brief Positions the inner generator after the given block. */
+    void aesSeekInner(std::uint64_t block) noexcept;
+
+    /** \returns whether the inner generator was reseeded. */
+    bool aesNextBlock() noexcept;
 
     CryptoPP::CTR_Mode<CryptoPP::AES>::Encryption m_iPrng;
     CryptoPP::CTR_Mode<CryptoPP::AES>::Encryption m_oPrng;
@@ -76,18 +108,35 @@ struct Inner {
 
     /// buffer of generated randomness
     std::array<std::uint8_t, AES_INTERNAL_BUFFER> m_block;
+
+    /* The keys and counter blocks, kept for saving the state: */
+    std::uint8_t m_outerKey[AES_KEY_SIZE];
+    std::uint8_t m_outerCounter[AES_BLOCK_SIZE];
+    std::uint8_t m_innerKey[AES_KEY_SIZE];
+    std::uint8_t m_innerIv[AES_BLOCK_SIZE];
 };
 
 void Inner::aesReseedInner() noexcept {
-    std::uint8_t key[CryptoPP::AES::DEFAULT_KEYLENGTH];
-    m_oPrng.GenerateBlock(key, sizeof(key));
-    std::uint8_t iv[CryptoPP::AES::BLOCKSIZE];
-    m_oPrng.GenerateBlock(iv, sizeof(iv));
-    m_iPrng.SetKeyWithIV(key, sizeof(key), iv, sizeof(iv));
+    m_oPrng.GenerateBlock(m_innerKey, sizeof(m_innerKey));
+    m_oPrng.GenerateBlock(m_innerIv, sizeof(m_innerIv));
+    addToCounter(m_outerCounter,
+                 (sizeof(m_innerKey) + sizeof(m_innerIv)) / AES_BLOCK_SIZE);
+    aesSeekInner(0u);
 }
 
-void Inner::aesNextBlock() noexcept {
-    if (m_counterInner >= AES_COUNTER_LIMIT) {
+void Inner::aesSeekInner(std::uint64_t const block) noexcept {
+    std::uint8_t counter[AES_BLOCK_SIZE];
+    std::memcpy(counter, m_innerIv, sizeof(counter));
+    addToCounter(counter, block);
+    m_iPrng.SetKeyWithIV(m_innerKey,
+                         sizeof(m_innerKey),
+                         counter,
+                         sizeof(counter));
+}
+
+bool Inner::aesNextBlock() noexcept {
+    bool const reseed = m_counterInner >= AES_COUNTER_LIMIT;
+    if (reseed) {
         aesReseedInner();
         m_counterInner = 0u;
     }
@@ -95,6 +144,7 @@ void Inner::aesNextBlock() noexcept {
     m_iPrng.GenerateBlock(m_block.data(), AES_INTERNAL_BUFFER);
 
     m_counterInner += AES_PARALLEL_BLOCKS;
+    return reseed;
 }
 
 } // namespace anonymous
@@ -110,9 +160,96 @@ AesRandomEngine::~AesRandomEngine() noexcept
 { delete static_cast<Inner *>(m_inner); }
 
 void AesRandomEngine::fillBytes(void * memptr, std::size_t size) noexcept {
+    m_stats.recordRequest(size);
+    m_stats.recordGenerated(size);
     if (size <= 0u)
         return;
     assert(memptr);
+    generate(memptr, size, RandomCopier());
+}
+
+void AesRandomEngine::combineInto(void * memptr,
+                                  std::size_t size,
+                                  RandomCombineOp const op,
+                                  std::size_t const elementSize) noexcept
+{
+    m_stats.recordRequest(size);
+    m_stats.recordGenerated(size);
+    if (size <= 0u)
+        return;
+    assert(memptr);
+    assert(size % elementSize == 0u);
+    RandomCombiner combiner(op, elementSize);
+    generate(memptr, size, combiner);
+    assert(combiner.complete());
+}
+
+std::size_t AesRandomEngine::stateSize() const noexcept
+{ return RandomEngineState::HeaderSize + AES_STATE_PAYLOAD_SIZE; }
+
+void AesRandomEngine::saveState(void * buffer) const {
+    assert(buffer);
+    Inner const & rng = *static_cast<Inner const *>(m_inner);
+    RandomEngineState::Writer w(buffer,
+                                SHAREMIND_RANDOM_AES,
+                                AES_STATE_PAYLOAD_SIZE);
+    w.bytes(rng.m_outerKey, sizeof(rng.m_outerKey));
+    w.bytes(rng.m_outerCounter, sizeof(rng.m_outerCounter));
+    w.bytes(rng.m_innerKey, sizeof(rng.m_innerKey));
+    w.bytes(rng.m_innerIv, sizeof(rng.m_innerIv));
+    w.u64(rng.m_counterInner);
+    w.u32(static_cast<std::uint32_t>(rng.m_blockConsumed));
+}
+
+void AesRandomEngine::restoreState(void const * buffer, std::size_t size) {
+    RandomEngineState::Reader r(buffer,
+                                size,
+                                SHAREMIND_RANDOM_AES,
+                                AES_STATE_PAYLOAD_SIZE);
+    Inner & rng = *static_cast<Inner *>(m_inner);
+    std::uint8_t outerKey[AES_KEY_SIZE];
+    std::uint8_t outerCounter[AES_BLOCK_SIZE];
+    std::uint8_t innerKey[AES_KEY_SIZE];
+    std::uint8_t innerIv[AES_BLOCK_SIZE];
+    r.bytes(outerKey, sizeof(outerKey));
+    r.bytes(outerCounter, sizeof(outerCounter));
+    r.bytes(innerKey, sizeof(innerKey));
+    r.bytes(innerIv, sizeof(innerIv));
+    auto const counterInner = r.u64();
+    auto const blockConsumed = r.u32();
+
+    /* The inner generator produces whole buffers, and if the current buffer
+       is not fully consumed it must have been generated: */
+    if (counterInner % AES_PARALLEL_BLOCKS != 0u
+        || counterInner > AES_COUNTER_LIMIT
+        || blockConsumed > AES_INTERNAL_BUFFER
+        || (blockConsumed < AES_INTERNAL_BUFFER
+            && counterInner < AES_PARALLEL_BLOCKS))
+        throw InvalidStateException();
+
+    std::memcpy(rng.m_outerKey, outerKey, sizeof(outerKey));
+    std::memcpy(rng.m_outerCounter, outerCounter, sizeof(outerCounter));
+    std::memcpy(rng.m_innerKey, innerKey, sizeof(innerKey));
+    std::memcpy(rng.m_innerIv, innerIv, sizeof(innerIv));
+    rng.m_oPrng.SetKeyWithIV(rng.m_outerKey,
+                             sizeof(rng.m_outerKey),
+                             rng.m_outerCounter,
+                             sizeof(rng.m_outerCounter));
+    rng.m_counterInner = counterInner;
+    rng.m_blockConsumed = blockConsumed;
+    if (blockConsumed < AES_INTERNAL_BUFFER) {
+        rng.aesSeekInner(counterInner - AES_PARALLEL_BLOCKS);
+        rng.m_iPrng.GenerateBlock(rng.m_block.data(), AES_INTERNAL_BUFFER);
+    } else {
+        rng.aesSeekInner(counterInner);
+    }
+}
+
+template <typename Output>
+void AesRandomEngine::generate(void * memptr,
+                               std::size_t size,
+                               Output && output) noexcept
+{
 
     Inner & rng = *static_cast<Inner *>(m_inner);
     std::size_t unconsumedSize = AES_INTERNAL_BUFFER - rng.m_blockConsumed;
@@ -122,10 +259,11 @@ void AesRandomEngine::fillBytes(void * memptr, std::size_t size) noexcept {
     /* Consume full blocks (first might already be partially or entirely
        consumed). */
     while (offsetEnd <= size) {
-        std::memcpy(ptrAdd(memptr, offsetStart),
-                    &rng.m_block[rng.m_blockConsumed],
-                    unconsumedSize);
-        rng.aesNextBlock();
+        output(ptrAdd(memptr, offsetStart),
+               &rng.m_block[rng.m_blockConsumed],
+               unconsumedSize);
+        if (rng.aesNextBlock())
+            m_stats.recordInnerReseed();
         rng.m_blockConsumed = 0u;
         unconsumedSize = AES_INTERNAL_BUFFER;
         offsetStart = offsetEnd;
@@ -133,9 +271,9 @@ void AesRandomEngine::fillBytes(void * memptr, std::size_t size) noexcept {
     }
 
     std::size_t const remainingSize = size - offsetStart;
-    std::memcpy(ptrAdd(memptr, offsetStart),
-                &rng.m_block[rng.m_blockConsumed],
-                remainingSize);
+    output(ptrAdd(memptr, offsetStart),
+           &rng.m_block[rng.m_blockConsumed],
+           remainingSize);
     rng.m_blockConsumed += remainingSize;
 
     // the supply may deplete:
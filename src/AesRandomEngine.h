@@ -38,10 +38,30 @@ public: /* Methods: */
 
     void fillBytes(void * buffer, std::size_t size) noexcept override;
 
+    void combineInto(void * buffer,
+                     std::size_t size,
+                     RandomCombineOp op,
+                     std::size_t elementSize) noexcept override;
+
+    std::size_t stateSize() const noexcept override;
+
+    void saveState(void * buffer) const override;
+
+    void restoreState(void const * buffer, std::size_t size) override;
+
     static bool supported() noexcept;
 
     static std::size_t seedSize() noexcept;
 
+private: /* Methods: */
+
+    /**
+     * \brief Generates size bytes of keystream, passing them to
+     *        output(dst, src, n) piece by piece.
+     */
+    template <typename Output>
+    void generate(void * buffer, std::size_t size, Output && output) noexcept;
+
 private: /* Fields: */
 
     void * m_inner;
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "ChaCha20BatchEngine.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sharemind/PotentiallyVoidTypeInfo.h>
+
+
+namespace sharemind {
+
+namespace {
+
+inline std::uint32_t u8to32_little(std::uint8_t const * const p) noexcept {
+    return static_cast<std::uint32_t>(p[0])
+           | (static_cast<std::uint32_t>(p[1]) << 8u)
+           | (static_cast<std::uint32_t>(p[2]) << 16u)
+           | (static_cast<std::uint32_t>(p[3]) << 24u);
+}
+
+} // anonymous namespace
+
+ChaCha20BatchEngine::ChaCha20BatchEngine(void const * const seeds,
+                                         std::size_t const streamCount)
+    : ChaCha20BatchEngine(seeds,
+                          streamCount,
+                          CpuFeatures::instance().level())
+{}
+
+ChaCha20BatchEngine::ChaCha20BatchEngine(void const * const seeds,
+                                         std::size_t const streamCount,
+                                         CpuFeatures::Level const level)
+    : m_kernel(chaCha20BatchKernel(std::min(level,
+                                            CpuFeatures::instance().level())))
+    , m_streamCount(streamCount)
+    , m_stride((streamCount + ChaCha20BatchLanes - 1u)
+               / ChaCha20BatchLanes * ChaCha20BatchLanes)
+    , m_keys(10u * m_stride, 0u)
+    , m_groups(m_stride * GroupSize)
+{
+    assert(seeds || streamCount == 0u);
+    for (std::size_t s = 0u; s < streamCount; ++s) {
+        auto const seed =
+                static_cast<std::uint8_t const *>(ptrAdd(seeds, s * SeedSize));
+        for (std::size_t i = 0u; i < 10u; ++i)
+            m_keys[i * m_stride + s] = u8to32_little(seed + i * 4u);
+    }
+}
+
+void ChaCha20BatchEngine::fillBytes(void * const buffer, std::size_t size)
+        noexcept
+{
+    assert(buffer || size == 0u || m_streamCount == 0u);
+    auto const out = static_cast<std::uint8_t *>(buffer);
+    for (std::size_t offset = 0u; offset < size;) {
+        auto const n = std::min(acquire(), size - offset);
+        for (std::size_t s = 0u; s < m_streamCount; ++s)
+            std::memcpy(out + s * size + offset, span(s), n);
+        consume(n);
+        offset += n;
+    }
+}
+
+void ChaCha20BatchEngine::nextGroups() noexcept {
+    m_kernel(m_keys.data(), m_stride, m_stride, m_counter, m_groups.data());
+    m_counter += 4u;
+    m_consumed = 0u;
+}
+
+} /* namespace sharemind { */
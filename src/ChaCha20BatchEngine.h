@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_CHACHA20BATCHENGINE_H
+#define SHAREMIND_LIBRANDOM_CHACHA20BATCHENGINE_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ChaCha20Kernels.h"
+#include "ChaCha20RandomEngine.h"
+#include "CpuFeatures.h"
+
+
+namespace sharemind {
+
+/**
+ * \brief Many independent ChaCha20 streams advanced together.
+ *
+ * The keys and nonces of the streams are held in structure-of-arrays form, so
+ * that the batch kernel generates a group of four blocks for every stream at
+ * once, one stream per SIMD lane. The stream of every seed is identical to
+ * that of a ChaCha20RandomEngine constructed with the same seed.
+ *
+ * All streams are consumed in lockstep: the output of the current groups is
+ * exposed per stream by span(), and advanced for all streams by consume().
+ */
+class ChaCha20BatchEngine {
+
+public: /* Constants: */
+
+    static constexpr std::size_t SeedSize = ChaCha20RandomEngine::SeedSize;
+
+    /** The number of bytes of every stream generated at a time. */
+    static constexpr std::size_t GroupSize = 256u;
+
+public: /* Methods: */
+
+    /**
+     * \param[in] seeds streamCount seeds of SeedSize bytes each.
+     * \param[in] streamCount the number of streams.
+     */
+    ChaCha20BatchEngine(void const * seeds, std::size_t streamCount);
+
+    /**
+     * \brief Constructs an engine using the batch kernel for the given SIMD
+     *        level, or for the level of the host if that is lower.
+     */
+    ChaCha20BatchEngine(void const * seeds,
+                        std::size_t streamCount,
+                        CpuFeatures::Level level);
+
+    inline std::size_t streamCount() const noexcept { return m_streamCount; }
+
+    /**
+     * \brief Generates the next groups of all streams if the current ones
+     *        have been consumed.
+     * \returns the number of bytes of every stream available through span().
+     */
+    inline std::size_t acquire() noexcept {
+        if (m_consumed >= GroupSize)
+            nextGroups();
+        return GroupSize - m_consumed;
+    }
+
+    /** \returns the acquired bytes of the given stream. */
+    inline std::uint8_t const * span(std::size_t const stream) const noexcept {
+        assert(stream < m_streamCount);
+        assert(m_consumed < GroupSize);
+        return &m_groups[stream * GroupSize + m_consumed];
+    }
+
+    /** \brief Consumes the given number of acquired bytes of every stream. */
+    inline void consume(std::size_t const size) noexcept {
+        assert(size <= GroupSize - m_consumed);
+        m_consumed += size;
+    }
+
+    /**
+     * \brief Fills the next size bytes of every stream into the given buffer,
+     *        those of stream i starting at offset i * size.
+     */
+    void fillBytes(void * buffer, std::size_t size) noexcept;
+
+private: /* Methods: */
+
+    void nextGroups() noexcept;
+
+private: /* Fields: */
+
+    ChaCha20BatchKernel const m_kernel;
+    std::size_t const m_streamCount;
+
+    /** The number of streams rounded up to a multiple of the batch lanes. */
+    std::size_t const m_stride;
+
+    /// The key and nonce words of the streams, see ChaCha20BatchKernel:
+    std::vector<std::uint32_t> m_keys;
+
+    /// The counter of the next groups, shared by all streams:
+    std::uint64_t m_counter = 0u;
+
+    /// The number of bytes consumed from the current group of every stream:
+    std::size_t m_consumed = GroupSize;
+
+    /// The current groups of the streams, including those of padding:
+    std::vector<std::uint8_t> m_groups;
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_CHACHA20BATCHENGINE_H */
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_CHACHA20KERNELIMPL_H
+#define SHAREMIND_LIBRANDOM_CHACHA20KERNELIMPL_H
+
+/* This header is included by the translation units of the kernels, which are
+   compiled for different instruction sets. Hence it must only define entities
+   with internal linkage, i.e. nothing which the linker could pick from a
+   translation unit compiled for an instruction set the host lacks. */
+
+#include <cstddef>
+#include <cstdint>
+#include "ChaCha20Kernels.h"
+
+
+namespace sharemind {
+namespace {
+
+/** \brief Applies the 20 rounds of ChaCha20 to the given state. */
+template <typename V>
+inline void chaCha20Rounds(typename V::Type (&x)[16u]) noexcept {
+    #define SHAREMIND_CHACHA20_QUARTERROUND(a,b,c,d) \
+        do { \
+            x[a] = V::add(x[a], x[b]); \
+            x[d] = V::template rotl<16>(V::bxor(x[d], x[a])); \
+            x[c] = V::add(x[c], x[d]); \
+            x[b] = V::template rotl<12>(V::bxor(x[b], x[c])); \
+            x[a] = V::add(x[a], x[b]); \
+            x[d] = V::template rotl<8>(V::bxor(x[d], x[a])); \
+            x[c] = V::add(x[c], x[d]); \
+            x[b] = V::template rotl<7>(V::bxor(x[b], x[c])); \
+        } while (false)
+    for (std::size_t i = 0u; i < 10u; ++i) {
+        SHAREMIND_CHACHA20_QUARTERROUND(0, 4,  8, 12);
+        SHAREMIND_CHACHA20_QUARTERROUND(1, 5,  9, 13);
+        SHAREMIND_CHACHA20_QUARTERROUND(2, 6, 10, 14);
+        SHAREMIND_CHACHA20_QUARTERROUND(3, 7, 11, 15);
+        SHAREMIND_CHACHA20_QUARTERROUND(0, 5, 10, 15);
+        SHAREMIND_CHACHA20_QUARTERROUND(1, 6, 11, 12);
+        SHAREMIND_CHACHA20_QUARTERROUND(2, 7,  8, 13);
+        SHAREMIND_CHACHA20_QUARTERROUND(3, 4,  9, 14);
+    }
+    #undef SHAREMIND_CHACHA20_QUARTERROUND
+}
+
+/**
+   \brief Generates ChaCha20KernelBlocks blocks using the given vector type,
+          which provides V::Lanes 32-bit lanes, i.e. V::Lanes / 4 groups of
+          four blocks, and the operations below.
+*/
+template <typename V>
+inline void chaCha20Blocks(std::uint32_t * const state,
+                           std::uint8_t * out) noexcept
+{
+    using T = typename V::Type;
+    constexpr std::size_t const groups = V::Lanes / 4u;
+    static_assert(ChaCha20KernelBlocks % V::Lanes == 0u, "");
+
+    std::uint64_t counter = (static_cast<std::uint64_t>(state[13]) << 32u)
+                            | state[12];
+    for (std::size_t b = 0u; b < ChaCha20KernelBlocks; b += V::Lanes) {
+        T x0[16u];
+        for (std::size_t i = 0u; i < 16u; ++i)
+            x0[i] = V::set1(state[i]);
+        std::uint32_t low[V::Lanes];
+        std::uint32_t high[V::Lanes];
+        for (std::size_t l = 0u; l < V::Lanes; ++l) {
+            auto const c = counter + l;
+            low[l] = static_cast<std::uint32_t>(c);
+            high[l] = static_cast<std::uint32_t>(c >> 32u);
+        }
+        x0[12u] = V::load(low);
+        x0[13u] = V::load(high);
+
+        T x[16u];
+        for (std::size_t i = 0u; i < 16u; ++i)
+            x[i] = x0[i];
+
+        chaCha20Rounds<V>(x);
+
+        for (std::size_t i = 0u; i < 16u; ++i)
+            V::store(out + i * 16u, V::add(x[i], x0[i]));
+        out += groups * 256u;
+        counter += V::Lanes;
+    }
+    state[12] = static_cast<std::uint32_t>(counter);
+    state[13] = static_cast<std::uint32_t>(counter >> 32u);
+}
+
+/**
+   \brief Generates a group of four blocks for each of count independent
+          cipher states, one state per vector lane, using the given vector
+          type, which must also provide storeTransposed().
+*/
+template <typename V>
+inline void chaCha20BatchBlocks(std::uint32_t const * const keys,
+                                std::size_t const stride,
+                                std::size_t const count,
+                                std::uint64_t const counter,
+                                std::uint8_t * const out) noexcept
+{
+    using T = typename V::Type;
+    static_assert(ChaCha20BatchLanes % V::Lanes == 0u, "");
+
+    for (std::size_t base = 0u; base < count; base += V::Lanes) {
+        T x0[16u];
+        x0[0u] = V::set1(0x61707865u);
+        x0[1u] = V::set1(0x3320646eu);
+        x0[2u] = V::set1(0x79622d32u);
+        x0[3u] = V::set1(0x6b206574u);
+        for (std::size_t i = 0u; i < 8u; ++i)
+            x0[4u + i] = V::load(keys + i * stride + base);
+        x0[14u] = V::load(keys + 8u * stride + base);
+        x0[15u] = V::load(keys + 9u * stride + base);
+
+        T result[4u][16u];
+        for (std::size_t block = 0u; block < 4u; ++block) {
+            auto const c = counter + block;
+            x0[12u] = V::set1(static_cast<std::uint32_t>(c));
+            x0[13u] = V::set1(static_cast<std::uint32_t>(c >> 32u));
+
+            T x[16u];
+            for (std::size_t i = 0u; i < 16u; ++i)
+                x[i] = x0[i];
+
+            chaCha20Rounds<V>(x);
+
+            for (std::size_t i = 0u; i < 16u; ++i)
+                result[block][i] = V::add(x[i], x0[i]);
+        }
+
+        /* Word i of the group of a state holds word i of its four blocks,
+           hence the results are stored transposed: */
+        for (std::size_t i = 0u; i < 16u; ++i)
+            V::storeTransposed(out + base * 256u + i * 16u,
+                               256u,
+                               result[0u][i],
+                               result[1u][i],
+                               result[2u][i],
+                               result[3u][i]);
+    }
+}
+
+/**
+   \brief Generates the block with each of the count given counters of the
+          given cipher state, one counter per vector lane, using the given
+          vector type. The blocks are not interleaved.
+*/
+template <typename V>
+inline void chaCha20PrfBlocks(std::uint32_t const * const state,
+                              std::uint64_t const * const counters,
+                              std::size_t const count,
+                              std::uint8_t * const out) noexcept
+{
+    using T = typename V::Type;
+    static_assert(ChaCha20BatchLanes % V::Lanes == 0u, "");
+
+    for (std::size_t base = 0u; base < count; base += V::Lanes) {
+        T x0[16u];
+        for (std::size_t i = 0u; i < 16u; ++i)
+            x0[i] = V::set1(state[i]);
+        std::uint32_t low[V::Lanes];
+        std::uint32_t high[V::Lanes];
+        for (std::size_t l = 0u; l < V::Lanes; ++l) {
+            low[l] = static_cast<std::uint32_t>(counters[base + l]);
+            high[l] = static_cast<std::uint32_t>(counters[base + l] >> 32u);
+        }
+        x0[12u] = V::load(low);
+        x0[13u] = V::load(high);
+
+        T x[16u];
+        for (std::size_t i = 0u; i < 16u; ++i)
+            x[i] = x0[i];
+        chaCha20Rounds<V>(x);
+
+        for (std::size_t i = 0u; i < 16u; i += 4u)
+            V::storeTransposed(out + base * 64u + i * 4u,
+                               64u,
+                               V::add(x[i], x0[i]),
+                               V::add(x[i + 1u], x0[i + 1u]),
+                               V::add(x[i + 2u], x0[i + 2u]),
+                               V::add(x[i + 3u], x0[i + 3u]));
+    }
+}
+
+} // anonymous namespace
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_CHACHA20KERNELIMPL_H */
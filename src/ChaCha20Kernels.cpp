@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "ChaCha20Kernels.h"
+
+#include <cstring>
+#include "ChaCha20KernelImpl.h"
+
+
+namespace sharemind {
+
+namespace {
+
+struct GenericVector {
+
+    struct Type { std::uint32_t v[4u]; };
+
+    static constexpr std::size_t Lanes = 4u;
+
+    static inline Type set1(std::uint32_t const x) noexcept
+    { return Type{{x, x, x, x}}; }
+
+    static inline Type load(std::uint32_t const * const p) noexcept
+    { return Type{{p[0u], p[1u], p[2u], p[3u]}}; }
+
+    static inline Type add(Type a, Type const & b) noexcept {
+        for (std::size_t i = 0u; i < 4u; ++i)
+            a.v[i] += b.v[i];
+        return a;
+    }
+
+    static inline Type bxor(Type a, Type const & b) noexcept {
+        for (std::size_t i = 0u; i < 4u; ++i)
+            a.v[i] ^= b.v[i];
+        return a;
+    }
+
+    template <unsigned N>
+    static inline Type rotl(Type a) noexcept {
+        for (std::size_t i = 0u; i < 4u; ++i)
+            a.v[i] = (a.v[i] << N) | (a.v[i] >> (32u - N));
+        return a;
+    }
+
+    static inline void store(std::uint8_t * const p, Type const & a) noexcept
+    { std::memcpy(p, a.v, sizeof(a.v)); }
+
+    /** Stores lane l of a0, a1, a2 and a3 consecutively at p + l * stride. */
+    static inline void storeTransposed(std::uint8_t * const p,
+                                       std::size_t const stride,
+                                       Type const & a0,
+                                       Type const & a1,
+                                       Type const & a2,
+                                       Type const & a3) noexcept
+    {
+        for (std::size_t l = 0u; l < 4u; ++l) {
+            std::uint32_t const words[4u] = {
+                a0.v[l], a1.v[l], a2.v[l], a3.v[l] };
+            std::memcpy(p + l * stride, words, sizeof(words));
+        }
+    }
+
+};
+
+} // anonymous namespace
+
+void chaCha20KernelGeneric(std::uint32_t * const state,
+                           std::uint8_t * const out) noexcept
+{ chaCha20Blocks<GenericVector>(state, out); }
+
+void chaCha20BatchKernelGeneric(std::uint32_t const * const keys,
+                                std::size_t const stride,
+                                std::size_t const count,
+                                std::uint64_t const counter,
+                                std::uint8_t * const out) noexcept
+{ chaCha20BatchBlocks<GenericVector>(keys, stride, count, counter, out); }
+
+void chaCha20PrfKernelGeneric(std::uint32_t const * const state,
+                              std::uint64_t const * const counters,
+                              std::size_t const count,
+                              std::uint8_t * const out) noexcept
+{ chaCha20PrfBlocks<GenericVector>(state, counters, count, out); }
+
+ChaCha20Kernel chaCha20Kernel(CpuFeatures::Level const level) noexcept {
+    using L = CpuFeatures::Level;
+    #if defined(__x86_64__) || defined(__i386__)
+    switch (level) {
+    case L::Avx512:  return &chaCha20KernelAvx512;
+    case L::Avx2:    return &chaCha20KernelAvx2;
+    case L::Ssse3:   return &chaCha20KernelSsse3;
+    case L::Sse2:    return &chaCha20KernelSse2;
+    case L::Generic: break;
+    }
+    #else
+    (void) level;
+    #endif
+    return &chaCha20KernelGeneric;
+}
+
+ChaCha20BatchKernel chaCha20BatchKernel(CpuFeatures::Level const level)
+        noexcept
+{
+    using L = CpuFeatures::Level;
+    #if defined(__x86_64__) || defined(__i386__)
+    switch (level) {
+    case L::Avx512:  return &chaCha20BatchKernelAvx512;
+    case L::Avx2:    return &chaCha20BatchKernelAvx2;
+    case L::Ssse3:   return &chaCha20BatchKernelSsse3;
+    case L::Sse2:    return &chaCha20BatchKernelSse2;
+    case L::Generic: break;
+    }
+    #else
+    (void) level;
+    #endif
+    return &chaCha20BatchKernelGeneric;
+}
+
+ChaCha20PrfKernel chaCha20PrfKernel(CpuFeatures::Level const level)
+        noexcept
+{
+    using L = CpuFeatures::Level;
+    #if defined(__x86_64__) || defined(__i386__)
+    switch (level) {
+    case L::Avx512:  return &chaCha20PrfKernelAvx512;
+    case L::Avx2:    return &chaCha20PrfKernelAvx2;
+    case L::Ssse3:   return &chaCha20PrfKernelSsse3;
+    case L::Sse2:    return &chaCha20PrfKernelSse2;
+    case L::Generic: break;
+    }
+    #else
+    (void) level;
+    #endif
+    return &chaCha20PrfKernelGeneric;
+}
+
+} /* namespace sharemind { */
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_CHACHA20KERNELS_H
+#define SHAREMIND_LIBRANDOM_CHACHA20KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "CpuFeatures.h"
+
+
+namespace sharemind {
+
+/** The number of ChaCha20 blocks generated by a kernel at a time. */
+constexpr std::size_t const ChaCha20KernelBlocks = 16u;
+
+/**
+ * \brief Generates ChaCha20KernelBlocks blocks of keystream from the given
+ *        cipher state and advances the 64-bit counter in words 12 and 13 of
+ *        the state accordingly.
+ *
+ * The blocks are generated in groups of four consecutive blocks, the 32-bit
+ * words of which are interleaved, i.e. the output of a group is word 0 of its
+ * four blocks, followed by word 1 of its four blocks, and so on. Hence all
+ * kernels produce the same output regardless of their vector width.
+ *
+ * \pre The counter in the state is a multiple of four.
+ */
+using ChaCha20Kernel = void (*)(std::uint32_t * state, std::uint8_t * out);
+
+void chaCha20KernelGeneric(std::uint32_t * state, std::uint8_t * out)
+        noexcept;
+
+#if defined(__x86_64__) || defined(__i386__)
+void chaCha20KernelSse2(std::uint32_t * state, std::uint8_t * out) noexcept;
+void chaCha20KernelSsse3(std::uint32_t * state, std::uint8_t * out) noexcept;
+void chaCha20KernelAvx2(std::uint32_t * state, std::uint8_t * out) noexcept;
+void chaCha20KernelAvx512(std::uint32_t * state, std::uint8_t * out)
+        noexcept;
+#endif
+
+/** \returns the fastest kernel usable at the given SIMD level. */
+ChaCha20Kernel chaCha20Kernel(CpuFeatures::Level level) noexcept;
+
+/** The granularity of the number of states of the batch kernels. */
+constexpr std::size_t const ChaCha20BatchLanes = 16u;
+
+/**
+ * \brief Generates a group of four blocks of keystream, starting with the
+ *        given counter, for each of count independent cipher states, in the
+ *        layout of ChaCha20Kernel. The groups are written consecutively.
+ *
+ * The states are given in structure-of-arrays form: keys holds ten arrays of
+ * stride words each, for the eight key words and the two nonce words of the
+ * states in this order.
+ *
+ * \pre count is a multiple of ChaCha20BatchLanes and at most stride.
+ * \pre The counter is a multiple of four.
+ */
+using ChaCha20BatchKernel = void (*)(std::uint32_t const * keys,
+                                     std::size_t stride,
+                                     std::size_t count,
+                                     std::uint64_t counter,
+                                     std::uint8_t * out);
+
+void chaCha20BatchKernelGeneric(std::uint32_t const * keys,
+                                std::size_t stride,
+                                std::size_t count,
+                                std::uint64_t counter,
+                                std::uint8_t * out) noexcept;
+
+#if defined(__x86_64__) || defined(__i386__)
+void chaCha20BatchKernelSse2(std::uint32_t const * keys,
+                             std::size_t stride,
+                             std::size_t count,
+                             std::uint64_t counter,
+                             std::uint8_t * out) noexcept;
+void chaCha20BatchKernelSsse3(std::uint32_t const * keys,
+                              std::size_t stride,
+                              std::size_t count,
+                              std::uint64_t counter,
+                              std::uint8_t * out) noexcept;
+void chaCha20BatchKernelAvx2(std::uint32_t const * keys,
+                             std::size_t stride,
+                             std::size_t count,
+                             std::uint64_t counter,
+                             std::uint8_t * out) noexcept;
+void chaCha20BatchKernelAvx512(std::uint32_t const * keys,
+                               std::size_t stride,
+                               std::size_t count,
+                               std::uint64_t counter,
+                               std::uint8_t * out) noexcept;
+#endif
+
+/** \returns the fastest batch kernel usable at the given SIMD level. */
+ChaCha20BatchKernel chaCha20BatchKernel(CpuFeatures::Level level) noexcept;
+
+/**
+ * \brief Generates the block of the given cipher state with each of the count
+ *        given counters, ignoring words 12 and 13 of the state. The blocks
+ *        are written consecutively and are not interleaved, i.e. every block
+ *        is its 16 words in order.
+ *
+ * \pre count is a multiple of ChaCha20BatchLanes.
+ */
+using ChaCha20PrfKernel = void (*)(std::uint32_t const * state,
+                                   std::uint64_t const * counters,
+                                   std::size_t count,
+                                   std::uint8_t * out);
+
+void chaCha20PrfKernelGeneric(std::uint32_t const * state,
+                              std::uint64_t const * counters,
+                              std::size_t count,
+                              std::uint8_t * out) noexcept;
+
+#if defined(__x86_64__) || defined(__i386__)
+void chaCha20PrfKernelSse2(std::uint32_t const * state,
+                           std::uint64_t const * counters,
+                           std::size_t count,
+                           std::uint8_t * out) noexcept;
+void chaCha20PrfKernelSsse3(std::uint32_t const * state,
+                            std::uint64_t const * counters,
+                            std::size_t count,
+                            std::uint8_t * out) noexcept;
+void chaCha20PrfKernelAvx2(std::uint32_t const * state,
+                           std::uint64_t const * counters,
+                           std::size_t count,
+                           std::uint8_t * out) noexcept;
+void chaCha20PrfKernelAvx512(std::uint32_t const * state,
+                             std::uint64_t const * counters,
+                             std::size_t count,
+                             std::uint8_t * out) noexcept;
+#endif
+
+/** \returns the fastest PRF kernel usable at the given SIMD level. */
+ChaCha20PrfKernel chaCha20PrfKernel(CpuFeatures::Level level) noexcept;
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_CHACHA20KERNELS_H */
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/* Compiled with -mavx2 on x86, see CMakeLists.txt. */
+
+#if defined(__x86_64__) || defined(__i386__)
+#ifndef __AVX2__
+#error This file must be compiled with AVX2 support enabled!
+#endif
+
+#include "ChaCha20Kernels.h"
+
+#include <immintrin.h>
+#include "ChaCha20KernelImpl.h"
+
+
+namespace sharemind {
+
+namespace {
+
+/** Every vector holds the lanes of two groups of four blocks. */
+struct Avx2Vector {
+
+    using Type = __m256i;
+
+    static constexpr std::size_t Lanes = 8u;
+
+    static inline Type set1(std::uint32_t const x) noexcept
+    { return _mm256_set1_epi32(static_cast<int>(x)); }
+
+    static inline Type load(std::uint32_t const * const p) noexcept
+    { return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)); }
+
+    static inline Type add(Type const a, Type const b) noexcept
+    { return _mm256_add_epi32(a, b); }
+
+    static inline Type bxor(Type const a, Type const b) noexcept
+    { return _mm256_xor_si256(a, b); }
+
+    template <unsigned N>
+    static inline Type rotl(Type const a) noexcept {
+        return _mm256_or_si256(_mm256_slli_epi32(a, N),
+                               _mm256_srli_epi32(a, 32u - N));
+    }
+
+    static inline void store(std::uint8_t * const p, Type const a) noexcept {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p),
+                         _mm256_castsi256_si128(a));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 256u),
+                         _mm256_extracti128_si256(a, 1));
+    }
+
+    /** Stores lane l of a0, a1, a2 and a3 consecutively at p + l * stride. */
+    static inline void storeTransposed(std::uint8_t * const p,
+                                       std::size_t const stride,
+                                       Type const a0,
+                                       Type const a1,
+                                       Type const a2,
+                                       Type const a3) noexcept
+    {
+        // Transpose within both 128-bit halves:
+        auto const t0 = _mm256_unpacklo_epi32(a0, a1);
+        auto const t1 = _mm256_unpacklo_epi32(a2, a3);
+        auto const t2 = _mm256_unpackhi_epi32(a0, a1);
+        auto const t3 = _mm256_unpackhi_epi32(a2, a3);
+        Type const r[4u] = { _mm256_unpacklo_epi64(t0, t1),
+                             _mm256_unpackhi_epi64(t0, t1),
+                             _mm256_unpacklo_epi64(t2, t3),
+                             _mm256_unpackhi_epi64(t2, t3) };
+        for (std::size_t l = 0u; l < 4u; ++l) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(p + l * stride),
+                             _mm256_castsi256_si128(r[l]));
+            _mm_storeu_si128(
+                    reinterpret_cast<__m128i *>(p + (l + 4u) * stride),
+                    _mm256_extracti128_si256(r[l], 1));
+        }
+    }
+
+};
+
+/* Rotations by whole bytes are byte shuffles: */
+
+template <>
+inline Avx2Vector::Type Avx2Vector::rotl<16u>(Type const a) noexcept {
+    return _mm256_shuffle_epi8(
+                a,
+                _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10,
+                                5, 4, 7, 6, 1, 0, 3, 2,
+                                13, 12, 15, 14, 9, 8, 11, 10,
+                                5, 4, 7, 6, 1, 0, 3, 2));
+}
+
+template <>
+inline Avx2Vector::Type Avx2Vector::rotl<8u>(Type const a) noexcept {
+    return _mm256_shuffle_epi8(
+                a,
+                _mm256_set_epi8(14, 13, 12, 15, 10, 9, 8, 11,
+                                6, 5, 4, 7, 2, 1, 0, 3,
+                                14, 13, 12, 15, 10, 9, 8, 11,
+                                6, 5, 4, 7, 2, 1, 0, 3));
+}
+
+} // anonymous namespace
+
+void chaCha20KernelAvx2(std::uint32_t * const state,
+                        std::uint8_t * const out) noexcept
+{ chaCha20Blocks<Avx2Vector>(state, out); }
+
+void chaCha20BatchKernelAvx2(std::uint32_t const * const keys,
+                             std::size_t const stride,
+                             std::size_t const count,
+                             std::uint64_t const counter,
+                             std::uint8_t * const out) noexcept
+{ chaCha20BatchBlocks<Avx2Vector>(keys, stride, count, counter, out); }
+
+void chaCha20PrfKernelAvx2(std::uint32_t const * const state,
+                           std::uint64_t const * const counters,
+                           std::size_t const count,
+                           std::uint8_t * const out) noexcept
+{ chaCha20PrfBlocks<Avx2Vector>(state, counters, count, out); }
+
+} /* namespace sharemind { */
+
+#endif
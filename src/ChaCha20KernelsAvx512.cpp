@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/* Compiled with -mavx512f on x86, see CMakeLists.txt. */
+
+#if defined(__x86_64__) || defined(__i386__)
+#ifndef __AVX512F__
+#error This file must be compiled with AVX-512F support enabled!
+#endif
+
+#include "ChaCha20Kernels.h"
+
+#include <immintrin.h>
+#include "ChaCha20KernelImpl.h"
+
+
+namespace sharemind {
+
+namespace {
+
+/** Every vector holds the lanes of four groups of four blocks. */
+struct Avx512Vector {
+
+    using Type = __m512i;
+
+    static constexpr std::size_t Lanes = 16u;
+
+    static inline Type set1(std::uint32_t const x) noexcept
+    { return _mm512_set1_epi32(static_cast<int>(x)); }
+
+    static inline Type load(std::uint32_t const * const p) noexcept
+    { return _mm512_loadu_si512(p); }
+
+    static inline Type add(Type const a, Type const b) noexcept
+    { return _mm512_add_epi32(a, b); }
+
+    static inline Type bxor(Type const a, Type const b) noexcept
+    { return _mm512_xor_si512(a, b); }
+
+    /* The masked forms are used below, because the unmasked ones trigger
+       spurious -Wuninitialized warnings in the headers of some GCC versions:
+    */
+
+    template <unsigned N>
+    static inline Type rotl(Type const a) noexcept
+    { return _mm512_mask_rol_epi32(a, 0xffff, a, N); }
+
+    template <int I>
+    static inline __m128i extract(Type const a) noexcept
+    { return _mm512_mask_extracti32x4_epi32(_mm_setzero_si128(), 0xf, a, I); }
+
+    static inline void store(std::uint8_t * const p, Type const a) noexcept {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), extract<0>(a));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 256u), extract<1>(a));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 512u), extract<2>(a));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 768u), extract<3>(a));
+    }
+
+    /** Stores lane l of a0, a1, a2 and a3 consecutively at p + l * stride. */
+    static inline void storeTransposed(std::uint8_t * const p,
+                                       std::size_t const stride,
+                                       Type const a0,
+                                       Type const a1,
+                                       Type const a2,
+                                       Type const a3) noexcept
+    {
+        /* Transpose within all four 128-bit quarters. The masked forms avoid
+           spurious warnings about an uninitialized passthrough operand: */
+        auto const t0 = _mm512_mask_unpacklo_epi32(a0, 0xffff, a0, a1);
+        auto const t1 = _mm512_mask_unpacklo_epi32(a2, 0xffff, a2, a3);
+        auto const t2 = _mm512_mask_unpackhi_epi32(a0, 0xffff, a0, a1);
+        auto const t3 = _mm512_mask_unpackhi_epi32(a2, 0xffff, a2, a3);
+        Type const r[4u] = { _mm512_mask_unpacklo_epi64(t0, 0xff, t0, t1),
+                             _mm512_mask_unpackhi_epi64(t0, 0xff, t0, t1),
+                             _mm512_mask_unpacklo_epi64(t2, 0xff, t2, t3),
+                             _mm512_mask_unpackhi_epi64(t2, 0xff, t2, t3) };
+        for (std::size_t l = 0u; l < 4u; ++l) {
+            auto const q = p + l * stride;
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(q), extract<0>(r[l]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(q + 4u * stride),
+                             extract<1>(r[l]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(q + 8u * stride),
+                             extract<2>(r[l]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(q + 12u * stride),
+                             extract<3>(r[l]));
+        }
+    }
+
+};
+
+} // anonymous namespace
+
+void chaCha20KernelAvx512(std::uint32_t * const state,
+                          std::uint8_t * const out) noexcept
+{ chaCha20Blocks<Avx512Vector>(state, out); }
+
+void chaCha20BatchKernelAvx512(std::uint32_t const * const keys,
+                               std::size_t const stride,
+                               std::size_t const count,
+                               std::uint64_t const counter,
+                               std::uint8_t * const out) noexcept
+{ chaCha20BatchBlocks<Avx512Vector>(keys, stride, count, counter, out); }
+
+void chaCha20PrfKernelAvx512(std::uint32_t const * const state,
+                             std::uint64_t const * const counters,
+                             std::size_t const count,
+                             std::uint8_t * const out) noexcept
+{ chaCha20PrfBlocks<Avx512Vector>(state, counters, count, out); }
+
+} /* namespace sharemind { */
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/* Compiled with -mssse3 on x86, see CMakeLists.txt. */
+
+#if defined(__x86_64__) || defined(__i386__)
+#ifndef __SSSE3__
+#error This file must be compiled with SSSE3 support enabled!
+#endif
+
+#include "ChaCha20Kernels.h"
+
+#include <tmmintrin.h>
+#include "ChaCha20KernelImpl.h"
+
+
+namespace sharemind {
+
+namespace {
+
+struct Ssse3Vector {
+
+    using Type = __m128i;
+
+    static constexpr std::size_t Lanes = 4u;
+
+    static inline Type set1(std::uint32_t const x) noexcept
+    { return _mm_set1_epi32(static_cast<int>(x)); }
+
+    static inline Type load(std::uint32_t const * const p) noexcept
+    { return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p)); }
+
+    static inline Type add(Type const a, Type const b) noexcept
+    { return _mm_add_epi32(a, b); }
+
+    static inline Type bxor(Type const a, Type const b) noexcept
+    { return _mm_xor_si128(a, b); }
+
+    template <unsigned N>
+    static inline Type rotl(Type const a) noexcept
+    { return _mm_or_si128(_mm_slli_epi32(a, N), _mm_srli_epi32(a, 32u - N)); }
+
+    static inline void store(std::uint8_t * const p, Type const a) noexcept
+    { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), a); }
+
+    /** Stores lane l of a0, a1, a2 and a3 consecutively at p + l * stride. */
+    static inline void storeTransposed(std::uint8_t * const p,
+                                       std::size_t const stride,
+                                       Type const a0,
+                                       Type const a1,
+                                       Type const a2,
+                                       Type const a3) noexcept
+    {
+        auto const t0 = _mm_unpacklo_epi32(a0, a1);
+        auto const t1 = _mm_unpacklo_epi32(a2, a3);
+        auto const t2 = _mm_unpackhi_epi32(a0, a1);
+        auto const t3 = _mm_unpackhi_epi32(a2, a3);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p),
+                         _mm_unpacklo_epi64(t0, t1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + stride),
+                         _mm_unpackhi_epi64(t0, t1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 2u * stride),
+                         _mm_unpacklo_epi64(t2, t3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 3u * stride),
+                         _mm_unpackhi_epi64(t2, t3));
+    }
+
+};
+
+/* Rotations by whole bytes are byte shuffles: */
+
+template <>
+inline Ssse3Vector::Type Ssse3Vector::rotl<16u>(Type const a) noexcept {
+    return _mm_shuffle_epi8(a, _mm_set_epi8(13, 12, 15, 14, 9, 8, 11, 10,
+                                            5, 4, 7, 6, 1, 0, 3, 2));
+}
+
+template <>
+inline Ssse3Vector::Type Ssse3Vector::rotl<8u>(Type const a) noexcept {
+    return _mm_shuffle_epi8(a, _mm_set_epi8(14, 13, 12, 15, 10, 9, 8, 11,
+                                            6, 5, 4, 7, 2, 1, 0, 3));
+}
+
+} // anonymous namespace
+
+void chaCha20KernelSsse3(std::uint32_t * const state,
+                         std::uint8_t * const out) noexcept
+{ chaCha20Blocks<Ssse3Vector>(state, out); }
+
+void chaCha20BatchKernelSsse3(std::uint32_t const * const keys,
+                              std::size_t const stride,
+                              std::size_t const count,
+                              std::uint64_t const counter,
+                              std::uint8_t * const out) noexcept
+{ chaCha20BatchBlocks<Ssse3Vector>(keys, stride, count, counter, out); }
+
+void chaCha20PrfKernelSsse3(std::uint32_t const * const state,
+                            std::uint64_t const * const counters,
+                            std::size_t const count,
+                            std::uint8_t * const out) noexcept
+{ chaCha20PrfBlocks<Ssse3Vector>(state, counters, count, out); }
+
+} /* namespace sharemind { */
+
+#endif
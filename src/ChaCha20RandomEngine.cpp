@@ -32,89 +32,38 @@
  *    with counter = 0. We do this to avoid transposing data and instead use a
  *    single memcpy. After 4x16 32-bit values have been generated the counter
  *    is incremented by 4.
+ *
+ * The blocks are generated ChaCha20KernelBlocks at a time by the fastest
+ * kernel for the host (see ChaCha20Kernels.h), which is selected when the
+ * engine is constructed.
  */
 
 #include "ChaCha20RandomEngine.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <sharemind/PotentiallyVoidTypeInfo.h>
+#include "ChaCha20Kernels.h"
+#include "CpuFeatures.h"
+#include "RandomEngineState.h"
 #ifdef SHAREMIND_LIBRANDOM_HAVE_VALGRIND
 #include <valgrind/memcheck.h>
 #endif
 
-#if SHAREMIND_HAVE_EMMINTRIN_SSE2
-#include <emmintrin.h>
-#endif
 
 namespace sharemind {
 
 namespace /* anonymous */ {
 
-#if SHAREMIND_HAVE_EMMINTRIN_SSE2
-using v4_u32_t = __m128i;
-
-inline
-v4_u32_t v4_set(uint32_t x, uint32_t y, uint32_t z, uint32_t w) noexcept {
-    return _mm_set_epi32(w, z, y, x);
-}
-
-inline v4_u32_t v4_set1(const uint32_t x) noexcept {
-    return _mm_set1_epi32(x);
-}
-
-inline void v4_rotl (v4_u32_t& v, const uint32_t n) noexcept {
-    const uint32_t m = sizeof(uint32_t) * 8u - n;
-    v = _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, m));
-}
-
-inline void v4_add(v4_u32_t& v, const v4_u32_t& u) noexcept {
-    v = _mm_add_epi32(v, u);
-}
-
-inline void v4_xor(v4_u32_t& v, const v4_u32_t& u) noexcept {
-    v = _mm_xor_si128(v, u);
-}
-
-#else
-
-#warning Using ~4x as slow ChaCha20 due to missing SSE2 support.
-
-struct v4_u32_t { uint32_t v0, v1, v2, v3; };
-
-inline
-v4_u32_t v4_set(uint32_t x, uint32_t y, uint32_t z, uint32_t w) noexcept {
-    return v4_u32_t {x, y, z, w};
-}
-
-inline v4_u32_t v4_set1(const uint32_t x) noexcept {
-    return v4_u32_t {x, x, x, x};
-}
-
-inline void v4_rotl (v4_u32_t& v, const uint32_t n) noexcept {
-    const uint32_t m = sizeof(uint32_t) * 8u - n;
-    v.v0 = (v.v0 << n) | (v.v0 >> m);
-    v.v1 = (v.v1 << n) | (v.v1 >> m);
-    v.v2 = (v.v2 << n) | (v.v2 >> m);
-    v.v3 = (v.v3 << n) | (v.v3 >> m);
-}
-
-inline void v4_add(v4_u32_t& v, const v4_u32_t& u) noexcept {
-    v.v0 += u.v0; v.v1 += u.v1; v.v2 += u.v2; v.v3 += u.v3;
-}
-
-inline void v4_xor(v4_u32_t& v, const v4_u32_t& u) noexcept {
-    v.v0 ^= u.v0; v.v1 ^= u.v1; v.v2 ^= u.v2; v.v3 ^= u.v3;
-}
-
-#endif
-
-static_assert(sizeof(v4_u32_t) == 4*sizeof(uint32_t),
-              "Incorrect size of v4_u32_t");
-
 static_assert(sizeof(uint32_t) <= sizeof(size_t),
               "uint32_t bigger than size_t.");
 
+/* The state is saved with the current position in a group of four blocks: */
+constexpr static size_t const STATE_GROUP_BLOCKS = 4u;
+constexpr static size_t const STATE_GROUP_SIZE = STATE_GROUP_BLOCKS * 64u;
+constexpr static size_t const STATE_PAYLOAD_SIZE = 12u * 4u + 4u;
+
 inline uint32_t u8to32_little (const uint8_t* p) noexcept {
     const uint32_t p0 = p[0];
     const uint32_t p1 = p[1];
@@ -125,7 +74,16 @@ inline uint32_t u8to32_little (const uint8_t* p) noexcept {
 
 } // namespace anonymous
 
-ChaCha20RandomEngine::ChaCha20RandomEngine(void const * seed) noexcept {
+ChaCha20RandomEngine::ChaCha20RandomEngine(void const * seed) noexcept
+    : ChaCha20RandomEngine(seed, CpuFeatures::instance().level())
+{}
+
+ChaCha20RandomEngine::ChaCha20RandomEngine(void const * seed,
+                                           CpuFeatures::Level const level)
+        noexcept
+    : m_kernel(chaCha20Kernel(std::min(level,
+                                       CpuFeatures::instance().level())))
+{
     assert(seed);
     #ifdef SHAREMIND_LIBRANDOM_HAVE_VALGRIND
     VALGRIND_MAKE_MEM_DEFINED(this, sizeof(ChaCha20RandomEngine));
@@ -154,74 +112,112 @@ ChaCha20RandomEngine::ChaCha20RandomEngine(void const * seed) noexcept {
     m_state[15] = u8to32_little(nonce + 4);
 }
 
-#define QUARTERROUND(a,b,c,d) \
-    do { \
-        v4_add(x[a], x[b]); v4_xor(x[d], x[a]); v4_rotl(x[d], 16); \
-        v4_add(x[c], x[d]); v4_xor(x[b], x[c]); v4_rotl(x[b], 12); \
-        v4_add(x[a], x[b]); v4_xor(x[d], x[a]); v4_rotl(x[d],  8); \
-        v4_add(x[c], x[d]); v4_xor(x[b], x[c]); v4_rotl(x[b],  7); \
-    } while (0)
-
 void ChaCha20RandomEngine::fillBytes(void * buffer, size_t size) noexcept
 {
+    m_stats.recordRequest(size);
+    m_stats.recordGenerated(size);
+    if (size == 0u)
+        return;
+    assert(buffer);
+    generate(buffer, size, RandomCopier());
+}
+
+void ChaCha20RandomEngine::combineInto(void * buffer,
+                                       size_t size,
+                                       RandomCombineOp const op,
+                                       size_t const elementSize) noexcept
+{
+    m_stats.recordRequest(size);
+    m_stats.recordGenerated(size);
     if (size == 0u)
         return;
     assert(buffer);
+    assert(size % elementSize == 0u);
+    RandomCombiner combiner(op, elementSize);
+    generate(buffer, size, combiner);
+    assert(combiner.complete());
+}
+
+void ChaCha20RandomEngine::nextBlocks() noexcept
+{ m_kernel(m_state, m_block); }
 
+size_t ChaCha20RandomEngine::stateSize() const noexcept
+{ return RandomEngineState::HeaderSize + STATE_PAYLOAD_SIZE; }
+
+void ChaCha20RandomEngine::saveState(void * buffer) const {
+    assert(buffer);
+    RandomEngineState::Writer w(buffer,
+                                SHAREMIND_RANDOM_CHACHA20,
+                                STATE_PAYLOAD_SIZE);
+
+    /* The state is saved relative to the group of four blocks containing the
+       current position, so that it does not depend on the size of the buffer:
+    */
+    auto counter = (static_cast<uint64_t>(m_state[13]) << 32u) | m_state[12];
+    counter -= CHACHA20_PARALLEL_BLOCK_COUNT;
+    auto const groups = m_consumed_byte_count / STATE_GROUP_SIZE;
+    auto consumed = m_consumed_byte_count % STATE_GROUP_SIZE;
+    if (consumed <= 0u) {
+        counter += groups * STATE_GROUP_BLOCKS;
+        consumed = STATE_GROUP_SIZE;
+    } else {
+        counter += (groups + 1u) * STATE_GROUP_BLOCKS;
+    }
+
+    for (size_t i = 4u; i < 12u; ++i)
+        w.u32(m_state[i]);
+    w.u32(static_cast<uint32_t>(counter));
+    w.u32(static_cast<uint32_t>(counter >> 32u));
+    w.u32(m_state[14]);
+    w.u32(m_state[15]);
+    w.u32(static_cast<uint32_t>(consumed));
+}
+
+void ChaCha20RandomEngine::restoreState(void const * buffer, size_t size) {
+    RandomEngineState::Reader r(buffer,
+                                size,
+                                SHAREMIND_RANDOM_CHACHA20,
+                                STATE_PAYLOAD_SIZE);
+    uint32_t words[16u];
+    for (size_t i = 4u; i < 16u; ++i)
+        words[i] = r.u32();
+    auto const consumed = r.u32();
+
+    /* The counter must be a multiple of four (see ChaCha20Kernels.h), and if
+       the current group is not fully consumed it must have been generated: */
+    uint64_t counter = (static_cast<uint64_t>(words[13]) << 32u) | words[12];
+    if (consumed > STATE_GROUP_SIZE
+        || counter % STATE_GROUP_BLOCKS != 0u
+        || (consumed < STATE_GROUP_SIZE && counter < STATE_GROUP_BLOCKS))
+        throw InvalidStateException();
+
+    for (size_t i = 4u; i < 16u; ++i)
+        m_state[i] = words[i];
+    if (consumed < STATE_GROUP_SIZE) {
+        // Regenerate the buffer starting with the current group:
+        counter -= STATE_GROUP_BLOCKS;
+        m_state[12] = static_cast<uint32_t>(counter);
+        m_state[13] = static_cast<uint32_t>(counter >> 32u);
+        nextBlocks();
+        m_consumed_byte_count = consumed;
+    } else {
+        m_consumed_byte_count = CHACHA20_BUFFER_SIZE;
+    }
+}
+
+template <typename Output>
+void ChaCha20RandomEngine::generate(void * buffer,
+                                    size_t size,
+                                    Output && output) noexcept
+{
     size_t unconsumedSize = CHACHA20_BUFFER_SIZE - m_consumed_byte_count;
     size_t offsetStart = 0;
     size_t offsetEnd = unconsumedSize;
 
     // Consume full blocks (first might already be partially or entirely consumed).
     while (offsetEnd <= size) {
-        memcpy(ptrAdd(buffer, offsetStart), &m_block[m_consumed_byte_count], unconsumedSize);
-        { // Generate next four blocks:
-            v4_u32_t x[16];
-
-            for (size_t i = 0; i < 16u; ++ i) {
-                x[i] = v4_set1(m_state[i]);
-            }
-
-            v4_add(x[12], v4_set(0, 1, 2, 3));
-
-            for (size_t i = 0; i < 10; ++ i) {
-                QUARTERROUND(0, 4,  8, 12);
-                QUARTERROUND(1, 5,  9, 13);
-                QUARTERROUND(2, 6, 10, 14);
-                QUARTERROUND(3, 7, 11, 15);
-                QUARTERROUND(0, 5, 10, 15);
-                QUARTERROUND(1, 6, 11, 12);
-                QUARTERROUND(2, 7,  8, 13);
-                QUARTERROUND(3, 4,  9, 14);
-            }
-
-            for (size_t i = 0; i < 16; ++ i) {
-                v4_add(x[i], v4_set1(m_state[i]));
-            }
-
-            v4_add(x[12], v4_set(0, 1, 2, 3));
-
-            // Ordering of bytes does not matter for us:
-            memcpy(&m_block[0], &x[0], CHACHA20_BUFFER_SIZE);
-
-            /* Increment the counter.
-             *
-             * NOTE: This is one place where our implementation differs from
-             * RFC7539 where only the m_state[12] is used as a counter. This
-             * limits the RNG to generating only 256 GB of data. Thus, we
-             * borrow m_state[13] from the nonce and use it as higher bits of
-             * the counter.
-             *
-             * NOTE: This does not overflow as long as the m_state[12] is
-             * initially 0 and the number of values in uint32_t is divisible
-             * by 4!
-             */
-            m_state[12] += 4;
-            if (m_state[12] == 0) {
-                m_state[13] ++;
-            }
-        }
-
+        output(ptrAdd(buffer, offsetStart), &m_block[m_consumed_byte_count], unconsumedSize);
+        nextBlocks();
         m_consumed_byte_count = 0;
         unconsumedSize = CHACHA20_BUFFER_SIZE;
         offsetStart = offsetEnd;
@@ -229,7 +225,7 @@ void ChaCha20RandomEngine::fillBytes(void * buffer, size_t size) noexcept
     }
 
     const size_t remainingSize = size - offsetStart;
-    memcpy(ptrAdd(buffer, offsetStart), &m_block[m_consumed_byte_count], remainingSize);
+    output(ptrAdd(buffer, offsetStart), &m_block[m_consumed_byte_count], remainingSize);
     m_consumed_byte_count += remainingSize;
     assert(m_consumed_byte_count <= CHACHA20_BUFFER_SIZE); // the supply may deplete
 }
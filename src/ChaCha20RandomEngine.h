@@ -22,6 +22,8 @@
 
 #include "RandomEngine.h"
 #include <cstdint>
+#include "ChaCha20Kernels.h"
+#include "CpuFeatures.h"
 
 
 namespace sharemind {
@@ -36,7 +38,8 @@ private: /* Constants: */
     static constexpr std::size_t CHACHA20_NONCE_SIZE = 8u;
 
 
-    static constexpr std::size_t CHACHA20_PARALLEL_BLOCK_COUNT = 4u;
+    static constexpr std::size_t CHACHA20_PARALLEL_BLOCK_COUNT =
+            ChaCha20KernelBlocks;
     static constexpr std::size_t CHACHA20_BUFFER_SIZE =
             CHACHA20_PARALLEL_BLOCK_COUNT * CHACHA20_BLOCK_SIZE;
 
@@ -49,10 +52,42 @@ public: /* Methods: */
 
     explicit ChaCha20RandomEngine(void const * seed) noexcept;
 
+    /**
+     * \brief Constructs an engine using the kernel for the given SIMD level,
+     *        or for the level of the host if that is lower. Intended for
+     *        comparing the kernels, as all of them produce the same stream.
+     */
+    ChaCha20RandomEngine(void const * seed, CpuFeatures::Level level) noexcept;
+
     void fillBytes(void * buffer, size_t bufferSize) noexcept override;
 
+    void combineInto(void * buffer,
+                     size_t bufferSize,
+                     RandomCombineOp op,
+                     size_t elementSize) noexcept override;
+
+    size_t stateSize() const noexcept override;
+
+    void saveState(void * buffer) const override;
+
+    void restoreState(void const * buffer, size_t size) override;
+
+private: /* Methods: */
+
+    /** \brief Generates the next blocks into m_block. */
+    void nextBlocks() noexcept;
+
+    /**
+     * \brief Generates bufferSize bytes of keystream, passing them to
+     *        output(dst, src, n) piece by piece.
+     */
+    template <typename Output>
+    void generate(void * buffer, size_t bufferSize, Output && output) noexcept;
+
 private: /* Fields: */
 
+    ChaCha20Kernel const m_kernel;
+
     /// Internal state of the ChaCha20 cipher:
     uint32_t m_state[16u];
 
@@ -65,7 +100,7 @@ private: /* Fields: */
 
     /**
      * \brief A buffer of generated blocks.
-     * \note Currently 4 blocks are generated at a time.
+     * \note Currently 16 blocks are generated at a time.
      */
     uint8_t m_block[CHACHA20_BUFFER_SIZE];
 
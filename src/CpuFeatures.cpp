@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "CpuFeatures.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+/* Missing from the cpuid.h of older compilers: */
+#ifndef bit_SHA
+#define bit_SHA (1 << 29)
+#endif
+#ifndef bit_VAES
+#define bit_VAES (1 << 9)
+#endif
+#ifndef bit_RDRND
+#define bit_RDRND (1 << 30)
+#endif
+#ifndef bit_RDSEED
+#define bit_RDSEED (1 << 18)
+#endif
+#endif
+
+
+namespace sharemind {
+
+namespace {
+
+#if defined(__x86_64__) || defined(__i386__)
+std::uint64_t xgetbv() noexcept {
+    std::uint32_t eax;
+    std::uint32_t edx;
+    __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0u));
+    return (static_cast<std::uint64_t>(edx) << 32u) | eax;
+}
+#endif
+
+unsigned detectFeatures() noexcept {
+    unsigned r = 0u;
+    #if defined(__x86_64__) || defined(__i386__)
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1u, &eax, &ebx, &ecx, &edx))
+        return r;
+    if (edx & bit_SSE2)
+        r |= CpuFeatures::Sse2;
+    if (ecx & bit_SSSE3)
+        r |= CpuFeatures::Ssse3;
+    if (ecx & bit_AES)
+        r |= CpuFeatures::AesNi;
+    if (ecx & bit_RDRND)
+        r |= CpuFeatures::Rdrand;
+
+    /* The wide vector registers are only usable if the operating system
+       saves them on context switches: */
+    bool avxState = false;
+    bool avx512State = false;
+    if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+        auto const xcr0 = xgetbv();
+        avxState = (xcr0 & 0x06u) == 0x06u;
+        avx512State = avxState && (xcr0 & 0xe0u) == 0xe0u;
+    }
+
+    if (__get_cpuid_max(0u, nullptr) < 7u)
+        return r;
+    __cpuid_count(7u, 0u, eax, ebx, ecx, edx);
+    if (ebx & bit_SHA)
+        r |= CpuFeatures::Sha;
+    if (ebx & bit_RDSEED)
+        r |= CpuFeatures::Rdseed;
+    if (avxState) {
+        if (ebx & bit_AVX2)
+            r |= CpuFeatures::Avx2;
+        if (ecx & bit_VAES)
+            r |= CpuFeatures::Vaes;
+        if (avx512State && (ebx & bit_AVX512F))
+            r |= CpuFeatures::Avx512;
+    }
+    #endif
+    return r;
+}
+
+CpuFeatures::Level highestLevel(unsigned const features) noexcept {
+    using L = CpuFeatures::Level;
+    if ((features & CpuFeatures::Avx512) && (features & CpuFeatures::Avx2))
+        return L::Avx512;
+    if (features & CpuFeatures::Avx2)
+        return L::Avx2;
+    if (features & CpuFeatures::Ssse3)
+        return L::Ssse3;
+    if (features & CpuFeatures::Sse2)
+        return L::Sse2;
+    return L::Generic;
+}
+
+/** \returns the given features without those above the given level. */
+unsigned limitFeatures(unsigned features, CpuFeatures::Level const level)
+        noexcept
+{
+    using L = CpuFeatures::Level;
+    if (level < L::Avx512)
+        features &= ~static_cast<unsigned>(CpuFeatures::Avx512);
+    if (level < L::Avx2)
+        features &= ~static_cast<unsigned>(CpuFeatures::Avx2
+                                           | CpuFeatures::Vaes);
+    if (level < L::Ssse3)
+        features &= ~static_cast<unsigned>(CpuFeatures::Ssse3);
+    if (level < L::Sse2)
+        features &= ~static_cast<unsigned>(CpuFeatures::Sse2
+                                           | CpuFeatures::AesNi
+                                           | CpuFeatures::Sha);
+    return features;
+}
+
+} // anonymous namespace
+
+constexpr char const * CpuFeatures::LevelEnvironmentVariable;
+
+CpuFeatures::CpuFeatures() noexcept
+    : m_features(detectFeatures())
+    , m_level(highestLevel(m_features))
+{
+    Level level;
+    auto const * const override = std::getenv(LevelEnvironmentVariable);
+    if (override && parseLevel(override, level) && level < m_level) {
+        m_level = level;
+        m_features = limitFeatures(m_features, level);
+    }
+}
+
+CpuFeatures const & CpuFeatures::instance() {
+    static CpuFeatures const instance;
+    return instance;
+}
+
+char const * CpuFeatures::levelName(Level const level) noexcept {
+    switch (level) {
+    case Level::Generic: return "generic";
+    case Level::Sse2:    return "sse2";
+    case Level::Ssse3:   return "ssse3";
+    case Level::Avx2:    return "avx2";
+    case Level::Avx512:  return "avx512";
+    }
+    return "unknown";
+}
+
+bool CpuFeatures::parseLevel(char const * const name, Level & level) noexcept
+{
+    for (auto const l : { Level::Generic,
+                          Level::Sse2,
+                          Level::Ssse3,
+                          Level::Avx2,
+                          Level::Avx512 })
+    {
+        if (std::strcmp(name, levelName(l)) == 0) {
+            level = l;
+            return true;
+        }
+    }
+    return false;
+}
+
+} /* namespace sharemind { */
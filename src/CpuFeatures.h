@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_CPUFEATURES_H
+#define SHAREMIND_LIBRANDOM_CPUFEATURES_H
+
+
+namespace sharemind {
+
+/**
+ * \brief The instruction set extensions of the host usable by the kernels of
+ *        the engines, as detected once using CPUID.
+ *
+ * The SIMD level used can be lowered by setting the environment variable
+ * named by LevelEnvironmentVariable to the name of a level, e.g. to compare
+ * the performance of the kernels or to test the generic code paths. Levels
+ * above the level supported by the host are ignored.
+ */
+class CpuFeatures {
+
+public: /* Types: */
+
+    enum Feature: unsigned {
+        Sse2   = 0x01u,
+        Ssse3  = 0x02u,
+        Avx2   = 0x04u,
+
+        /** AVX-512 Foundation. */
+        Avx512 = 0x08u,
+
+        AesNi  = 0x10u,
+
+        /** Vector AES, i.e. AES on 256-bit and 512-bit vectors. */
+        Vaes   = 0x20u,
+
+        /** SHA extensions. */
+        Sha    = 0x40u,
+
+        Rdrand = 0x80u,
+        Rdseed = 0x100u
+    };
+
+    /** \brief SIMD levels in increasing order. */
+    enum class Level: unsigned {
+        Generic,
+        Sse2,
+        Ssse3,
+        Avx2,
+        Avx512
+    };
+
+public: /* Constants: */
+
+    static constexpr char const * LevelEnvironmentVariable =
+            "SHAREMIND_RANDOM_CPU_LEVEL";
+
+public: /* Methods: */
+
+    static CpuFeatures const & instance();
+
+    /** \returns a bitwise OR of the available features. */
+    inline unsigned features() const noexcept { return m_features; }
+
+    inline bool has(Feature const feature) const noexcept
+    { return (m_features & feature) != 0u; }
+
+    /** \returns the highest SIMD level to use. */
+    inline Level level() const noexcept { return m_level; }
+
+    /** \returns the name of the given level, e.g. "avx2". */
+    static char const * levelName(Level level) noexcept;
+
+    /**
+     * \brief Parses the name of a level.
+     * \returns whether the name was valid.
+     */
+    static bool parseLevel(char const * name, Level & level) noexcept;
+
+private: /* Methods: */
+
+    CpuFeatures() noexcept;
+
+private: /* Fields: */
+
+    unsigned m_features;
+    Level m_level;
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_CPUFEATURES_H */
@@ -33,8 +33,17 @@
 
 #include <cassert>
 #include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <pthread.h>
 #include <sharemind/abort.h>
 #include <sharemind/PotentiallyVoidTypeInfo.h>
+#include <sharemind/visibility.h>
+#include "ChaCha20RandomEngine.h"
+#include "HardwareRandom.h"
 
 #ifdef SHAREMIND_HAVE_LINUX_GETRANDOM
 #error SHAREMIND_HAVE_LINUX_GETRANDOM should not be defined!
@@ -230,6 +239,118 @@ SHAREMIND_LIBRANDOM_BR(sharemindCryptographicURandom,
 
 SHAREMIND_EXTERN_C_END
 
+namespace {
+
+/*
+  Requests are served from a ChaCha20 keystream. Its key is obtained from
+  getrandom(2) every OS_RESEED_REQUESTS requests or OS_RESEED_BYTES bytes, and
+  from the keystream itself every HARDWARE_RESEED_REQUESTS requests. Every time
+  HARDWARE_SIZE bytes from the hardware source are used as the nonce, hence the
+  key acts as a PRF key for the hardware random, and the outputs of requests
+  before a reseed can not be recomputed from the current state.
+*/
+constexpr static std::size_t const KEY_SIZE = 32u;
+constexpr static std::size_t const HARDWARE_SIZE =
+        sharemind::ChaCha20RandomEngine::SeedSize - KEY_SIZE;
+constexpr static unsigned const HARDWARE_RESEED_REQUESTS = 16u;
+constexpr static unsigned const OS_RESEED_REQUESTS = 1024u;
+constexpr static std::uint64_t const OS_RESEED_BYTES = 1024u * 1024u;
+
+/* Clears the state of a replaced or released engine, so that earlier output
+   can not be recomputed from freed memory: */
+struct ClearingDelete {
+    void operator()(sharemind::ChaCha20RandomEngine * const engine)
+            const noexcept
+    {
+        engine->~ChaCha20RandomEngine();
+        std::memset(static_cast<void *>(engine),
+                    0,
+                    sizeof(sharemind::ChaCha20RandomEngine));
+        ::operator delete(engine);
+    }
+};
+
+std::mutex mixedMutex;
+std::unique_ptr<sharemind::ChaCha20RandomEngine, ClearingDelete> mixedEngine;
+unsigned mixedRequests = 0u;
+std::uint64_t mixedBytes = 0u;
+
+extern "C" void sharemindCryptographicMixedPrepare() noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+extern "C" void sharemindCryptographicMixedParent() noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+extern "C" void sharemindCryptographicMixedChild() noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" void sharemindCryptographicMixedPrepare() noexcept
+{ mixedMutex.lock(); }
+
+extern "C" void sharemindCryptographicMixedParent() noexcept
+{ mixedMutex.unlock(); }
+
+// The child must not continue the keystream of the parent:
+extern "C" void sharemindCryptographicMixedChild() noexcept {
+    mixedRequests = OS_RESEED_REQUESTS;
+    mixedMutex.unlock();
+}
+
+bool mixedReseed(unsigned char * const seed) noexcept {
+    using sharemind::ChaCha20RandomEngine;
+    if (!sharemind::HardwareRandom::fill(seed + KEY_SIZE, HARDWARE_SIZE))
+        return false;
+    mixedEngine.reset(new (std::nothrow) ChaCha20RandomEngine(seed));
+    std::memset(seed, 0, ChaCha20RandomEngine::SeedSize);
+    return mixedEngine != nullptr;
+}
+
+bool mixedURandom(void * const buf, size_t const bufSize) noexcept {
+    static bool const atforkRegistered =
+            ::pthread_atfork(&sharemindCryptographicMixedPrepare,
+                             &sharemindCryptographicMixedParent,
+                             &sharemindCryptographicMixedChild) == 0;
+    if (!atforkRegistered || !sharemind::HardwareRandom::supported())
+        return false;
+
+    unsigned char seed[sharemind::ChaCha20RandomEngine::SeedSize];
+    std::lock_guard<std::mutex> const guard(mixedMutex);
+    if (!mixedEngine
+        || mixedRequests >= OS_RESEED_REQUESTS
+        || mixedBytes >= OS_RESEED_BYTES)
+    {
+        sharemindCryptographicURandom(seed, KEY_SIZE);
+        if (!mixedReseed(seed)) {
+            mixedEngine.reset();
+            return false;
+        }
+        mixedRequests = 0u;
+        mixedBytes = 0u;
+    } else if (mixedRequests % HARDWARE_RESEED_REQUESTS == 0u) {
+        mixedEngine->fillBytes(seed, KEY_SIZE);
+        if (!mixedReseed(seed)) {
+            mixedEngine.reset();
+            return false;
+        }
+    }
+    mixedEngine->fillBytes(buf, bufSize);
+    ++mixedRequests;
+    mixedBytes += bufSize;
+    return true;
+}
+
+} // anonymous namespace
+
+SHAREMIND_EXTERN_C_BEGIN
+
+void sharemindCryptographicMixedURandom(void * buf, size_t bufSize) noexcept {
+    assert(buf);
+    if (bufSize <= 0u)
+        return;
+    if (!mixedURandom(buf, bufSize))
+        sharemindCryptographicURandom(buf, bufSize);
+}
+
+SHAREMIND_EXTERN_C_END
+
 #ifdef SHAREMIND_LIBRANDOM_CRYPTOGRAPHICRANDOM_TEST
 
 #include <cstdint>
@@ -39,6 +39,16 @@ size_t sharemindCryptographicURandomNonblocking(void * buf,
 void sharemindCryptographicRandom(void * buf, size_t bufSize) noexcept;
 void sharemindCryptographicURandom(void * buf, size_t bufSize) noexcept;
 
+/**
+  Like sharemindCryptographicURandom(), but avoids most system calls when a
+  hardware entropy source is available (see HardwareRandom), by serving the
+  requests from a ChaCha20 keystream. Its key is obtained from getrandom(2)
+  periodically and after fork(), and frequently reseeded in between with
+  hardware random mixed in. Falls back to sharemindCryptographicURandom() if
+  the hardware source is missing, fails or is disabled.
+*/
+void sharemindCryptographicMixedURandom(void * buf, size_t bufSize) noexcept;
+
 SHAREMIND_EXTERN_C_END
 
 
@@ -56,6 +66,8 @@ inline void cryptographicRandom(void * buf, size_t bufSize) noexcept
 { return ::sharemindCryptographicRandom(buf, bufSize); }
 inline void cryptographicURandom(void * buf, size_t bufSize) noexcept
 { return ::sharemindCryptographicURandom(buf, bufSize); }
+inline void cryptographicMixedURandom(void * buf, size_t bufSize) noexcept
+{ return ::sharemindCryptographicMixedURandom(buf, bufSize); }
 
 template <typename T>
 inline T cryptographicRandom() noexcept {
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "GgmKernels.h"
+
+#include <cstring>
+#include "AesKernels.h"
+
+
+namespace sharemind {
+
+void ggmExpandKeys(void const * const keys, GgmKeySchedule & schedule)
+        noexcept
+{
+    auto const k = static_cast<std::uint8_t const *>(keys);
+    aesExpandKey(k, schedule.roundKeys[0u]);
+    aesExpandKey(k + 16u, schedule.roundKeys[1u]);
+}
+
+void ggmKernelGeneric(GgmKeySchedule const & keys,
+                      std::uint8_t const * const parents,
+                      std::size_t count,
+                      std::uint8_t * const children) noexcept
+{
+    // Every chunk of seeds is encrypted with a single call per child:
+    constexpr std::size_t const Chunk = 64u;
+    std::uint8_t seeds[Chunk * 16u];
+    std::uint8_t blocks[2u][Chunk * 16u];
+    while (count > 0u) {
+        auto const n = (count < Chunk) ? count : Chunk;
+        count -= n;
+        std::memcpy(seeds, parents + count * 16u, n * 16u);
+        for (std::size_t child = 0u; child < 2u; ++child)
+            aesBlocksKernelGeneric(keys.roundKeys[child],
+                                   seeds,
+                                   n,
+                                   blocks[child]);
+        for (std::size_t s = 0u; s < n; ++s) {
+            for (std::size_t child = 0u; child < 2u; ++child) {
+                auto const out = children + (2u * (count + s) + child) * 16u;
+                for (std::size_t i = 0u; i < 16u; ++i)
+                    out[i] = static_cast<std::uint8_t>(
+                                 blocks[child][s * 16u + i]
+                                 ^ seeds[s * 16u + i]);
+            }
+        }
+    }
+}
+
+GgmKernel ggmKernel(bool const hardwareAes) noexcept {
+    #if defined(__x86_64__) || defined(__i386__)
+    if (hardwareAes && aesHardwareSupported())
+        return &ggmKernelAesni;
+    #else
+    (void) hardwareAes;
+    #endif
+    return &ggmKernelGeneric;
+}
+
+} /* namespace sharemind { */
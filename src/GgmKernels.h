@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_GGMKERNELS_H
+#define SHAREMIND_LIBRANDOM_GGMKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "AesKernels.h"
+
+
+namespace sharemind {
+
+/** The size of the seeds of the nodes of a GGM tree. */
+constexpr std::size_t const GgmSeedSize = 16u;
+
+/** The AES-128 round keys of the left and the right children. */
+struct GgmKeySchedule {
+
+    AesRoundKeys roundKeys[2u];
+
+};
+
+/**
+ * \brief Expands the given 32 bytes, the AES-128 keys of the left and the
+ *        right children, into the round keys.
+ */
+void ggmExpandKeys(void const * keys, GgmKeySchedule & schedule) noexcept;
+
+/**
+ * \brief Expands count seeds with the length-doubling PRG
+ *        G(s) = (AES_k0(s) ^ s, AES_k1(s) ^ s), writing the children of
+ *        seed i to indexes 2i and 2i + 1 of children.
+ *
+ * The seeds are processed from the last to the first and every chunk of
+ * seeds is read before its children are written. Hence children may equal
+ * parents, i.e. a level of a tree can be expanded in place.
+ */
+using GgmKernel = void (*)(GgmKeySchedule const & keys,
+                           std::uint8_t const * parents,
+                           std::size_t count,
+                           std::uint8_t * children);
+
+void ggmKernelGeneric(GgmKeySchedule const & keys,
+                      std::uint8_t const * parents,
+                      std::size_t count,
+                      std::uint8_t * children) noexcept;
+
+#if defined(__x86_64__) || defined(__i386__)
+void ggmKernelAesni(GgmKeySchedule const & keys,
+                    std::uint8_t const * parents,
+                    std::size_t count,
+                    std::uint8_t * children) noexcept;
+#endif
+
+/**
+ * \returns the AES-NI kernel if hardwareAes is set and the host supports it,
+ *          and the generic kernel otherwise.
+ */
+GgmKernel ggmKernel(bool hardwareAes) noexcept;
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_GGMKERNELS_H */
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/* Compiled with -maes on x86, see CMakeLists.txt. */
+
+#if defined(__x86_64__) || defined(__i386__)
+#ifndef __AES__
+#error This file must be compiled with AES-NI support enabled!
+#endif
+
+#include "GgmKernels.h"
+
+#include <wmmintrin.h>
+
+
+namespace sharemind {
+
+namespace {
+
+/** The number of seeds whose encryptions are interleaved in the pipeline. */
+constexpr std::size_t const Chunk = 4u;
+
+inline __m128i load(std::uint8_t const * const p) noexcept
+{ return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p)); }
+
+inline void store(std::uint8_t * const p, __m128i const a) noexcept
+{ _mm_storeu_si128(reinterpret_cast<__m128i *>(p), a); }
+
+/** Expands n <= Chunk seeds, with 2n encryptions in flight. */
+template <std::size_t N>
+inline void expand(__m128i const (&rk)[2u][11u],
+                   std::uint8_t const * const parents,
+                   std::uint8_t * const children) noexcept
+{
+    __m128i seed[N];
+    __m128i x[N][2u];
+    for (std::size_t i = 0u; i < N; ++i) {
+        seed[i] = load(parents + i * 16u);
+        x[i][0u] = _mm_xor_si128(seed[i], rk[0u][0u]);
+        x[i][1u] = _mm_xor_si128(seed[i], rk[1u][0u]);
+    }
+    for (std::size_t round = 1u; round < 10u; ++round) {
+        for (std::size_t i = 0u; i < N; ++i) {
+            x[i][0u] = _mm_aesenc_si128(x[i][0u], rk[0u][round]);
+            x[i][1u] = _mm_aesenc_si128(x[i][1u], rk[1u][round]);
+        }
+    }
+    for (std::size_t i = 0u; i < N; ++i) {
+        x[i][0u] = _mm_aesenclast_si128(x[i][0u], rk[0u][10u]);
+        x[i][1u] = _mm_aesenclast_si128(x[i][1u], rk[1u][10u]);
+    }
+    for (std::size_t i = 0u; i < N; ++i) {
+        store(children + 32u * i, _mm_xor_si128(x[i][0u], seed[i]));
+        store(children + 32u * i + 16u, _mm_xor_si128(x[i][1u], seed[i]));
+    }
+}
+
+} // anonymous namespace
+
+void ggmKernelAesni(GgmKeySchedule const & keys,
+                    std::uint8_t const * const parents,
+                    std::size_t count,
+                    std::uint8_t * const children) noexcept
+{
+    __m128i rk[2u][11u];
+    for (std::size_t k = 0u; k < 2u; ++k)
+        for (std::size_t round = 0u; round < 11u; ++round)
+            rk[k][round] = load(keys.roundKeys[k][round]);
+
+    // The last seeds first, so that the chunks below are aligned to Chunk:
+    while (count % Chunk != 0u) {
+        --count;
+        expand<1u>(rk, parents + count * 16u, children + count * 32u);
+    }
+    while (count > 0u) {
+        count -= Chunk;
+        expand<Chunk>(rk, parents + count * 16u, children + count * 32u);
+    }
+}
+
+} /* namespace sharemind { */
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "HardwareRandom.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include "CpuFeatures.h"
+
+
+namespace sharemind {
+
+namespace {
+
+std::mutex hardwareRandomMutex;
+HardwareRandom::HealthTests hardwareRandomTests;
+bool hardwareRandomStarted = false;
+
+bool nextWord(std::uint64_t & value) noexcept {
+    #if defined(__x86_64__)
+    auto const & cpu = CpuFeatures::instance();
+    if (cpu.has(CpuFeatures::Rdseed) && hardwareRandomRdseed(value))
+        return true;
+    return cpu.has(CpuFeatures::Rdrand) && hardwareRandomRdrand(value);
+    #else
+    (void) value;
+    return false;
+    #endif
+}
+
+/* Generates size bytes, feeding them to the health tests: */
+bool nextBytes(unsigned char * out, std::size_t size) noexcept {
+    while (size > 0u) {
+        std::uint64_t word;
+        if (!nextWord(word))
+            return false;
+        unsigned char bytes[sizeof(word)];
+        std::memcpy(bytes, &word, sizeof(word));
+        auto const n = (size < sizeof(bytes)) ? size : sizeof(bytes);
+        for (auto const b : bytes)
+            if (!hardwareRandomTests.feed(b))
+                return false;
+        std::memcpy(out, bytes, n);
+        out += n;
+        size -= n;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+constexpr char const * HardwareRandom::EnvironmentVariable;
+constexpr unsigned HardwareRandom::HealthTests::AssumedEntropyBits;
+constexpr std::size_t HardwareRandom::HealthTests::RepetitionCutoff;
+constexpr std::size_t HardwareRandom::HealthTests::ProportionWindow;
+constexpr std::size_t HardwareRandom::HealthTests::ProportionCutoff;
+
+bool HardwareRandom::HealthTests::feed(std::uint8_t const sample) noexcept {
+    if (m_failed)
+        return false;
+
+    // Repetition count test:
+    if (m_repetitions > 0u && sample == m_lastSample) {
+        if (++m_repetitions >= RepetitionCutoff)
+            m_failed = true;
+    } else {
+        m_lastSample = sample;
+        m_repetitions = 1u;
+    }
+
+    // Adaptive proportion test:
+    if (m_windowPosition == 0u) {
+        m_windowSample = sample;
+        m_windowMatches = 1u;
+    } else if (sample == m_windowSample) {
+        if (++m_windowMatches >= ProportionCutoff)
+            m_failed = true;
+    }
+    if (++m_windowPosition == ProportionWindow)
+        m_windowPosition = 0u;
+
+    return !m_failed;
+}
+
+bool HardwareRandom::supported() noexcept {
+    #if defined(__x86_64__)
+    static bool const r = []() noexcept {
+        auto const * const enabled = std::getenv(EnvironmentVariable);
+        if (enabled && std::strcmp(enabled, "0") == 0)
+            return false;
+        auto const & cpu = CpuFeatures::instance();
+        return cpu.has(CpuFeatures::Rdseed) || cpu.has(CpuFeatures::Rdrand);
+    }();
+    return r;
+    #else
+    return false;
+    #endif
+}
+
+bool HardwareRandom::fill(void * const buffer, std::size_t const size) noexcept
+{
+    if (!supported())
+        return false;
+    std::lock_guard<std::mutex> const guard(hardwareRandomMutex);
+    if (hardwareRandomTests.failed())
+        return false;
+    if (!hardwareRandomStarted) {
+        unsigned char startup[HealthTests::ProportionWindow];
+        if (!nextBytes(startup, sizeof(startup)))
+            return false;
+        hardwareRandomStarted = true;
+    }
+    return nextBytes(static_cast<unsigned char *>(buffer), size);
+}
+
+} /* namespace sharemind { */
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_HARDWARERANDOM_H
+#define SHAREMIND_LIBRANDOM_HARDWARERANDOM_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace sharemind {
+
+/**
+ * \brief Random bytes from the RDSEED and RDRAND instructions of x86-64 CPUs,
+ *        checked by the continuous health tests of NIST SP 800-90B 4.4.
+ *
+ * RDSEED is preferred, with RDRAND used when RDSEED is missing or keeps
+ * failing. The output is never used alone, only mixed into a generator keyed
+ * using getrandom(2), see sharemindCryptographicMixedURandom(). Once a health
+ * test fails, the source stays disabled for the lifetime of the process.
+ *
+ * The source can be disabled by setting the environment variable named by
+ * EnvironmentVariable to "0".
+ */
+class HardwareRandom {
+
+public: /* Constants: */
+
+    static constexpr char const * EnvironmentVariable =
+            "SHAREMIND_RANDOM_HARDWARE_ENTROPY";
+
+public: /* Types: */
+
+    /**
+     * \brief The repetition count and adaptive proportion tests on a stream of
+     *        byte-sized samples, with a false positive rate of 2^-20.
+     */
+    class HealthTests {
+
+    public: /* Constants: */
+
+        /** The conservatively assumed min-entropy per byte. */
+        static constexpr unsigned AssumedEntropyBits = 4u;
+
+        /** 1 + ceil(20 / AssumedEntropyBits) */
+        static constexpr std::size_t RepetitionCutoff = 6u;
+
+        static constexpr std::size_t ProportionWindow = 1024u;
+
+        /** 1 + CRITBINOM(ProportionWindow, 2^-AssumedEntropyBits, 1-2^-20) */
+        static constexpr std::size_t ProportionCutoff = 105u;
+
+    public: /* Methods: */
+
+        /**
+         * \brief Feeds the next sample to the tests.
+         * \returns false if any test has failed on this or an earlier sample.
+         */
+        bool feed(std::uint8_t sample) noexcept;
+
+        inline bool failed() const noexcept { return m_failed; }
+
+    private: /* Fields: */
+
+        bool m_failed = false;
+
+        std::uint8_t m_lastSample = 0u;
+        std::size_t m_repetitions = 0u;
+
+        std::uint8_t m_windowSample = 0u;
+        std::size_t m_windowPosition = 0u;
+        std::size_t m_windowMatches = 0u;
+
+    };
+
+public: /* Methods: */
+
+    /** \returns whether the CPU has RDSEED or RDRAND and it is enabled. */
+    static bool supported() noexcept;
+
+    /**
+     * \brief Fills the given buffer with bytes which passed the health tests.
+     * \returns false if the source is not supported or has been disabled, or
+     *          the instructions failed, in which case the contents of the
+     *          buffer are unspecified.
+     * \note The first call runs the start-up tests on ProportionWindow
+     *       discarded bytes.
+     */
+    static bool fill(void * buffer, std::size_t size) noexcept;
+
+};
+
+#if defined(__x86_64__)
+/* Compiled with -mrdrnd -mrdseed, see CMakeLists.txt. */
+bool hardwareRandomRdseed(std::uint64_t & value) noexcept;
+bool hardwareRandomRdrand(std::uint64_t & value) noexcept;
+#endif
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_HARDWARERANDOM_H */
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/* Compiled with -mrdrnd -mrdseed on x86, see CMakeLists.txt. */
+
+#if defined(__x86_64__)
+#if !defined(__RDRND__) || !defined(__RDSEED__)
+#error This file must be compiled with RDRAND and RDSEED support enabled!
+#endif
+
+#include "HardwareRandom.h"
+
+#include <immintrin.h>
+
+
+namespace sharemind {
+
+namespace {
+
+/* As recommended by Intel, RDRAND is retried 10 times, after which a failure
+   indicates a broken CPU. RDSEED often fails under contention, in which case
+   we give up soon and fall back to RDRAND: */
+constexpr static unsigned const RDRAND_RETRIES = 10u;
+constexpr static unsigned const RDSEED_RETRIES = 4u;
+
+} // anonymous namespace
+
+bool hardwareRandomRdseed(std::uint64_t & value) noexcept {
+    for (unsigned i = 0u; i < RDSEED_RETRIES; ++i) {
+        unsigned long long v;
+        if (_rdseed64_step(&v)) {
+            value = v;
+            return true;
+        }
+        _mm_pause();
+    }
+    return false;
+}
+
+bool hardwareRandomRdrand(std::uint64_t & value) noexcept {
+    for (unsigned i = 0u; i < RDRAND_RETRIES; ++i) {
+        unsigned long long v;
+        if (_rdrand64_step(&v)) {
+            value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+} /* namespace sharemind { */
+
+#endif /* defined(__x86_64__) */
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+
+#include "NormalKernels.h"
+
+#include <cmath>
+#include <cstring>
+
+
+namespace sharemind {
+
+namespace {
+
+/* See "The Ziggurat Method for Generating Random Variables" by Marsaglia and
+   Tsang, 2000: */
+ZigguratTables makeZigguratTables() noexcept {
+    constexpr double const m = 2147483648.0;
+    constexpr double const v = 9.91256303526217e-3;
+    constexpr std::size_t const top = ZigguratLayers - 1u;
+    ZigguratTables t;
+    double d = ZigguratR;
+    double previous = d;
+    double const q = v / std::exp(-0.5 * d * d);
+    t.k[0u] = static_cast<std::uint32_t>((d / q) * m);
+    t.k[1u] = 0u;
+    t.w[0u] = q / m;
+    t.w[top] = d / m;
+    t.f[0u] = 1.0;
+    t.f[top] = std::exp(-0.5 * d * d);
+    for (std::size_t i = top - 1u; i >= 1u; --i) {
+        d = std::sqrt(-2.0 * std::log(v / d + std::exp(-0.5 * d * d)));
+        t.k[i + 1u] = static_cast<std::uint32_t>((d / previous) * m);
+        previous = d;
+        t.f[i] = std::exp(-0.5 * d * d);
+        t.w[i] = d / m;
+    }
+    return t;
+}
+
+} // anonymous namespace
+
+ZigguratTables const & zigguratTables() noexcept {
+    static ZigguratTables const tables(makeZigguratTables());
+    return tables;
+}
+
+std::size_t normalKernelGeneric(double * const values,
+                                std::size_t const count,
+                                std::uint32_t * const rejected) noexcept
+{
+    auto const & t = zigguratTables();
+    std::size_t r = 0u;
+    for (std::size_t i = 0u; i < count; ++i) {
+        std::uint64_t word;
+        std::memcpy(&word, values + i, sizeof(word));
+        auto const layer = word & (ZigguratLayers - 1u);
+        auto const sample = static_cast<std::int32_t>(
+                    static_cast<std::uint32_t>(word >> 32u));
+        auto const magnitude = (sample < 0)
+                               ? 0u - static_cast<std::uint32_t>(sample)
+                               : static_cast<std::uint32_t>(sample);
+        if (magnitude < t.k[layer]) {
+            values[i] = static_cast<double>(sample) * t.w[layer];
+        } else {
+            rejected[r++] = static_cast<std::uint32_t>(i);
+        }
+    }
+    return r;
+}
+
+NormalKernel normalKernel(CpuFeatures::Level const level) noexcept {
+    #if defined(__x86_64__) || defined(__i386__)
+    if (level >= CpuFeatures::Level::Avx2)
+        return &normalKernelAvx2;
+    #else
+    (void) level;
+    #endif
+    return &normalKernelGeneric;
+}
+
+} /* namespace sharemind { */
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+
+#ifndef SHAREMIND_LIBRANDOM_NORMALKERNELS_H
+#define SHAREMIND_LIBRANDOM_NORMALKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "CpuFeatures.h"
+
+
+namespace sharemind {
+
+/** The number of layers of the ziggurat for the normal distribution. */
+constexpr std::size_t const ZigguratLayers = 128u;
+
+/** The start of the tail of the ziggurat. */
+constexpr double const ZigguratR = 3.442619855899;
+
+/**
+ * \brief The tables of the ziggurat of Marsaglia and Tsang for the standard
+ *        normal distribution with 32-bit signed integer samples.
+ */
+struct ZigguratTables {
+
+    /** The largest absolute sample accepted in the rectangle of a layer. */
+    std::uint32_t k[ZigguratLayers];
+
+    /** The width of a layer per unit of the sample. */
+    double w[ZigguratLayers];
+
+    /** The density at the top of a layer. */
+    double f[ZigguratLayers];
+
+};
+
+ZigguratTables const & zigguratTables() noexcept;
+
+/**
+ * \brief Converts the given 64-bit words in place to standard normal deviates
+ *        using the fast path of the ziggurat.
+ *
+ * The 7 lowest bits of a word select the layer and the high 32 bits are the
+ * signed sample. A word is accepted if the sample falls into the rectangle
+ * of its layer, in which case it is replaced by the sample times the width
+ * of the layer. The indexes of the rejected words are written to rejected in
+ * increasing order and the words are left untouched. Hence all kernels
+ * produce the same output regardless of their vector width.
+ *
+ * \returns the number of rejected words.
+ */
+using NormalKernel = std::size_t (*)(double * values,
+                                     std::size_t count,
+                                     std::uint32_t * rejected);
+
+std::size_t normalKernelGeneric(double * values,
+                                std::size_t count,
+                                std::uint32_t * rejected) noexcept;
+
+#if defined(__x86_64__) || defined(__i386__)
+std::size_t normalKernelAvx2(double * values,
+                             std::size_t count,
+                             std::uint32_t * rejected) noexcept;
+#endif
+
+/** \returns the fastest kernel usable at the given SIMD level. */
+NormalKernel normalKernel(CpuFeatures::Level level) noexcept;
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_NORMALKERNELS_H */
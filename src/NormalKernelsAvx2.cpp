@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+
+/* Compiled with -mavx2 on x86, see CMakeLists.txt. */
+
+#if defined(__x86_64__) || defined(__i386__)
+#ifndef __AVX2__
+#error This file must be compiled with AVX2 support enabled!
+#endif
+
+#include "NormalKernels.h"
+
+#include <immintrin.h>
+
+
+namespace sharemind {
+
+std::size_t normalKernelAvx2(double * const values,
+                             std::size_t const count,
+                             std::uint32_t * const rejected) noexcept
+{
+    auto const & t = zigguratTables();
+    __m256i const lowHalves = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+    __m256i const highHalves = _mm256_setr_epi32(1, 3, 5, 7, 0, 0, 0, 0);
+    __m128i const layerMask =
+            _mm_set1_epi32(static_cast<int>(ZigguratLayers - 1u));
+    // Biasing both sides turns the signed comparison into an unsigned one:
+    __m128i const bias = _mm_set1_epi32(INT32_MIN);
+    __m128i const allLanes = _mm_set1_epi32(-1);
+
+    std::size_t r = 0u;
+    std::size_t i = 0u;
+    for (; i + 4u <= count; i += 4u) {
+        __m256i const words =
+                _mm256_loadu_si256(reinterpret_cast<__m256i const *>(
+                                       values + i));
+        __m128i const layers = _mm_and_si128(
+                    _mm256_castsi256_si128(
+                        _mm256_permutevar8x32_epi32(words, lowHalves)),
+                    layerMask);
+        __m128i const samples = _mm256_castsi256_si128(
+                    _mm256_permutevar8x32_epi32(words, highHalves));
+        __m128i const k = _mm_mask_i32gather_epi32(
+                    _mm_setzero_si128(),
+                    reinterpret_cast<int const *>(t.k),
+                    layers,
+                    allLanes,
+                    4);
+        __m256d const w = _mm256_mask_i32gather_pd(
+                    _mm256_setzero_pd(),
+                    t.w,
+                    layers,
+                    _mm256_castsi256_pd(_mm256_cvtepi32_epi64(allLanes)),
+                    8);
+        __m128i const accepted = _mm_cmpgt_epi32(
+                    _mm_xor_si128(k, bias),
+                    _mm_xor_si128(_mm_abs_epi32(samples), bias));
+        _mm256_maskstore_pd(values + i,
+                            _mm256_cvtepi32_epi64(accepted),
+                            _mm256_mul_pd(_mm256_cvtepi32_pd(samples), w));
+        auto mask = ~static_cast<unsigned>(
+                    _mm_movemask_ps(_mm_castsi128_ps(accepted))) & 0xfu;
+        for (std::uint32_t j = 0u; mask; ++j, mask >>= 1u)
+            if (mask & 1u)
+                rejected[r++] = static_cast<std::uint32_t>(i + j);
+    }
+    auto const tail = normalKernelGeneric(values + i, count - i, rejected + r);
+    for (std::size_t j = 0u; j < tail; ++j)
+        rejected[r + j] += static_cast<std::uint32_t>(i);
+    return r + tail;
+}
+
+} /* namespace sharemind { */
+
+#endif
@@ -33,6 +33,11 @@ public: /* Methods: */
     inline void fillBytes(void * memptr, size_t numBytes) noexcept override
     { memset(memptr, 0, numBytes); }
 
+    /** \brief Combining with zero bytes leaves the buffer unchanged. */
+    inline void combineInto(void *, size_t, RandomCombineOp, size_t)
+            noexcept override
+    {}
+
     static inline NullRandomEngine & instance() noexcept;
 
 };
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "NumaReplicatedRandomEngine.h"
+
+#include <cassert>
+#include <utility>
+#include "NumaTopology.h"
+
+
+namespace sharemind {
+
+NumaReplicatedRandomEngine::NumaReplicatedRandomEngine(
+        std::vector<std::pair<unsigned, std::shared_ptr<RandomEngine> > >
+            replicas)
+{
+    assert(!replicas.empty());
+    for (auto & replica : replicas) {
+        assert(replica.second);
+        if (m_replicas.size() <= replica.first)
+            m_replicas.resize(replica.first + 1u);
+        m_replicas[replica.first] = std::move(replica.second);
+    }
+    auto const & first = replicas.front().first;
+    for (auto & replica : m_replicas)
+        if (!replica)
+            replica = m_replicas[first];
+}
+
+void NumaReplicatedRandomEngine::fillBytes(void * buffer,
+                                           std::size_t size) noexcept
+{
+    m_stats.recordRequest(size);
+    localReplica().fillBytes(buffer, size);
+}
+
+void NumaReplicatedRandomEngine::fillBytesV(struct iovec const * const iov,
+                                            std::size_t const iovcnt)
+        noexcept
+{
+    // All buffers are served by the same replica, like a single request:
+    for (std::size_t i = 0u; i < iovcnt; ++i)
+        m_stats.recordRequest(iov[i].iov_len);
+    localReplica().fillBytesV(iov, iovcnt);
+}
+
+void NumaReplicatedRandomEngine::fillBytesAsync(
+        void * buffer,
+        std::size_t size,
+        std::function<void ()> callback) noexcept
+{
+    m_stats.recordRequest(size);
+    localReplica().fillBytesAsync(buffer, size, std::move(callback));
+}
+
+void NumaReplicatedRandomEngine::combineInto(void * buffer,
+                                             std::size_t size,
+                                             RandomCombineOp const op,
+                                             std::size_t const elementSize)
+        noexcept
+{
+    m_stats.recordRequest(size);
+    localReplica().combineInto(buffer, size, op, elementSize);
+}
+
+void NumaReplicatedRandomEngine::reserve(std::size_t const size,
+                                         std::chrono::nanoseconds const within)
+        noexcept
+{ localReplica().reserve(size, within); }
+
+std::size_t NumaReplicatedRandomEngine::bufferSize() const noexcept
+{ return localReplica().bufferSize(); }
+
+void NumaReplicatedRandomEngine::getStats(SharemindRandomEngineStats & stats)
+        const noexcept
+{
+    stats = SharemindRandomEngineStats();
+    SharemindRandomEngineStats replicaStats;
+    for (std::size_t node = 0u; node < m_replicas.size(); ++node) {
+        // Skip the gaps which refer to other replicas:
+        bool duplicate = false;
+        for (std::size_t i = 0u; i < node && !duplicate; ++i)
+            duplicate = (m_replicas[i] == m_replicas[node]);
+        if (duplicate)
+            continue;
+        m_replicas[node]->getStats(replicaStats);
+        RandomEngineStats::add(stats, replicaStats);
+    }
+    m_stats.addToWrapped(stats);
+}
+
+RandomEngine & NumaReplicatedRandomEngine::localReplica() const noexcept {
+    auto const node = NumaTopology::instance().currentNode();
+    return (node < m_replicas.size())
+           ? *m_replicas[node]
+           : *m_replicas.front();
+}
+
+} /* namespace sharemind { */
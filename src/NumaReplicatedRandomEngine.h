@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_NUMAREPLICATEDRANDOMENGINE_H
+#define SHAREMIND_LIBRANDOM_NUMAREPLICATEDRANDOMENGINE_H
+
+#include "RandomEngine.h"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+namespace sharemind {
+
+/**
+ * \brief A random engine consisting of one replica per NUMA node, each of
+ *        which is expected to have its memory and threads on that node.
+ *        Every request is served by the replica of the node the calling
+ *        thread is currently running on.
+ * \note Like other engines, instances of this class may only be used by a
+ *       single thread at a time.
+ */
+class NumaReplicatedRandomEngine: public RandomEngine {
+
+public: /* Methods: */
+
+    /**
+     * \param[in] replicas pairs of NUMA node identifiers and the engines
+     *                     local to these nodes. Must not be empty.
+     */
+    NumaReplicatedRandomEngine(
+            std::vector<std::pair<unsigned, std::shared_ptr<RandomEngine> > >
+                replicas);
+
+    void fillBytes(void * buffer, std::size_t size) noexcept override;
+
+    void fillBytesV(struct iovec const * iov, std::size_t iovcnt)
+            noexcept override;
+
+    void fillBytesAsync(void * buffer,
+                        std::size_t size,
+                        std::function<void ()> callback) noexcept override;
+
+    void combineInto(void * buffer,
+                     std::size_t size,
+                     RandomCombineOp op,
+                     std::size_t elementSize) noexcept override;
+
+    /** \brief Passes the hint to the replica local to the calling thread. */
+    void reserve(std::size_t size, std::chrono::nanoseconds within)
+            noexcept override;
+
+    /** \returns the buffer size of the replica local to the calling thread.*/
+    std::size_t bufferSize() const noexcept override;
+
+    void getStats(SharemindRandomEngineStats & stats) const noexcept override;
+
+private: /* Methods: */
+
+    RandomEngine & localReplica() const noexcept;
+
+private: /* Fields: */
+
+    /// Replicas indexed by NUMA node, with gaps filled by the first replica:
+    std::vector<std::shared_ptr<RandomEngine> > m_replicas;
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_NUMAREPLICATEDRANDOMENGINE_H */
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "NumaTopology.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+namespace sharemind {
+
+namespace {
+
+constexpr static std::size_t const NODEMASK_WORDS =
+        NumaTopology::MaxNodes / (sizeof(unsigned long) * CHAR_BIT);
+
+struct NodeMask {
+
+    inline NodeMask(unsigned const node) noexcept {
+        std::fill(m_words, m_words + NODEMASK_WORDS, 0ul);
+        constexpr static unsigned const bits = sizeof(unsigned long) * CHAR_BIT;
+        m_words[node / bits] |= 1ul << (node % bits);
+    }
+
+    /* The kernel interprets maxnode off by one, see mbind(2). */
+    constexpr static unsigned long maxNode() noexcept
+    { return NumaTopology::MaxNodes + 1u; }
+
+    unsigned long m_words[NODEMASK_WORDS];
+
+};
+
+/** Parses lists like "0-3,8,10-11" as used in /sys/devices/system. */
+std::vector<unsigned> parseList(std::string const & str) {
+    std::vector<unsigned> r;
+    std::istringstream iss(str);
+    std::string range;
+    while (std::getline(iss, range, ',')) {
+        if (range.empty() || range == "\n")
+            continue;
+        auto const dash = range.find('-');
+        try {
+            unsigned long const first = std::stoul(range.substr(0u, dash));
+            unsigned long const last =
+                    (dash == std::string::npos)
+                    ? first
+                    : std::stoul(range.substr(dash + 1u));
+            for (auto i = first; i <= last && i < CPU_SETSIZE; ++i)
+                r.emplace_back(static_cast<unsigned>(i));
+        } catch (...) {
+            return std::vector<unsigned>();
+        }
+    }
+    return r;
+}
+
+std::vector<unsigned> readList(std::string const & filename) {
+    std::ifstream f(filename);
+    std::string line;
+    if (!f || !std::getline(f, line))
+        return std::vector<unsigned>();
+    return parseList(line);
+}
+
+} // anonymous namespace
+
+NumaTopology::NumaTopology(std::string const & nodeDirectory) {
+    for (auto const node : readList(nodeDirectory + "/online")) {
+        if (node >= MaxNodes)
+            continue;
+        auto cpus(readList(nodeDirectory + "/node" + std::to_string(node)
+                           + "/cpulist"));
+        if (m_nodeCpus.size() <= node)
+            m_nodeCpus.resize(node + 1u);
+        m_nodeCpus[node] = std::move(cpus);
+        m_nodes.emplace_back(node);
+    }
+
+    // No NUMA information, assume a single node with all CPUs:
+    if (m_nodes.empty()) {
+        auto const numCpus = ::sysconf(_SC_NPROCESSORS_CONF);
+        std::vector<unsigned> cpus;
+        for (long i = 0; i < numCpus && i < CPU_SETSIZE; ++i)
+            cpus.emplace_back(static_cast<unsigned>(i));
+        m_nodeCpus.emplace_back(std::move(cpus));
+        m_nodes.emplace_back(0u);
+    }
+
+    for (auto const node : m_nodes) {
+        for (auto const cpu : m_nodeCpus[node]) {
+            if (m_cpuNodes.size() <= cpu)
+                m_cpuNodes.resize(cpu + 1u, m_nodes.front());
+            m_cpuNodes[cpu] = node;
+        }
+    }
+}
+
+NumaTopology const & NumaTopology::instance() {
+    static NumaTopology const topology("/sys/devices/system/node");
+    return topology;
+}
+
+bool NumaTopology::hasNode(unsigned const node) const noexcept
+{ return std::find(m_nodes.begin(), m_nodes.end(), node) != m_nodes.end(); }
+
+unsigned NumaTopology::currentNode() const noexcept {
+    if (m_nodes.size() <= 1u)
+        return m_nodes.front();
+    auto const cpu = ::sched_getcpu();
+    if (cpu < 0 || static_cast<unsigned>(cpu) >= m_cpuNodes.size())
+        return m_nodes.front();
+    return m_cpuNodes[static_cast<unsigned>(cpu)];
+}
+
+bool NumaTopology::bindCurrentThreadToNode(unsigned const node) const noexcept
+{
+    if (!hasNode(node))
+        return false;
+
+    bool r = true;
+    auto const & cpus = m_nodeCpus[node];
+    if (!cpus.empty()) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (auto const cpu : cpus)
+            CPU_SET(cpu, &cpuSet);
+        r = ::pthread_setaffinity_np(::pthread_self(),
+                                     sizeof(cpuSet),
+                                     &cpuSet) == 0;
+    }
+
+    #ifdef SYS_set_mempolicy
+    NodeMask const mask(node);
+    if (::syscall(SYS_set_mempolicy,
+                  MPOL_PREFERRED,
+                  mask.m_words,
+                  NodeMask::maxNode()) != 0)
+        r = false;
+    #endif
+    return r;
+}
+
+bool NumaTopology::bindMemoryToNode(void * const memptr,
+                                    std::size_t const size,
+                                    unsigned const node) noexcept
+{
+    #ifdef SYS_mbind
+    if (!memptr || size <= 0u || node >= MaxNodes)
+        return false;
+    auto const pageSize = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    auto const begin = reinterpret_cast<std::uintptr_t>(memptr);
+    auto const alignedBegin = begin & ~(pageSize - 1u);
+    NodeMask const mask(node);
+    return ::syscall(SYS_mbind,
+                     reinterpret_cast<void *>(alignedBegin),
+                     static_cast<unsigned long>(size + (begin - alignedBegin)),
+                     MPOL_PREFERRED,
+                     mask.m_words,
+                     NodeMask::maxNode(),
+                     0u) == 0;
+    #else
+    (void) memptr; (void) size; (void) node;
+    return false;
+    #endif
+}
+
+} /* namespace sharemind { */
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_NUMATOPOLOGY_H
+#define SHAREMIND_LIBRANDOM_NUMATOPOLOGY_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+namespace sharemind {
+
+/**
+ * \brief Read-only view of the NUMA topology of the host, as reported by
+ *        /sys/devices/system/node. Systems without NUMA support are presented
+ *        as a single node 0 containing all CPUs.
+ */
+class NumaTopology {
+
+public: /* Constants: */
+
+    static constexpr unsigned MaxNodes = 1024u;
+
+    /** Indicates that no NUMA placement is to be done. */
+    static constexpr unsigned NoNode = ~0u;
+
+public: /* Methods: */
+
+    /**
+     * \brief Reads the topology from the given directory laid out like
+     *        /sys/devices/system/node, e.g. for testing.
+     */
+    explicit NumaTopology(std::string const & nodeDirectory);
+
+    static NumaTopology const & instance();
+
+    /** \returns the list of online NUMA node identifiers. */
+    inline std::vector<unsigned> const & nodes() const noexcept
+    { return m_nodes; }
+
+    bool hasNode(unsigned node) const noexcept;
+
+    /** \returns the node of the CPU the calling thread is running on. */
+    unsigned currentNode() const noexcept;
+
+    /**
+     * \brief Pins the calling thread to the CPUs of the given node and makes
+     *        the node the preferred node for its future memory allocations.
+     * \returns whether both succeeded. Failures are otherwise harmless.
+     */
+    bool bindCurrentThreadToNode(unsigned node) const noexcept;
+
+    /**
+     * \brief Asks the kernel to place the pages of the given region on the
+     *        given node.
+     * \returns whether the request succeeded.
+     */
+    static bool bindMemoryToNode(void * memptr,
+                                 std::size_t size,
+                                 unsigned node) noexcept;
+
+private: /* Fields: */
+
+    std::vector<unsigned> m_nodes;
+    std::vector<std::vector<unsigned> > m_nodeCpus;
+    std::vector<unsigned> m_cpuNodes;
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_NUMATOPOLOGY_H */
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+
+#include "RandomAliasTable.h"
+
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <thread>
+
+
+namespace sharemind {
+
+SHAREMIND_DEFINE_EXCEPTION_CONST_MSG_NOINLINE(
+        RandomEngine::Exception,
+        RandomAliasTable::,
+        InvalidWeightsException,
+        "The weights must be non-negative and finite and not all zero!");
+
+struct RandomAliasTable::Scratch {
+
+    inline explicit Scratch(std::size_t const size)
+        : probabilities(size)
+        , small(size)
+        , large(size)
+    {}
+
+    std::vector<double> probabilities;
+    std::vector<std::uint32_t> small;
+    std::vector<std::uint32_t> large;
+
+};
+
+namespace {
+
+/** \returns the threshold for keeping an entry with the given probability. */
+inline std::uint64_t threshold(double const probability) noexcept {
+    constexpr double const limit = 18446744073709551616.0; // 2^64
+    auto const t = std::ldexp(probability, 64);
+    return (t >= limit)
+           ? std::numeric_limits<std::uint64_t>::max()
+           : static_cast<std::uint64_t>(t);
+}
+
+/** \returns the sum of the given weights, or NaN if any is invalid. */
+double checkedSum(double const * const weights, std::size_t const size)
+        noexcept
+{
+    double sum = 0.0;
+    for (std::size_t i = 0u; i < size; ++i) {
+        if (!(weights[i] >= 0.0) || !std::isfinite(weights[i]))
+            return std::numeric_limits<double>::quiet_NaN();
+        sum += weights[i];
+    }
+    return sum;
+}
+
+} // anonymous namespace
+
+RandomAliasTable::RandomAliasTable(double const * const weights,
+                                   std::size_t const size,
+                                   unsigned threads)
+    : m_size(size)
+{
+    if (size <= 0u)
+        throw InvalidWeightsException();
+    auto const numBlocks = (size - 1u) / BlockSize + 1u;
+    auto const blockSize = [size](std::size_t const block) noexcept
+            { return (size - block * BlockSize < BlockSize)
+                     ? size - block * BlockSize
+                     : BlockSize; };
+
+    m_blocks.resize(numBlocks);
+    for (std::size_t b = 0u; b < numBlocks; ++b) {
+        m_blocks[b].thresholds.resize(blockSize(b));
+        m_blocks[b].aliases.resize(blockSize(b));
+    }
+    if (threads <= 0u)
+        threads = std::thread::hardware_concurrency();
+    if (threads <= 0u)
+        threads = 1u;
+    if (threads > numBlocks)
+        threads = static_cast<unsigned>(numBlocks);
+    std::vector<Scratch> scratches;
+    scratches.reserve(threads);
+    for (unsigned t = 0u; t < threads; ++t)
+        scratches.emplace_back(blockSize(0u));
+
+    // Every block is constructed by whichever thread takes it first:
+    std::vector<double> sums(numBlocks);
+    std::atomic<std::size_t> nextBlock(0u);
+    auto const worker = [&](Scratch & scratch) noexcept {
+        for (;;) {
+            auto const b = nextBlock++;
+            if (b >= numBlocks)
+                return;
+            auto const blockWeights = weights + b * BlockSize;
+            sums[b] = checkedSum(blockWeights, blockSize(b));
+            if (!std::isnan(sums[b]))
+                buildTable(blockWeights,
+                           blockSize(b),
+                           sums[b],
+                           m_blocks[b],
+                           scratch);
+        }
+    };
+    {
+        std::vector<std::thread> helpers;
+        try {
+            for (unsigned t = 1u; t < threads; ++t)
+                helpers.emplace_back(worker, std::ref(scratches[t]));
+        } catch (...) {
+            // Construct the rest on the threads which were started:
+        }
+        worker(scratches[0u]);
+        for (auto & helper : helpers)
+            helper.join();
+    }
+
+    double total = 0.0;
+    for (auto const sum : sums)
+        total += sum;
+    if (!(total > 0.0) || !std::isfinite(total))
+        throw InvalidWeightsException();
+    if (numBlocks > 1u) {
+        m_top.thresholds.resize(numBlocks);
+        m_top.aliases.resize(numBlocks);
+        Scratch scratch(numBlocks);
+        buildTable(sums.data(), numBlocks, total, m_top, scratch);
+    }
+}
+
+void RandomAliasTable::buildTable(double const * const weights,
+                                  std::size_t const size,
+                                  double const sum,
+                                  Table & table,
+                                  Scratch & scratch) noexcept
+{
+    auto & p = scratch.probabilities;
+    auto & small = scratch.small;
+    auto & large = scratch.large;
+    std::size_t numSmall = 0u;
+    std::size_t numLarge = 0u;
+
+    /* Blocks without weight are never drawn, and entries left over due to
+       rounding errors are kept with probability 1: */
+    auto const keep = [&table](std::size_t const i) noexcept {
+        table.thresholds[i] = std::numeric_limits<std::uint64_t>::max();
+        table.aliases[i] = static_cast<std::uint32_t>(i);
+    };
+    if (!(sum > 0.0)) {
+        for (std::size_t i = 0u; i < size; ++i)
+            keep(i);
+        return;
+    }
+
+    auto const scale = static_cast<double>(size) / sum;
+    for (std::size_t i = 0u; i < size; ++i) {
+        p[i] = weights[i] * scale;
+        if (p[i] < 1.0) {
+            small[numSmall++] = static_cast<std::uint32_t>(i);
+        } else {
+            large[numLarge++] = static_cast<std::uint32_t>(i);
+        }
+    }
+    while (numSmall > 0u && numLarge > 0u) {
+        auto const l = small[--numSmall];
+        auto const g = large[--numLarge];
+        table.thresholds[l] = threshold(p[l]);
+        table.aliases[l] = g;
+        p[g] = (p[g] + p[l]) - 1.0;
+        if (p[g] < 1.0) {
+            small[numSmall++] = g;
+        } else {
+            large[numLarge++] = g;
+        }
+    }
+    while (numLarge > 0u)
+        keep(large[--numLarge]);
+    while (numSmall > 0u)
+        keep(small[--numSmall]);
+}
+
+} /* namespace sharemind { */
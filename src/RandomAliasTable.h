@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+
+#ifndef SHAREMIND_LIBRANDOM_RANDOMALIASTABLE_H
+#define SHAREMIND_LIBRANDOM_RANDOMALIASTABLE_H
+
+#include "RandomEngine.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace sharemind {
+
+/**
+ * \brief Samples indexes with probabilities proportional to given weights
+ *        using the alias method of Walker, constructed as given by Vose.
+ *
+ * The weights are split into blocks of BlockSize entries, each of which gets
+ * its own alias table. Larger tables have an alias table of the blocks on
+ * top, so a draw takes a block and then an entry of that block. The blocks
+ * are constructed in parallel, and the tables only depend on the weights,
+ * not on the number of threads used.
+ *
+ * Every draw takes a pair of 64-bit words per level: a bounded integer which
+ * selects an entry, and a fraction which is compared to the probability of
+ * keeping the entry instead of its alias. The words of DrawsPerRequest draws
+ * are generated with a single fillBytes call, so the output only depends on
+ * the seed of the engine and the sequence of calls.
+ */
+class RandomAliasTable {
+
+public: /* Types: */
+
+    SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(RandomEngine::Exception,
+                                                   InvalidWeightsException);
+
+public: /* Constants: */
+
+    /** The number of entries in the alias table of a block. */
+    static constexpr std::size_t BlockSize = 1u << 20u;
+
+    /** The number of draws generated per fillBytes call. */
+    static constexpr std::size_t DrawsPerRequest = 256u;
+
+public: /* Methods: */
+
+    /**
+     * \param[in] weights the non-negative weights of the entries.
+     * \param[in] size the number of weights.
+     * \param[in] threads the number of threads to construct the blocks
+     *                    with, or 0 for the number of hardware threads.
+     * \throws InvalidWeightsException if there are no weights, a weight is
+     *         negative or not finite, or all weights are zero.
+     */
+    RandomAliasTable(double const * weights,
+                     std::size_t size,
+                     unsigned threads = 1u);
+
+    inline std::size_t size() const noexcept { return m_size; }
+
+    /**
+     * \brief Fills the given array with indexes drawn independently with
+     *        probabilities proportional to their weights.
+     * \param[in] engine a RandomEngine or a RandomEngineFacade.
+     */
+    template <typename Engine>
+    inline void sample(Engine & engine, std::uint64_t * out, std::size_t count)
+            const noexcept
+    {
+        std::size_t const wordsPerDraw = m_blocks.size() > 1u ? 4u : 2u;
+        std::uint64_t words[4u * DrawsPerRequest];
+        while (count > 0u) {
+            auto const n = (count < DrawsPerRequest) ? count : DrawsPerRequest;
+            engine.fillBytes(words, n * wordsPerDraw * sizeof(words[0u]));
+            auto w = words;
+            for (std::size_t i = 0u; i < n; ++i, w += wordsPerDraw) {
+                if (wordsPerDraw == 2u) {
+                    out[i] = draw(m_blocks[0u], w, engine);
+                } else {
+                    auto const block = draw(m_top, w, engine);
+                    out[i] = block * BlockSize
+                             + draw(m_blocks[block], w + 2u, engine);
+                }
+            }
+            out += n;
+            count -= n;
+        }
+    }
+
+private: /* Types: */
+
+    struct Table {
+        /** The fraction words below which an entry is kept. */
+        std::vector<std::uint64_t> thresholds;
+        std::vector<std::uint32_t> aliases;
+    };
+
+    struct Scratch;
+
+private: /* Methods: */
+
+    template <typename Engine>
+    static inline std::uint64_t draw(Table const & table,
+                                     std::uint64_t const * const words,
+                                     Engine & engine) noexcept
+    {
+        auto const i = bounded(words[0u], table.aliases.size(), engine);
+        return (words[1u] < table.thresholds[i]) ? i : table.aliases[i];
+    }
+
+    /**
+     * \returns the given word mapped to [0, bound), or a replacement word
+     *          drawn from the engine if the word would introduce bias.
+     */
+    template <typename Engine>
+    static inline std::uint64_t bounded(std::uint64_t word,
+                                        std::uint64_t const bound,
+                                        Engine & engine) noexcept
+    {
+        assert(bound > 0u);
+        #ifdef __SIZEOF_INT128__
+        // "Fast Random Integer Generation in an Interval" by Lemire, 2019:
+        using UInt128 = unsigned __int128;
+        auto m = static_cast<UInt128>(word) * bound;
+        if (static_cast<std::uint64_t>(m) < bound) {
+            auto const threshold = (0u - bound) % bound;
+            while (static_cast<std::uint64_t>(m) < threshold) {
+                engine.fillBytes(&word, sizeof(word));
+                m = static_cast<UInt128>(word) * bound;
+            }
+        }
+        return static_cast<std::uint64_t>(m >> 64u);
+        #else
+        auto const threshold = (0u - bound) % bound;
+        while (word < threshold)
+            engine.fillBytes(&word, sizeof(word));
+        return word % bound;
+        #endif
+    }
+
+    static void buildTable(double const * weights,
+                           std::size_t size,
+                           double sum,
+                           Table & table,
+                           Scratch & scratch) noexcept;
+
+private: /* Fields: */
+
+    std::size_t m_size;
+
+    /** The alias table of the blocks, if there is more than one block. */
+    Table m_top;
+
+    std::vector<Table> m_blocks;
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_RANDOMALIASTABLE_H */
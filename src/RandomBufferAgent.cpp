@@ -20,54 +20,366 @@
 
 #include "RandomBufferAgent.h"
 
-#include <sharemind/Durations.h>
+#include <chrono>
+#include <limits>
 #include <sharemind/PotentiallyVoidTypeInfo.h>
+#include <utility>
 
 
 namespace sharemind {
 
+namespace {
+
+/* The maximum number of bytes generated before making them available to the
+   consumer: */
+constexpr static std::size_t const FILL_CHUNK_SIZE = 64u * 1024u;
+
+/* How often the size of an adaptive buffer is reconsidered: */
+constexpr static std::chrono::milliseconds const ADAPT_PERIOD{100};
+
+} // anonymous namespace
+
+struct RandomBufferAgent::AdaptState {
+    std::chrono::steady_clock::time_point lastCheck;
+    std::uint64_t lastStallCount;
+    std::uint64_t lastTotalRead;
+    unsigned quietPeriods;
+    std::size_t targetSize;
+};
+
 RandomBufferAgent::RandomBufferAgent(
         std::shared_ptr<RandomEngine> randomEngine,
-        size_t const bufferSize)
+        size_t const bufferSize,
+        unsigned const numaNode,
+        unsigned const bufferFlags,
+        size_t const minBufferSize)
    : m_engine{std::move(randomEngine)}
-   , m_buffer(bufferSize)
+   , m_numaNode((numaNode != NoNumaNode
+                  && NumaTopology::instance().hasNode(numaNode))
+                 ? numaNode
+                 : NoNumaNode)
+   , m_minBufferSize((minBufferSize > 0u && minBufferSize < bufferSize)
+                     ? minBufferSize
+                     : bufferSize)
+   , m_buffer(m_minBufferSize, bufferFlags, m_numaNode, bufferSize)
+   , m_startTime(std::chrono::steady_clock::now())
    , m_thread{&RandomBufferAgent::fillerThread, this}
 {}
 
 RandomBufferAgent::~RandomBufferAgent() noexcept {
-    m_stoppable.stop();
+    m_buffer.close();
     m_thread.join();
+    while (serveAsyncRequest());
 }
 
 void RandomBufferAgent::fillBytes(void * buffer,
                                   size_t bufferSize) noexcept
 {
+    m_stats.recordRequest(bufferSize);
+    readBuffer(buffer, bufferSize);
+}
+
+void RandomBufferAgent::fillBytesAsync(void * buffer,
+                                       size_t bufferSize,
+                                       std::function<void ()> callback)
+        noexcept
+{
+    m_stats.recordRequest(bufferSize);
+    if (bufferSize <= 0u) {
+        callback();
+        return;
+    }
+
+    /* Without pending requests the filler does not read the buffer, so the
+       request can be served from it directly if it has enough data: */
+    if (m_asyncPending.load(std::memory_order_acquire) <= 0u
+        && m_buffer.dataAvailable() >= bufferSize)
+    {
+        readBuffer(buffer, bufferSize);
+        callback();
+        return;
+    }
+
+    AsyncRequest request{buffer, bufferSize, std::move(callback), false};
+    try {
+        std::lock_guard<std::mutex> const guard(m_asyncMutex);
+        m_asyncRequests.emplace_back(std::move(request));
+        m_asyncPending.fetch_add(1u, std::memory_order_release);
+    } catch (...) {
+        // Could not queue the request, serve it synchronously instead:
+        readBuffer(request.buffer, request.size);
+        request.callback();
+        return;
+    }
+    m_buffer.wakeProducer();
+}
+
+void RandomBufferAgent::combineInto(void * buffer,
+                                    size_t bufferSize,
+                                    RandomCombineOp const op,
+                                    size_t const elementSize) noexcept
+{
+    m_stats.recordRequest(bufferSize);
+    assert(bufferSize % elementSize == 0u);
+    RandomCombiner combiner(op, elementSize);
+    readBuffer(buffer, bufferSize, combiner);
+    assert(combiner.complete());
+}
+
+void RandomBufferAgent::readBuffer(void * buffer, size_t bufferSize) noexcept
+{ readBuffer(buffer, bufferSize, RandomCopier()); }
+
+template <typename Output>
+void RandomBufferAgent::readBuffer(void * buffer,
+                                   size_t bufferSize,
+                                   Output && output) noexcept
+{
+    // The filler reads the buffer while serving asynchronous requests:
+    if (m_asyncPending.load(std::memory_order_acquire) > 0u)
+        waitAsyncRequests();
     for (;;) {
-        const auto read = m_buffer.read(buffer, bufferSize);
+        const auto read = m_buffer.read(buffer, bufferSize, output);
         assert(read <= bufferSize);
         if (read >= bufferSize)
             return;
         buffer = ptrAdd(buffer, read);
         bufferSize -= read;
+        auto const stallStart = std::chrono::steady_clock::now();
         m_buffer.waitDataAvailable();
+        m_stats.recordConsumerStall(std::chrono::steady_clock::now()
+                                    - stallStart);
     }
 }
 
+void RandomBufferAgent::reserve(size_t const size,
+                                std::chrono::nanoseconds const within)
+        noexcept
+{
+    if (size <= 0u || within <= std::chrono::nanoseconds::zero())
+        return;
+    auto const now = std::chrono::steady_clock::now();
+    auto const deadline =
+            (within < std::chrono::steady_clock::time_point::max() - now)
+            ? now + std::chrono::duration_cast<
+                        std::chrono::steady_clock::duration>(within)
+            : std::chrono::steady_clock::time_point::max();
+    auto const end = m_buffer.totalRead() + size;
+    {
+        std::lock_guard<std::mutex> const guard(m_reservationMutex);
+        if (m_reservationEnd <= m_buffer.totalWritten()
+            || now >= m_reservationDeadline)
+        {
+            m_reservationEnd = end;
+            m_reservationDeadline = deadline;
+        } else {
+            if (m_reservationEnd < end)
+                m_reservationEnd = end;
+            if (m_reservationDeadline < deadline)
+                m_reservationDeadline = deadline;
+        }
+    }
+    m_buffer.wakeProducer();
+}
+
+void RandomBufferAgent::waitAsyncRequests() noexcept {
+    auto const stallStart = std::chrono::steady_clock::now();
+    {
+        std::unique_lock<std::mutex> lock(m_asyncMutex);
+        m_asyncServed.wait(lock,
+                           [this]() noexcept
+                           { return m_asyncRequests.empty(); });
+    }
+    m_stats.recordConsumerStall(std::chrono::steady_clock::now()
+                                - stallStart);
+}
+
+size_t RandomBufferAgent::bufferSize() const noexcept
+{ return m_buffer.capacity(); }
+
+void RandomBufferAgent::getStats(SharemindRandomEngineStats & stats)
+        const noexcept
+{
+    m_engine->getStats(stats);
+    m_stats.addToWrapped(stats);
+    stats.fillerTotalNanoseconds += RandomEngineStats::toCount(
+                std::chrono::steady_clock::now() - m_startTime);
+}
+
 void RandomBufferAgent::fillerThread() noexcept {
-    struct GracefulStop {};
-    try {
+    if (m_numaNode != NoNumaNode)
+        NumaTopology::instance().bindCurrentThreadToNode(m_numaNode);
+
+    if (m_minBufferSize >= m_buffer.maxCapacity()) {
         for (;;) {
-            m_buffer.write(
-                        [this](void * buffer, size_t const bufferSize) noexcept
-                        {
-                            m_engine->fillBytes(buffer, bufferSize);
-                            return bufferSize;
-                        });
-            m_buffer.waitSpaceAvailable(
-                        Stoppable::TestActor<GracefulStop>{m_stoppable},
-                        sharemind::StaticLoopDuration<10>{});
+            /* The buffer is not refilled before asynchronous requests have
+               been served, as they continue the stream from the buffer: */
+            if (serveAsyncRequest())
+                continue;
+            // Reserved bytes are generated first, as soon as they fit:
+            if (reservedSize() > 0u && fillChunk())
+                continue;
+            if (m_buffer.waitSpaceAvailable()) {
+                fillChunk();
+            } else {
+                return;
+            }
         }
-    } catch (const GracefulStop &) {}
+    }
+
+    AdaptState state{std::chrono::steady_clock::now(),
+                     0u,
+                     0u,
+                     0u,
+                     m_buffer.capacity()};
+    for (;;) {
+        if (serveAsyncRequest()) {
+            adaptTargetSize(state);
+            continue;
+        }
+
+        auto const capacity = m_buffer.capacity();
+        if (auto const reserved = reservedSize()) {
+            // Grow to hold the reserved bytes:
+            auto const maxCapacity = m_buffer.maxCapacity();
+            auto const wanted =
+                    (reserved < maxCapacity) ? reserved : maxCapacity;
+            if (state.targetSize < wanted)
+                state.targetSize = wanted;
+            if (state.targetSize <= capacity && fillChunk()) {
+                adaptTargetSize(state);
+                continue;
+            }
+        }
+
+        if (state.targetSize != capacity && m_buffer.resize(state.targetSize))
+            continue;
+
+        /* When shrinking, the buffer can only be resized once the consumer
+           has drained it enough for the data to fit: */
+        if (state.targetSize < capacity) {
+            if (!m_buffer.waitDrained(state.targetSize, ADAPT_PERIOD))
+                return;
+        } else if (m_buffer.waitSpaceAvailable(ADAPT_PERIOD)) {
+            fillChunk();
+        } else {
+            return;
+        }
+        adaptTargetSize(state);
+    }
+}
+
+void RandomBufferAgent::generate(void * buffer, size_t bufferSize) noexcept
+{
+    auto const start = std::chrono::steady_clock::now();
+    m_engine->fillBytes(buffer, bufferSize);
+    m_stats.recordFillerBusy(std::chrono::steady_clock::now() - start);
+}
+
+bool RandomBufferAgent::fillChunk() noexcept {
+    return m_buffer.write([this](void * buffer, size_t bufferSize) noexcept {
+                              if (bufferSize > FILL_CHUNK_SIZE)
+                                  bufferSize = FILL_CHUNK_SIZE;
+                              generate(buffer, bufferSize);
+                              return bufferSize;
+                          }) > 0u;
+}
+
+size_t RandomBufferAgent::reservedSize() noexcept {
+    std::lock_guard<std::mutex> const guard(m_reservationMutex);
+    if (m_reservationEnd <= m_buffer.totalWritten())
+        return 0u;
+    if (std::chrono::steady_clock::now() >= m_reservationDeadline) {
+        m_reservationEnd = 0u;
+        return 0u;
+    }
+    auto const r = m_reservationEnd - m_buffer.totalRead();
+    return (r < std::numeric_limits<size_t>::max())
+           ? static_cast<size_t>(r)
+           : std::numeric_limits<size_t>::max();
+}
+
+bool RandomBufferAgent::serveAsyncRequest() noexcept {
+    /* Only this function removes requests, hence the front request stays
+       valid while the lock is released: */
+    AsyncRequest * request;
+    {
+        std::lock_guard<std::mutex> const guard(m_asyncMutex);
+        if (m_asyncRequests.empty())
+            return false;
+        request = &m_asyncRequests.front();
+    }
+
+    size_t size;
+    if (!request->drained) {
+        // The unread contents of the buffer precede the generated bytes:
+        size = m_buffer.read(request->buffer, request->size);
+        request->drained = true;
+    } else {
+        size = (request->size > FILL_CHUNK_SIZE)
+               ? FILL_CHUNK_SIZE
+               : request->size;
+        generate(request->buffer, size);
+    }
+    request->buffer = ptrAdd(request->buffer, size);
+    request->size -= size;
+    if (request->size > 0u)
+        return true;
+
+    std::function<void ()> callback;
+    {
+        std::lock_guard<std::mutex> const guard(m_asyncMutex);
+        callback = std::move(request->callback);
+        m_asyncRequests.pop_front();
+        m_asyncPending.fetch_sub(1u, std::memory_order_release);
+    }
+    m_asyncServed.notify_all();
+    callback();
+    return true;
+}
+
+void RandomBufferAgent::adaptTargetSize(AdaptState & state) const noexcept {
+    auto const capacity = m_buffer.capacity();
+    auto const now = std::chrono::steady_clock::now();
+    if (now - state.lastCheck < ADAPT_PERIOD)
+        return;
+    state.lastCheck = now;
+
+    auto const stallCount = m_stats.consumerStalls();
+    auto const totalRead = m_buffer.totalRead();
+    bool const stalled = stallCount > state.lastStallCount;
+    auto const consumed = totalRead - state.lastTotalRead;
+    state.lastStallCount = stallCount;
+    state.lastTotalRead = totalRead;
+    state.targetSize = adaptedTargetSize(state.targetSize,
+                                         capacity,
+                                         m_minBufferSize,
+                                         m_buffer.maxCapacity(),
+                                         stalled,
+                                         consumed,
+                                         state.quietPeriods);
+}
+
+size_t RandomBufferAgent::adaptedTargetSize(size_t const targetSize,
+                                            size_t const capacity,
+                                            size_t const minCapacity,
+                                            size_t const maxCapacity,
+                                            bool const stalled,
+                                            std::uint64_t const consumed,
+                                            unsigned & quietPeriods) noexcept
+{
+    // Grow when the consumer had to wait:
+    if (stalled) {
+        quietPeriods = 0u;
+        return (capacity > maxCapacity / 2u) ? maxCapacity : capacity * 2u;
+    }
+    if (consumed * AdaptShrinkUsage >= capacity) {
+        quietPeriods = 0u;
+    } else if (++quietPeriods >= AdaptShrinkPeriods) {
+        // The consumer has used only a small part for a long time:
+        quietPeriods = 0u;
+        return (capacity / 2u < minCapacity) ? minCapacity : capacity / 2u;
+    }
+    return targetSize;
 }
 
 } /* namespace sharemind { */
@@ -22,36 +22,186 @@
 
 #include "RandomEngine.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory>
-#include <sharemind/CircBufferSCSP.h>
-#include <sharemind/Stoppable.h>
+#include <mutex>
 #include <thread>
 #include "librandom.h"
+#include "NumaTopology.h"
+#include "RandomRingBuffer.h"
 
 
 namespace sharemind {
 
 class RandomBufferAgent: public RandomEngine {
 
+public: /* Constants: */
+
+    /** Indicates that no NUMA placement is to be done. */
+    static constexpr unsigned NoNumaNode = NumaTopology::NoNode;
+
+    /**
+     * An adaptive buffer is shrunk after the consumer has used less than a
+     * 1/AdaptShrinkUsage part of it without stalling for AdaptShrinkPeriods
+     * periods.
+     */
+    static constexpr unsigned AdaptShrinkPeriods = 50u;
+    static constexpr std::size_t AdaptShrinkUsage = 4u;
+
 public: /* Methods: */
 
+    /**
+     * \param[in] numaNode if not NoNumaNode, the filler thread is pinned to
+     *                     the CPUs of the given node and the buffer memory is
+     *                     placed on that node.
+     * \param[in] bufferFlags bitwise OR of SharemindRandomEngineBufferFlags.
+     * \param[in] minBufferSize if nonzero and less than bufferSize, the buffer
+     *                          starts at this size and adapts its size to the
+     *                          consumption between minBufferSize and
+     *                          bufferSize.
+     */
     RandomBufferAgent(std::shared_ptr<RandomEngine> randomEngine,
-                      size_t const bufferSize);
+                      size_t const bufferSize,
+                      unsigned const numaNode = NoNumaNode,
+                      unsigned const bufferFlags = 0u,
+                      size_t const minBufferSize = 0u);
 
     ~RandomBufferAgent() noexcept override;
 
     void fillBytes(void * buffer, size_t bufferSize) noexcept override;
 
+    /**
+     * \brief Queues the request for the filler thread, which copies the
+     *        unread contents of the buffer into the given buffer, generates
+     *        the rest directly into it and calls the callback.
+     *
+     * The buffer is only refilled after the request, hence the request gets
+     * the same bytes fillBytes would, and later requests block until the
+     * pending asynchronous requests have been served. Requests which can be
+     * served from the buffer right away are completed before returning.
+     * \note Requests still pending on destruction are completed by the
+     *       destructor.
+     */
+    void fillBytesAsync(void * buffer,
+                        size_t bufferSize,
+                        std::function<void ()> callback) noexcept override;
+
+    /** \brief Combines the buffered bytes directly into the given buffer. */
+    void combineInto(void * buffer,
+                     size_t bufferSize,
+                     RandomCombineOp op,
+                     size_t elementSize) noexcept override;
+
+    /**
+     * \brief Makes the filler thread refill the buffer as soon as there is
+     *        any space until the next size bytes are in the buffer or the
+     *        given time has elapsed.
+     *
+     * An adaptive buffer is grown up to its maximum size to hold the bytes.
+     * It is shrunk again like after any other burst of consumption. Hints
+     * given before the previous one has been satisfied or has expired
+     * extend it.
+     */
+    void reserve(size_t size, std::chrono::nanoseconds within)
+            noexcept override;
+
+    size_t bufferSize() const noexcept override;
+
+    void getStats(SharemindRandomEngineStats & stats) const noexcept override;
+
+    /**
+     * \brief Decides the size of an adaptive buffer after a period: the size
+     *        is doubled up to maxCapacity if the consumer stalled, and halved
+     *        down to minCapacity after AdaptShrinkPeriods quiet periods.
+     * \param[in] targetSize the size decided so far.
+     * \param[in] capacity the current size of the buffer.
+     * \param[in] stalled whether the consumer stalled during the period.
+     * \param[in] consumed the number of bytes read during the period.
+     * \param[in,out] quietPeriods the number of consecutive quiet periods.
+     * \returns the new size to resize the buffer to.
+     */
+    static size_t adaptedTargetSize(size_t targetSize,
+                                    size_t capacity,
+                                    size_t minCapacity,
+                                    size_t maxCapacity,
+                                    bool stalled,
+                                    std::uint64_t consumed,
+                                    unsigned & quietPeriods) noexcept;
+
+private: /* Types: */
+
+    struct AdaptState;
+
+    struct AsyncRequest {
+        void * buffer;
+        size_t size;
+        std::function<void ()> callback;
+
+        /// Whether the contents of the buffer have been copied:
+        bool drained;
+    };
+
 private: /* Methods: */
 
+    void readBuffer(void * buffer, size_t bufferSize) noexcept;
+
+    /** \brief Blocks until all asynchronous requests have been served. */
+    void waitAsyncRequests() noexcept;
+
+    template <typename Output>
+    void readBuffer(void * buffer, size_t bufferSize, Output && output)
+            noexcept;
+
     void fillerThread() noexcept;
 
+    void generate(void * buffer, size_t bufferSize) noexcept;
+
+    /** \returns whether any bytes were written to the buffer. */
+    bool fillChunk() noexcept;
+
+    /**
+     * \returns the number of bytes the buffer needs to hold for the pending
+     *          reservation, or 0 if there is no reservation pending.
+     */
+    size_t reservedSize() noexcept;
+
+    /**
+     * \brief Serves the next chunk of the oldest asynchronous request from
+     *        the buffer or the engine, completing the request if it was the
+     *        last chunk.
+     * \returns false if there were no pending requests, true otherwise.
+     */
+    bool serveAsyncRequest() noexcept;
+
+    void adaptTargetSize(AdaptState & state) const noexcept;
+
 public: /* Fields: */
 
     std::shared_ptr<RandomEngine> m_engine;
-    CircBufferSCSP<void> m_buffer;
-    Stoppable m_stoppable;
+    unsigned const m_numaNode;
+    size_t const m_minBufferSize;
+    RandomRingBuffer m_buffer;
+
+    std::chrono::steady_clock::time_point const m_startTime;
+
+    std::mutex m_asyncMutex;
+    std::condition_variable m_asyncServed;
+    std::deque<AsyncRequest> m_asyncRequests;
+
+    /// The number of queued asynchronous requests:
+    std::atomic<std::size_t> m_asyncPending{0u};
+
+    /// The end of the reserved bytes in the stream and its deadline:
+    std::mutex m_reservationMutex;
+    std::uint64_t m_reservationEnd = 0u;
+    std::chrono::steady_clock::time_point m_reservationDeadline;
+
     std::thread m_thread;
 
 };
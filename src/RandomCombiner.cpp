@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "RandomCombiner.h"
+
+#include <cstdint>
+
+
+namespace sharemind {
+namespace {
+
+template <typename T> struct XorOp
+{ static inline T apply(T a, T b) noexcept { return a ^ b; } };
+
+template <typename T> struct AddOp
+{ static inline T apply(T a, T b) noexcept { return static_cast<T>(a + b); } };
+
+template <typename T> struct SubtractOp
+{ static inline T apply(T a, T b) noexcept { return static_cast<T>(a - b); } };
+
+/* The data may be unaligned, hence the elements are accessed through memcpy,
+   which compilers turn into plain (vectorizable) loads and stores: */
+template <template <typename> class Op, typename T>
+void combineKernel(unsigned char * dst,
+                   unsigned char const * src,
+                   std::size_t count) noexcept
+{
+    for (std::size_t i = 0u; i < count; ++i) {
+        T a;
+        T b;
+        std::memcpy(&a, dst + i * sizeof(T), sizeof(T));
+        std::memcpy(&b, src + i * sizeof(T), sizeof(T));
+        a = Op<T>::apply(a, b);
+        std::memcpy(dst + i * sizeof(T), &a, sizeof(T));
+    }
+}
+
+template <template <typename> class Op>
+RandomCombiner::Kernel kernelForSize(std::size_t const elementSize) noexcept {
+    switch (elementSize) {
+        case 1u: return &combineKernel<Op, std::uint8_t>;
+        case 2u: return &combineKernel<Op, std::uint16_t>;
+        case 4u: return &combineKernel<Op, std::uint32_t>;
+        default:
+            assert(elementSize == 8u);
+            return &combineKernel<Op, std::uint64_t>;
+    }
+}
+
+RandomCombiner::Kernel kernelFor(RandomCombineOp const op,
+                                 std::size_t const elementSize) noexcept
+{
+    switch (op) {
+        case RandomCombineOp::Xor:
+            assert(elementSize == 1u);
+            return kernelForSize<XorOp>(elementSize);
+        case RandomCombineOp::Add:
+            return kernelForSize<AddOp>(elementSize);
+        default:
+            assert(op == RandomCombineOp::Subtract);
+            return kernelForSize<SubtractOp>(elementSize);
+    }
+}
+
+} // anonymous namespace
+
+RandomCombiner::RandomCombiner(RandomCombineOp const op,
+                               std::size_t const elementSize) noexcept
+    : m_kernel(kernelFor(op, elementSize))
+    , m_elementSize(elementSize)
+{}
+
+} /* namespace sharemind { */
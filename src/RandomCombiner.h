@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_RANDOMCOMBINER_H
+#define SHAREMIND_LIBRANDOM_RANDOMCOMBINER_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+
+namespace sharemind {
+
+/** \brief How random bytes are combined into existing data. */
+enum class RandomCombineOp {
+    /** data ^= random */
+    Xor,
+
+    /** data += random, element-wise modulo 2^(8 * elementSize) */
+    Add,
+
+    /** data -= random, element-wise modulo 2^(8 * elementSize) */
+    Subtract
+};
+
+/** \brief Copies pieces of keystream into a destination buffer. */
+struct RandomCopier {
+    inline void operator()(void * dst, void const * src, std::size_t n)
+            const noexcept
+    { std::memcpy(dst, src, n); }
+};
+
+/**
+ * \brief Combines pieces of keystream into a destination buffer as they are
+ *        generated. Used by engines in place of memcpy when combining into
+ *        rather than overwriting the destination.
+ * \note The pieces must be given in order, each starting where the previous
+ *       one ended. Elements split between pieces are combined once complete.
+ */
+class RandomCombiner {
+
+public: /* Types: */
+
+    /** Combines count elements of src into dst. */
+    using Kernel = void (*)(unsigned char * dst,
+                            unsigned char const * src,
+                            std::size_t count);
+
+public: /* Methods: */
+
+    /**
+     * \pre elementSize is 1, 2, 4 or 8.
+     * \pre For Xor, elementSize is 1.
+     */
+    RandomCombiner(RandomCombineOp op, std::size_t elementSize) noexcept;
+
+    /** \brief Combines the given n bytes of keystream into dst. */
+    inline void operator()(void * dst, void const * src, std::size_t n)
+            noexcept
+    {
+        auto d = static_cast<unsigned char *>(dst);
+        auto s = static_cast<unsigned char const *>(src);
+        if (m_pending > 0u) {
+            auto const missing = m_elementSize - m_pending;
+            auto const k = (n < missing) ? n : missing;
+            std::memcpy(m_pendingBytes + m_pending, s, k);
+            m_pending += k;
+            if (m_pending < m_elementSize)
+                return;
+            m_kernel(d + k - m_elementSize, m_pendingBytes, 1u);
+            m_pending = 0u;
+            d += k;
+            s += k;
+            n -= k;
+        }
+        auto const count = n / m_elementSize;
+        m_kernel(d, s, count);
+        auto const done = count * m_elementSize;
+        m_pending = n - done;
+        std::memcpy(m_pendingBytes, s + done, m_pending);
+    }
+
+    /** \returns whether no element is waiting for more keystream. */
+    inline bool complete() const noexcept { return m_pending == 0u; }
+
+private: /* Fields: */
+
+    Kernel const m_kernel;
+    std::size_t const m_elementSize;
+    std::size_t m_pending = 0u;
+    unsigned char m_pendingBytes[8u];
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_RANDOMCOMBINER_H */
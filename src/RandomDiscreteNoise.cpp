@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+
+#include "RandomEngine.h"
+
+#include <cstdint>
+#include <limits>
+#include "RandomWordSource.h"
+
+
+/*
+  The samplers of the discrete Laplace and Gaussian distributions from "The
+  Discrete Gaussian for Differential Privacy" by Canonne, Kamath and Steinke,
+  2020. They only use integer arithmetic, hence their output distribution is
+  exact, apart from the saturation of the discrete Laplace samples to 64 bits
+  and the rejection of the discrete Gaussian candidates y with |y|bt - a of
+  2^64 or more, both of which happen with probability below exp(-2^30).
+*/
+
+namespace sharemind {
+
+#ifdef __SIZEOF_INT128__
+
+namespace {
+
+using UInt128 = unsigned __int128;
+
+constexpr static UInt128 const UINT64_LIMIT = UInt128(1u) << 64u;
+
+/** \returns a number uniformly distributed in [0, bound). */
+UInt128 uniformBelow(RandomWordSource & source, UInt128 const bound) noexcept
+{
+    assert(bound > 0u);
+    if (bound <= UINT64_LIMIT) {
+        if (bound == UINT64_LIMIT)
+            return source.word();
+        return source.uniformBelow(static_cast<std::uint64_t>(bound));
+    }
+    // Sample the bits up to the highest bit of the bound and reject:
+    auto const high = static_cast<std::uint64_t>((bound - 1u) >> 64u);
+    auto mask = high;
+    for (unsigned shift = 1u; shift < 64u; shift *= 2u)
+        mask |= mask >> shift;
+    for (;;) {
+        auto const r = (UInt128(source.word() & mask) << 64u) | source.word();
+        if (r < bound)
+            return r;
+    }
+}
+
+/** \returns true with probability numerator / denominator. */
+inline bool bernoulli(RandomWordSource & source,
+                      UInt128 const numerator,
+                      UInt128 const denominator) noexcept
+{ return uniformBelow(source, denominator) < numerator; }
+
+/** \returns true with probability exp(-numerator / denominator). */
+bool bernoulliExp(RandomWordSource & source,
+                  UInt128 numerator,
+                  UInt128 const denominator) noexcept
+{
+    assert(denominator > 0u);
+    // exp(-(1 + g)) = exp(-1) * exp(-g):
+    while (numerator > denominator) {
+        if (!bernoulliExp(source, 1u, 1u))
+            return false;
+        numerator -= denominator;
+    }
+    // For g in [0, 1], the index of the first failure of Bernoulli(g / k):
+    UInt128 k = 1u;
+    while (bernoulli(source, numerator, denominator * k))
+        ++k;
+    return (k % 2u) != 0u;
+}
+
+/** \returns a sample of the discrete Laplace distribution with scale t/s. */
+std::int64_t discreteLaplace(RandomWordSource & source,
+                             std::uint32_t const t,
+                             std::uint32_t const s) noexcept
+{
+    for (;;) {
+        auto const u = source.uniformBelow(t);
+        if (!bernoulliExp(source, u, t))
+            continue;
+        UInt128 v = 0u;
+        while (bernoulliExp(source, 1u, 1u))
+            ++v;
+        auto const y = (u + t * v) / s;
+        bool const negative = source.bit();
+        if (negative && y == 0u)
+            continue;
+        auto const magnitude =
+                (y > static_cast<std::uint64_t>(
+                         std::numeric_limits<std::int64_t>::max()))
+                ? std::numeric_limits<std::int64_t>::max()
+                : static_cast<std::int64_t>(y);
+        return negative ? -magnitude : magnitude;
+    }
+}
+
+/** \returns floor(sqrt(numerator / denominator)). */
+std::uint32_t floorSqrt(std::uint32_t const numerator,
+                        std::uint32_t const denominator) noexcept
+{
+    // For integers r, r^2 <= n/d exactly when r^2 <= floor(n/d):
+    std::uint64_t const n = numerator / denominator;
+    std::uint64_t r = 0u;
+    for (std::uint64_t bit = std::uint64_t(1u) << 16u; bit > 0u; bit >>= 1u)
+        if ((r + bit) * (r + bit) <= n)
+            r += bit;
+    return static_cast<std::uint32_t>(r);
+}
+
+} // anonymous namespace
+
+void RandomEngine::fillDiscreteLaplace(std::int64_t * const buffer,
+                                       size_t const count,
+                                       std::uint32_t const scaleNumerator,
+                                       std::uint32_t const scaleDenominator)
+{
+    if (scaleNumerator <= 0u || scaleDenominator <= 0u)
+        throw InvalidParameterException();
+    RandomWordSource source(*this);
+    for (size_t i = 0u; i < count; ++i)
+        buffer[i] = discreteLaplace(source, scaleNumerator, scaleDenominator);
+}
+
+void RandomEngine::fillDiscreteGaussian(
+        std::int64_t * const buffer,
+        size_t const count,
+        std::uint32_t const varianceNumerator,
+        std::uint32_t const varianceDenominator)
+{
+    if (varianceNumerator <= 0u || varianceDenominator <= 0u)
+        throw InvalidParameterException();
+    RandomWordSource source(*this);
+    UInt128 const a = varianceNumerator;
+    UInt128 const b = varianceDenominator;
+    std::uint32_t const t = floorSqrt(varianceNumerator, varianceDenominator)
+                            + 1u;
+    /* Candidates y are accepted with probability
+       exp(-(|y| - a/(bt))^2 / (2a/b)) = exp(-(|y|bt - a)^2 / (2abt^2)): */
+    UInt128 const denominator = 2u * a * b * t * t;
+    for (size_t i = 0u; i < count;) {
+        auto const y = discreteLaplace(source, t, 1u);
+        auto const magnitude = (y < 0)
+                               ? -static_cast<UInt128>(y)
+                               : static_cast<UInt128>(y);
+        auto const scaled = magnitude * b * t;
+        auto const difference = (scaled < a) ? a - scaled : scaled - a;
+        if (difference >= UINT64_LIMIT)
+            continue;
+        if (bernoulliExp(source, difference * difference, denominator))
+            buffer[i++] = y;
+    }
+}
+
+#else
+
+void RandomEngine::fillDiscreteLaplace(std::int64_t *,
+                                       size_t,
+                                       std::uint32_t,
+                                       std::uint32_t)
+{ throw GeneratorNotSupportedException(); }
+
+void RandomEngine::fillDiscreteGaussian(std::int64_t *,
+                                        size_t,
+                                        std::uint32_t,
+                                        std::uint32_t)
+{ throw GeneratorNotSupportedException(); }
+
+#endif
+
+} /* namespace sharemind { */
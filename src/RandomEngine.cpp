@@ -19,9 +19,57 @@
 
 #include "RandomEngine.h"
 
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include "NormalKernels.h"
+#include "RandomWordSource.h"
+
 
 namespace sharemind {
 
+namespace {
+
+/* The number of values converted by the normal kernel at a time: */
+constexpr std::size_t const NORMAL_CHUNK_SIZE = 1024u;
+
+constexpr double const DOUBLE_UNIT = 1.0 / 9007199254740992.0; // 2^-53
+constexpr float const FLOAT_UNIT = 1.0f / 16777216.0f; // 2^-24
+
+/* The slow path of the ziggurat by Marsaglia and Tsang, for a word rejected
+   by the fast path of a NormalKernel: */
+double normalSlowPath(RandomWordSource & source, std::uint64_t word) noexcept
+{
+    auto const & t = zigguratTables();
+    for (;;) {
+        auto const layer = word & (ZigguratLayers - 1u);
+        auto const sample = static_cast<std::int32_t>(
+                    static_cast<std::uint32_t>(word >> 32u));
+        auto const magnitude = (sample < 0)
+                               ? 0u - static_cast<std::uint32_t>(sample)
+                               : static_cast<std::uint32_t>(sample);
+        double const x = static_cast<double>(sample) * t.w[layer];
+        if (magnitude < t.k[layer])
+            return x;
+        if (layer == 0u) { // The tail:
+            double a;
+            double b;
+            do {
+                a = -std::log(source.uniformOpen()) / ZigguratR;
+                b = -std::log(source.uniformOpen());
+            } while (b + b < a * a);
+            return (sample > 0) ? ZigguratR + a : -ZigguratR - a;
+        }
+        if (t.f[layer] + source.uniformOpen() * (t.f[layer - 1u] - t.f[layer])
+            < std::exp(-0.5 * x * x))
+            return x;
+        word = source.word();
+    }
+}
+
+} // anonymous namespace
+
 SHAREMIND_DEFINE_EXCEPTION_NOINLINE(sharemind::Exception,
                                     RandomEngine::,
                                     Exception);
@@ -29,7 +77,128 @@ SHAREMIND_DEFINE_EXCEPTION_CONST_MSG_NOINLINE(Exception,
                                               RandomEngine::,
                                               GeneratorNotSupportedException,
                                               "Generator not supported!");
+SHAREMIND_DEFINE_EXCEPTION_CONST_MSG_NOINLINE(
+        Exception,
+        RandomEngine::,
+        StateNotSupportedException,
+        "Saving and restoring the state is not supported by this engine!");
+SHAREMIND_DEFINE_EXCEPTION_CONST_MSG_NOINLINE(Exception,
+                                              RandomEngine::,
+                                              InvalidStateException,
+                                              "Invalid engine state!");
+SHAREMIND_DEFINE_EXCEPTION_CONST_MSG_NOINLINE(
+        Exception,
+        RandomEngine::,
+        InvalidParameterException,
+        "Invalid parameters for the distribution!");
 
 RandomEngine::~RandomEngine() noexcept {}
 
+void RandomEngine::fillBytesV(struct iovec const * const iov,
+                              size_t const iovcnt) noexcept
+{
+    assert(iov || iovcnt == 0u);
+    for (size_t i = 0u; i < iovcnt; ++i)
+        fillBytes(iov[i].iov_base, iov[i].iov_len);
+}
+
+void RandomEngine::combineInto(void * buffer,
+                               size_t size,
+                               RandomCombineOp const op,
+                               size_t const elementSize) noexcept
+{
+    assert(size % elementSize == 0u);
+    RandomCombiner combiner(op, elementSize);
+    alignas(64) unsigned char block[4096u];
+    while (size > 0u) {
+        auto const n = (size < sizeof(block)) ? size : sizeof(block);
+        fillBytes(block, n);
+        combiner(buffer, block, n);
+        buffer = static_cast<unsigned char *>(buffer) + n;
+        size -= n;
+    }
+    assert(combiner.complete());
+}
+
+void RandomEngine::fillUniformDouble(double * const buffer,
+                                     size_t const count) noexcept
+{
+    assert(count <= std::numeric_limits<size_t>::max() / sizeof(double));
+    fillBytes(buffer, count * sizeof(double));
+    for (size_t i = 0u; i < count; ++i) {
+        std::uint64_t word;
+        std::memcpy(&word, buffer + i, sizeof(word));
+        buffer[i] = static_cast<double>(word >> 11u) * DOUBLE_UNIT;
+    }
+}
+
+void RandomEngine::fillUniformFloat(float * const buffer,
+                                    size_t const count) noexcept
+{
+    assert(count <= std::numeric_limits<size_t>::max() / sizeof(float));
+    fillBytes(buffer, count * sizeof(float));
+    for (size_t i = 0u; i < count; ++i) {
+        std::uint32_t word;
+        std::memcpy(&word, buffer + i, sizeof(word));
+        buffer[i] = static_cast<float>(word >> 8u) * FLOAT_UNIT;
+    }
+}
+
+void RandomEngine::fillNormal(double * const buffer,
+                              size_t const count,
+                              double const mean,
+                              double const stddev) noexcept
+{
+    static_assert(sizeof(double) == sizeof(std::uint64_t), "");
+    static NormalKernel const kernel(
+                normalKernel(CpuFeatures::instance().level()));
+    assert(count <= std::numeric_limits<size_t>::max() / sizeof(double));
+    fillBytes(buffer, count * sizeof(double));
+
+    RandomWordSource source(*this);
+    std::uint32_t rejected[NORMAL_CHUNK_SIZE];
+    for (size_t i = 0u; i < count; i += NORMAL_CHUNK_SIZE) {
+        auto const chunk = buffer + i;
+        auto const n = kernel(chunk,
+                              (count - i < NORMAL_CHUNK_SIZE)
+                              ? count - i
+                              : NORMAL_CHUNK_SIZE,
+                              rejected);
+        for (size_t j = 0u; j < n; ++j) {
+            std::uint64_t word;
+            std::memcpy(&word, chunk + rejected[j], sizeof(word));
+            chunk[rejected[j]] = normalSlowPath(source, word);
+        }
+    }
+    if (mean != 0.0 || stddev != 1.0)
+        for (size_t i = 0u; i < count; ++i)
+            buffer[i] = mean + stddev * buffer[i];
+}
+
+size_t RandomEngine::bufferSize() const noexcept { return 0u; }
+
+void RandomEngine::fillBytesAsync(void * const buffer,
+                                  size_t const size,
+                                  std::function<void ()> callback) noexcept
+{
+    fillBytes(buffer, size);
+    callback();
+}
+
+void RandomEngine::reserve(size_t, std::chrono::nanoseconds) noexcept {}
+
+void RandomEngine::getStats(SharemindRandomEngineStats & stats) const noexcept
+{
+    stats = SharemindRandomEngineStats();
+    m_stats.addTo(stats);
+}
+
+size_t RandomEngine::stateSize() const noexcept { return 0u; }
+
+void RandomEngine::saveState(void *) const
+{ throw StateNotSupportedException(); }
+
+void RandomEngine::restoreState(void const *, size_t)
+{ throw StateNotSupportedException(); }
+
 } /* namespace sharemind { */
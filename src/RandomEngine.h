@@ -21,12 +21,18 @@
 #define SHAREMIND_LIBRANDOM_RANDOMENGINE_H
 
 #include "librandom.h"
+#include "RandomCombiner.h"
+#include "RandomEngineStats.h"
 
 #include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <exception>
+#include <functional>
 #include <sharemind/Exception.h>
 #include <sharemind/ExceptionMacros.h>
+#include <type_traits>
 
 
 namespace sharemind {
@@ -39,6 +45,13 @@ public: /* Types: */
     SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(
             Exception,
             GeneratorNotSupportedException);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(
+            Exception,
+            StateNotSupportedException);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(Exception,
+                                                   InvalidStateException);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(Exception,
+                                                   InvalidParameterException);
 
 public: /* Methods: */
 
@@ -46,6 +59,145 @@ public: /* Methods: */
 
     virtual void fillBytes(void * buffer, size_t size) noexcept = 0;
 
+    /**
+     * \brief Fills the given buffers with random bytes in order.
+     * \note Consumes the same random bytes as calling fillBytes() for each
+     *       buffer in turn would, and records the same statistics.
+     * \note The default implementation calls fillBytes() for each buffer.
+     */
+    virtual void fillBytesV(struct iovec const * iov, size_t iovcnt) noexcept;
+
+    /**
+     * \brief Combines size random bytes into the given buffer as they are
+     *        generated, instead of overwriting it.
+     * \pre size is a multiple of elementSize, which is 1, 2, 4 or 8.
+     * \pre For RandomCombineOp::Xor, elementSize is 1.
+     * \note Consumes the same random bytes as fillBytes(buffer, size) would.
+     * \note The default implementation generates the bytes in small blocks
+     *       on the stack using fillBytes.
+     */
+    virtual void combineInto(void * buffer,
+                             size_t size,
+                             RandomCombineOp op,
+                             size_t elementSize) noexcept;
+
+    /**
+     * \returns the current size of the buffer of a buffering engine in bytes,
+     *          or 0 if the engine is not buffered.
+     */
+    virtual size_t bufferSize() const noexcept;
+
+    /**
+     * \brief Fills the given buffer with random bytes and calls the given
+     *        callback when done, possibly before returning.
+     * \note The default implementation is synchronous.
+     * \see SharemindRandomEngine::fillBytesAsync
+     */
+    virtual void fillBytesAsync(void * buffer,
+                                size_t size,
+                                std::function<void ()> callback) noexcept;
+
+    /**
+     * \brief Hints that the next size bytes will be requested within the
+     *        given time, so that a buffering engine can generate them ahead.
+     * \note The default implementation does nothing.
+     * \see SharemindRandomEngine::reserve
+     */
+    virtual void reserve(size_t size, std::chrono::nanoseconds within)
+            noexcept;
+
+    /** \brief Overwrites the given stats with the counters of this engine. */
+    virtual void getStats(SharemindRandomEngineStats & stats) const noexcept;
+
+    /**
+     * \returns the size of the state written by saveState() in bytes, or 0
+     *          if the engine does not support saving its state.
+     * \note Only core engines support saving their state. The size does not
+     *       depend on how much randomness has been generated.
+     */
+    virtual size_t stateSize() const noexcept;
+
+    /**
+     * \brief Writes the current position of the engine in its keystream into
+     *        the given buffer of stateSize() bytes.
+     * \warning The state contains the key of the engine, hence it must be
+     *          protected like the seed.
+     * \throws StateNotSupportedException if the engine does not support
+     *         saving its state.
+     * \see RandomEngineState
+     */
+    virtual void saveState(void * buffer) const;
+
+    /**
+     * \brief Continues the keystream from a state saved by saveState() of an
+     *        engine of the same kind.
+     * \throws StateNotSupportedException if the engine does not support
+     *         restoring its state.
+     * \throws InvalidStateException if the given state is not valid for this
+     *         engine. The engine is not modified in this case.
+     */
+    virtual void restoreState(void const * buffer, size_t size);
+
+    /**
+     * \brief Fills the given array with doubles uniformly distributed in
+     *        [0, 1), each made of the 53 high bits of a 64-bit random word.
+     * \note Consumes the same random bytes as fillBytes(buffer, 8 * count).
+     */
+    void fillUniformDouble(double * buffer, size_t count) noexcept;
+
+    /**
+     * \brief Fills the given array with floats uniformly distributed in
+     *        [0, 1), each made of the 24 high bits of a 32-bit random word.
+     * \note Consumes the same random bytes as fillBytes(buffer, 4 * count).
+     */
+    void fillUniformFloat(float * buffer, size_t count) noexcept;
+
+    /**
+     * \brief Fills the given array with normally distributed doubles using
+     *        the ziggurat method.
+     *
+     * One 64-bit word is generated per value with a single fillBytes call
+     * and converted using the fastest SIMD kernel of the host. The rare
+     * values not accepted by the fast path draw additional randomness from
+     * the engine afterwards. The output only depends on the seed and the
+     * sequence of calls, not on the SIMD level.
+     */
+    void fillNormal(double * buffer,
+                    size_t count,
+                    double mean = 0.0,
+                    double stddev = 1.0) noexcept;
+
+    /**
+     * \brief Fills the given array with samples of the discrete Laplace
+     *        distribution with the given scale, i.e. with the probability of
+     *        z proportional to exp(-|z| * scaleDenominator / scaleNumerator).
+     *
+     * The samples are exact, i.e. computed using integer arithmetic only, and
+     * all randomness is drawn from the engine in blocks.
+     * \throws InvalidParameterException if either parameter is zero.
+     * \throws GeneratorNotSupportedException if the platform lacks 128-bit
+     *         integers.
+     */
+    void fillDiscreteLaplace(std::int64_t * buffer,
+                             size_t count,
+                             std::uint32_t scaleNumerator,
+                             std::uint32_t scaleDenominator = 1u);
+
+    /**
+     * \brief Fills the given array with exact samples of the discrete
+     *        Gaussian distribution with the given variance parameter, i.e.
+     *        with the probability of z proportional to exp(-z^2 / (2 s)) for
+     *        s = varianceNumerator / varianceDenominator.
+     * \throws InvalidParameterException if either parameter is zero.
+     * \throws GeneratorNotSupportedException if the platform lacks 128-bit
+     *         integers.
+     * \see fillDiscreteLaplace
+     */
+    void fillDiscreteGaussian(std::int64_t * buffer,
+                              size_t count,
+                              std::uint32_t varianceNumerator,
+                              std::uint32_t varianceDenominator = 1u);
+
     template <typename T>
     inline void fillBlock(T * begin, T * end) noexcept {
         assert(begin <= end);
@@ -53,6 +205,20 @@ public: /* Methods: */
             fillBytes(begin, sizeof(T) * (end - begin));
     }
 
+    /** \brief XORs size random bytes into the given buffer. */
+    inline void xorBytesInto(void * buffer, size_t size) noexcept
+    { combineInto(buffer, size, RandomCombineOp::Xor, 1u); }
+
+    /** \brief Adds random values to the elements in the given range. */
+    template <typename T>
+    inline void addInto(T * begin, T * end) noexcept
+    { combineBlock(begin, end, RandomCombineOp::Add); }
+
+    /** \brief Subtracts random values from the elements in the given range.*/
+    template <typename T>
+    inline void subFrom(T * begin, T * end) noexcept
+    { combineBlock(begin, end, RandomCombineOp::Subtract); }
+
     template <typename T>
     inline T randomValue() noexcept(noexcept(T(T()))) {
         T value;
@@ -60,6 +226,25 @@ public: /* Methods: */
         return value;
     }
 
+private: /* Methods: */
+
+    template <typename T>
+    inline void combineBlock(T * begin, T * end, RandomCombineOp op) noexcept
+    {
+        static_assert(std::is_integral<T>::value
+                      && std::is_unsigned<T>::value,
+                      "Ring arithmetic requires an unsigned integral type!");
+        static_assert(sizeof(T) == 1u || sizeof(T) == 2u || sizeof(T) == 4u
+                      || sizeof(T) == 8u, "Unsupported element size!");
+        assert(begin <= end);
+        if (begin < end)
+            combineInto(begin, sizeof(T) * (end - begin), op, sizeof(T));
+    }
+
+protected: /* Fields: */
+
+    RandomEngineStats m_stats;
+
 };
 
 } /* namespace sharemind { */
@@ -24,7 +24,9 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <future>
 #include <iterator>
+#include <memory>
 #include <vector>
 #include <type_traits>
 
@@ -63,6 +65,128 @@ public: /* Methods: */
         m_inner->fillBytes (m_inner, memptr, numBytes);
     }
 
+    inline void fillBytesV (struct iovec const * iov, size_t iovcnt) noexcept {
+        assert (m_inner != nullptr);
+        m_inner->fillBytesV (m_inner, iov, iovcnt);
+    }
+
+    inline void fillBytesAsync (void * memptr,
+                                size_t numBytes,
+                                SharemindRandomFillCallback callback,
+                                void * userData) noexcept
+    {
+        assert (m_inner != nullptr);
+        m_inner->fillBytesAsync (m_inner, memptr, numBytes, callback, userData);
+    }
+
+    /**
+     * \returns a future which becomes ready once the given memory region has
+     *          been filled.
+     * \see SharemindRandomEngine::fillBytesAsync
+     */
+    inline std::future<void> fillBytesAsync (void * memptr, size_t numBytes) {
+        assert (m_inner != nullptr);
+        std::unique_ptr<std::promise<void> > promise(new std::promise<void>());
+        auto future(promise->get_future());
+        m_inner->fillBytesAsync (
+                    m_inner,
+                    memptr,
+                    numBytes,
+                    [](void * const p) noexcept {
+                        std::unique_ptr<std::promise<void> > const promise(
+                                    static_cast<std::promise<void> *>(p));
+                        promise->set_value();
+                    },
+                    promise.release());
+        return future;
+    }
+
+    /** \see SharemindRandomEngine::reserve */
+    inline void reserve (size_t numBytes, uint64_t withinNanoseconds)
+            noexcept
+    {
+        assert (m_inner != nullptr);
+        m_inner->reserve (m_inner, numBytes, withinNanoseconds);
+    }
+
+    inline size_t bufferSize() const noexcept {
+        assert (m_inner != nullptr);
+        return m_inner->bufferSize (m_inner);
+    }
+
+    inline SharemindRandomEngineStats stats() const noexcept {
+        assert (m_inner != nullptr);
+        SharemindRandomEngineStats r;
+        m_inner->getStats (m_inner, &r);
+        return r;
+    }
+
+    inline size_t stateSize() const noexcept {
+        assert (m_inner != nullptr);
+        return m_inner->stateSize (m_inner);
+    }
+
+    inline SharemindRandomEngineCtorError saveState (void * memptr,
+                                                     size_t size) const noexcept
+    {
+        assert (m_inner != nullptr);
+        return m_inner->saveState (m_inner, memptr, size);
+    }
+
+    inline SharemindRandomEngineCtorError restoreState (void const * memptr,
+                                                        size_t size) noexcept
+    {
+        assert (m_inner != nullptr);
+        return m_inner->restoreState (m_inner, memptr, size);
+    }
+
+    inline void fillUniformDouble (double * values, size_t count) noexcept {
+        assert (m_inner != nullptr);
+        m_inner->fillUniformDouble (m_inner, values, count);
+    }
+
+    inline void fillUniformFloat (float * values, size_t count) noexcept {
+        assert (m_inner != nullptr);
+        m_inner->fillUniformFloat (m_inner, values, count);
+    }
+
+    inline void fillNormal (double * values,
+                            size_t count,
+                            double mean = 0.0,
+                            double stddev = 1.0) noexcept
+    {
+        assert (m_inner != nullptr);
+        m_inner->fillNormal (m_inner, values, count, mean, stddev);
+    }
+
+    inline SharemindRandomEngineCtorError fillDiscreteLaplace (
+            int64_t * values,
+            size_t count,
+            uint32_t scaleNumerator,
+            uint32_t scaleDenominator = 1u) noexcept
+    {
+        assert (m_inner != nullptr);
+        return m_inner->fillDiscreteLaplace (m_inner,
+                                             values,
+                                             count,
+                                             scaleNumerator,
+                                             scaleDenominator);
+    }
+
+    inline SharemindRandomEngineCtorError fillDiscreteGaussian (
+            int64_t * values,
+            size_t count,
+            uint32_t varianceNumerator,
+            uint32_t varianceDenominator = 1u) noexcept
+    {
+        assert (m_inner != nullptr);
+        return m_inner->fillDiscreteGaussian (m_inner,
+                                              values,
+                                              count,
+                                              varianceNumerator,
+                                              varianceDenominator);
+    }
+
     template <typename T>
     inline void fillBlock(T * begin, T * end) noexcept {
         assert (m_inner != nullptr);
@@ -74,6 +198,25 @@ public: /* Methods: */
         }
     }
 
+    inline void xorBytesInto (void * memptr, size_t numBytes) noexcept {
+        assert (m_inner != nullptr);
+        m_inner->xorBytesInto (m_inner, memptr, numBytes);
+    }
+
+    template <typename T>
+    inline void addInto(T * begin, T * end) noexcept {
+        assert (m_inner != nullptr);
+        if (begin < end)
+            m_inner->addInto (m_inner, begin, blockSize(begin, end), sizeof(T));
+    }
+
+    template <typename T>
+    inline void subFrom(T * begin, T * end) noexcept {
+        assert (m_inner != nullptr);
+        if (begin < end)
+            m_inner->subFrom (m_inner, begin, blockSize(begin, end), sizeof(T));
+    }
+
     template <typename T>
     inline T randomValue() noexcept(noexcept(T(T()))) {
         assert (m_inner != nullptr);
@@ -82,6 +225,21 @@ public: /* Methods: */
         return value;
     }
 
+private: /* Methods: */
+
+    template <typename T>
+    static inline size_t blockSize(T * begin, T * end) noexcept {
+        static_assert(std::is_integral<T>::value
+                      && std::is_unsigned<T>::value,
+                      "Ring arithmetic requires an unsigned integral type!");
+        static_assert(sizeof(T) == 1u || sizeof(T) == 2u || sizeof(T) == 4u
+                      || sizeof(T) == 8u, "Unsupported element size!");
+        assert(begin <= end);
+        auto const dist = std::distance(begin, end);
+        using U = typename std::make_unsigned<decltype(dist)>::type;
+        return sizeof(T) * static_cast<U>(dist);
+    }
+
 private: /* Fields: */
     SharemindRandomEngine * m_inner;
 
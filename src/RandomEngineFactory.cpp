@@ -23,14 +23,22 @@
 #include "ChaCha20RandomEngine.h"
 #include "CryptographicRandom.h"
 #include "NullRandomEngine.h"
+#include "NumaReplicatedRandomEngine.h"
+#include "NumaTopology.h"
 #include "RandomBufferAgent.h"
 #include "RandomEngine.h"
+#include "RandomFileEngine.h"
+#include "RandomReservoirEngine.h"
+#include "RandomSharedPool.h"
 #include "Snow2RandomEngine.h"
 
+#include <algorithm>
 #include <exception>
 #include <memory>
 #include <mutex>
 #include <new>
+#include <utility>
+#include <vector>
 #ifdef SHAREMIND_LIBRANDOM_HAVE_VALGRIND
 #include <valgrind/memcheck.h>
 #endif
@@ -77,6 +85,135 @@ size_t RandomEngineFactory::getSeedSize(SharemindCoreRandomEngineKind kind) noex
 }
 
 
+namespace {
+
+std::shared_ptr<RandomEngine> createCoreEngine(
+        SharemindCoreRandomEngineKind const kind,
+        void const * const seedData)
+{
+    switch (kind) {
+        case SHAREMIND_RANDOM_SNOW2:
+            return std::make_shared<Snow2RandomEngine>(seedData);
+        case SHAREMIND_RANDOM_CHACHA20:
+            return std::make_shared<ChaCha20RandomEngine>(seedData);
+        case SHAREMIND_RANDOM_AES:
+            return std::make_shared<AesRandomEngine>(seedData);
+        default:
+            throw RandomEngineFactory::RandomCtorGeneratorNotSupported{};
+    }
+}
+
+std::shared_ptr<RandomEngine> createThreadBufferedEngine(
+        RandomEngineFactory::Configuration const & conf,
+        std::shared_ptr<RandomEngine> coreEngine)
+{
+    if (conf.bufferSize <= 0u)
+        throw RandomEngineFactory::RandomCtorOtherError{};
+    std::size_t minBufferSize = 0u;
+    if (conf.bufferMode == SHAREMIND_RANDOM_BUFFERING_ADAPTIVE_THREAD) {
+        if (conf.minBufferSize <= 0u || conf.minBufferSize > conf.bufferSize)
+            throw RandomEngineFactory::RandomCtorOtherError{};
+        minBufferSize = conf.minBufferSize;
+    }
+
+    switch (conf.numaPolicy) {
+    case SHAREMIND_RANDOM_NUMA_NONE:
+        return std::make_shared<RandomBufferAgent>(
+                    std::move(coreEngine),
+                    conf.bufferSize,
+                    RandomBufferAgent::NoNumaNode,
+                    conf.bufferFlags,
+                    minBufferSize);
+    case SHAREMIND_RANDOM_NUMA_NODE:
+        if (!NumaTopology::instance().hasNode(conf.numaNode))
+            throw RandomEngineFactory::RandomCtorOtherError{};
+        return std::make_shared<RandomBufferAgent>(std::move(coreEngine),
+                                                   conf.bufferSize,
+                                                   conf.numaNode,
+                                                   conf.bufferFlags,
+                                                   minBufferSize);
+    case SHAREMIND_RANDOM_NUMA_REPLICATE: {
+        auto const & nodes = NumaTopology::instance().nodes();
+        if (nodes.size() <= 1u)
+            return std::make_shared<RandomBufferAgent>(std::move(coreEngine),
+                                                       conf.bufferSize,
+                                                       nodes.front(),
+                                                       conf.bufferFlags,
+                                                       minBufferSize);
+
+        /* The replicas are seeded from the output of the core engine, so
+           that no two replicas produce the same stream: */
+        std::vector<unsigned char> seed(
+                    RandomEngineFactory::getSeedSize(conf.coreEngine));
+        std::vector<std::pair<unsigned, std::shared_ptr<RandomEngine> > >
+                replicas;
+        for (auto const node : nodes) {
+            coreEngine->fillBytes(seed.data(), seed.size());
+            replicas.emplace_back(
+                        node,
+                        std::make_shared<RandomBufferAgent>(
+                            createCoreEngine(conf.coreEngine, seed.data()),
+                            conf.bufferSize,
+                            node,
+                            conf.bufferFlags,
+                            minBufferSize));
+        }
+        // The seed of the last replica must not linger in memory:
+        std::fill(seed.begin(), seed.end(), 0u);
+        return std::make_shared<NumaReplicatedRandomEngine>(
+                    std::move(replicas));
+    }
+    default:
+        throw RandomEngineFactory::RandomCtorOtherError{};
+    }
+}
+
+/**
+   \brief Draws the prefix of the keystream of a randomness file, i.e. the
+          fingerprint recorded in the file and the seed of the engine to
+          continue with once the file has been exhausted.
+*/
+void drawFilePrefix(SharemindCoreRandomEngineKind const kind,
+                    RandomEngine & coreEngine,
+                    void * const fingerprint,
+                    std::vector<unsigned char> & continuationSeed)
+{
+    coreEngine.fillBytes(fingerprint, RandomFileEngine::FingerprintSize);
+    continuationSeed.resize(RandomEngineFactory::getSeedSize(kind));
+    coreEngine.fillBytes(continuationSeed.data(), continuationSeed.size());
+}
+
+std::shared_ptr<RandomEngine> createFileEngine(
+        RandomEngineFactory::Configuration const & conf,
+        std::shared_ptr<RandomEngine> coreEngine)
+{
+    if (!conf.filePath)
+        throw RandomEngineFactory::RandomCtorOtherError{};
+    unsigned char fingerprint[RandomFileEngine::FingerprintSize];
+    std::vector<unsigned char> continuationSeed;
+    drawFilePrefix(conf.coreEngine, *coreEngine, fingerprint, continuationSeed);
+    auto const kind = conf.coreEngine;
+    std::shared_ptr<RandomEngine> r;
+    try {
+        r = std::make_shared<RandomFileEngine>(
+                    conf.filePath,
+                    kind,
+                    fingerprint,
+                    continuationSeed.data(),
+                    continuationSeed.size(),
+                    [kind](void const * const seed)
+                    { return createCoreEngine(kind, seed); });
+    } catch (...) {
+        std::fill(continuationSeed.begin(), continuationSeed.end(), 0u);
+        throw;
+    }
+    // The file engine keeps a copy of the seed of the continuation:
+    std::fill(continuationSeed.begin(), continuationSeed.end(), 0u);
+    return r;
+}
+
+} // anonymous namespace
+
 std::shared_ptr<RandomEngine> RandomEngineFactory::createRandomEngineWithSeed(
         Configuration const & conf,
         void const * seedData,
@@ -88,36 +225,58 @@ std::shared_ptr<RandomEngine> RandomEngineFactory::createRandomEngineWithSeed(
         throw RandomCtorSeedTooShort{};
 
     // Construct core engine:
-    std::shared_ptr<RandomEngine> coreEngine;
-    switch (conf.coreEngine) {
-        case SHAREMIND_RANDOM_NULL:
-            if (seedSize > 0u)
-                throw RandomCtorSeedNotSupported{};
-            return std::shared_ptr<RandomEngine>(&NullRandomEngine::instance(),
-                                                 [](RandomEngine * const){});
-        case SHAREMIND_RANDOM_SNOW2:
-            coreEngine = std::make_shared<Snow2RandomEngine>(seedData);
-            break;
-        case SHAREMIND_RANDOM_CHACHA20:
-            coreEngine = std::make_shared<ChaCha20RandomEngine>(seedData);
-            break;
-        case SHAREMIND_RANDOM_AES:
-            coreEngine = std::make_shared<AesRandomEngine>(seedData);
-            break;
-        default:
-            throw RandomCtorGeneratorNotSupported{};
+    if (conf.coreEngine == SHAREMIND_RANDOM_NULL) {
+        if (seedSize > 0u)
+            throw RandomCtorSeedNotSupported{};
+        return std::shared_ptr<RandomEngine>(&NullRandomEngine::instance(),
+                                             [](RandomEngine * const){});
     }
+    auto coreEngine(createCoreEngine(conf.coreEngine, seedData));
 
     // Add buffering if need be:
     switch (conf.bufferMode) {
     case SHAREMIND_RANDOM_BUFFERING_NONE:
         return coreEngine;
     case SHAREMIND_RANDOM_BUFFERING_THREAD:
-            return std::make_shared<RandomBufferAgent>(coreEngine,
+    case SHAREMIND_RANDOM_BUFFERING_ADAPTIVE_THREAD:
+        return createThreadBufferedEngine(conf, std::move(coreEngine));
+    case SHAREMIND_RANDOM_BUFFERING_FILE:
+        return createFileEngine(conf, std::move(coreEngine));
+    case SHAREMIND_RANDOM_BUFFERING_SHARED_POOL:
+        if (!conf.sharedPoolName)
+            throw RandomCtorOtherError{};
+        return std::make_shared<RandomSharedPoolEngine>(conf.sharedPoolName,
+                                                        std::move(coreEngine));
+    case SHAREMIND_RANDOM_BUFFERING_RESERVOIR:
+        if (conf.bufferSize <= 0u)
+            throw RandomCtorOtherError{};
+        return std::make_shared<RandomReservoirEngine>(std::move(coreEngine),
                                                        conf.bufferSize);
     default:
         throw RandomCtorOtherError{};
     }
 }
 
+void RandomEngineFactory::generateRandomFile(Configuration const & conf,
+                                             void const * seedData,
+                                             size_t seedSize,
+                                             std::uint64_t dataSize)
+{
+    if (getSeedSize(conf.coreEngine) > seedSize)
+        throw RandomCtorSeedTooShort{};
+    if (!conf.filePath)
+        throw RandomCtorOtherError{};
+    auto const coreEngine(createCoreEngine(conf.coreEngine, seedData));
+    unsigned char fingerprint[RandomFileEngine::FingerprintSize];
+    std::vector<unsigned char> continuationSeed;
+    drawFilePrefix(conf.coreEngine, *coreEngine, fingerprint, continuationSeed);
+    // Only drawn to skip it in the keystream of the core engine:
+    std::fill(continuationSeed.begin(), continuationSeed.end(), 0u);
+    RandomFileEngine::generate(conf.filePath,
+                               conf.coreEngine,
+                               fingerprint,
+                               *coreEngine,
+                               dataSize);
+}
+
 } // namespace sharemind
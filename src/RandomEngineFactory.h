@@ -22,6 +22,7 @@
 
 #include "librandom.h"
 
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
 #include <sharemind/Exception.h>
@@ -77,6 +78,15 @@ public: /* Methods: */
             const void * seedData,
             size_t seedSize);
 
+    /**
+     * \brief Pre-generates dataSize bytes of randomness into the new file
+     *        conf.filePath for engines in SHAREMIND_RANDOM_BUFFERING_FILE mode.
+     */
+    static void generateRandomFile(Configuration const & conf,
+                                   const void * seedData,
+                                   size_t seedSize,
+                                   std::uint64_t dataSize);
+
 private: /* Fields: */
 
     Configuration const m_defaultConf;
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_RANDOMENGINESTATE_H
+#define SHAREMIND_LIBRANDOM_RANDOMENGINESTATE_H
+
+#include "librandom.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "RandomEngine.h"
+
+
+namespace sharemind {
+
+/**
+ * \brief The format of the states saved by RandomEngine::saveState().
+ *
+ * A state starts with a header of HeaderSize bytes: the format version, the
+ * kind of the core engine, two reserved zero bytes and the size of the
+ * payload which follows. All integers are stored in little-endian byte order.
+ */
+struct RandomEngineState {
+
+    static constexpr std::uint8_t Version = 1u;
+    static constexpr std::size_t HeaderSize = 8u;
+
+    /** \brief Writes a state into a buffer of HeaderSize + payloadSize bytes.*/
+    class Writer {
+
+    public: /* Methods: */
+
+        inline Writer(void * const buffer,
+                      SharemindCoreRandomEngineKind const kind,
+                      std::size_t const payloadSize) noexcept
+            : m_ptr(static_cast<unsigned char *>(buffer))
+        {
+            u8(Version);
+            u8(static_cast<std::uint8_t>(kind));
+            u8(0u);
+            u8(0u);
+            u32(static_cast<std::uint32_t>(payloadSize));
+        }
+
+        inline void u8(std::uint8_t const value) noexcept
+        { *m_ptr++ = value; }
+
+        inline void u32(std::uint32_t const value) noexcept {
+            for (unsigned i = 0u; i < 4u; ++i)
+                u8(static_cast<std::uint8_t>(value >> (8u * i)));
+        }
+
+        inline void u64(std::uint64_t const value) noexcept {
+            u32(static_cast<std::uint32_t>(value));
+            u32(static_cast<std::uint32_t>(value >> 32u));
+        }
+
+        inline void bytes(void const * const data, std::size_t const size)
+                noexcept
+        {
+            std::memcpy(m_ptr, data, size);
+            m_ptr += size;
+        }
+
+    private: /* Fields: */
+
+        unsigned char * m_ptr;
+
+    };
+
+    /** \brief Reads a state written by a Writer. */
+    class Reader {
+
+    public: /* Methods: */
+
+        /**
+         * \throws RandomEngine::InvalidStateException if the buffer does not
+         *         hold a state of the given kind and payload size.
+         */
+        inline Reader(void const * const buffer,
+                      std::size_t const size,
+                      SharemindCoreRandomEngineKind const kind,
+                      std::size_t const payloadSize)
+            : m_ptr(static_cast<unsigned char const *>(buffer))
+        {
+            if (!buffer || size != HeaderSize + payloadSize
+                || u8() != Version
+                || u8() != static_cast<std::uint8_t>(kind)
+                || u8() != 0u
+                || u8() != 0u
+                || u32() != payloadSize)
+                throw RandomEngine::InvalidStateException();
+        }
+
+        inline std::uint8_t u8() noexcept { return *m_ptr++; }
+
+        inline std::uint32_t u32() noexcept {
+            std::uint32_t r = 0u;
+            for (unsigned i = 0u; i < 4u; ++i)
+                r |= static_cast<std::uint32_t>(u8()) << (8u * i);
+            return r;
+        }
+
+        inline std::uint64_t u64() noexcept {
+            auto const low = u32();
+            return low | (static_cast<std::uint64_t>(u32()) << 32u);
+        }
+
+        inline void bytes(void * const data, std::size_t const size) noexcept
+        {
+            std::memcpy(data, m_ptr, size);
+            m_ptr += size;
+        }
+
+    private: /* Fields: */
+
+        unsigned char const * m_ptr;
+
+    };
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_RANDOMENGINESTATE_H */
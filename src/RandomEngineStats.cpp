@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "RandomEngineStats.h"
+
+
+namespace sharemind {
+
+void RandomEngineStats::addTo(SharemindRandomEngineStats & stats) const noexcept
+{
+    constexpr auto const relaxed = std::memory_order_relaxed;
+    stats.bytesGenerated += m_bytesGenerated.load(relaxed);
+    stats.fillRequests += m_fillRequests.load(relaxed);
+    for (std::size_t i = 0u; i < SHAREMIND_RANDOM_STATS_HISTOGRAM_SIZE; ++i)
+        stats.requestSizeHistogram[i] += m_requestSizeHistogram[i].load(relaxed);
+    stats.consumerStalls += m_consumerStalls.load(relaxed);
+    stats.consumerStallNanoseconds += m_consumerStallNanoseconds.load(relaxed);
+    stats.fillerBusyNanoseconds += m_fillerBusyNanoseconds.load(relaxed);
+    stats.innerReseeds += m_innerReseeds.load(relaxed);
+}
+
+void RandomEngineStats::addToWrapped(SharemindRandomEngineStats & stats)
+        const noexcept
+{
+    stats.fillRequests = 0u;
+    for (auto & bucket : stats.requestSizeHistogram)
+        bucket = 0u;
+    addTo(stats);
+}
+
+void RandomEngineStats::add(SharemindRandomEngineStats & to,
+                            SharemindRandomEngineStats const & from) noexcept
+{
+    to.bytesGenerated += from.bytesGenerated;
+    to.fillRequests += from.fillRequests;
+    for (std::size_t i = 0u; i < SHAREMIND_RANDOM_STATS_HISTOGRAM_SIZE; ++i)
+        to.requestSizeHistogram[i] += from.requestSizeHistogram[i];
+    to.consumerStalls += from.consumerStalls;
+    to.consumerStallNanoseconds += from.consumerStallNanoseconds;
+    to.fillerBusyNanoseconds += from.fillerBusyNanoseconds;
+    to.fillerTotalNanoseconds += from.fillerTotalNanoseconds;
+    to.innerReseeds += from.innerReseeds;
+}
+
+} /* namespace sharemind { */
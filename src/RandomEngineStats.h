@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_RANDOMENGINESTATS_H
+#define SHAREMIND_LIBRANDOM_RANDOMENGINESTATS_H
+
+#include "librandom.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace sharemind {
+
+/**
+ * \brief Performance counters of a single random engine.
+ * \note Every counter has a single writer, the thread using the engine or its
+ *       filler thread, so the counters are updated with relaxed loads and
+ *       stores instead of atomic read-modify-write operations. Readers may see
+ *       slightly stale values.
+ */
+class RandomEngineStats {
+
+public: /* Methods: */
+
+    inline void recordRequest(std::size_t const size) noexcept {
+        increment(m_fillRequests);
+        increment(m_requestSizeHistogram[histogramBucket(size)]);
+    }
+
+    inline void recordGenerated(std::size_t const size) noexcept
+    { increment(m_bytesGenerated, size); }
+
+    inline void recordInnerReseed() noexcept { increment(m_innerReseeds); }
+
+    inline void recordConsumerStall(std::chrono::nanoseconds const duration)
+            noexcept
+    {
+        increment(m_consumerStalls);
+        increment(m_consumerStallNanoseconds, toCount(duration));
+    }
+
+    inline void recordFillerBusy(std::chrono::nanoseconds const duration)
+            noexcept
+    { increment(m_fillerBusyNanoseconds, toCount(duration)); }
+
+    inline std::uint64_t consumerStalls() const noexcept
+    { return m_consumerStalls.load(std::memory_order_relaxed); }
+
+    /** \brief Adds these counters to the given ones. */
+    void addTo(SharemindRandomEngineStats & stats) const noexcept;
+
+    /**
+     * \brief Replaces the request counters in the given stats with these,
+     *        and adds the rest of these counters to the given ones.
+     * \note Used by wrapping engines on the stats of the wrapped engines.
+     */
+    void addToWrapped(SharemindRandomEngineStats & stats) const noexcept;
+
+    static void add(SharemindRandomEngineStats & to,
+                    SharemindRandomEngineStats const & from) noexcept;
+
+    static inline std::uint64_t toCount(std::chrono::nanoseconds const d)
+            noexcept
+    { return (d.count() > 0) ? static_cast<std::uint64_t>(d.count()) : 0u; }
+
+private: /* Methods: */
+
+    static inline void increment(std::atomic<std::uint64_t> & counter,
+                                 std::uint64_t const value = 1u) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value,
+                      std::memory_order_relaxed);
+    }
+
+    static inline std::size_t histogramBucket(std::size_t const size) noexcept
+    {
+        if (size <= 1u)
+            return 0u;
+        static_assert(sizeof(std::size_t) <= sizeof(unsigned long long), "");
+        auto const log2 = static_cast<std::size_t>(
+                    sizeof(unsigned long long) * 8u - 1u
+                    - static_cast<unsigned>(__builtin_clzll(size)));
+        return (log2 < SHAREMIND_RANDOM_STATS_HISTOGRAM_SIZE)
+               ? log2
+               : SHAREMIND_RANDOM_STATS_HISTOGRAM_SIZE - 1u;
+    }
+
+private: /* Fields: */
+
+    std::atomic<std::uint64_t> m_bytesGenerated{0u};
+    std::atomic<std::uint64_t> m_fillRequests{0u};
+    std::atomic<std::uint64_t>
+            m_requestSizeHistogram[SHAREMIND_RANDOM_STATS_HISTOGRAM_SIZE] = {};
+    std::atomic<std::uint64_t> m_consumerStalls{0u};
+    std::atomic<std::uint64_t> m_consumerStallNanoseconds{0u};
+    std::atomic<std::uint64_t> m_fillerBusyNanoseconds{0u};
+    std::atomic<std::uint64_t> m_innerReseeds{0u};
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_RANDOMENGINESTATS_H */
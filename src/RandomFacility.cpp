@@ -19,12 +19,22 @@
 
 #include "RandomFacility.h"
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <memory>
+#include <pthread.h>
+#include <set>
 #include <sharemind/AssertReturn.h>
 #include <sharemind/visibility.h>
+#include <string>
+#include <vector>
 #include "CryptographicRandom.h"
 #include "RandomEngine.h"
+#include "RandomFileEngine.h"
+#include "RandomSharedPool.h"
 
 
 namespace sharemind {
@@ -39,6 +49,57 @@ public: /* Methods: */
                           size_t const bufferSize) noexcept
     { assertReturn(m_engine)->fillBytes(buffer, bufferSize); }
 
+    inline void fillBytesV(struct iovec const * const iov,
+                           size_t const iovcnt) noexcept
+    { assertReturn(m_engine)->fillBytesV(iov, iovcnt); }
+
+    inline void fillBytesAsync(void * const buffer,
+                               size_t const bufferSize,
+                               SharemindRandomFillCallback const callback,
+                               void * const userData) noexcept
+    {
+        assert(callback);
+        assertReturn(m_engine)->fillBytesAsync(
+                    buffer,
+                    bufferSize,
+                    [callback, userData]() noexcept { callback(userData); });
+    }
+
+    inline void combineInto(void * const buffer,
+                            size_t const bufferSize,
+                            RandomCombineOp const op,
+                            size_t const elementSize) noexcept
+    {
+        // The arguments come from C callers, hence they are checked always:
+        if ((elementSize != 1u && elementSize != 2u && elementSize != 4u
+             && elementSize != 8u)
+            || bufferSize % elementSize != 0u)
+            return;
+        assertReturn(m_engine)->combineInto(buffer, bufferSize, op, elementSize);
+    }
+
+    inline RandomEngine & engine() const noexcept
+    { return *assertReturn(m_engine); }
+
+    inline void reserve(size_t const size,
+                        std::chrono::nanoseconds const within) noexcept
+    { assertReturn(m_engine)->reserve(size, within); }
+
+    inline size_t bufferSize() const noexcept
+    { return assertReturn(m_engine)->bufferSize(); }
+
+    inline void getStats(SharemindRandomEngineStats & stats) const noexcept
+    { assertReturn(m_engine)->getStats(stats); }
+
+    inline size_t stateSize() const noexcept
+    { return assertReturn(m_engine)->stateSize(); }
+
+    inline void saveState(void * const buffer) const
+    { assertReturn(m_engine)->saveState(buffer); }
+
+    inline void restoreState(void const * const buffer, size_t const size)
+    { assertReturn(m_engine)->restoreState(buffer, size); }
+
 private: /* Fields: */
 
     std::shared_ptr<RandomEngine> const m_engine;
@@ -47,6 +108,117 @@ private: /* Fields: */
 
 namespace {
 
+/* All facilities, for locking them around fork(): */
+std::mutex facilitiesMutex;
+std::set<RandomFacility *> facilities;
+
+} // anonymous namespace
+
+/* No mutex of a facility may be held by another thread during fork(), as the
+   child could not lock it again: */
+struct RandomFacility::ForkHandlers {
+
+    static void prepare() noexcept {
+        facilitiesMutex.lock();
+        for (auto * const facility : facilities)
+            facility->m_scopedEnginesMutex.lock();
+    }
+
+    static void parent() noexcept {
+        for (auto * const facility : facilities)
+            facility->m_scopedEnginesMutex.unlock();
+        facilitiesMutex.unlock();
+    }
+
+};
+
+namespace {
+
+std::atomic<std::uint64_t> nextFacilityId{0u};
+
+struct ThreadEngine {
+    std::uint64_t facilityId;
+    std::uint64_t generation;
+    SharemindRandomEngineConf conf;
+
+    /* A copy of the string in conf, which might not outlive it: */
+    bool hasSharedPoolName;
+    std::string sharedPoolName;
+
+    std::shared_ptr<RandomFacility::ScopedEngine> engine;
+};
+
+inline bool sameString(bool const has,
+                       std::string const & str,
+                       char const * const other) noexcept
+{ return has ? (other && str == other) : !other; }
+
+inline bool sameConf(ThreadEngine const & e,
+                     SharemindRandomEngineConf const & conf) noexcept
+{
+    return e.conf.coreEngine == conf.coreEngine
+           && e.conf.bufferMode == conf.bufferMode
+           && e.conf.bufferSize == conf.bufferSize
+           && e.conf.numaPolicy == conf.numaPolicy
+           && e.conf.numaNode == conf.numaNode
+           && e.conf.bufferFlags == conf.bufferFlags
+           && e.conf.minBufferSize == conf.minBufferSize
+           && sameString(e.hasSharedPoolName,
+                         e.sharedPoolName,
+                         conf.sharedPoolName);
+}
+
+/**
+ * \brief The thread engines of the current thread.
+ * \note After fork() the engines of the parent are abandoned in the child
+ *       without being destroyed, as the filler threads of buffered engines do
+ *       not exist in the child. Hence the child never continues the streams of
+ *       the parent.
+ */
+class ThreadEngines {
+
+public: /* Methods: */
+
+    inline ~ThreadEngines() noexcept { delete m_engines; }
+
+    inline std::vector<ThreadEngine> * engines() const noexcept
+    { return m_engines; }
+
+    inline std::vector<ThreadEngine> & createEngines() {
+        if (!m_engines)
+            m_engines = new std::vector<ThreadEngine>();
+        return *m_engines;
+    }
+
+    inline void abandon() noexcept { m_engines = nullptr; }
+
+private: /* Fields: */
+
+    std::vector<ThreadEngine> * m_engines = nullptr;
+
+};
+
+thread_local ThreadEngines threadEngines;
+
+extern "C" void SharemindRandomFacility_atforkPrepare() noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+extern "C" void SharemindRandomFacility_atforkParent() noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+extern "C" void SharemindRandomFacility_atforkChild() noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" void SharemindRandomFacility_atforkPrepare() noexcept
+{ RandomFacility::ForkHandlers::prepare(); }
+
+extern "C" void SharemindRandomFacility_atforkParent() noexcept
+{ RandomFacility::ForkHandlers::parent(); }
+
+/* Only the thread which called fork() exists in the child: */
+extern "C" void SharemindRandomFacility_atforkChild() noexcept {
+    threadEngines.abandon();
+    RandomFacility::ForkHandlers::parent();
+}
+
 extern "C" void SharemindRandomEngine_fillBytes(SharemindRandomEngine * rng,
                                                 void * memptr,
                                                 size_t size) noexcept
@@ -61,6 +233,176 @@ extern "C" void SharemindRandomEngine_fillBytes(SharemindRandomEngine * rng,
                                                 size_t size) noexcept
 { fromWrapper(*assertReturn(rng)).fillBytes(memptr, size); }
 
+extern "C" void SharemindRandomEngine_fillBytesV(
+        SharemindRandomEngine * rng,
+        struct iovec const * iov,
+        size_t iovcnt) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" void SharemindRandomEngine_fillBytesV(
+        SharemindRandomEngine * rng,
+        struct iovec const * iov,
+        size_t iovcnt) noexcept
+{ fromWrapper(*assertReturn(rng)).fillBytesV(iov, iovcnt); }
+
+extern "C" void SharemindRandomEngine_fillBytesAsync(
+        SharemindRandomEngine * rng,
+        void * memptr,
+        size_t size,
+        SharemindRandomFillCallback callback,
+        void * userData) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" void SharemindRandomEngine_fillBytesAsync(
+        SharemindRandomEngine * rng,
+        void * memptr,
+        size_t size,
+        SharemindRandomFillCallback callback,
+        void * userData) noexcept
+{
+    fromWrapper(*assertReturn(rng)).fillBytesAsync(memptr,
+                                                   size,
+                                                   callback,
+                                                   userData);
+}
+
+extern "C" void SharemindRandomEngine_xorBytesInto(
+        SharemindRandomEngine * rng,
+        void * memptr,
+        size_t size) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" void SharemindRandomEngine_xorBytesInto(
+        SharemindRandomEngine * rng,
+        void * memptr,
+        size_t size) noexcept
+{
+    fromWrapper(*assertReturn(rng)).combineInto(memptr,
+                                                size,
+                                                RandomCombineOp::Xor,
+                                                1u);
+}
+
+extern "C" void SharemindRandomEngine_addInto(SharemindRandomEngine * rng,
+                                              void * memptr,
+                                              size_t size,
+                                              size_t elementSize) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" void SharemindRandomEngine_addInto(SharemindRandomEngine * rng,
+                                              void * memptr,
+                                              size_t size,
+                                              size_t elementSize) noexcept
+{
+    fromWrapper(*assertReturn(rng)).combineInto(memptr,
+                                                size,
+                                                RandomCombineOp::Add,
+                                                elementSize);
+}
+
+extern "C" void SharemindRandomEngine_subFrom(SharemindRandomEngine * rng,
+                                              void * memptr,
+                                              size_t size,
+                                              size_t elementSize) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" void SharemindRandomEngine_subFrom(SharemindRandomEngine * rng,
+                                              void * memptr,
+                                              size_t size,
+                                              size_t elementSize) noexcept
+{
+    fromWrapper(*assertReturn(rng)).combineInto(memptr,
+                                                size,
+                                                RandomCombineOp::Subtract,
+                                                elementSize);
+}
+
+extern "C" void SharemindRandomEngine_fillUniformDouble(
+        SharemindRandomEngine * rng,
+        double * values,
+        size_t count) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" void SharemindRandomEngine_fillUniformDouble(
+        SharemindRandomEngine * rng,
+        double * values,
+        size_t count) noexcept
+{ fromWrapper(*assertReturn(rng)).engine().fillUniformDouble(values, count); }
+
+extern "C" void SharemindRandomEngine_fillUniformFloat(
+        SharemindRandomEngine * rng,
+        float * values,
+        size_t count) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" void SharemindRandomEngine_fillUniformFloat(
+        SharemindRandomEngine * rng,
+        float * values,
+        size_t count) noexcept
+{ fromWrapper(*assertReturn(rng)).engine().fillUniformFloat(values, count); }
+
+extern "C" void SharemindRandomEngine_fillNormal(SharemindRandomEngine * rng,
+                                                 double * values,
+                                                 size_t count,
+                                                 double mean,
+                                                 double stddev) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" void SharemindRandomEngine_fillNormal(SharemindRandomEngine * rng,
+                                                 double * values,
+                                                 size_t count,
+                                                 double mean,
+                                                 double stddev) noexcept
+{
+    fromWrapper(*assertReturn(rng)).engine().fillNormal(values,
+                                                        count,
+                                                        mean,
+                                                        stddev);
+}
+
+inline RandomFacility::ScopedEngine const & fromWrapper(
+        SharemindRandomEngine const & base) noexcept
+{ return static_cast<RandomFacility::ScopedEngine const &>(base); }
+
+extern "C" void SharemindRandomEngine_reserve(
+        SharemindRandomEngine * rng,
+        size_t size,
+        uint64_t withinNanoseconds) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" void SharemindRandomEngine_reserve(
+        SharemindRandomEngine * rng,
+        size_t size,
+        uint64_t withinNanoseconds) noexcept
+{
+    // Saturate, as the duration is signed:
+    using D = std::chrono::nanoseconds;
+    auto const maxWithin = static_cast<std::uint64_t>(D::max().count());
+    fromWrapper(*assertReturn(rng)).reserve(
+                size,
+                D(static_cast<D::rep>((withinNanoseconds < maxWithin)
+                                      ? withinNanoseconds
+                                      : maxWithin)));
+}
+
+extern "C" size_t SharemindRandomEngine_bufferSize(
+        SharemindRandomEngine const * rng) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" size_t SharemindRandomEngine_bufferSize(
+        SharemindRandomEngine const * rng) noexcept
+{ return fromWrapper(*assertReturn(rng)).bufferSize(); }
+
+extern "C" void SharemindRandomEngine_getStats(
+        SharemindRandomEngine const * rng,
+        SharemindRandomEngineStats * stats) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" void SharemindRandomEngine_getStats(
+        SharemindRandomEngine const * rng,
+        SharemindRandomEngineStats * stats) noexcept
+{ fromWrapper(*assertReturn(rng)).getStats(*assertReturn(stats)); }
+
 inline RandomFacility & fromWrapper(SharemindRandomFacility & base) noexcept
 { return static_cast<RandomFacility &>(base); }
 
@@ -101,6 +443,22 @@ inline void handleException(SharemindRandomEngineCtorError * const e) {
         *e = SHAREMIND_RANDOM_SEED_GENERATION_ERROR;
     } catch (REF::RandomCtorSeedNotSupported const &) {
         *e = SHAREMIND_RANDOM_SEED_NOT_SUPPORTED;
+    } catch (RandomFileEngine::FileMismatchException const &) {
+        *e = SHAREMIND_RANDOM_FILE_MISMATCH;
+    } catch (RandomFileEngine::FileException const &) {
+        *e = SHAREMIND_RANDOM_FILE_ERROR;
+    } catch (RandomSharedPool::PoolFullException const &) {
+        *e = SHAREMIND_RANDOM_SHARED_POOL_FULL;
+    } catch (RandomSharedPool::PoolException const &) {
+        *e = SHAREMIND_RANDOM_SHARED_POOL_ERROR;
+    } catch (RandomEngine::StateNotSupportedException const &) {
+        *e = SHAREMIND_RANDOM_STATE_NOT_SUPPORTED;
+    } catch (RandomEngine::InvalidStateException const &) {
+        *e = SHAREMIND_RANDOM_INVALID_STATE;
+    } catch (RandomEngine::InvalidParameterException const &) {
+        *e = SHAREMIND_RANDOM_INVALID_PARAMETERS;
+    } catch (RandomEngine::GeneratorNotSupportedException const &) {
+        *e = SHAREMIND_RANDOM_GENERATOR_NOT_SUPPORTED;
     } catch (RandomEngine::Exception const &) {
         *e = SHAREMIND_RANDOM_GENERAL_ERROR;
     } catch (...) {
@@ -108,6 +466,118 @@ inline void handleException(SharemindRandomEngineCtorError * const e) {
     }
 }
 
+extern "C" size_t SharemindRandomEngine_stateSize(
+        SharemindRandomEngine const * rng) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" size_t SharemindRandomEngine_stateSize(
+        SharemindRandomEngine const * rng) noexcept
+{ return fromWrapper(*assertReturn(rng)).stateSize(); }
+
+extern "C" SharemindRandomEngineCtorError SharemindRandomEngine_saveState(
+        SharemindRandomEngine const * rng,
+        void * memptr,
+        size_t size) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" SharemindRandomEngineCtorError SharemindRandomEngine_saveState(
+        SharemindRandomEngine const * rng,
+        void * memptr,
+        size_t size) noexcept
+{
+    auto const & engine = fromWrapper(*assertReturn(rng));
+    auto const stateSize = engine.stateSize();
+    if (stateSize <= 0u)
+        return SHAREMIND_RANDOM_STATE_NOT_SUPPORTED;
+    if (!memptr || size < stateSize)
+        return SHAREMIND_RANDOM_GENERAL_ERROR;
+    SharemindRandomEngineCtorError error = SHAREMIND_RANDOM_OK;
+    try {
+        engine.saveState(memptr);
+    } catch (...) {
+        handleException(&error);
+    }
+    return error;
+}
+
+extern "C" SharemindRandomEngineCtorError SharemindRandomEngine_restoreState(
+        SharemindRandomEngine * rng,
+        void const * memptr,
+        size_t size) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" SharemindRandomEngineCtorError SharemindRandomEngine_restoreState(
+        SharemindRandomEngine * rng,
+        void const * memptr,
+        size_t size) noexcept
+{
+    SharemindRandomEngineCtorError error = SHAREMIND_RANDOM_OK;
+    try {
+        fromWrapper(*assertReturn(rng)).restoreState(memptr, size);
+    } catch (...) {
+        handleException(&error);
+    }
+    return error;
+}
+
+extern "C" SharemindRandomEngineCtorError
+SharemindRandomEngine_fillDiscreteLaplace(SharemindRandomEngine * rng,
+                                          int64_t * values,
+                                          size_t count,
+                                          uint32_t scaleNumerator,
+                                          uint32_t scaleDenominator) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" SharemindRandomEngineCtorError
+SharemindRandomEngine_fillDiscreteLaplace(SharemindRandomEngine * rng,
+                                          int64_t * values,
+                                          size_t count,
+                                          uint32_t scaleNumerator,
+                                          uint32_t scaleDenominator) noexcept
+{
+    SharemindRandomEngineCtorError error = SHAREMIND_RANDOM_OK;
+    try {
+        fromWrapper(*assertReturn(rng)).engine().fillDiscreteLaplace(
+                    values,
+                    count,
+                    scaleNumerator,
+                    scaleDenominator);
+    } catch (...) {
+        handleException(&error);
+    }
+    return error;
+}
+
+extern "C" SharemindRandomEngineCtorError
+SharemindRandomEngine_fillDiscreteGaussian(
+        SharemindRandomEngine * rng,
+        int64_t * values,
+        size_t count,
+        uint32_t varianceNumerator,
+        uint32_t varianceDenominator) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C" SharemindRandomEngineCtorError
+SharemindRandomEngine_fillDiscreteGaussian(
+        SharemindRandomEngine * rng,
+        int64_t * values,
+        size_t count,
+        uint32_t varianceNumerator,
+        uint32_t varianceDenominator) noexcept
+{
+    SharemindRandomEngineCtorError error = SHAREMIND_RANDOM_OK;
+    try {
+        fromWrapper(*assertReturn(rng)).engine().fillDiscreteGaussian(
+                    values,
+                    count,
+                    varianceNumerator,
+                    varianceDenominator);
+    } catch (...) {
+        handleException(&error);
+    }
+    return error;
+}
+
 #define SHAREMIND_RANDOMFACILITY_TRY(...) \
     try { __VA_ARGS__ } catch (...) { \
         handleException(errorPtr); \
@@ -223,11 +693,93 @@ SharemindRandomEngine * SharemindRandomFacility_createRandomEngineWithSeed(
                             seedSize).get();)
 }
 
-} // anonymous namespace
+extern "C"
+SharemindRandomEngineCtorError SharemindRandomFacility_generateRandomFile(
+        SharemindRandomFacility * facility,
+        SharemindRandomEngineConf const * conf,
+        const void * seedData,
+        size_t seedSize,
+        uint64_t dataSize) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C"
+SharemindRandomEngineCtorError SharemindRandomFacility_generateRandomFile(
+        SharemindRandomFacility * facility,
+        SharemindRandomEngineConf const * conf,
+        const void * seedData,
+        size_t seedSize,
+        uint64_t dataSize) noexcept
+{
+    assert(facility);
+    assert(conf);
+    SharemindRandomEngineCtorError error = SHAREMIND_RANDOM_OK;
+    try {
+        fromWrapper(*facility).generateRandomFile(*conf,
+                                                  seedData,
+                                                  seedSize,
+                                                  dataSize);
+    } catch (...) {
+        handleException(&error);
+    }
+    return error;
+}
+
+extern "C"
+void SharemindRandomFacility_getStats(
+        SharemindRandomFacility const * facility,
+        SharemindRandomEngineStats * stats) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C"
+void SharemindRandomFacility_getStats(
+        SharemindRandomFacility const * facility,
+        SharemindRandomEngineStats * stats) noexcept
+{
+    assert(facility);
+    assert(stats);
+    fromWrapper(*facility).getStats(*stats);
+}
+
+extern "C"
+SharemindRandomEngine * SharemindRandomFacility_threadEngine(
+        SharemindRandomFacility * facility,
+        SharemindRandomEngineConf const * conf,
+        SharemindRandomEngineCtorError * errorPtr) noexcept
+        SHAREMIND_VISIBILITY_HIDDEN;
+
+extern "C"
+SharemindRandomEngine * SharemindRandomFacility_threadEngine(
+        SharemindRandomFacility * facility,
+        SharemindRandomEngineConf const * conf,
+        SharemindRandomEngineCtorError * errorPtr) noexcept
+{
+    assert(facility);
+    auto & f = fromWrapper(*facility);
+    SHAREMIND_RANDOMFACILITY_TRY(
+            return &f.threadEngine(
+                        conf ? *conf : f.defaultFactoryConfiguration());)
+}
 
+} // anonymous namespace
 
 RandomFacility::ScopedEngine::ScopedEngine(std::shared_ptr<RandomEngine> engine)
-    : SharemindRandomEngine{&SharemindRandomEngine_fillBytes}
+    : SharemindRandomEngine{&SharemindRandomEngine_fillBytes,
+                            &SharemindRandomEngine_bufferSize,
+                            &SharemindRandomEngine_getStats,
+                            &SharemindRandomEngine_fillBytesAsync,
+                            &SharemindRandomEngine_xorBytesInto,
+                            &SharemindRandomEngine_addInto,
+                            &SharemindRandomEngine_subFrom,
+                            &SharemindRandomEngine_stateSize,
+                            &SharemindRandomEngine_saveState,
+                            &SharemindRandomEngine_restoreState,
+                            &SharemindRandomEngine_fillUniformDouble,
+                            &SharemindRandomEngine_fillUniformFloat,
+                            &SharemindRandomEngine_fillNormal,
+                            &SharemindRandomEngine_fillDiscreteLaplace,
+                            &SharemindRandomEngine_fillDiscreteGaussian,
+                            &SharemindRandomEngine_fillBytesV,
+                            &SharemindRandomEngine_reserve}
     , m_engine(assertReturn(std::move(engine)))
 {}
 
@@ -242,15 +794,34 @@ RandomFacility::RandomFacility(
           },
           &SharemindRandomFacility_defaultFactoryConfiguration,
           &SharemindRandomFacility_getSeedSize,
-          &SharemindRandomFacility_createRandomEngineWithSeed}
+          &SharemindRandomFacility_createRandomEngineWithSeed,
+          &SharemindRandomFacility_generateRandomFile,
+          &SharemindRandomFacility_getStats,
+          &SharemindRandomFacility_threadEngine}
     , m_engineFactory{defaultFactoryConf}
-{}
+    , m_id(nextFacilityId++)
+{
+    static int const atforkRegistered =
+            ::pthread_atfork(&SharemindRandomFacility_atforkPrepare,
+                             &SharemindRandomFacility_atforkParent,
+                             &SharemindRandomFacility_atforkChild);
+    if (atforkRegistered != 0)
+        throw RandomEngineFactory::RandomCtorOtherError();
+
+    std::lock_guard<std::mutex> const guard(facilitiesMutex);
+    facilities.insert(this);
+}
+
+RandomFacility::~RandomFacility() noexcept {
+    std::lock_guard<std::mutex> const guard(facilitiesMutex);
+    facilities.erase(this);
+}
 
 void RandomFacility::RandomBlocking(void * memptr, size_t size) const noexcept
 { sharemindCryptographicRandom(memptr, size); }
 
 void RandomFacility::URandomBlocking(void * memptr, size_t size) const noexcept
-{ sharemindCryptographicURandom(memptr, size); }
+{ sharemindCryptographicMixedURandom(memptr, size); }
 
 size_t RandomFacility::RandomNonblocking(void * memptr, size_t size) const noexcept
 { return sharemindCryptographicRandomNonblocking(memptr, size); }
@@ -272,9 +843,99 @@ RandomFacility::createRandomEngineWithSeed(
                     m_engineFactory.createRandomEngineWithSeed(conf,
                                                                seedData,
                                                                seedSize)));
+    std::lock_guard<std::mutex> const guard(m_scopedEnginesMutex);
     m_scopedEngines.emplace_back(scopedEngine);
     return scopedEngine;
 }
 
+void RandomFacility::generateRandomFile(
+        SharemindRandomEngineConf const & conf,
+        const void * seedData,
+        size_t seedSize,
+        std::uint64_t dataSize) const
+{
+    RandomEngineFactory::generateRandomFile(conf,
+                                            seedData,
+                                            seedSize,
+                                            dataSize);
+}
+
+SharemindRandomEngine & RandomFacility::threadEngine(
+        SharemindRandomEngineConf const & conf)
+{
+    // A file matches only the seed it was generated with:
+    if (conf.bufferMode == SHAREMIND_RANDOM_BUFFERING_FILE)
+        throw RandomEngineFactory::RandomCtorOtherError();
+
+    auto const generation =
+            m_threadEngineGeneration.load(std::memory_order_relaxed);
+    if (auto * const engines = threadEngines.engines()) {
+        for (auto it = engines->begin(); it != engines->end(); ++it) {
+            if (it->facilityId != m_id || !sameConf(*it, conf))
+                continue;
+            if (it->generation == generation)
+                return *it->engine;
+            // Replace the engine released by clear():
+            engines->erase(it);
+            break;
+        }
+    }
+
+    ThreadEngine e;
+    e.facilityId = m_id;
+    e.generation = generation;
+    e.conf = conf;
+    e.conf.filePath = nullptr;
+    e.conf.sharedPoolName = nullptr;
+    e.hasSharedPoolName = (conf.sharedPoolName != nullptr);
+    if (conf.sharedPoolName)
+        e.sharedPoolName = conf.sharedPoolName;
+    e.engine = createThreadEngine(conf);
+    auto & engines = threadEngines.createEngines();
+    engines.emplace_back(std::move(e));
+    return *engines.back().engine;
+}
+
+std::shared_ptr<RandomFacility::ScopedEngine>
+RandomFacility::createThreadEngine(SharemindRandomEngineConf const & conf) {
+    std::vector<unsigned char> seed(getSeedSize(conf));
+    sharemindCryptographicMixedURandom(seed.data(), seed.size());
+    auto scopedEngine(
+                std::make_shared<RandomFacility::ScopedEngine>(
+                    m_engineFactory.createRandomEngineWithSeed(conf,
+                                                               seed.data(),
+                                                               seed.size())));
+    std::lock_guard<std::mutex> const guard(m_scopedEnginesMutex);
+    m_threadEngines.remove_if([](std::weak_ptr<ScopedEngine> const & e)
+                              { return e.expired(); });
+    m_threadEngines.emplace_back(scopedEngine);
+    return scopedEngine;
+}
+
+void RandomFacility::clear() noexcept {
+    std::lock_guard<std::mutex> const guard(m_scopedEnginesMutex);
+    m_scopedEngines.clear();
+    m_threadEngines.clear();
+    ++m_threadEngineGeneration;
+}
+
+void RandomFacility::getStats(SharemindRandomEngineStats & stats)
+        const noexcept
+{
+    stats = SharemindRandomEngineStats();
+    SharemindRandomEngineStats engineStats;
+    std::lock_guard<std::mutex> const guard(m_scopedEnginesMutex);
+    for (auto const & scopedEngine : m_scopedEngines) {
+        scopedEngine->getStats(engineStats);
+        RandomEngineStats::add(stats, engineStats);
+    }
+    for (auto const & threadEngine : m_threadEngines) {
+        if (auto const scopedEngine = threadEngine.lock()) {
+            scopedEngine->getStats(engineStats);
+            RandomEngineStats::add(stats, engineStats);
+        }
+    }
+}
+
 
 } // namespace sharemind {
@@ -22,8 +22,11 @@
 
 #include "librandom.h"
 
+#include <atomic>
+#include <cstdint>
 #include <list>
 #include <memory>
+#include <mutex>
 #include "RandomEngine.h"
 #include "RandomEngineFactory.h"
 
@@ -36,12 +39,24 @@ public: /* Types: */
 
     class ScopedEngine;
 
+    struct ForkHandlers;
+
 public: /* Methods: */
 
+    /**
+     * \throws RandomEngineFactory::RandomCtorOtherError if the fork handlers
+     *         could not be registered.
+     */
     RandomFacility(
             RandomEngineFactory::Configuration const & defaultFactoryConf);
 
-    void clear() noexcept { return m_scopedEngines.clear(); }
+    ~RandomFacility() noexcept;
+
+    /**
+     * \brief Releases all engines created by this facility. Threads replace
+     *        their thread engines on their next call to threadEngine().
+     */
+    void clear() noexcept;
 
     SharemindRandomFacility & facility() noexcept
     { return static_cast<SharemindRandomFacility &>(*this); }
@@ -62,11 +77,46 @@ public: /* Methods: */
             const void * seedData,
             size_t seedSize);
 
+    void generateRandomFile(SharemindRandomEngineConf const & conf,
+                            const void * seedData,
+                            size_t seedSize,
+                            std::uint64_t dataSize) const;
+
+    /** \brief Sums up the stats of all engines created by this facility. */
+    void getStats(SharemindRandomEngineStats & stats) const noexcept;
+
+    /**
+     * \returns the engine of the calling thread for the given configuration,
+     *          which is created and seeded from entropy on first use, and
+     *          again after fork() and clear().
+     * \see SharemindRandomFacility::threadEngine
+     */
+    SharemindRandomEngine & threadEngine(
+            SharemindRandomEngineConf const & conf);
+
+    inline SharemindRandomEngine & threadEngine()
+    { return threadEngine(defaultFactoryConfiguration()); }
+
+private: /* Methods: */
+
+    std::shared_ptr<ScopedEngine> createThreadEngine(
+            SharemindRandomEngineConf const & conf);
+
 private: /* Fields: */
 
     RandomEngineFactory m_engineFactory;
+    mutable std::mutex m_scopedEnginesMutex;
     std::list<std::shared_ptr<ScopedEngine> > m_scopedEngines;
 
+    /// Identifies the thread engines of this facility:
+    std::uint64_t const m_id;
+
+    /// Incremented by clear() to have threads replace their engines:
+    std::atomic<std::uint64_t> m_threadEngineGeneration{0u};
+
+    /// The thread engines, owned by their threads:
+    std::list<std::weak_ptr<ScopedEngine> > m_threadEngines;
+
 };
 
 
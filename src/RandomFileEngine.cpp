@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "RandomFileEngine.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <sharemind/AssertReturn.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+
+namespace sharemind {
+
+SHAREMIND_DEFINE_EXCEPTION_CONST_MSG_NOINLINE(
+        Exception,
+        RandomFileEngine::,
+        FileException,
+        "Failed to use the pre-generated randomness file");
+SHAREMIND_DEFINE_EXCEPTION_CONST_MSG_NOINLINE(
+        FileException,
+        RandomFileEngine::,
+        FileMismatchException,
+        "The pre-generated randomness file is for a different engine or seed");
+
+namespace {
+
+constexpr static char const FILE_MAGIC[8u] =
+        { 'S', 'M', 'R', 'N', 'D', 'F', 'I', 'L' };
+constexpr static std::uint32_t const FILE_VERSION = 2u;
+
+/* The size of the blocks written when generating a file: */
+constexpr static std::size_t const GENERATE_BLOCK_SIZE = 1024u * 1024u;
+
+/* The size of the blocks used when drawing from the continuation engine: */
+constexpr static std::size_t const CONTINUATION_BLOCK_SIZE = 4096u;
+
+/// The header of the file, in host byte order:
+struct FileHeader {
+    char magic[sizeof(FILE_MAGIC)];
+    std::uint32_t version;
+    std::uint32_t coreEngine;
+    std::uint64_t dataSize;
+    std::uint64_t consumed;
+    unsigned char fingerprint[RandomFileEngine::FingerprintSize];
+};
+static_assert(sizeof(FileHeader) <= RandomFileEngine::HeaderSize, "");
+
+bool readFully(int const fd, void * buffer, std::size_t size, off_t offset)
+        noexcept
+{
+    while (size > 0u) {
+        auto const r = ::pread(fd, buffer, size, offset);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        if (r == 0)
+            return false;
+        buffer = static_cast<char *>(buffer) + r;
+        size -= static_cast<std::size_t>(r);
+        offset += r;
+    }
+    return true;
+}
+
+bool writeFully(int const fd,
+                void const * buffer,
+                std::size_t size,
+                off_t offset) noexcept
+{
+    while (size > 0u) {
+        auto const r = ::pwrite(fd, buffer, size, offset);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        buffer = static_cast<char const *>(buffer) + r;
+        size -= static_cast<std::size_t>(r);
+        offset += r;
+    }
+    return true;
+}
+
+bool writeConsumed(int const fd, std::uint64_t const consumed) noexcept {
+    return writeFully(fd,
+                      &consumed,
+                      sizeof(consumed),
+                      offsetof(FileHeader, consumed))
+           && ::fdatasync(fd) == 0;
+}
+
+} // anonymous namespace
+
+RandomFileEngine::RandomFileEngine(
+        char const * const path,
+        SharemindCoreRandomEngineKind const kind,
+        void const * const fingerprint,
+        void const * const continuationSeed,
+        std::size_t const continuationSeedSize,
+        ContinuationFactory createContinuation)
+    : m_fd(::open(assertReturn(path), O_RDWR | O_CLOEXEC))
+    , m_createContinuation(std::move(createContinuation))
+{
+    assert(continuationSeedSize >= sizeof(std::uint64_t));
+    assert(m_createContinuation);
+    if (m_fd < 0)
+        throw FileException();
+    try {
+        auto const seed = static_cast<unsigned char const *>(
+                              assertReturn(continuationSeed));
+        m_continuationSeed.assign(seed, seed + continuationSeedSize);
+        if (::flock(m_fd, LOCK_EX | LOCK_NB) != 0)
+            throw FileException();
+
+        FileHeader header;
+        if (!readFully(m_fd, &header, sizeof(header), 0))
+            throw FileException();
+        if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0
+            || header.version != FILE_VERSION)
+            throw FileException();
+        if (header.coreEngine != static_cast<std::uint32_t>(kind)
+            || std::memcmp(header.fingerprint,
+                           assertReturn(fingerprint),
+                           FingerprintSize) != 0)
+            throw FileMismatchException();
+
+        struct ::stat st;
+        if (::fstat(m_fd, &st) != 0
+            || header.dataSize > std::numeric_limits<std::size_t>::max()
+                                 - HeaderSize
+            || static_cast<std::uint64_t>(st.st_size)
+               < HeaderSize + header.dataSize)
+            throw FileException();
+        m_dataSize = header.dataSize;
+        m_offset = header.consumed;
+        m_reserved = header.consumed;
+        m_released = 0u;
+
+        if (m_offset < m_dataSize) {
+            m_mapSize = static_cast<std::size_t>(HeaderSize + m_dataSize);
+            auto const map =
+                    ::mmap(nullptr, m_mapSize, PROT_READ, MAP_SHARED, m_fd, 0);
+            if (map == MAP_FAILED)
+                throw FileException();
+            ::madvise(map, m_mapSize, MADV_SEQUENTIAL);
+            m_data = static_cast<unsigned char *>(map) + HeaderSize;
+            release();
+        }
+        seekContinuation((m_offset < m_dataSize) ? 0u : m_offset - m_dataSize);
+    } catch (...) {
+        std::fill(m_continuationSeed.begin(), m_continuationSeed.end(), 0u);
+        if (m_data)
+            ::munmap(m_data - HeaderSize, m_mapSize);
+        ::close(m_fd);
+        throw;
+    }
+}
+
+RandomFileEngine::~RandomFileEngine() noexcept {
+    std::fill(m_continuationSeed.begin(), m_continuationSeed.end(), 0u);
+    /* The bytes after m_offset have not been served, hence they can be
+       returned to the file: */
+    if (m_offset < m_reserved)
+        writeConsumed(m_fd, m_offset);
+    if (m_data)
+        ::munmap(m_data - HeaderSize, m_mapSize);
+    ::close(m_fd);
+}
+
+void RandomFileEngine::fillBytes(void * buffer, std::size_t size) noexcept {
+    m_stats.recordRequest(size);
+    serve(buffer, size, RandomCopier());
+}
+
+void RandomFileEngine::combineInto(void * buffer,
+                                   std::size_t size,
+                                   RandomCombineOp const op,
+                                   std::size_t const elementSize) noexcept
+{
+    m_stats.recordRequest(size);
+    assert(size % elementSize == 0u);
+    RandomCombiner combiner(op, elementSize);
+    serve(buffer, size, combiner);
+    assert(combiner.complete());
+}
+
+template <typename Output>
+void RandomFileEngine::serve(void * buffer,
+                             std::size_t size,
+                             Output && output) noexcept
+{
+    auto out = static_cast<unsigned char *>(buffer);
+    while (size > 0u) {
+        if (m_offset >= m_reserved)
+            reserveAhead();
+        auto n = (size < m_reserved - m_offset)
+                 ? size
+                 : static_cast<std::size_t>(m_reserved - m_offset);
+        if (m_offset < m_dataSize) {
+            if (n > m_dataSize - m_offset)
+                n = static_cast<std::size_t>(m_dataSize - m_offset);
+            output(out, m_data + m_offset, n);
+        } else {
+            auto const position = m_offset - m_dataSize;
+            if (position / ContinuationStepSize != m_continuationStep) {
+                /* Serving anything but the stream of the step would serve
+                   other bytes after a restart. Hence we fail closed: */
+                try {
+                    seekContinuation(position);
+                } catch (...) {
+                    std::abort();
+                }
+            }
+            auto const stepLeft =
+                    ContinuationStepSize - position % ContinuationStepSize;
+            unsigned char block[CONTINUATION_BLOCK_SIZE];
+            if (n > sizeof(block))
+                n = sizeof(block);
+            if (n > stepLeft)
+                n = static_cast<std::size_t>(stepLeft);
+            m_continuation->fillBytes(block, n);
+            output(out, block, n);
+        }
+        m_offset += n;
+        out += n;
+        size -= n;
+    }
+}
+
+void RandomFileEngine::reserveAhead() noexcept {
+    auto const reserved = m_offset + ReservationSize;
+    /* Serving bytes which are not durably recorded as consumed could serve
+       them again after a crash. Hence we fail closed: */
+    if (!writeConsumed(m_fd, reserved))
+        std::abort();
+    m_reserved = reserved;
+    release();
+}
+
+void RandomFileEngine::seekContinuation(std::uint64_t const offset) {
+    auto const step = offset / ContinuationStepSize;
+    std::vector<unsigned char> seed(m_continuationSeed);
+    try {
+        // Add the step to the last 8 bytes as a little-endian integer:
+        auto const nonce = seed.data() + seed.size() - sizeof(std::uint64_t);
+        std::uint64_t sum = step;
+        for (std::size_t i = 0u; i < sizeof(std::uint64_t); ++i) {
+            sum += nonce[i];
+            nonce[i] = static_cast<unsigned char>(sum);
+            sum >>= 8u;
+        }
+        m_continuation = assertReturn(m_createContinuation(seed.data()));
+    } catch (...) {
+        std::fill(seed.begin(), seed.end(), 0u);
+        throw;
+    }
+    std::fill(seed.begin(), seed.end(), 0u);
+    m_continuationStep = step;
+
+    // Skip what has been consumed from the engine of the step:
+    unsigned char block[CONTINUATION_BLOCK_SIZE];
+    for (auto left = offset % ContinuationStepSize; left > 0u;) {
+        auto const n = (left < sizeof(block))
+                       ? static_cast<std::size_t>(left)
+                       : sizeof(block);
+        m_continuation->fillBytes(block, n);
+        left -= n;
+    }
+}
+
+void RandomFileEngine::release() noexcept {
+    if (!m_data)
+        return;
+    auto const pageSize = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+    auto const consumed = (m_offset < m_dataSize) ? m_offset : m_dataSize;
+    auto const from = (HeaderSize + m_released + pageSize - 1u)
+                      & ~(pageSize - 1u);
+    auto const to = (HeaderSize + consumed) & ~(pageSize - 1u);
+    if (from >= to)
+        return;
+    ::madvise(m_data - HeaderSize + from,
+              static_cast<std::size_t>(to - from),
+              MADV_DONTNEED);
+    #ifdef FALLOC_FL_PUNCH_HOLE
+    ::fallocate(m_fd,
+                FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                static_cast<off_t>(from),
+                static_cast<off_t>(to - from));
+    #endif
+    m_released = to - HeaderSize;
+}
+
+void RandomFileEngine::generate(char const * const path,
+                                SharemindCoreRandomEngineKind const kind,
+                                void const * const fingerprint,
+                                RandomEngine & keystream,
+                                std::uint64_t const dataSize)
+{
+    auto const fd = ::open(assertReturn(path),
+                           O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                           0600);
+    if (fd < 0)
+        throw FileException();
+
+    auto const fail = [fd, path]() {
+        ::close(fd);
+        ::unlink(path);
+        throw FileException();
+    };
+
+    std::vector<unsigned char> block;
+    try {
+        block.resize(GENERATE_BLOCK_SIZE);
+    } catch (...) {
+        ::close(fd);
+        ::unlink(path);
+        throw;
+    }
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = FILE_VERSION;
+    header.coreEngine = static_cast<std::uint32_t>(kind);
+    header.dataSize = dataSize;
+    header.consumed = 0u;
+    std::memcpy(header.fingerprint, assertReturn(fingerprint), FingerprintSize);
+    std::memset(block.data(), 0, HeaderSize);
+    std::memcpy(block.data(), &header, sizeof(header));
+    if (!writeFully(fd, block.data(), HeaderSize, 0))
+        fail();
+
+    off_t offset = HeaderSize;
+    for (auto left = dataSize; left > 0u;) {
+        auto const n = (left < block.size())
+                       ? static_cast<std::size_t>(left)
+                       : block.size();
+        keystream.fillBytes(block.data(), n);
+        if (!writeFully(fd, block.data(), n, offset))
+            fail();
+        offset += static_cast<off_t>(n);
+        left -= n;
+    }
+    if (::fsync(fd) != 0)
+        fail();
+    ::close(fd);
+}
+
+} /* namespace sharemind { */
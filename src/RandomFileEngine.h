@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_RANDOMFILEENGINE_H
+#define SHAREMIND_LIBRANDOM_RANDOMFILEENGINE_H
+
+#include "RandomEngine.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "librandom.h"
+
+
+namespace sharemind {
+
+/**
+ * \brief A random engine serving a keystream pre-generated into a file.
+ *
+ * The file starts with a header recording the kind of the core engine, a
+ * fingerprint of the seed and the consumed offset, followed by the keystream.
+ * The fingerprint and the seed of the continuation engine are the first bytes
+ * of the keystream of the core engine, and the keystream in the file follows
+ * them. Hence neither is ever served as randomness.
+ *
+ * Before serving any bytes, the consumed offset in the header is durably
+ * advanced past them in steps of ReservationSize bytes. After a crash or a
+ * restart the engine continues after the reserved offset, so the same bytes
+ * are never served twice, at the cost of skipping at most one step. Consumed
+ * parts of the file are released from memory and, where supported, punched
+ * out of the file. Once the file is exhausted, the continuation takes over,
+ * with its progress recorded in the same consumed offset.
+ *
+ * The continuation is served in steps of ContinuationStepSize bytes, each
+ * from a fresh engine, the seed of which is the continuation seed with the
+ * index of the step added to the last 8 bytes, i.e. to the IV or nonce of
+ * the core engines. Hence reopening the engine far into the continuation
+ * only skips the consumed part of a single step.
+ *
+ * \note The file is locked while the engine exists, so a file can not be
+ *       consumed by two engines at once.
+ */
+class RandomFileEngine: public RandomEngine {
+
+public: /* Types: */
+
+    SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(Exception, FileException);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(FileException,
+                                                   FileMismatchException);
+
+    /** Creates an engine of the continuation from the given seed. */
+    using ContinuationFactory =
+            std::function<std::shared_ptr<RandomEngine> (void const * seed)>;
+
+public: /* Constants: */
+
+    static constexpr std::size_t FingerprintSize = 32u;
+
+    /** The size of the header, after which the keystream starts. */
+    static constexpr std::size_t HeaderSize = 4096u;
+
+    /** The granularity of durable updates of the consumed offset. */
+    static constexpr std::uint64_t ReservationSize = 64u * 1024u * 1024u;
+
+    /** The number of bytes of the continuation served from every seed. */
+    static constexpr std::uint64_t ContinuationStepSize = 1024u * 1024u;
+
+public: /* Methods: */
+
+    /**
+     * \param[in] path path to a file created with generate().
+     * \param[in] kind the kind of the core engine the file must be from.
+     * \param[in] fingerprint the FingerprintSize bytes the file must have
+     *                        recorded.
+     * \param[in] continuationSeed the seed of the continuation, of at least
+     *                             8 bytes, to serve randomness from after the
+     *                             file has been exhausted.
+     * \param[in] continuationSeedSize the size of continuationSeed in bytes.
+     * \param[in] createContinuation creates the engine of every step of the
+     *                               continuation.
+     * \throws FileException if the file could not be opened, mapped or
+     *                       locked, or has an invalid header.
+     * \throws FileMismatchException if the file was generated with a
+     *                               different core engine or seed.
+     */
+    RandomFileEngine(char const * path,
+                     SharemindCoreRandomEngineKind kind,
+                     void const * fingerprint,
+                     void const * continuationSeed,
+                     std::size_t continuationSeedSize,
+                     ContinuationFactory createContinuation);
+
+    ~RandomFileEngine() noexcept override;
+
+    void fillBytes(void * buffer, std::size_t size) noexcept override;
+
+    void combineInto(void * buffer,
+                     std::size_t size,
+                     RandomCombineOp op,
+                     std::size_t elementSize) noexcept override;
+
+    /** \returns the size of the keystream in the file. */
+    inline std::uint64_t dataSize() const noexcept { return m_dataSize; }
+
+    /** \returns the number of bytes consumed, including skipped ones. */
+    inline std::uint64_t consumed() const noexcept { return m_offset; }
+
+    /**
+     * \brief Creates a new file and writes the header and dataSize bytes of
+     *        keystream from the given engine into it.
+     * \param[in] fingerprint the FingerprintSize bytes to record.
+     * \throws FileException if the file already exists or could not be
+     *                       written. No file is left behind on failure.
+     */
+    static void generate(char const * path,
+                         SharemindCoreRandomEngineKind kind,
+                         void const * fingerprint,
+                         RandomEngine & keystream,
+                         std::uint64_t dataSize);
+
+private: /* Methods: */
+
+    template <typename Output>
+    void serve(void * buffer, std::size_t size, Output && output) noexcept;
+
+    void reserveAhead() noexcept;
+
+    void seekContinuation(std::uint64_t offset);
+
+    void release() noexcept;
+
+private: /* Fields: */
+
+    int m_fd;
+    unsigned char * m_data = nullptr;
+    std::size_t m_mapSize = 0u;
+    std::uint64_t m_dataSize;
+
+    /// The number of bytes consumed:
+    std::uint64_t m_offset;
+
+    /// The consumed offset durably recorded in the file:
+    std::uint64_t m_reserved;
+
+    /// The offset up to which the file has been released:
+    std::uint64_t m_released;
+
+    std::vector<unsigned char> m_continuationSeed;
+    ContinuationFactory const m_createContinuation;
+
+    /// The engine of the current step of the continuation:
+    std::shared_ptr<RandomEngine> m_continuation;
+    std::uint64_t m_continuationStep = 0u;
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_RANDOMFILEENGINE_H */
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "RandomGgmTree.h"
+
+#include <cassert>
+#include <cstring>
+#include "RandomEngine.h"
+
+
+namespace sharemind {
+
+namespace {
+
+inline void xorSeed(std::uint8_t * const dst, std::uint8_t const * const src)
+        noexcept
+{
+    std::uint64_t a[2u];
+    std::uint64_t b[2u];
+    std::memcpy(a, dst, sizeof(a));
+    std::memcpy(b, src, sizeof(b));
+    a[0u] ^= b[0u];
+    a[1u] ^= b[1u];
+    std::memcpy(dst, a, sizeof(a));
+}
+
+} // anonymous namespace
+
+std::uint8_t const RandomGgmTree::DefaultKeys[KeysSize] = {
+    0x24, 0x3f, 0x6a, 0x88, 0x85, 0xa3, 0x08, 0xd3,
+    0x13, 0x19, 0x8a, 0x2e, 0x03, 0x70, 0x73, 0x44,
+    0xa4, 0x09, 0x38, 0x22, 0x29, 0x9f, 0x31, 0xd0,
+    0x08, 0x2e, 0xfa, 0x98, 0xec, 0x4e, 0x6c, 0x89 };
+
+RandomGgmTree::RandomGgmTree() noexcept
+    : RandomGgmTree(DefaultKeys)
+{}
+
+RandomGgmTree::RandomGgmTree(void const * const keys, bool const hardwareAes)
+        noexcept
+    : m_kernel(ggmKernel(hardwareAes))
+{
+    assert(keys);
+    ggmExpandKeys(keys, m_keys);
+}
+
+void RandomGgmTree::expandLevel(void const * const parents,
+                                std::size_t const count,
+                                void * const children,
+                                std::uint8_t * const controlBits)
+        const noexcept
+{
+    assert(parents || count == 0u);
+    assert(children || count == 0u);
+    auto const out = static_cast<std::uint8_t *>(children);
+    m_kernel(m_keys, static_cast<std::uint8_t const *>(parents), count, out);
+    if (controlBits) {
+        for (std::size_t i = 0u; i < 2u * count; ++i) {
+            controlBits[i] = out[i * SeedSize] & 1u;
+            out[i * SeedSize] &= 0xfeu;
+        }
+    }
+}
+
+void RandomGgmTree::expandFull(void const * const root,
+                               unsigned const depth,
+                               void * const leaves,
+                               void * const levelSums) const
+{
+    if (depth > MaxDepth)
+        throw RandomEngine::InvalidParameterException();
+    assert(root);
+    assert(leaves);
+    auto const out = static_cast<std::uint8_t *>(leaves);
+    auto const sums = static_cast<std::uint8_t *>(levelSums);
+    if (sums)
+        std::memset(sums, 0, 2u * depth * SeedSize);
+    std::memmove(out, root, SeedSize);
+    if (depth <= BatchDepth) {
+        expandInPlace(out, depth, sums);
+        return;
+    }
+
+    /* Expand the top of the tree in place at the start of the leaves, and
+       move every node of its last level to the start of its subtree. The
+       nodes are moved from the last, so no node is overwritten before it is
+       moved: */
+    auto const topDepth = depth - BatchDepth;
+    expandInPlace(out, topDepth, sums);
+    std::size_t const subtrees = static_cast<std::size_t>(1u) << topDepth;
+    std::size_t const subtreeSize =
+            (static_cast<std::size_t>(1u) << BatchDepth) * SeedSize;
+    for (std::size_t i = subtrees; i-- > 1u;)
+        std::memcpy(out + i * subtreeSize, out + i * SeedSize, SeedSize);
+
+    auto const subtreeSums = sums ? sums + 2u * topDepth * SeedSize : nullptr;
+    for (std::size_t i = 0u; i < subtrees; ++i)
+        expandInPlace(out + i * subtreeSize, BatchDepth, subtreeSums);
+}
+
+void RandomGgmTree::expandInPlace(std::uint8_t * const nodes,
+                                  unsigned const levels,
+                                  std::uint8_t * levelSums) const noexcept
+{
+    for (unsigned level = 0u; level < levels; ++level) {
+        std::size_t const count = static_cast<std::size_t>(1u) << level;
+        m_kernel(m_keys, nodes, count, nodes);
+        if (levelSums) {
+            for (std::size_t i = 0u; i < 2u * count; i += 2u) {
+                xorSeed(levelSums, nodes + i * SeedSize);
+                xorSeed(levelSums + SeedSize, nodes + (i + 1u) * SeedSize);
+            }
+            levelSums += 2u * SeedSize;
+        }
+    }
+}
+
+} /* namespace sharemind { */
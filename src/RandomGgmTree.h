@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_RANDOMGGMTREE_H
+#define SHAREMIND_LIBRANDOM_RANDOMGGMTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include "GgmKernels.h"
+
+
+namespace sharemind {
+
+/**
+ * \brief Expansion of GGM trees of 128-bit seeds, as used by distributed
+ *        point functions and by the punctured PRFs of silent OT.
+ *
+ * The children of a seed s are AES_k0(s) ^ s and AES_k1(s) ^ s for two fixed
+ * keys, so the key schedules are computed once instead of per node. All
+ * parties of a protocol must use the same keys, by default DefaultKeys.
+ */
+class RandomGgmTree {
+
+public: /* Constants: */
+
+    static constexpr std::size_t SeedSize = GgmSeedSize;
+    static constexpr std::size_t KeysSize = 32u;
+
+    /** The default keys, the first hexadecimal digits of the fraction of pi. */
+    static std::uint8_t const DefaultKeys[KeysSize];
+
+    /**
+     * \brief The depth of the subtrees expanded at a time by expandFull(),
+     *        i.e. subtrees of 2^BatchDepth leaves take 256 KiB.
+     */
+    static constexpr unsigned BatchDepth = 14u;
+
+    static constexpr unsigned MaxDepth =
+            std::numeric_limits<std::size_t>::digits - 5u;
+
+public: /* Methods: */
+
+    RandomGgmTree() noexcept;
+
+    /**
+     * \param[in] keys the KeysSize bytes of the AES-128 keys of the left and
+     *                 the right children.
+     * \param[in] hardwareAes whether to use AES-NI if the host supports it.
+     */
+    explicit RandomGgmTree(void const * keys, bool hardwareAes = true)
+            noexcept;
+
+    /**
+     * \brief Expands a level of count seeds, writing the children of seed i
+     *        to indexes 2i and 2i + 1 of children, which may equal parents.
+     * \param[out] controlBits if not null, the lowest bit of the first byte
+     *                         of every child is moved to the respective
+     *                         element of the 2 * count bytes, as needed for
+     *                         the control bits of distributed point functions.
+     */
+    void expandLevel(void const * parents,
+                     std::size_t count,
+                     void * children,
+                     std::uint8_t * controlBits = nullptr) const noexcept;
+
+    /**
+     * \brief Expands the full tree of the given depth under the given root,
+     *        in subtrees of 2^BatchDepth leaves.
+     * \param[out] leaves the 2^depth leaves in order.
+     * \param[out] levelSums if not null, 2 * depth seeds receiving for every
+     *                       level of children the XOR of all left children
+     *                       followed by the XOR of all right children.
+     * \throws RandomEngine::InvalidParameterException if depth exceeds
+     *         MaxDepth.
+     */
+    void expandFull(void const * root,
+                    unsigned depth,
+                    void * leaves,
+                    void * levelSums = nullptr) const;
+
+private: /* Methods: */
+
+    /**
+     * \brief Expands the tree in place from the seed at the start of the
+     *        given buffer, for the given number of levels.
+     */
+    void expandInPlace(std::uint8_t * nodes,
+                       unsigned levels,
+                       std::uint8_t * levelSums) const noexcept;
+
+private: /* Fields: */
+
+    GgmKernel const m_kernel;
+    GgmKeySchedule m_keys;
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_RANDOMGGMTREE_H */
@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+
+#ifndef SHAREMIND_LIBRANDOM_RANDOMINDEXSAMPLING_H
+#define SHAREMIND_LIBRANDOM_RANDOMINDEXSAMPLING_H
+
+#include "RandomEngine.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "RandomWordSource.h"
+
+
+namespace sharemind {
+
+/** \brief The order of the indexes output by sampleIndices(). */
+enum class RandomIndexOrder {
+    /** In increasing order. */
+    Sorted,
+
+    /** In uniformly random order. */
+    Unsorted
+};
+
+/**
+ * \brief Selects k of the indexes 0, ..., n - 1 without replacement in
+ *        increasing order, one at a time, using method D of Vitter.
+ *
+ * Every index takes expected constant time and only constant memory is used,
+ * hence the indexes can be consumed as a stream. Where k is more than a
+ * 1/Alpha fraction of n, the cheaper method A is used instead, which takes
+ * time proportional to n, i.e. at most Alpha times k.
+ *
+ * See "An Efficient Algorithm for Sequential Random Sampling" by Vitter, 1987.
+ */
+template <typename Engine>
+class RandomSequentialSampler {
+
+public: /* Constants: */
+
+    /** The ratio of n to k above which method D is used. */
+    static constexpr std::uint64_t Alpha = 13u;
+
+    /** The largest n supported, i.e. the precision of doubles. */
+    static constexpr std::uint64_t MaxPopulation = std::uint64_t(1u) << 53u;
+
+public: /* Methods: */
+
+    /**
+     * \throws RandomEngine::InvalidParameterException if k exceeds n or n
+     *         exceeds MaxPopulation.
+     */
+    inline RandomSequentialSampler(Engine & engine,
+                                   std::uint64_t const n,
+                                   std::uint64_t const k)
+        : m_source(engine)
+        , m_population(n)
+        , m_remaining(k)
+    {
+        if (k > n || n > MaxPopulation)
+            throw RandomEngine::InvalidParameterException();
+    }
+
+    /** \returns the number of indexes left to select. */
+    inline std::uint64_t remaining() const noexcept { return m_remaining; }
+
+    /**
+     * \returns the next selected index.
+     * \pre remaining() > 0
+     */
+    inline std::uint64_t next() noexcept {
+        assert(m_remaining > 0u);
+        std::uint64_t skip;
+        if (m_remaining == 1u) {
+            skip = m_source.uniformBelow(m_population);
+        } else if (m_remaining * Alpha < m_population) {
+            skip = skipD();
+        } else {
+            m_haveVPrime = false;
+            skip = skipA();
+        }
+        assert(skip < m_population);
+        auto const index = m_next + skip;
+        m_next = index + 1u;
+        m_population -= skip + 1u;
+        --m_remaining;
+        return index;
+    }
+
+private: /* Methods: */
+
+    inline double uniform() noexcept { return m_source.uniformOpen(); }
+
+    /** \returns the number of indexes to skip, by method A. */
+    inline std::uint64_t skipA() noexcept {
+        auto const v = uniform();
+        std::uint64_t skip = 0u;
+        auto top = static_cast<double>(m_population - m_remaining);
+        auto population = static_cast<double>(m_population);
+        auto quotient = top / population;
+        while (quotient > v) {
+            ++skip;
+            top -= 1.0;
+            population -= 1.0;
+            quotient = quotient * top / population;
+        }
+        return skip;
+    }
+
+    /** \returns the number of indexes to skip, by method D. */
+    inline std::uint64_t skipD() noexcept {
+        auto const n = static_cast<double>(m_remaining);
+        auto const population = static_cast<double>(m_population);
+        auto const q = population - n + 1.0;
+        if (!m_haveVPrime) {
+            m_vPrime = std::exp(std::log(uniform()) / n);
+            m_haveVPrime = true;
+        }
+        for (;;) {
+            double x;
+            double s;
+            for (;;) {
+                x = population * (1.0 - m_vPrime);
+                s = std::floor(x);
+                if (s < q)
+                    break;
+                m_vPrime = std::exp(std::log(uniform()) / n);
+            }
+            auto const y1 = std::exp(std::log(uniform() * population / q)
+                                     / (n - 1.0));
+            m_vPrime = y1 * (1.0 - x / population) * (q / (q - s));
+            // The quick acceptance test, after which V' serves the next call:
+            if (m_vPrime <= 1.0)
+                return static_cast<std::uint64_t>(s);
+
+            double y2 = 1.0;
+            double top = population - 1.0;
+            double bottom;
+            double limit;
+            if (n - 1.0 > s) {
+                bottom = population - n;
+                limit = population - s;
+            } else {
+                bottom = population - s - 1.0;
+                limit = q;
+            }
+            for (double t = population - 1.0; t >= limit; t -= 1.0) {
+                y2 = (y2 * top) / bottom;
+                top -= 1.0;
+                bottom -= 1.0;
+            }
+            if (population / (population - x)
+                >= y1 * std::exp(std::log(y2) / (n - 1.0)))
+            {
+                m_vPrime = std::exp(std::log(uniform()) / (n - 1.0));
+                return static_cast<std::uint64_t>(s);
+            }
+            m_vPrime = std::exp(std::log(uniform()) / n);
+        }
+    }
+
+private: /* Fields: */
+
+    BasicRandomWordSource<Engine> m_source;
+
+    /// The number of indexes left to select from:
+    std::uint64_t m_population;
+
+    /// The number of indexes left to select:
+    std::uint64_t m_remaining;
+
+    /// The first index left to select from:
+    std::uint64_t m_next = 0u;
+
+    /// V' of method D, distributed as the largest of m_remaining uniforms:
+    bool m_haveVPrime = false;
+    double m_vPrime = 0.0;
+
+};
+
+/**
+ * \brief Fills out with k distinct indexes drawn uniformly from 0, ..., n - 1.
+ *
+ * Sorted output is generated by RandomSequentialSampler. Unsorted output uses
+ * the algorithm of Floyd with a hash set of O(k) entries where k is at most a
+ * 1/Alpha fraction of n, and sorted output otherwise, followed by a shuffle.
+ * Hence the time taken is proportional to k, not to n.
+ *
+ * \param[in] engine a RandomEngine or a RandomEngineFacade.
+ * \throws RandomEngine::InvalidParameterException if k exceeds n or n
+ *         exceeds RandomSequentialSampler::MaxPopulation.
+ * \throws std::bad_alloc if the hash set can not be allocated.
+ */
+template <typename Engine>
+void sampleIndices(Engine & engine,
+                   std::uint64_t const n,
+                   std::uint64_t const k,
+                   std::uint64_t * const out,
+                   RandomIndexOrder const order = RandomIndexOrder::Unsorted)
+{
+    using Sampler = RandomSequentialSampler<Engine>;
+    if (k > n || n > Sampler::MaxPopulation)
+        throw RandomEngine::InvalidParameterException();
+    if (order == RandomIndexOrder::Sorted || k * Sampler::Alpha >= n) {
+        Sampler sampler(engine, n, k);
+        for (std::uint64_t i = 0u; i < k; ++i)
+            out[i] = sampler.next();
+        if (order == RandomIndexOrder::Sorted)
+            return;
+    } else {
+        /* An open addressing hash set of the selected indexes plus one, with
+           at least twice as many slots as indexes: */
+        std::size_t slots = 16u;
+        while (slots < 2u * k)
+            slots *= 2u;
+        std::vector<std::uint64_t> set(slots);
+        auto const mask = slots - 1u;
+        auto const insert = [&set, mask](std::uint64_t const value) noexcept {
+            auto slot = static_cast<std::size_t>(
+                        ((value + 1u) * 0x9e3779b97f4a7c15u) >> 32u) & mask;
+            for (; set[slot] != 0u; slot = (slot + 1u) & mask)
+                if (set[slot] == value + 1u)
+                    return false;
+            set[slot] = value + 1u;
+            return true;
+        };
+
+        BasicRandomWordSource<Engine> source(engine);
+        for (std::uint64_t j = n - k, i = 0u; j < n; ++j, ++i) {
+            auto const t = source.uniformBelow(j + 1u);
+            out[i] = insert(t) ? t : (insert(j), j);
+        }
+    }
+
+    // Fisher-Yates, as neither method outputs in random order:
+    BasicRandomWordSource<Engine> source(engine);
+    for (std::uint64_t i = k; i > 1u; --i)
+        std::swap(out[i - 1u], out[source.uniformBelow(i)]);
+}
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_RANDOMINDEXSAMPLING_H */
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "RandomPrf.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include "ChaCha20RandomEngine.h"
+#include "RandomEngine.h"
+
+
+namespace sharemind {
+
+namespace {
+
+/** The number of indexes evaluated at a time. */
+constexpr std::size_t const CHUNK_SIZE = 64u;
+static_assert(CHUNK_SIZE % ChaCha20BatchLanes == 0u, "");
+
+constexpr std::size_t const AES_KEY_SIZE = 16u;
+constexpr std::size_t const AES_BLOCK_SIZE = 16u;
+constexpr std::size_t const CHACHA20_BLOCK_SIZE = 64u;
+
+inline std::uint32_t u8to32_little(std::uint8_t const * const p) noexcept {
+    return static_cast<std::uint32_t>(p[0])
+           | (static_cast<std::uint32_t>(p[1]) << 8u)
+           | (static_cast<std::uint32_t>(p[2]) << 16u)
+           | (static_cast<std::uint32_t>(p[3]) << 24u);
+}
+
+inline void u64to8_little(std::uint64_t v, std::uint8_t * const p) noexcept {
+    for (std::size_t i = 0u; i < 8u; ++i, v >>= 8u)
+        p[i] = static_cast<std::uint8_t>(v);
+}
+
+} // anonymous namespace
+
+RandomPrf::RandomPrf(SharemindCoreRandomEngineKind const kind,
+                     void const * const key)
+    : RandomPrf(kind, key, CpuFeatures::instance().level())
+{}
+
+RandomPrf::RandomPrf(SharemindCoreRandomEngineKind const kind,
+                     void const * const key,
+                     CpuFeatures::Level level)
+    : m_kind(kind)
+{
+    assert(key);
+    level = std::min(level, CpuFeatures::instance().level());
+    auto const k = static_cast<std::uint8_t const *>(key);
+    switch (kind) {
+    case SHAREMIND_RANDOM_AES:
+        m_aesKernel = aesBlocksKernel(level > CpuFeatures::Level::Generic);
+        aesExpandKey(k, m_aesKeys);
+        break;
+    case SHAREMIND_RANDOM_CHACHA20:
+        m_chaCha20Kernel = chaCha20PrfKernel(level);
+        m_chaCha20State[0u] = 0x61707865u;
+        m_chaCha20State[1u] = 0x3320646eu;
+        m_chaCha20State[2u] = 0x79622d32u;
+        m_chaCha20State[3u] = 0x6b206574u;
+        for (std::size_t i = 0u; i < 8u; ++i)
+            m_chaCha20State[4u + i] = u8to32_little(k + i * 4u);
+        m_chaCha20State[12u] = 0u;
+        m_chaCha20State[13u] = 0u;
+        m_chaCha20State[14u] = u8to32_little(k + 32u);
+        m_chaCha20State[15u] = u8to32_little(k + 36u);
+        break;
+    default:
+        throw RandomEngine::GeneratorNotSupportedException();
+    }
+}
+
+std::size_t RandomPrf::keySize(SharemindCoreRandomEngineKind const kind)
+        noexcept
+{
+    switch (kind) {
+    case SHAREMIND_RANDOM_AES:      return AES_KEY_SIZE;
+    case SHAREMIND_RANDOM_CHACHA20: return ChaCha20RandomEngine::SeedSize;
+    default:                        return 0u;
+    }
+}
+
+void RandomPrf::eval(std::uint64_t const * const indexes,
+                     std::size_t const count,
+                     void * const out,
+                     std::size_t const outWidth) const
+{
+    if (outWidth == 0u || outWidth > MaxOutputWidth)
+        throw RandomEngine::InvalidParameterException();
+    if (count == 0u)
+        return;
+    assert(indexes);
+    assert(out);
+    if (m_kind == SHAREMIND_RANDOM_AES) {
+        evalAes(indexes, count, static_cast<std::uint8_t *>(out), outWidth);
+    } else {
+        evalChaCha20(indexes,
+                     count,
+                     static_cast<std::uint8_t *>(out),
+                     outWidth);
+    }
+}
+
+void RandomPrf::evalAes(std::uint64_t const * const indexes,
+                        std::size_t const count,
+                        std::uint8_t * const out,
+                        std::size_t const outWidth) const noexcept
+{
+    constexpr std::size_t const maxBlocks = MaxOutputWidth / AES_BLOCK_SIZE;
+    auto const blocks = (outWidth + AES_BLOCK_SIZE - 1u) / AES_BLOCK_SIZE;
+    std::uint8_t buffer[CHUNK_SIZE * maxBlocks * AES_BLOCK_SIZE];
+    for (std::size_t start = 0u; start < count; start += CHUNK_SIZE) {
+        auto const n = std::min(CHUNK_SIZE, count - start);
+        auto block = buffer;
+        for (std::size_t i = 0u; i < n; ++i) {
+            for (std::size_t j = 0u; j < blocks; ++j) {
+                u64to8_little(indexes[start + i], block);
+                u64to8_little(j, block + 8u);
+                block += AES_BLOCK_SIZE;
+            }
+        }
+        m_aesKernel(m_aesKeys, buffer, n * blocks, buffer);
+        for (std::size_t i = 0u; i < n; ++i)
+            std::memcpy(out + (start + i) * outWidth,
+                        buffer + i * blocks * AES_BLOCK_SIZE,
+                        outWidth);
+    }
+}
+
+void RandomPrf::evalChaCha20(std::uint64_t const * const indexes,
+                             std::size_t const count,
+                             std::uint8_t * const out,
+                             std::size_t const outWidth) const noexcept
+{
+    std::uint64_t counters[CHUNK_SIZE];
+    std::uint8_t buffer[CHUNK_SIZE * CHACHA20_BLOCK_SIZE];
+    for (std::size_t start = 0u; start < count; start += CHUNK_SIZE) {
+        auto const n = std::min(CHUNK_SIZE, count - start);
+        // The kernel takes whole multiples of the lanes:
+        auto const lanes = (n + ChaCha20BatchLanes - 1u)
+                           / ChaCha20BatchLanes * ChaCha20BatchLanes;
+        std::memcpy(counters, indexes + start, n * sizeof(counters[0u]));
+        std::fill(counters + n, counters + lanes, 0u);
+        m_chaCha20Kernel(m_chaCha20State, counters, lanes, buffer);
+        for (std::size_t i = 0u; i < n; ++i)
+            std::memcpy(out + (start + i) * outWidth,
+                        buffer + i * CHACHA20_BLOCK_SIZE,
+                        outWidth);
+    }
+}
+
+void prfEval(SharemindCoreRandomEngineKind const kind,
+             void const * const key,
+             std::uint64_t const * const indexes,
+             std::size_t const count,
+             void * const out,
+             std::size_t const outWidth)
+{ RandomPrf(kind, key).eval(indexes, count, out, outWidth); }
+
+} /* namespace sharemind { */
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_RANDOMPRF_H
+#define SHAREMIND_LIBRANDOM_RANDOMPRF_H
+
+#include <cstddef>
+#include <cstdint>
+#include "AesKernels.h"
+#include "ChaCha20Kernels.h"
+#include "CpuFeatures.h"
+#include "librandom.h"
+
+
+namespace sharemind {
+
+/**
+ * \brief A keyed pseudo-random function of 64-bit indexes, evaluated for
+ *        arrays of arbitrary indexes at a time.
+ *
+ * For ChaCha20 the key is a seed of ChaCha20RandomEngine, and F_k(i) is the
+ * block of the cipher with counter i, i.e. block i of the stream of the
+ * engine seeded with k, but with its words in order. For AES the key is an
+ * AES-128 key, and block j of F_k(i) is AES_k(i || j) for i and j encoded as
+ * 64-bit little-endian integers. The outputs are prefixes of these blocks.
+ *
+ * The key schedule is computed once on construction, and the indexes are
+ * evaluated in the lanes of SIMD vectors or in the AES-NI pipeline.
+ */
+class RandomPrf {
+
+public: /* Constants: */
+
+    static constexpr std::size_t MaxOutputWidth = 64u;
+
+public: /* Methods: */
+
+    /**
+     * \param[in] key keySize(kind) bytes of key.
+     * \throws RandomEngine::GeneratorNotSupportedException if kind is neither
+     *         SHAREMIND_RANDOM_AES nor SHAREMIND_RANDOM_CHACHA20.
+     */
+    RandomPrf(SharemindCoreRandomEngineKind kind, void const * key);
+
+    /**
+     * \brief Constructs a function using the kernels for the given SIMD
+     *        level, or for the level of the host if that is lower. AES-NI is
+     *        used only above the generic level.
+     */
+    RandomPrf(SharemindCoreRandomEngineKind kind,
+              void const * key,
+              CpuFeatures::Level level);
+
+    /** \returns the size of the key for the given kind, or 0 if unsupported. */
+    static std::size_t keySize(SharemindCoreRandomEngineKind kind) noexcept;
+
+    inline SharemindCoreRandomEngineKind kind() const noexcept
+    { return m_kind; }
+
+    /**
+     * \brief Writes F_k(indexes[i]) of outWidth bytes to out at i * outWidth
+     *        for every i < count.
+     * \throws RandomEngine::InvalidParameterException if outWidth is zero or
+     *         exceeds MaxOutputWidth.
+     */
+    void eval(std::uint64_t const * indexes,
+              std::size_t count,
+              void * out,
+              std::size_t outWidth) const;
+
+private: /* Methods: */
+
+    void evalAes(std::uint64_t const * indexes,
+                 std::size_t count,
+                 std::uint8_t * out,
+                 std::size_t outWidth) const noexcept;
+
+    void evalChaCha20(std::uint64_t const * indexes,
+                      std::size_t count,
+                      std::uint8_t * out,
+                      std::size_t outWidth) const noexcept;
+
+private: /* Fields: */
+
+    SharemindCoreRandomEngineKind const m_kind;
+
+    AesBlocksKernel m_aesKernel = nullptr;
+    AesRoundKeys m_aesKeys;
+
+    ChaCha20PrfKernel m_chaCha20Kernel = nullptr;
+    std::uint32_t m_chaCha20State[16u];
+
+};
+
+/**
+ * \brief Evaluates the given keyed function at the given indexes, see
+ *        RandomPrf::eval().
+ */
+void prfEval(SharemindCoreRandomEngineKind kind,
+             void const * key,
+             std::uint64_t const * indexes,
+             std::size_t count,
+             void * out,
+             std::size_t outWidth);
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_RANDOMPRF_H */
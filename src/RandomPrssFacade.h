@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_RANDOMPRSSFACADE_H
+#define SHAREMIND_LIBRANDOM_RANDOMPRSSFACADE_H
+
+#include "librandom.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include "RandomEngineFacade.h"
+
+
+namespace sharemind {
+
+/**
+ * \brief Pseudo-random secret sharing for three-party sessions.
+ *
+ * Every party i holds an engine seeded with the seed it shares with the next
+ * party i+1 and one seeded with the seed it shares with the previous party
+ * i-1 (indices modulo 3). Hence the next engine of party i produces the same
+ * stream as the previous engine of party i+1, and the shares generated below
+ * by the three parties in the same order are consistent.
+ *
+ * The zero sharings are generated in blocks small enough to stay in the L1
+ * cache: every block is filled from one engine, and the stream of the other
+ * engine is combined into it as it is generated.
+ */
+class RandomPrssFacade {
+
+public: /* Constants: */
+
+    /** The number of bytes generated from both engines at a time. */
+    static constexpr std::size_t BlockSize = 4096u;
+
+public: /* Methods: */
+
+    /**
+     * \param[in] nextEngine engine seeded with the seed shared with the next
+     *                       party.
+     * \param[in] prevEngine engine seeded with the seed shared with the
+     *                       previous party.
+     */
+    inline RandomPrssFacade(RandomEngineFacade nextEngine,
+                            RandomEngineFacade prevEngine) noexcept
+        : m_next(std::move(nextEngine))
+        , m_prev(std::move(prevEngine))
+    {}
+
+    inline RandomEngineFacade & nextEngine() noexcept { return m_next; }
+    inline RandomEngineFacade & prevEngine() noexcept { return m_prev; }
+
+    /**
+     * \brief Fills the given memory region with a share of zero, i.e. the
+     *        regions filled by the three parties XOR to zero.
+     */
+    inline void fillZeroShareXor(void * memptr, std::size_t numBytes) noexcept
+    {
+        auto out = static_cast<unsigned char *>(memptr);
+        while (numBytes > 0u) {
+            auto const n = (numBytes < BlockSize) ? numBytes : BlockSize;
+            m_next.fillBytes(out, n);
+            m_prev.xorBytesInto(out, n);
+            out += n;
+            numBytes -= n;
+        }
+    }
+
+    /**
+     * \brief Fills the given range with additive shares of zero modulo
+     *        2^(8 * sizeof(T)), i.e. the ranges filled by the three parties
+     *        sum up to zero element-wise.
+     */
+    template <typename T>
+    inline void fillZeroShareAdd(T * begin, T * end) noexcept {
+        static_assert(std::is_integral<T>::value
+                      && std::is_unsigned<T>::value,
+                      "Additive shares require an unsigned integral type!");
+        static_assert(BlockSize % sizeof(T) == 0u, "");
+        assert(begin <= end);
+        constexpr std::size_t const blockCount = BlockSize / sizeof(T);
+        while (begin < end) {
+            auto const left = std::distance(begin, end);
+            using U = typename std::make_unsigned<decltype(left)>::type;
+            auto const blockEnd = (static_cast<U>(left) < blockCount)
+                                  ? end
+                                  : begin + blockCount;
+            m_next.fillBlock(begin, blockEnd);
+            m_prev.subFrom(begin, blockEnd);
+            begin = blockEnd;
+        }
+    }
+
+    /**
+     * \brief Fills the given memory regions with a replicated sharing of a
+     *        random value, i.e. the nextShare of every party equals the
+     *        prevShare of the next party.
+     */
+    inline void fillReplicatedShare(void * nextShare,
+                                    void * prevShare,
+                                    std::size_t numBytes) noexcept
+    {
+        m_next.fillBytes(nextShare, numBytes);
+        m_prev.fillBytes(prevShare, numBytes);
+    }
+
+private: /* Fields: */
+
+    RandomEngineFacade m_next;
+    RandomEngineFacade m_prev;
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_RANDOMPRSSFACADE_H */
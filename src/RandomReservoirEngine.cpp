@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "RandomReservoirEngine.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <sharemind/AssertReturn.h>
+#include <utility>
+
+
+namespace sharemind {
+
+namespace {
+
+unsigned char * allocateReservoir(std::size_t const size) {
+    void * r;
+    if (::posix_memalign(&r, RandomReservoirEngine::Alignment, size) != 0)
+        throw std::bad_alloc();
+    return static_cast<unsigned char *>(r);
+}
+
+std::size_t roundSize(std::size_t const size) {
+    constexpr auto const a = RandomReservoirEngine::Alignment;
+    if (size <= a)
+        return a;
+    // Such a reservoir could never be allocated, and rounding it would wrap:
+    if (size > std::numeric_limits<std::size_t>::max() - (a - 1u))
+        throw std::bad_alloc();
+    return (size + a - 1u) / a * a;
+}
+
+} // anonymous namespace
+
+RandomReservoirEngine::RandomReservoirEngine(
+        std::shared_ptr<RandomEngine> engine,
+        std::size_t const reservoirSize)
+    : m_engine(assertReturn(std::move(engine)))
+    , m_size(roundSize(reservoirSize))
+    , m_reservoir(allocateReservoir(m_size))
+    , m_offset(m_size)
+{}
+
+RandomReservoirEngine::~RandomReservoirEngine() noexcept
+{ std::free(m_reservoir); }
+
+void RandomReservoirEngine::fillBytes(void * buffer, std::size_t size)
+        noexcept
+{
+    m_stats.recordRequest(size);
+    auto const available = m_size - m_offset;
+    if (size <= available) {
+        std::memcpy(buffer, m_reservoir + m_offset, size);
+        m_offset += size;
+        return;
+    }
+
+    auto out = static_cast<unsigned char *>(buffer);
+    std::memcpy(out, m_reservoir + m_offset, available);
+    out += available;
+    size -= available;
+    if (size >= m_size) {
+        // Whole reservoirs worth of bytes are generated directly:
+        auto const direct = size - size % m_size;
+        m_engine->fillBytes(out, direct);
+        out += direct;
+        size -= direct;
+    }
+    refill();
+    std::memcpy(out, m_reservoir, size);
+    m_offset = size;
+}
+
+void RandomReservoirEngine::combineInto(void * buffer,
+                                        std::size_t size,
+                                        RandomCombineOp const op,
+                                        std::size_t const elementSize)
+        noexcept
+{
+    m_stats.recordRequest(size);
+    assert(size % elementSize == 0u);
+    RandomCombiner combiner(op, elementSize);
+    for (;;) {
+        auto const available = m_size - m_offset;
+        if (size <= available) {
+            combiner(buffer, m_reservoir + m_offset, size);
+            m_offset += size;
+            break;
+        }
+        combiner(buffer, m_reservoir + m_offset, available);
+        buffer = static_cast<unsigned char *>(buffer) + available;
+        size -= available;
+        refill();
+    }
+    assert(combiner.complete());
+}
+
+std::size_t RandomReservoirEngine::bufferSize() const noexcept
+{ return m_size; }
+
+void RandomReservoirEngine::getStats(SharemindRandomEngineStats & stats)
+        const noexcept
+{
+    m_engine->getStats(stats);
+    m_stats.addToWrapped(stats);
+}
+
+void RandomReservoirEngine::refill() noexcept {
+    m_engine->fillBytes(m_reservoir, m_size);
+    m_offset = 0u;
+}
+
+} /* namespace sharemind { */
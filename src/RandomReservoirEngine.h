@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_RANDOMRESERVOIRENGINE_H
+#define SHAREMIND_LIBRANDOM_RANDOMRESERVOIRENGINE_H
+
+#include "RandomEngine.h"
+
+#include <cstddef>
+#include <memory>
+
+
+namespace sharemind {
+
+/**
+ * \brief A random engine serving small requests from a reservoir of
+ *        keystream, which is refilled in bulk from the wrapped engine on the
+ *        calling thread.
+ *
+ * Small reads are a bounds check and a copy from the cache-aligned
+ * reservoir, and the per-call overhead of the wrapped engine is amortized
+ * over the whole reservoir. Requests larger than the reservoir are filled
+ * directly by the wrapped engine after the rest of the reservoir. The stream
+ * is the same as that of the wrapped engine.
+ */
+class RandomReservoirEngine: public RandomEngine {
+
+public: /* Constants: */
+
+    /** The alignment of the reservoir, and the granularity of its size. */
+    static constexpr std::size_t Alignment = 64u;
+
+public: /* Methods: */
+
+    /**
+     * \param[in] engine the engine to wrap.
+     * \param[in] reservoirSize the size of the reservoir in bytes, rounded up
+     *                          to a multiple of Alignment, e.g. 4-16 KiB.
+     * \throws std::bad_alloc if the reservoir could not be allocated, or if
+     *                        its rounded size would not fit std::size_t.
+     */
+    RandomReservoirEngine(std::shared_ptr<RandomEngine> engine,
+                          std::size_t reservoirSize);
+
+    ~RandomReservoirEngine() noexcept override;
+
+    void fillBytes(void * buffer, std::size_t size) noexcept override;
+
+    void combineInto(void * buffer,
+                     std::size_t size,
+                     RandomCombineOp op,
+                     std::size_t elementSize) noexcept override;
+
+    std::size_t bufferSize() const noexcept override;
+
+    void getStats(SharemindRandomEngineStats & stats) const noexcept override;
+
+private: /* Methods: */
+
+    void refill() noexcept;
+
+private: /* Fields: */
+
+    std::shared_ptr<RandomEngine> const m_engine;
+    std::size_t const m_size;
+    unsigned char * const m_reservoir;
+
+    /// The number of bytes consumed from the reservoir:
+    std::size_t m_offset;
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_RANDOMRESERVOIRENGINE_H */
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "RandomRingBuffer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <sharemind/PotentiallyVoidTypeInfo.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include "librandom.h"
+
+
+namespace sharemind {
+
+namespace {
+
+constexpr static std::size_t const DEFAULT_HUGE_PAGE_SIZE = 2u * 1024u * 1024u;
+
+/* The number of times to poll before going to sleep when waiting: */
+constexpr static unsigned const WAIT_SPIN_COUNT = 64u;
+
+/* The amount of free space the producer waits for when the buffer is full,
+   to avoid waking it up for every small read: */
+constexpr static std::size_t const MAX_REFILL_THRESHOLD = 64u * 1024u;
+
+std::size_t hugePageSize() noexcept {
+    static std::size_t const r = []() noexcept {
+        std::size_t size = DEFAULT_HUGE_PAGE_SIZE;
+        if (auto * const f = std::fopen("/proc/meminfo", "r")) {
+            char line[128u];
+            unsigned long kb;
+            while (std::fgets(line, sizeof(line), f))
+                if (std::sscanf(line, "Hugepagesize: %lu kB", &kb) == 1) {
+                    size = kb * 1024u;
+                    break;
+                }
+            std::fclose(f);
+        }
+        return size;
+    }();
+    return r;
+}
+
+inline std::size_t roundUp(std::size_t const size, std::size_t const to)
+        noexcept
+{ return ((size + to - 1u) / to) * to; }
+
+} // anonymous namespace
+
+RandomRingBuffer::RandomRingBuffer(std::size_t const capacity,
+                                   unsigned const flags,
+                                   unsigned const numaNode,
+                                   std::size_t const maxCapacity)
+    : m_pageSize(static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)))
+    , m_capacity(capacity)
+    , m_maxCapacity((maxCapacity > capacity) ? maxCapacity : capacity)
+    , m_resizable(maxCapacity > capacity)
+{
+    assert(capacity > 0u);
+    m_data = MAP_FAILED;
+
+    if (flags & SHAREMIND_RANDOM_BUFFER_HUGE_PAGES) {
+        auto const hugeSize = hugePageSize();
+        m_mappedSize = roundUp(m_maxCapacity, hugeSize);
+        #ifdef MAP_HUGETLB
+        m_data = ::mmap(nullptr,
+                        m_mappedSize,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                        -1,
+                        0);
+        #endif
+        if (m_data == MAP_FAILED) {
+            /* No huge pages reserved, fall back to transparent huge pages. The
+               region is over-allocated and trimmed to be huge page aligned,
+               because otherwise the kernel can not use huge pages for it: */
+            auto const size = m_mappedSize + hugeSize;
+            auto * const p = ::mmap(nullptr,
+                                    size,
+                                    PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS,
+                                    -1,
+                                    0);
+            if (p != MAP_FAILED) {
+                auto const addr = reinterpret_cast<std::uintptr_t>(p);
+                auto const aligned = roundUp(addr, hugeSize);
+                if (aligned > addr)
+                    ::munmap(p, aligned - addr);
+                auto const tail = (addr + size) - (aligned + m_mappedSize);
+                if (tail > 0u)
+                    ::munmap(reinterpret_cast<void *>(aligned + m_mappedSize),
+                             tail);
+                m_data = reinterpret_cast<void *>(aligned);
+                #ifdef MADV_HUGEPAGE
+                m_hugePages = ::madvise(m_data,
+                                        m_mappedSize,
+                                        MADV_HUGEPAGE) == 0;
+                #endif
+            }
+        } else {
+            m_hugePages = true;
+        }
+        if (m_hugePages)
+            m_pageSize = hugeSize;
+    }
+
+    if (m_data == MAP_FAILED) {
+        m_mappedSize = roundUp(m_maxCapacity, m_pageSize);
+        m_data = ::mmap(nullptr,
+                        m_mappedSize,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                        -1,
+                        0);
+        if (m_data == MAP_FAILED)
+            throw std::bad_alloc();
+    }
+
+    // The following must be done before the pages are touched:
+    if (numaNode != NumaTopology::NoNode)
+        NumaTopology::bindMemoryToNode(m_data, m_mappedSize, numaNode);
+    if (flags & SHAREMIND_RANDOM_BUFFER_NO_DUMP) {
+        #ifdef MADV_DONTDUMP
+        ::madvise(m_data, m_mappedSize, MADV_DONTDUMP);
+        #endif
+        #ifdef MADV_WIPEONFORK
+        ::madvise(m_data, m_mappedSize, MADV_WIPEONFORK);
+        #endif
+    }
+    if (flags & SHAREMIND_RANDOM_BUFFER_LOCKED)
+        m_locked = ::mlock(m_data, commitSize(capacity)) == 0;
+}
+
+RandomRingBuffer::~RandomRingBuffer() noexcept {
+    if (m_locked)
+        ::munlock(m_data, m_mappedSize);
+    ::munmap(m_data, m_mappedSize);
+}
+
+std::size_t RandomRingBuffer::read(void * buffer, std::size_t size) noexcept {
+    if (m_resizable) {
+        std::lock_guard<std::mutex> const guard(m_resizeMutex);
+        return readUnlocked(buffer, size, RandomCopier());
+    }
+    return readUnlocked(buffer, size, RandomCopier());
+}
+
+std::size_t RandomRingBuffer::read(void * buffer,
+                                   std::size_t size,
+                                   RandomCombiner & combiner) noexcept
+{
+    if (m_resizable) {
+        std::lock_guard<std::mutex> const guard(m_resizeMutex);
+        return readUnlocked(buffer, size, combiner);
+    }
+    return readUnlocked(buffer, size, combiner);
+}
+
+template <typename Output>
+std::size_t RandomRingBuffer::readUnlocked(void * buffer,
+                                           std::size_t size,
+                                           Output && output) noexcept
+{
+    auto const readPos = m_readPos.load(std::memory_order_relaxed);
+    auto const available = dataAvailable();
+    if (size > available)
+        size = available;
+    if (size <= 0u)
+        return 0u;
+
+    auto const capacity = this->capacity();
+    auto const offset = static_cast<std::size_t>(
+                (readPos - m_basePos.load(std::memory_order_relaxed))
+                % capacity);
+    auto const contiguous = capacity - offset;
+    if (size <= contiguous) {
+        output(buffer, static_cast<char *>(m_data) + offset, size);
+    } else {
+        output(buffer, static_cast<char *>(m_data) + offset, contiguous);
+        output(ptrAdd(buffer, contiguous), m_data, size - contiguous);
+    }
+
+    m_readPos.store(readPos + size, std::memory_order_seq_cst);
+    if (m_producerWaiting.load(std::memory_order_seq_cst)
+        && spaceAvailable() >= refillThreshold())
+        notifyAll();
+    return size;
+}
+
+void RandomRingBuffer::waitDataAvailable() noexcept {
+    for (unsigned i = 0u; i < WAIT_SPIN_COUNT; ++i) {
+        if (dataAvailable() > 0u || m_closed.load(std::memory_order_relaxed))
+            return;
+        std::this_thread::yield();
+    }
+    m_consumerWaiting.store(true, std::memory_order_seq_cst);
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock,
+                    [this]() noexcept {
+                        return dataAvailable() > 0u
+                               || m_closed.load(std::memory_order_seq_cst);
+                    });
+    }
+    m_consumerWaiting.store(false, std::memory_order_relaxed);
+}
+
+template <typename Predicate>
+bool RandomRingBuffer::producerWait(
+        Predicate predicate,
+        std::chrono::milliseconds const * const maxWait) noexcept
+{
+    for (unsigned i = 0u; i < WAIT_SPIN_COUNT; ++i) {
+        if (m_closed.load(std::memory_order_relaxed))
+            return false;
+        if (predicate() || takeProducerWakeUp())
+            return true;
+        std::this_thread::yield();
+    }
+    m_producerWaiting.store(true, std::memory_order_seq_cst);
+    {
+        auto const test =
+                [this, &predicate]() noexcept
+                { return predicate()
+                         || takeProducerWakeUp()
+                         || m_closed.load(std::memory_order_seq_cst); };
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (maxWait) {
+            m_cond.wait_for(lock, *maxWait, test);
+        } else {
+            m_cond.wait(lock, test);
+        }
+    }
+    m_producerWaiting.store(false, std::memory_order_relaxed);
+    return !m_closed.load(std::memory_order_relaxed);
+}
+
+bool RandomRingBuffer::waitSpaceAvailable() noexcept {
+    return producerWait(
+                [this]() noexcept
+                { return spaceAvailable() >= refillThreshold(); },
+                nullptr);
+}
+
+bool RandomRingBuffer::waitSpaceAvailable(
+        std::chrono::milliseconds const maxWait) noexcept
+{
+    return producerWait(
+                [this]() noexcept
+                { return spaceAvailable() >= refillThreshold(); },
+                &maxWait);
+}
+
+bool RandomRingBuffer::waitDrained(
+        std::size_t const size,
+        std::chrono::milliseconds const maxWait) noexcept
+{
+    return producerWait([this, size]() noexcept
+                        { return dataAvailable() <= size; },
+                        &maxWait);
+}
+
+bool RandomRingBuffer::resize(std::size_t const newCapacity) noexcept {
+    assert(m_resizable);
+    assert(newCapacity > 0u);
+    assert(newCapacity <= m_maxCapacity);
+
+    std::lock_guard<std::mutex> const guard(m_resizeMutex);
+    if (dataAvailable() > newCapacity)
+        return false;
+
+    /* Move the data to the beginning of the memory region, so that it stays
+       contiguous for any capacity: */
+    auto const capacity = this->capacity();
+    auto const readPos = m_readPos.load(std::memory_order_relaxed);
+    auto * const data = static_cast<char *>(m_data);
+    std::rotate(data,
+                data + (readPos - m_basePos.load(std::memory_order_relaxed))
+                       % capacity,
+                data + capacity);
+    m_basePos.store(readPos, std::memory_order_relaxed);
+
+    auto const oldCommit = commitSize(capacity);
+    auto const newCommit = commitSize(newCapacity);
+    if (newCommit > oldCommit) {
+        if (m_locked)
+            ::mlock(data + oldCommit, newCommit - oldCommit);
+    } else if (newCommit < oldCommit) {
+        if (m_locked)
+            ::munlock(data + newCommit, oldCommit - newCommit);
+        ::madvise(data + newCommit, oldCommit - newCommit, MADV_DONTNEED);
+    }
+    m_capacity.store(newCapacity, std::memory_order_relaxed);
+    return true;
+}
+
+void RandomRingBuffer::wakeProducer() noexcept {
+    m_producerWakeUp.store(true, std::memory_order_seq_cst);
+    if (m_producerWaiting.load(std::memory_order_seq_cst))
+        notifyAll();
+}
+
+void RandomRingBuffer::close() noexcept {
+    m_closed.store(true, std::memory_order_seq_cst);
+    notifyAll();
+}
+
+std::size_t RandomRingBuffer::refillThreshold() const noexcept {
+    auto const r = capacity() / 4u;
+    if (r > MAX_REFILL_THRESHOLD)
+        return MAX_REFILL_THRESHOLD;
+    return (r > 0u) ? r : 1u;
+}
+
+std::size_t RandomRingBuffer::commitSize(std::size_t const capacity)
+        const noexcept
+{
+    auto const r = roundUp(capacity, m_pageSize);
+    return (r < m_mappedSize) ? r : m_mappedSize;
+}
+
+void RandomRingBuffer::notifyAll() noexcept {
+    std::lock_guard<std::mutex> const guard(m_mutex);
+    m_cond.notify_all();
+}
+
+} /* namespace sharemind { */
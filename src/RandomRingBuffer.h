@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_RANDOMRINGBUFFER_H
+#define SHAREMIND_LIBRANDOM_RANDOMRINGBUFFER_H
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include "NumaTopology.h"
+#include "RandomCombiner.h"
+
+
+namespace sharemind {
+
+/**
+ * \brief A single-consumer single-producer ring buffer of bytes backed by
+ *        anonymous memory mappings, the properties of which can be controlled
+ *        by SharemindRandomEngineBufferFlags.
+ */
+class RandomRingBuffer {
+
+public: /* Methods: */
+
+    /**
+     * \param[in] capacity the size of the buffer in bytes. Must be nonzero.
+     * \param[in] flags bitwise OR of SharemindRandomEngineBufferFlags.
+     * \param[in] numaNode the NUMA node to place the memory on, or
+     *                     NumaTopology::NoNode.
+     * \param[in] maxCapacity the largest capacity the buffer may later be
+     *                        resized to. Address space for it is reserved up
+     *                        front, but memory is only committed for the
+     *                        current capacity.
+     * \throws std::bad_alloc if the memory could not be mapped.
+     */
+    RandomRingBuffer(std::size_t capacity,
+                     unsigned flags = 0u,
+                     unsigned numaNode = NumaTopology::NoNode,
+                     std::size_t maxCapacity = 0u);
+
+    RandomRingBuffer(RandomRingBuffer const &) = delete;
+    RandomRingBuffer & operator=(RandomRingBuffer const &) = delete;
+
+    ~RandomRingBuffer() noexcept;
+
+    inline std::size_t capacity() const noexcept
+    { return m_capacity.load(std::memory_order_relaxed); }
+
+    inline std::size_t maxCapacity() const noexcept { return m_maxCapacity; }
+
+    /** \returns the total number of bytes read from the buffer. */
+    inline std::uint64_t totalRead() const noexcept
+    { return m_readPos.load(std::memory_order_relaxed); }
+
+    /** \returns the total number of bytes written to the buffer. */
+    inline std::uint64_t totalWritten() const noexcept
+    { return m_writePos.load(std::memory_order_relaxed); }
+
+    /** \returns whether the buffer is backed by (transparent) huge pages. */
+    inline bool hugePages() const noexcept { return m_hugePages; }
+
+    /** \returns whether the buffer is locked in memory. */
+    inline bool locked() const noexcept { return m_locked; }
+
+    /* Consumer interface: */
+
+    inline std::size_t dataAvailable() const noexcept {
+        return static_cast<std::size_t>(
+                    m_writePos.load(std::memory_order_acquire)
+                    - m_readPos.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * \brief Copies at most size bytes from the buffer.
+     * \returns the number of bytes copied.
+     */
+    std::size_t read(void * buffer, std::size_t size) noexcept;
+
+    /**
+     * \brief Like read(), but combines the bytes into the given buffer using
+     *        the given combiner instead of copying them.
+     */
+    std::size_t read(void * buffer,
+                     std::size_t size,
+                     RandomCombiner & combiner) noexcept;
+
+    inline std::size_t read(void * buffer, std::size_t size, RandomCopier)
+            noexcept
+    { return read(buffer, size); }
+
+    /** \brief Blocks until data is available or the buffer is closed. */
+    void waitDataAvailable() noexcept;
+
+    /* Producer interface: */
+
+    inline std::size_t spaceAvailable() const noexcept {
+        return capacity()
+                - static_cast<std::size_t>(
+                    m_writePos.load(std::memory_order_relaxed)
+                    - m_readPos.load(std::memory_order_acquire));
+    }
+
+    /**
+     * \brief Passes the next contiguous free region of the buffer to the given
+     *        function which must return the number of bytes it wrote to the
+     *        beginning of the region.
+     * \returns the number of bytes written.
+     */
+    template <typename ProducerFun>
+    inline std::size_t write(ProducerFun && f) noexcept {
+        auto const writePos = m_writePos.load(std::memory_order_relaxed);
+        auto const space = spaceAvailable();
+        if (space <= 0u)
+            return 0u;
+        auto const capacity = this->capacity();
+        auto const offset = static_cast<std::size_t>(
+                    (writePos - m_basePos.load(std::memory_order_relaxed))
+                    % capacity);
+        auto const contiguous = capacity - offset;
+        std::size_t const r =
+                f(static_cast<char *>(m_data) + offset,
+                  (space < contiguous) ? space : contiguous);
+        assert(r <= space && r <= contiguous);
+        if (r > 0u) {
+            m_writePos.store(writePos + r, std::memory_order_seq_cst);
+            if (m_consumerWaiting.load(std::memory_order_seq_cst))
+                notifyAll();
+        }
+        return r;
+    }
+
+    /**
+     * \brief Blocks until enough space is available for a refill to be
+     *        worthwhile or the buffer is closed.
+     * \returns false if the buffer was closed, true otherwise.
+     */
+    bool waitSpaceAvailable() noexcept;
+
+    /**
+     * \brief Like waitSpaceAvailable(), but returns (true) after at most the
+     *        given time has elapsed.
+     */
+    bool waitSpaceAvailable(std::chrono::milliseconds maxWait) noexcept;
+
+    /**
+     * \brief Blocks until at most the given number of bytes remain in the
+     *        buffer, the given time has elapsed, or the buffer is closed.
+     * \returns false if the buffer was closed, true otherwise.
+     */
+    bool waitDrained(std::size_t size,
+                     std::chrono::milliseconds maxWait) noexcept;
+
+    /**
+     * \brief Changes the capacity of the buffer, committing or releasing
+     *        memory as needed. Data in the buffer is preserved.
+     * \pre The buffer was constructed with a maxCapacity larger than its
+     *      capacity.
+     * \pre 0 < newCapacity <= maxCapacity()
+     * \returns false if the data in the buffer does not fit into the new
+     *          capacity, true otherwise.
+     */
+    bool resize(std::size_t newCapacity) noexcept;
+
+    /**
+     * \brief Makes the current or next wait of the producer return (true)
+     *        early, e.g. to let it attend to other work.
+     * \note May be called from any thread.
+     */
+    void wakeProducer() noexcept;
+
+    /** \brief Wakes up and disables waiting on both ends. */
+    void close() noexcept;
+
+private: /* Methods: */
+
+    template <typename Output>
+    std::size_t readUnlocked(void * buffer,
+                             std::size_t size,
+                             Output && output) noexcept;
+
+    std::size_t refillThreshold() const noexcept;
+
+    template <typename Predicate>
+    bool producerWait(Predicate predicate,
+                      std::chrono::milliseconds const * maxWait) noexcept;
+
+    inline bool takeProducerWakeUp() noexcept {
+        return m_producerWakeUp.load(std::memory_order_seq_cst)
+               && m_producerWakeUp.exchange(false, std::memory_order_seq_cst);
+    }
+
+    std::size_t commitSize(std::size_t capacity) const noexcept;
+
+    void notifyAll() noexcept;
+
+private: /* Fields: */
+
+    void * m_data;
+    std::size_t m_mappedSize;
+    std::size_t m_pageSize;
+    std::atomic<std::size_t> m_capacity;
+    std::size_t const m_maxCapacity;
+
+    /// The position which is at the beginning of the memory region:
+    std::atomic<std::uint64_t> m_basePos{0u};
+
+    /**
+     * \brief Excludes the consumer during resizes.
+     * \note Only used if the buffer is resizable, i.e. m_maxCapacity was
+     *       larger than the initial capacity.
+     */
+    std::mutex m_resizeMutex;
+    bool const m_resizable;
+    bool m_hugePages = false;
+    bool m_locked = false;
+
+    /* Keep the positions on separate cache lines to avoid false sharing
+       between the consumer and the producer: */
+    char m_padding0[64u];
+    std::atomic<std::uint64_t> m_readPos{0u};
+    char m_padding1[64u];
+    std::atomic<std::uint64_t> m_writePos{0u};
+    char m_padding2[64u];
+
+    std::atomic<bool> m_consumerWaiting{false};
+    std::atomic<bool> m_producerWaiting{false};
+    std::atomic<bool> m_producerWakeUp{false};
+    std::atomic<bool> m_closed{false};
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_RANDOMRINGBUFFER_H */
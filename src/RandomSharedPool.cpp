@@ -0,0 +1,553 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "RandomSharedPool.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <linux/futex.h>
+#include <new>
+#include <sharemind/AssertReturn.h>
+#include <sharemind/PotentiallyVoidTypeInfo.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <utility>
+
+
+namespace sharemind {
+
+SHAREMIND_DEFINE_EXCEPTION_CONST_MSG_NOINLINE(
+        RandomEngine::Exception,
+        RandomSharedPool::,
+        PoolException,
+        "Failed to use the shared randomness pool");
+SHAREMIND_DEFINE_EXCEPTION_CONST_MSG_NOINLINE(
+        PoolException,
+        RandomSharedPool::,
+        PoolFullException,
+        "All slots of the shared randomness pool are in use");
+
+namespace {
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+              "Atomics in shared memory must be lock-free!");
+
+constexpr static char const POOL_MAGIC[8u] =
+        { 'S', 'M', 'R', 'N', 'D', 'P', 'O', 'L' };
+constexpr static std::uint32_t const POOL_VERSION = 2u;
+
+/* The offsets of the bytes of the shared memory file locked with open file
+   description locks by the producer and by the consumer of every slot. The
+   kernel releases the locks when their holders die, unlike process IDs,
+   which may be reused or belong to another PID namespace: */
+constexpr static ::off_t const PRODUCER_LOCK_OFFSET = 0;
+constexpr static ::off_t const SLOT_LOCK_OFFSET = 1;
+
+/* The maximum number of bytes generated before making them available to the
+   consumer: */
+constexpr static std::size_t const FILL_CHUNK_SIZE = 64u * 1024u;
+
+/* The amount of free space the producer waits for in a slot, to avoid waking
+   it up for every small read: */
+constexpr static std::size_t const MAX_REFILL_THRESHOLD = 64u * 1024u;
+
+/* The number of times to poll before going to sleep when waiting: */
+constexpr static unsigned const WAIT_SPIN_COUNT = 64u;
+
+/* How long to sleep at most, i.e. how often consumers check whether the
+   producer is still alive: */
+constexpr static std::chrono::milliseconds const WAIT_PERIOD{100};
+
+/* The size of the blocks used when drawing from the fallback engine: */
+constexpr static std::size_t const FALLBACK_BLOCK_SIZE = 4096u;
+
+struct PoolHeader {
+    char magic[sizeof(POOL_MAGIC)];
+    std::uint32_t version;
+    std::uint32_t slotCount;
+    std::uint64_t slotCapacity;
+    std::atomic<std::uint32_t> closed;
+
+    /* Futex word of the producer, incremented to wake it up: */
+    alignas(64) std::atomic<std::uint32_t> producerSeq;
+    std::atomic<std::uint32_t> producerWaiting;
+};
+
+struct SlotHeader {
+    /* Nonzero while a consumer holds the lock of the slot, which is left set
+       by consumers which have died: */
+    alignas(64) std::atomic<std::uint32_t> claimed;
+
+    /* Keep the cursors on separate cache lines to avoid false sharing between
+       the consumer and the producer: */
+    alignas(64) std::atomic<std::uint64_t> readPos;
+    alignas(64) std::atomic<std::uint64_t> writePos;
+
+    /* Futex word of the consumer, incremented on every write: */
+    std::atomic<std::uint32_t> dataSeq;
+    std::atomic<std::uint32_t> consumerWaiting;
+};
+
+/**
+   \brief The layout of the shared memory, i.e. the pool header followed by
+          the slot headers, padded to the page size, followed by the rings of
+          the slots.
+*/
+struct PoolLayout {
+
+    PoolLayout(void * const memory) noexcept
+        : header(static_cast<PoolHeader *>(memory))
+        , slots(reinterpret_cast<SlotHeader *>(header + 1))
+    {}
+
+    static std::size_t pageSize() noexcept
+    { return static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)); }
+
+    static std::size_t roundUp(std::size_t const size) noexcept
+    { return ((size + pageSize() - 1u) / pageSize()) * pageSize(); }
+
+    static std::size_t headersSize(std::size_t const slotCount) noexcept
+    { return roundUp(sizeof(PoolHeader) + slotCount * sizeof(SlotHeader)); }
+
+    static std::size_t size(std::size_t const slotCount,
+                            std::size_t const slotCapacity) noexcept
+    { return headersSize(slotCount) + slotCount * slotCapacity; }
+
+    /**
+       \returns the size of a pool like size(), after checking that neither
+                 rounding the capacity nor computing the size wraps around and
+                 that the size fits ::off_t.
+       \throws RandomSharedPool::PoolException otherwise.
+    */
+    static std::size_t checkedSize(std::uint64_t const slotCount,
+                                   std::uint64_t const slotCapacity)
+    {
+        constexpr auto const sizeMax = std::numeric_limits<std::size_t>::max();
+        constexpr auto const offMax = static_cast<std::uint64_t>(
+                    std::numeric_limits<::off_t>::max());
+        constexpr auto const max =
+                (sizeMax < offMax) ? sizeMax : static_cast<std::size_t>(offMax);
+        if (slotCount <= 0u
+            || slotCapacity <= 0u
+            || slotCount > (max - sizeof(PoolHeader) - pageSize())
+                        / sizeof(SlotHeader)
+            || slotCapacity > max - (pageSize() - 1u))
+            throw RandomSharedPool::PoolException();
+        auto const headers = headersSize(static_cast<std::size_t>(slotCount));
+        auto const capacity = roundUp(static_cast<std::size_t>(slotCapacity));
+        if (slotCount > (max - headers) / capacity)
+            throw RandomSharedPool::PoolException();
+        return headers + static_cast<std::size_t>(slotCount) * capacity;
+    }
+
+    unsigned char * ring(std::size_t const slot) const noexcept {
+        return reinterpret_cast<unsigned char *>(header)
+               + headersSize(header->slotCount)
+               + slot * header->slotCapacity;
+    }
+
+    std::size_t refillThreshold() const noexcept {
+        auto const r = static_cast<std::size_t>(header->slotCapacity / 4u);
+        return (r < MAX_REFILL_THRESHOLD) ? r : MAX_REFILL_THRESHOLD;
+    }
+
+    std::size_t spaceAvailable(SlotHeader const & slot) const noexcept {
+        return static_cast<std::size_t>(
+                    header->slotCapacity
+                    - (slot.writePos.load(std::memory_order_relaxed)
+                       - slot.readPos.load(std::memory_order_acquire)));
+    }
+
+    PoolHeader * const header;
+    SlotHeader * const slots;
+
+};
+
+void futexWait(std::atomic<std::uint32_t> & word,
+               std::uint32_t const expected) noexcept
+{
+    static_assert(sizeof(word) == sizeof(std::uint32_t), "");
+    ::timespec timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_nsec = std::chrono::nanoseconds(WAIT_PERIOD).count();
+    ::syscall(SYS_futex,
+              reinterpret_cast<std::uint32_t *>(&word),
+              FUTEX_WAIT,
+              expected,
+              &timeout,
+              nullptr,
+              0);
+}
+
+void futexWake(std::atomic<std::uint32_t> & word) noexcept {
+    word.fetch_add(1u, std::memory_order_seq_cst);
+    ::syscall(SYS_futex,
+              reinterpret_cast<std::uint32_t *>(&word),
+              FUTEX_WAKE,
+              INT_MAX,
+              nullptr,
+              nullptr,
+              0);
+}
+
+::flock lockRequest(short const type, ::off_t const offset) noexcept {
+    ::flock r;
+    std::memset(&r, 0, sizeof(r));
+    r.l_type = type;
+    r.l_whence = SEEK_SET;
+    r.l_start = offset;
+    r.l_len = 1;
+    return r;
+}
+
+bool tryLock(int const fd, ::off_t const offset) noexcept {
+    auto request(lockRequest(F_WRLCK, offset));
+    return ::fcntl(fd, F_OFD_SETLK, &request) == 0;
+}
+
+/* Whether another open file description holds the lock. Errors are treated
+   as the lock being held, i.e. the holder being alive: */
+bool lockHeld(int const fd, ::off_t const offset) noexcept {
+    auto request(lockRequest(F_WRLCK, offset));
+    return ::fcntl(fd, F_OFD_GETLK, &request) != 0
+           || request.l_type != F_UNLCK;
+}
+
+/* Opens a new open file description of the file of the given descriptor,
+   which does not share the locks of the original one: */
+int reopen(int const fd) {
+    auto const path = "/proc/self/fd/" + std::to_string(fd);
+    auto const r = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (r < 0)
+        throw RandomSharedPool::PoolException();
+    return r;
+}
+
+} // anonymous namespace
+
+RandomSharedPool::RandomSharedPool(char const * const name,
+                                   std::size_t const slotCount,
+                                   std::size_t slotCapacity,
+                                   std::shared_ptr<RandomEngine> engine)
+    : m_name(name ? name : "")
+    , m_engine(assertReturn(std::move(engine)))
+{
+    if (slotCount <= 0u || slotCount > INT32_MAX || slotCapacity <= 0u)
+        throw PoolException();
+    m_memorySize = PoolLayout::checkedSize(slotCount, slotCapacity);
+    slotCapacity = PoolLayout::roundUp(slotCapacity);
+
+    m_fd = name
+           ? ::shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600)
+           : ::memfd_create("sharemind-random-pool", MFD_CLOEXEC);
+    if (m_fd < 0)
+        throw PoolException();
+    m_memory = MAP_FAILED;
+    try {
+        if (!tryLock(m_fd, PRODUCER_LOCK_OFFSET)
+            || ::ftruncate(m_fd, static_cast<::off_t>(m_memorySize)) != 0)
+            throw PoolException();
+        m_memory = ::mmap(nullptr,
+                          m_memorySize,
+                          PROT_READ | PROT_WRITE,
+                          MAP_SHARED,
+                          m_fd,
+                          0);
+        if (m_memory == MAP_FAILED)
+            throw PoolException();
+        #ifdef MADV_DONTDUMP
+        ::madvise(m_memory, m_memorySize, MADV_DONTDUMP);
+        #endif
+
+        PoolLayout const layout(m_memory);
+        auto & header = *new (layout.header) PoolHeader();
+        for (std::size_t i = 0u; i < slotCount; ++i)
+            new (&layout.slots[i]) SlotHeader();
+        header.version = POOL_VERSION;
+        header.slotCount = static_cast<std::uint32_t>(slotCount);
+        header.slotCapacity = slotCapacity;
+        // The magic is written last, after the header is complete:
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(header.magic, POOL_MAGIC, sizeof(POOL_MAGIC));
+
+        m_thread = std::thread(&RandomSharedPool::producerThread, this);
+    } catch (...) {
+        if (m_memory != MAP_FAILED)
+            ::munmap(m_memory, m_memorySize);
+        ::close(m_fd);
+        if (name)
+            ::shm_unlink(name);
+        throw;
+    }
+}
+
+RandomSharedPool::~RandomSharedPool() noexcept {
+    PoolLayout const layout(m_memory);
+    layout.header->closed.store(1u, std::memory_order_seq_cst);
+    futexWake(layout.header->producerSeq);
+    m_thread.join();
+    for (std::size_t i = 0u; i < layout.header->slotCount; ++i)
+        futexWake(layout.slots[i].dataSeq);
+    ::munmap(m_memory, m_memorySize);
+    ::close(m_fd);
+    if (!m_name.empty())
+        ::shm_unlink(m_name.c_str());
+}
+
+void RandomSharedPool::producerThread() noexcept {
+    PoolLayout const layout(m_memory);
+    auto & header = *layout.header;
+    auto const slotCount = header.slotCount;
+    while (!header.closed.load(std::memory_order_relaxed)) {
+        bool refilled = false;
+        for (std::size_t i = 0u; i < slotCount; ++i)
+            if (refillSlot(i, false))
+                refilled = true;
+        if (refilled)
+            continue;
+
+        auto const seq = header.producerSeq.load(std::memory_order_seq_cst);
+        header.producerWaiting.store(1u, std::memory_order_seq_cst);
+        bool refillNeeded = false;
+        for (std::size_t i = 0u; i < slotCount && !refillNeeded; ++i)
+            refillNeeded = refillSlot(i, true);
+        if (!refillNeeded && !header.closed.load(std::memory_order_seq_cst))
+            futexWait(header.producerSeq, seq);
+        header.producerWaiting.store(0u, std::memory_order_relaxed);
+    }
+}
+
+bool RandomSharedPool::refillSlot(std::size_t const i, bool const dryRun)
+        noexcept
+{
+    PoolLayout const layout(m_memory);
+    auto & slot = layout.slots[i];
+    if (!slot.claimed.load(std::memory_order_acquire))
+        return false;
+    auto const space = layout.spaceAvailable(slot);
+    if (space < layout.refillThreshold() || space <= 0u)
+        return false;
+    if (dryRun)
+        return true;
+
+    auto const capacity = static_cast<std::size_t>(layout.header->slotCapacity);
+    auto const writePos = slot.writePos.load(std::memory_order_relaxed);
+    auto const offset = static_cast<std::size_t>(writePos % capacity);
+    auto size = capacity - offset;
+    if (size > space)
+        size = space;
+    if (size > FILL_CHUNK_SIZE)
+        size = FILL_CHUNK_SIZE;
+    m_engine->fillBytes(layout.ring(i) + offset, size);
+    slot.writePos.store(writePos + size, std::memory_order_seq_cst);
+    if (slot.consumerWaiting.load(std::memory_order_seq_cst))
+        futexWake(slot.dataSeq);
+    return true;
+}
+
+RandomSharedPoolEngine::RandomSharedPoolEngine(
+        char const * const name,
+        std::shared_ptr<RandomEngine> fallback)
+    : m_fallback(assertReturn(std::move(fallback)))
+{
+    auto const fd = ::shm_open(assertReturn(name), O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0)
+        throw RandomSharedPool::PoolException();
+    attach(fd);
+}
+
+RandomSharedPoolEngine::RandomSharedPoolEngine(
+        int const fd,
+        std::shared_ptr<RandomEngine> fallback)
+    : m_fallback(assertReturn(std::move(fallback)))
+{ attach(reopen(fd)); }
+
+RandomSharedPoolEngine::~RandomSharedPoolEngine() noexcept {
+    PoolLayout const layout(m_memory);
+    layout.slots[m_slot].claimed.store(0u, std::memory_order_release);
+    ::munmap(m_memory, m_memorySize);
+    // Releases the lock of the slot:
+    ::close(m_fd);
+}
+
+void RandomSharedPoolEngine::attach(int const fd) {
+    m_fd = fd;
+    m_memory = MAP_FAILED;
+    try {
+        struct ::stat st;
+        if (::fstat(fd, &st) != 0
+            || static_cast<std::uint64_t>(st.st_size) < sizeof(PoolHeader))
+            throw RandomSharedPool::PoolException();
+        m_memorySize = static_cast<std::size_t>(st.st_size);
+        m_memory = ::mmap(nullptr,
+                          m_memorySize,
+                          PROT_READ | PROT_WRITE,
+                          MAP_SHARED,
+                          fd,
+                          0);
+        if (m_memory == MAP_FAILED)
+            throw RandomSharedPool::PoolException();
+
+        PoolLayout const layout(m_memory);
+        auto & header = *layout.header;
+        if (std::memcmp(header.magic, POOL_MAGIC, sizeof(POOL_MAGIC)) != 0)
+            throw RandomSharedPool::PoolException();
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header.version != POOL_VERSION
+            || header.slotCount <= 0u
+            || header.slotCount > INT32_MAX
+            || header.slotCapacity <= 0u
+            || header.slotCapacity % PoolLayout::pageSize() != 0u
+            || m_memorySize
+               != PoolLayout::checkedSize(header.slotCount,
+                                          header.slotCapacity))
+            throw RandomSharedPool::PoolException();
+
+        /* Claim a free slot, or one of a consumer which has died. Its unread
+           bytes have not been served to anyone, so they can be served here: */
+        for (m_slot = 0u; m_slot < header.slotCount; ++m_slot)
+            if (tryLock(fd,
+                        SLOT_LOCK_OFFSET + static_cast<::off_t>(m_slot)))
+                break;
+        if (m_slot >= header.slotCount)
+            throw RandomSharedPool::PoolFullException();
+        layout.slots[m_slot].claimed.store(1u, std::memory_order_release);
+    } catch (...) {
+        if (m_memory != MAP_FAILED)
+            ::munmap(m_memory, m_memorySize);
+        ::close(fd);
+        throw;
+    }
+    futexWake(PoolLayout(m_memory).header->producerSeq);
+}
+
+void RandomSharedPoolEngine::fillBytes(void * buffer, std::size_t size)
+        noexcept
+{
+    m_stats.recordRequest(size);
+    serve(buffer, size, RandomCopier());
+}
+
+void RandomSharedPoolEngine::combineInto(void * buffer,
+                                         std::size_t size,
+                                         RandomCombineOp const op,
+                                         std::size_t const elementSize)
+        noexcept
+{
+    m_stats.recordRequest(size);
+    assert(size % elementSize == 0u);
+    RandomCombiner combiner(op, elementSize);
+    serve(buffer, size, combiner);
+    assert(combiner.complete());
+}
+
+std::size_t RandomSharedPoolEngine::bufferSize() const noexcept {
+    return static_cast<std::size_t>(
+                PoolLayout(m_memory).header->slotCapacity);
+}
+
+template <typename Output>
+void RandomSharedPoolEngine::serve(void * buffer,
+                                   std::size_t size,
+                                   Output && output) noexcept
+{
+    PoolLayout const layout(m_memory);
+    auto & header = *layout.header;
+    auto & slot = layout.slots[m_slot];
+    auto const capacity = static_cast<std::size_t>(header.slotCapacity);
+    auto const ring = layout.ring(m_slot);
+    while (size > 0u) {
+        auto const readPos = slot.readPos.load(std::memory_order_relaxed);
+        auto const available = static_cast<std::size_t>(
+                    slot.writePos.load(std::memory_order_acquire) - readPos);
+        if (available <= 0u) {
+            if (m_detached) {
+                unsigned char block[FALLBACK_BLOCK_SIZE];
+                auto const n = (size < sizeof(block)) ? size : sizeof(block);
+                m_fallback->fillBytes(block, n);
+                output(buffer, block, n);
+                buffer = ptrAdd(buffer, n);
+                size -= n;
+            } else {
+                auto const stallStart = std::chrono::steady_clock::now();
+                waitDataAvailable();
+                m_stats.recordConsumerStall(std::chrono::steady_clock::now()
+                                            - stallStart);
+            }
+            continue;
+        }
+
+        auto const offset = static_cast<std::size_t>(readPos % capacity);
+        auto n = capacity - offset;
+        if (n > available)
+            n = available;
+        if (n > size)
+            n = size;
+        output(buffer, ring + offset, n);
+        buffer = ptrAdd(buffer, n);
+        size -= n;
+        slot.readPos.store(readPos + n, std::memory_order_seq_cst);
+        if (header.producerWaiting.load(std::memory_order_seq_cst)
+            && layout.spaceAvailable(slot) >= layout.refillThreshold())
+            futexWake(header.producerSeq);
+    }
+}
+
+void RandomSharedPoolEngine::waitDataAvailable() noexcept {
+    PoolLayout const layout(m_memory);
+    auto & header = *layout.header;
+    auto & slot = layout.slots[m_slot];
+    auto const dataAvailable =
+            [&slot]() noexcept {
+                return slot.writePos.load(std::memory_order_seq_cst)
+                       != slot.readPos.load(std::memory_order_relaxed);
+            };
+    for (unsigned i = 0u; i < WAIT_SPIN_COUNT; ++i) {
+        if (dataAvailable())
+            return;
+        std::this_thread::yield();
+    }
+    auto const seq = slot.dataSeq.load(std::memory_order_seq_cst);
+    slot.consumerWaiting.store(1u, std::memory_order_seq_cst);
+    if (!dataAvailable())
+        futexWait(slot.dataSeq, seq);
+    slot.consumerWaiting.store(0u, std::memory_order_relaxed);
+
+    if (!dataAvailable()
+        && (header.closed.load(std::memory_order_seq_cst)
+            || !lockHeld(m_fd, PRODUCER_LOCK_OFFSET)))
+        m_detached = true;
+}
+
+} /* namespace sharemind { */
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_LIBRANDOM_RANDOMSHAREDPOOL_H
+#define SHAREMIND_LIBRANDOM_RANDOMSHAREDPOOL_H
+
+#include "RandomEngine.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+
+
+namespace sharemind {
+
+/**
+ * \brief A pool of randomness in shared memory, filled by a producer thread
+ *        of the process owning the pool and consumed by engines of other
+ *        processes on the same host.
+ *
+ * The pool is divided into slots, each a single-producer single-consumer ring
+ * with its own read and write cursors. Every consumer engine claims a slot of
+ * its own, so no byte is ever served to two consumers. Both ends sleep on
+ * futexes in the shared memory when there is nothing to do.
+ *
+ * The producer and every consumer hold open file description locks on the
+ * shared memory file, which the kernel releases when they die. Consumers use
+ * these to claim the slots of dead consumers and to notice a dead producer,
+ * also across PID namespaces.
+ *
+ * The shared memory is either a POSIX shared memory object with the given
+ * name, which consumers attach to by name, or an anonymous memory file, the
+ * descriptor of which must be passed to the consumers, e.g. by inheritance.
+ */
+class RandomSharedPool {
+
+public: /* Types: */
+
+    SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(RandomEngine::Exception,
+                                                   PoolException);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(PoolException,
+                                                   PoolFullException);
+
+public: /* Methods: */
+
+    /**
+     * \param[in] name the name of the POSIX shared memory object to create,
+     *                 or nullptr to create an anonymous memory file.
+     * \param[in] slotCount the maximum number of attached consumers.
+     * \param[in] slotCapacity the size of the ring of every consumer in
+     *                         bytes, rounded up to the page size.
+     * \param[in] engine the engine to fill the pool from.
+     * \throws PoolException if the shared memory could not be created.
+     */
+    RandomSharedPool(char const * name,
+                     std::size_t slotCount,
+                     std::size_t slotCapacity,
+                     std::shared_ptr<RandomEngine> engine);
+
+    RandomSharedPool(RandomSharedPool const &) = delete;
+    RandomSharedPool & operator=(RandomSharedPool const &) = delete;
+
+    /**
+     * \brief Stops the producer and removes the shared memory object. The
+     *        attached consumers continue with their fallback engines.
+     */
+    ~RandomSharedPool() noexcept;
+
+    /**
+     * \returns the descriptor of the shared memory.
+     * \note The descriptor is close-on-exec, hence the flag has to be cleared
+     *       to pass it to executed workers.
+     */
+    inline int fd() const noexcept { return m_fd; }
+
+private: /* Methods: */
+
+    void producerThread() noexcept;
+
+    bool refillSlot(std::size_t slot, bool dryRun) noexcept;
+
+private: /* Fields: */
+
+    std::string const m_name;
+    int m_fd;
+    void * m_memory;
+    std::size_t m_memorySize;
+    std::shared_ptr<RandomEngine> const m_engine;
+    std::thread m_thread;
+
+};
+
+/**
+ * \brief An engine serving randomness from a slot of a RandomSharedPool.
+ * \note Once the pool has been destroyed or its process has died, the engine
+ *       serves the remaining bytes of its slot and continues with its
+ *       fallback engine. Hence its output is NOT reproducible and must not be
+ *       used for randomness that has to be shared between parties.
+ * \note Like the pool itself, the slot is shared with forked children. A
+ *       child must not use an engine attached by its parent.
+ */
+class RandomSharedPoolEngine: public RandomEngine {
+
+public: /* Methods: */
+
+    /**
+     * \brief Attaches to the pool in the named POSIX shared memory object.
+     * \throws RandomSharedPool::PoolException if the shared memory could not
+     *         be opened or does not contain a pool.
+     * \throws RandomSharedPool::PoolFullException if all slots are in use.
+     */
+    RandomSharedPoolEngine(char const * name,
+                           std::shared_ptr<RandomEngine> fallback);
+
+    /**
+     * \brief Attaches to the pool in the given shared memory descriptor.
+     * \note The file is reopened through /proc/self/fd to hold the lock of
+     *       the slot in an open file description of its own.
+     */
+    RandomSharedPoolEngine(int fd, std::shared_ptr<RandomEngine> fallback);
+
+    ~RandomSharedPoolEngine() noexcept override;
+
+    void fillBytes(void * buffer, std::size_t size) noexcept override;
+
+    void combineInto(void * buffer,
+                     std::size_t size,
+                     RandomCombineOp op,
+                     std::size_t elementSize) noexcept override;
+
+    std::size_t bufferSize() const noexcept override;
+
+    /** \returns whether the engine has switched to its fallback engine. */
+    inline bool detached() const noexcept { return m_detached; }
+
+private: /* Methods: */
+
+    void attach(int fd);
+
+    template <typename Output>
+    void serve(void * buffer, std::size_t size, Output && output) noexcept;
+
+    void waitDataAvailable() noexcept;
+
+private: /* Fields: */
+
+    int m_fd = -1;
+    void * m_memory = nullptr;
+    std::size_t m_memorySize = 0u;
+    std::size_t m_slot = 0u;
+    bool m_detached = false;
+    std::shared_ptr<RandomEngine> const m_fallback;
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_RANDOMSHAREDPOOL_H */
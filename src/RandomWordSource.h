@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+
+#ifndef SHAREMIND_LIBRANDOM_RANDOMWORDSOURCE_H
+#define SHAREMIND_LIBRANDOM_RANDOMWORDSOURCE_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include "RandomEngine.h"
+
+
+namespace sharemind {
+
+/**
+ * \brief Serves random words to the samplers which consume a varying amount
+ *        of randomness, drawing it in blocks from a RandomEngine or a
+ *        RandomEngineFacade.
+ * \note The words left in the block are discarded with the source, hence the
+ *       randomness consumed from the engine only depends on the sequence of
+ *       words requested.
+ */
+template <typename Engine>
+class BasicRandomWordSource {
+
+public: /* Methods: */
+
+    inline explicit BasicRandomWordSource(Engine & engine) noexcept
+        : m_engine(engine)
+    {}
+
+    inline std::uint64_t word() noexcept {
+        if (m_next >= BlockWords) {
+            m_engine.fillBytes(m_block, sizeof(m_block));
+            m_next = 0u;
+        }
+        return m_block[m_next++];
+    }
+
+    inline bool bit() noexcept {
+        if (m_bitsLeft == 0u) {
+            m_bits = word();
+            m_bitsLeft = 64u;
+        }
+        bool const r = (m_bits & 1u) != 0u;
+        m_bits >>= 1u;
+        --m_bitsLeft;
+        return r;
+    }
+
+    /** \returns a word uniformly distributed in [0, bound). */
+    inline std::uint64_t uniformBelow(std::uint64_t const bound) noexcept {
+        assert(bound > 0u);
+        #ifdef __SIZEOF_INT128__
+        // "Fast Random Integer Generation in an Interval" by Lemire, 2019:
+        using UInt128 = unsigned __int128;
+        auto m = static_cast<UInt128>(word()) * bound;
+        if (static_cast<std::uint64_t>(m) < bound) {
+            auto const threshold = (0u - bound) % bound;
+            while (static_cast<std::uint64_t>(m) < threshold)
+                m = static_cast<UInt128>(word()) * bound;
+        }
+        return static_cast<std::uint64_t>(m >> 64u);
+        #else
+        // Reject the lowest 2^64 mod bound words to remove the bias:
+        auto const threshold = (0u - bound) % bound;
+        for (;;) {
+            auto const r = word();
+            if (r >= threshold)
+                return r % bound;
+        }
+        #endif
+    }
+
+    /** \returns a double uniformly distributed in (0, 1). */
+    inline double uniformOpen() noexcept {
+        return (static_cast<double>(word() >> 11u) + 0.5)
+               * (1.0 / 9007199254740992.0);
+    }
+
+private: /* Fields: */
+
+    static constexpr std::size_t const BlockWords = 64u;
+
+    Engine & m_engine;
+    std::uint64_t m_block[BlockWords];
+    std::size_t m_next = BlockWords;
+    std::uint64_t m_bits = 0u;
+    unsigned m_bitsLeft = 0u;
+
+};
+
+using RandomWordSource = BasicRandomWordSource<RandomEngine>;
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_LIBRANDOM_RANDOMWORDSOURCE_H */
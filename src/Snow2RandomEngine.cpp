@@ -26,6 +26,7 @@
 #include <cstring>
 #include <limits>
 #include <sharemind/PotentiallyVoidTypeInfo.h>
+#include "RandomEngineState.h"
 #ifdef SHAREMIND_LIBRANDOM_HAVE_VALGRIND
 #include <valgrind/memcheck.h>
 #endif
@@ -398,8 +399,76 @@ Snow2RandomEngine::Snow2RandomEngine(const void * const seed) {
 }
 
 void Snow2RandomEngine::fillBytes(void * buffer, size_t size) noexcept {
+    m_stats.recordRequest(size);
+    m_stats.recordGenerated(size);
     if (size <= 0u)
         return;
+    generate(buffer, size, RandomCopier());
+}
+
+void Snow2RandomEngine::combineInto(void * buffer,
+                                    size_t size,
+                                    RandomCombineOp const op,
+                                    size_t const elementSize) noexcept
+{
+    m_stats.recordRequest(size);
+    m_stats.recordGenerated(size);
+    if (size <= 0u)
+        return;
+    assert(size % elementSize == 0u);
+    RandomCombiner combiner(op, elementSize);
+    generate(buffer, size, combiner);
+    assert(combiner.complete());
+}
+
+/* The state consists of the LFSR, the FSM registers, the number of unconsumed
+   keystream bytes and the keystream words they are in: */
+constexpr static std::size_t const SNOW2_STATE_PAYLOAD_SIZE =
+        (16u + 2u + 1u + 16u) * 4u;
+
+size_t Snow2RandomEngine::stateSize() const noexcept
+{ return RandomEngineState::HeaderSize + SNOW2_STATE_PAYLOAD_SIZE; }
+
+void Snow2RandomEngine::saveState(void * buffer) const {
+    assert(buffer);
+    RandomEngineState::Writer w(buffer,
+                                SHAREMIND_RANDOM_SNOW2,
+                                SNOW2_STATE_PAYLOAD_SIZE);
+    for (auto const v : s)
+        w.u32(v);
+    w.u32(r1);
+    w.u32(r2);
+    w.u32(haveData);
+    for (auto const v : keystream)
+        w.u32(v);
+}
+
+void Snow2RandomEngine::restoreState(void const * buffer, size_t size) {
+    RandomEngineState::Reader r(buffer,
+                                size,
+                                SHAREMIND_RANDOM_SNOW2,
+                                SNOW2_STATE_PAYLOAD_SIZE);
+    std::array<uint32_t, 16u> newS;
+    for (auto & v : newS)
+        v = r.u32();
+    auto const newR1 = r.u32();
+    auto const newR2 = r.u32();
+    auto const newHaveData = r.u32();
+    if (newHaveData > sizeof(keystream))
+        throw InvalidStateException();
+    s = newS;
+    r1 = newR1;
+    r2 = newR2;
+    haveData = newHaveData;
+    for (auto & v : keystream)
+        v = r.u32();
+}
+
+template <typename Output>
+void Snow2RandomEngine::generate(void * buffer,
+                                 size_t size,
+                                 Output && output) noexcept
+{
 
     /*
      * Function: snow_keystream_fast
@@ -438,11 +507,11 @@ void Snow2RandomEngine::fillBytes(void * buffer, size_t size) noexcept {
     if (haveData < maxBytes) {
         auto const * const readPtr = &un_byte_keystream[maxBytes - haveData];
         if (size <= haveData) {
-            memcpy(buffer, readPtr, size);
+            output(buffer, readPtr, size);
             haveData -= size;
             return;
         }
-        memcpy(buffer, readPtr, haveData);
+        output(buffer, readPtr, haveData);
         buffer = ptrAdd(buffer, haveData);
         size -= haveData;
         snow_keystream_fast_p();
@@ -451,7 +520,7 @@ void Snow2RandomEngine::fillBytes(void * buffer, size_t size) noexcept {
 
     // Fill big chunks (except last one it that one is big as well):
     while (size > maxBytes) {
-        memcpy(buffer, un_byte_keystream.data(), maxBytes);
+        output(buffer, un_byte_keystream.data(), maxBytes);
         buffer = ptrAdd(buffer, maxBytes);
         size -= maxBytes;
         snow_keystream_fast_p();
@@ -460,7 +529,7 @@ void Snow2RandomEngine::fillBytes(void * buffer, size_t size) noexcept {
     #undef snow_keystream_fast_p
 
     // Fill the rest:
-    memcpy(buffer, un_byte_keystream.data(), size);
+    output(buffer, un_byte_keystream.data(), size);
     static_assert(maxBytes <= std::numeric_limits<unsigned>::max(), "");
     haveData = static_cast<unsigned>(maxBytes - size);
 }
@@ -40,6 +40,26 @@ public: /* Methods: */
 
     void fillBytes(void * buffer, size_t size) noexcept override;
 
+    void combineInto(void * buffer,
+                     size_t size,
+                     RandomCombineOp op,
+                     size_t elementSize) noexcept override;
+
+    size_t stateSize() const noexcept override;
+
+    void saveState(void * buffer) const override;
+
+    void restoreState(void const * buffer, size_t size) override;
+
+private: /* Methods: */
+
+    /**
+     * \brief Generates size bytes of keystream, passing them to
+     *        output(dst, src, n) piece by piece.
+     */
+    template <typename Output>
+    void generate(void * buffer, size_t size, Output && output) noexcept;
+
 private: /* Fields: */
 
     std::array<uint32_t, 16u> s;
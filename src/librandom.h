@@ -21,6 +21,8 @@
 #define SHAREMIND_LIBRANDOM_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -69,8 +71,87 @@ typedef enum SharemindRandomEngineBufferingMode_ {
     /** Threaded buffering. Randomness is collected in a background thread. */
     SHAREMIND_RANDOM_BUFFERING_THREAD,
 
+    /**
+     * Threaded buffering with a buffer which adapts its size to the
+     * consumption between minBufferSize and bufferSize bytes. The buffer
+     * grows when the consumer has to wait for randomness and shrinks when
+     * the consumer only uses a small part of it for a prolonged time.
+     */
+    SHAREMIND_RANDOM_BUFFERING_ADAPTIVE_THREAD,
+
+    /**
+     * Serve the keystream pre-generated into the file given by filePath with
+     * generateRandomFile, and continue with the core engine once the file has
+     * been exhausted. The consumed offset is durably recorded in the file, so
+     * no bytes are served twice, even across crashes and restarts.
+     */
+    SHAREMIND_RANDOM_BUFFERING_FILE,
+
+    /**
+     * Serve randomness from a slot of the shared memory pool given by
+     * sharedPoolName, which is filled by another process on the same host,
+     * and continue with the core engine once the pool is gone.
+     * \warning Which bytes of the pool are served depends on scheduling, so
+     *          the output of such an engine is NOT reproducible from the seed
+     *          and must not be used for randomness that has to be shared
+     *          between parties.
+     */
+    SHAREMIND_RANDOM_BUFFERING_SHARED_POOL,
+
+    /**
+     * Serve requests from a cache-aligned reservoir of bufferSize bytes,
+     * e.g. 4-16 KiB, which is refilled in bulk on the calling thread when
+     * it runs out. No background thread is used, and the output is the same
+     * as without buffering.
+     */
+    SHAREMIND_RANDOM_BUFFERING_RESERVOIR,
+
 } SharemindRandomEngineBufferingMode;
 
+/**
+ * \brief Indicate how to place buffered engines on NUMA systems.
+ * \note Only used if the buffering mode employs a background thread.
+ */
+typedef enum SharemindRandomEngineNumaPolicy_ {
+    /** No placement. Memory and threads go wherever the OS puts them. */
+    SHAREMIND_RANDOM_NUMA_NONE = 0,
+
+    /**
+     * Allocate the buffer on the NUMA node given by numaNode and pin the
+     * filler thread to the CPUs of that node.
+     */
+    SHAREMIND_RANDOM_NUMA_NODE,
+
+    /**
+     * Create one buffered replica per NUMA node behind a single engine and
+     * route every fillBytes call to the replica local to the calling thread.
+     * \warning The replicas are seeded from the given seed, but which replica
+     *          serves which request depends on scheduling. Hence the output of
+     *          such an engine is NOT reproducible from the seed and must not be
+     *          used for randomness that has to be shared between parties.
+     */
+    SHAREMIND_RANDOM_NUMA_REPLICATE
+
+} SharemindRandomEngineNumaPolicy;
+
+/**
+ * \brief Flags controlling the memory backing of the buffer of buffered
+ *        engines. These are only hints, i.e. an engine is still constructed
+ *        when the system is unable to honor them.
+ */
+typedef enum SharemindRandomEngineBufferFlags_ {
+    /** Back the buffer with huge pages, or transparent huge pages if no
+        huge pages are reserved in the system. */
+    SHAREMIND_RANDOM_BUFFER_HUGE_PAGES = 0x1,
+
+    /** Lock the buffer in memory to prevent it from being swapped out. */
+    SHAREMIND_RANDOM_BUFFER_LOCKED = 0x2,
+
+    /** Exclude the buffer from core dumps and wipe it in forked children. */
+    SHAREMIND_RANDOM_BUFFER_NO_DUMP = 0x4
+
+} SharemindRandomEngineBufferFlags;
+
 /**
  * \brief Random engine configuration.
  * This indicates what core RNG engine to use, how to buffer the generated
@@ -85,8 +166,69 @@ typedef struct SharemindRandomEngineConf_ {
 
     /** The buffer size in bytes. Only used if relevant to the buffering mode.*/
     size_t                             bufferSize;
+
+    /** NUMA placement policy. Only used if relevant to the buffering mode. */
+    SharemindRandomEngineNumaPolicy    numaPolicy;
+
+    /** The NUMA node to use with SHAREMIND_RANDOM_NUMA_NODE. */
+    unsigned                           numaNode;
+
+    /** Bitwise OR of SharemindRandomEngineBufferFlags. Only used if relevant
+        to the buffering mode. */
+    unsigned                           bufferFlags;
+
+    /** The initial and minimum buffer size in bytes for adaptive buffering.*/
+    size_t                             minBufferSize;
+
+    /** The pre-generated randomness file used with
+        SHAREMIND_RANDOM_BUFFERING_FILE. */
+    char const *                       filePath;
+
+    /** The name of the POSIX shared memory object of the pool used with
+        SHAREMIND_RANDOM_BUFFERING_SHARED_POOL. */
+    char const *                       sharedPoolName;
 } SharemindRandomEngineConf;
 
+/** The number of buckets in the request size histogram of engine stats. */
+#define SHAREMIND_RANDOM_STATS_HISTOGRAM_SIZE 32
+
+/**
+ * \brief Performance counters of random engines.
+ * \note For buffered engines, the request counters describe the requests made
+ *       to the buffer and the generation counters the work done by the core
+ *       engine in the background.
+ */
+typedef struct SharemindRandomEngineStats_ {
+    /** The number of bytes generated by the core engine(s). */
+    uint64_t bytesGenerated;
+
+    /** The number of fillBytes requests made. */
+    uint64_t fillRequests;
+
+    /**
+     * Histogram of request sizes. Bucket i counts the requests of size in
+     * [2^i, 2^(i+1)), except bucket 0 also counts empty requests and the last
+     * bucket also counts all larger requests.
+     */
+    uint64_t requestSizeHistogram[SHAREMIND_RANDOM_STATS_HISTOGRAM_SIZE];
+
+    /** The number of times a consumer had to wait for a buffer to fill. */
+    uint64_t consumerStalls;
+
+    /** The total time consumers have waited for buffers to fill. */
+    uint64_t consumerStallNanoseconds;
+
+    /** The total time buffer filler threads have spent generating. */
+    uint64_t fillerBusyNanoseconds;
+
+    /** The total time buffer filler threads have been running. */
+    uint64_t fillerTotalNanoseconds;
+
+    /** The number of times the inner generator of AES engines was rekeyed. */
+    uint64_t innerReseeds;
+
+} SharemindRandomEngineStats;
+
 /**
  * \brief Indicates if the RNG was constructed (and seeded) properly.
  */
@@ -113,6 +255,35 @@ typedef enum SharemindRandomEngineCtorError_ {
 
     SHAREMIND_RANDOM_SEED_NOT_SUPPORTED,
 
+    /* File errors: */
+
+    /** The randomness file could not be created, opened or used. */
+    SHAREMIND_RANDOM_FILE_ERROR,
+
+    /** The randomness file was generated with a different engine or seed. */
+    SHAREMIND_RANDOM_FILE_MISMATCH,
+
+    /* Shared pool errors: */
+
+    /** The shared randomness pool could not be opened or used. */
+    SHAREMIND_RANDOM_SHARED_POOL_ERROR,
+
+    /** All slots of the shared randomness pool are in use. */
+    SHAREMIND_RANDOM_SHARED_POOL_FULL,
+
+    /* State errors: */
+
+    /** The engine does not support saving and restoring its state. */
+    SHAREMIND_RANDOM_STATE_NOT_SUPPORTED,
+
+    /** The given state is not valid for the engine. */
+    SHAREMIND_RANDOM_INVALID_STATE,
+
+    /* Sampling errors: */
+
+    /** The parameters of the distribution to sample are not valid. */
+    SHAREMIND_RANDOM_INVALID_PARAMETERS,
+
 } SharemindRandomEngineCtorError;
 
 
@@ -132,6 +303,9 @@ struct SharemindCryptographicRandom {
     /**
      * \param[out] memptr pointer to the memory region to randomize.
      * \param[in] size of the memory region to randomize.
+     * \note Where a hardware entropy source is available, most requests are
+     *       served without system calls, from a generator keyed by the
+     *       operating system and frequently reseeded from that source.
      */
     void (* const URandomBlocking)(
             SharemindRandomFacility * facility,
@@ -209,8 +383,64 @@ struct SharemindRandomFacility_ {
             size_t size,
             SharemindRandomEngineCtorError * e);
 
+    /**
+     * \brief Pre-generates randomness into a new file for use with
+     *        SHAREMIND_RANDOM_BUFFERING_FILE.
+     * \param[in] facility pointer to this factory facility.
+     * \param[in] conf the configuration specifying the core engine and the
+     *                 path of the file, which must not exist.
+     * \param[in] memptr pointer to the seed.
+     * \param[in] size of the seed.
+     * \param[in] dataSize the number of random bytes to generate.
+     * \returns SHAREMIND_RANDOM_OK on success, an error code otherwise.
+     */
+    SharemindRandomEngineCtorError (* const generateRandomFile)(
+            SharemindRandomFacility * facility,
+            SharemindRandomEngineConf const * conf,
+            void const * memptr,
+            size_t size,
+            uint64_t dataSize);
+
+    /**
+     * \param[in] facility pointer to this factory facility.
+     * \param[out] stats where to write the sums of the performance counters
+     *                   of all engines created by this facility.
+     */
+    void (* const getStats)(SharemindRandomFacility const * facility,
+                            SharemindRandomEngineStats * stats);
+
+    /**
+     * \brief Returns the engine of the calling thread for the given
+     *        configuration, creating and seeding it from entropy on first use.
+     * \param[in] facility pointer to this factory facility.
+     * \param[in] conf the configuration of the engine, or NULL for the
+     *                 default configuration.
+     * \param[out] e error flag. Set only on error, not touched otherwise.
+     *                May be NULL.
+     * \returns the engine, or NULL on error.
+     * \note The engine must only be used by the calling thread. It remains
+     *       valid until the thread exits or the facility is destroyed.
+     * \note In a child process created with fork(), a new engine is seeded
+     *       from entropy instead of continuing the stream of the parent. The
+     *       engines of the parent are abandoned in the child, as their filler
+     *       threads do not exist there.
+     * \note SHAREMIND_RANDOM_BUFFERING_FILE is not supported, as the engines
+     *       are not seeded with the seed of the file.
+     * \note Once an engine has been created, this function takes no locks.
+     */
+    SharemindRandomEngine * (* const threadEngine)(
+            SharemindRandomFacility * facility,
+            SharemindRandomEngineConf const * conf,
+            SharemindRandomEngineCtorError * e);
+
 };
 
+/**
+ * \brief Callback signalling the completion of an asynchronous fill request.
+ * \param[in] userData the pointer given along with the request.
+ */
+typedef void (* SharemindRandomFillCallback)(void * userData);
+
 /**
  * \brief Random number generation engine.
  */
@@ -225,6 +455,222 @@ struct SharemindRandomEngine_ {
                               void * memptr,
                               size_t size);
 
+    /**
+     * \param[in] rng pointer to this RNG engine.
+     * \returns the current size of the buffer in bytes, or 0 if the engine
+     *          is not buffered.
+     */
+    size_t (* const bufferSize)(SharemindRandomEngine const * rng);
+
+    /**
+     * \param[in] rng pointer to this RNG engine.
+     * \param[out] stats where to write the performance counters of the engine.
+     */
+    void (* const getStats)(SharemindRandomEngine const * rng,
+                            SharemindRandomEngineStats * stats);
+
+    /**
+     * \brief Starts filling the given memory region with random bytes and
+     *        returns without waiting for it to complete.
+     * \param[in] rng pointer to this RNG engine.
+     * \param[out] memptr memory region to randomize. Must remain valid and
+     *                    untouched until the callback is called.
+     * \param[in] size size of the memory region to randomize.
+     * \param[in] callback called exactly once when the region is filled.
+     * \param[in] userData passed to the callback.
+     * \note Thread-buffered engines generate directly into the given region
+     *       on their buffering thread and call the callback on that thread.
+     *       Other engines fill the region and call the callback before this
+     *       function returns.
+     * \note Asynchronous requests consume the same random bytes as fillBytes
+     *       would. Requests made to a thread-buffered engine before the
+     *       callback has been called block until the region is filled.
+     */
+    void (* const fillBytesAsync)(SharemindRandomEngine * rng,
+                                  void * memptr,
+                                  size_t size,
+                                  SharemindRandomFillCallback callback,
+                                  void * userData);
+
+    /**
+     * \brief XORs random bytes into the given memory region, consuming the
+     *        same random bytes as fillBytes would.
+     * \param[in] rng pointer to this RNG engine.
+     * \param[in,out] memptr memory region to mask.
+     * \param[in] size size of the memory region.
+     */
+    void (* const xorBytesInto)(SharemindRandomEngine * rng,
+                                void * memptr,
+                                size_t size);
+
+    /**
+     * \brief Adds random values to the unsigned integers in the given memory
+     *        region, modulo 2^(8 * elementSize).
+     * \param[in] rng pointer to this RNG engine.
+     * \param[in,out] memptr memory region of the integers.
+     * \param[in] size size of the memory region in bytes. Must be a multiple
+     *                 of elementSize.
+     * \param[in] elementSize the size of the integers: 1, 2, 4 or 8.
+     * \note If elementSize or size is invalid, neither the memory region nor
+     *       the engine is changed.
+     */
+    void (* const addInto)(SharemindRandomEngine * rng,
+                           void * memptr,
+                           size_t size,
+                           size_t elementSize);
+
+    /**
+     * \brief Subtracts random values from the unsigned integers in the given
+     *        memory region, modulo 2^(8 * elementSize).
+     * \see addInto
+     */
+    void (* const subFrom)(SharemindRandomEngine * rng,
+                           void * memptr,
+                           size_t size,
+                           size_t elementSize);
+
+    /**
+     * \param[in] rng pointer to this RNG engine.
+     * \returns the size of the state written by saveState in bytes, or 0 if
+     *          the engine does not support saving its state. Only unbuffered
+     *          engines support it.
+     */
+    size_t (* const stateSize)(SharemindRandomEngine const * rng);
+
+    /**
+     * \brief Saves the position of the engine in its keystream, from which
+     *        restoreState can continue the keystream without regenerating it.
+     * \param[in] rng pointer to this RNG engine.
+     * \param[out] memptr where to write the state.
+     * \param[in] size size of the memory region, at least stateSize(rng).
+     * \returns SHAREMIND_RANDOM_OK on success, an error code otherwise.
+     * \warning The state contains the key of the engine, hence it must be
+     *          protected like the seed.
+     */
+    SharemindRandomEngineCtorError (* const saveState)(
+            SharemindRandomEngine const * rng,
+            void * memptr,
+            size_t size);
+
+    /**
+     * \brief Continues the keystream from a state saved by an engine of the
+     *        same kind.
+     * \param[in] rng pointer to this RNG engine.
+     * \param[in] memptr the state.
+     * \param[in] size size of the state.
+     * \returns SHAREMIND_RANDOM_OK on success, an error code otherwise, in
+     *          which case the engine is not modified.
+     */
+    SharemindRandomEngineCtorError (* const restoreState)(
+            SharemindRandomEngine * rng,
+            void const * memptr,
+            size_t size);
+
+    /**
+     * \brief Fills the given array with doubles uniformly distributed in
+     *        [0, 1), each made of the 53 high bits of a 64-bit random word.
+     * \param[in] rng pointer to this RNG engine.
+     * \param[out] values the array to fill.
+     * \param[in] count the number of elements in the array.
+     */
+    void (* const fillUniformDouble)(SharemindRandomEngine * rng,
+                                     double * values,
+                                     size_t count);
+
+    /**
+     * \brief Fills the given array with floats uniformly distributed in
+     *        [0, 1), each made of the 24 high bits of a 32-bit random word.
+     * \param[in] rng pointer to this RNG engine.
+     * \param[out] values the array to fill.
+     * \param[in] count the number of elements in the array.
+     */
+    void (* const fillUniformFloat)(SharemindRandomEngine * rng,
+                                    float * values,
+                                    size_t count);
+
+    /**
+     * \brief Fills the given array with normally distributed doubles.
+     * \param[in] rng pointer to this RNG engine.
+     * \param[out] values the array to fill.
+     * \param[in] count the number of elements in the array.
+     * \param[in] mean the mean of the distribution.
+     * \param[in] stddev the standard deviation of the distribution.
+     * \note For a given seed, the output does not depend on the instruction
+     *       set extensions of the host.
+     */
+    void (* const fillNormal)(SharemindRandomEngine * rng,
+                              double * values,
+                              size_t count,
+                              double mean,
+                              double stddev);
+
+    /**
+     * \brief Fills the given array with exact samples of the discrete
+     *        Laplace distribution with the probability of z proportional to
+     *        exp(-|z| * scaleDenominator / scaleNumerator).
+     * \param[in] rng pointer to this RNG engine.
+     * \param[out] values the array to fill.
+     * \param[in] count the number of elements in the array.
+     * \param[in] scaleNumerator the numerator of the scale, at least 1.
+     * \param[in] scaleDenominator the denominator of the scale, at least 1.
+     * \returns SHAREMIND_RANDOM_OK on success, an error code otherwise.
+     */
+    SharemindRandomEngineCtorError (* const fillDiscreteLaplace)(
+            SharemindRandomEngine * rng,
+            int64_t * values,
+            size_t count,
+            uint32_t scaleNumerator,
+            uint32_t scaleDenominator);
+
+    /**
+     * \brief Fills the given array with exact samples of the discrete
+     *        Gaussian distribution with the probability of z proportional to
+     *        exp(-z^2 / (2 * varianceNumerator / varianceDenominator)).
+     * \param[in] rng pointer to this RNG engine.
+     * \param[out] values the array to fill.
+     * \param[in] count the number of elements in the array.
+     * \param[in] varianceNumerator the numerator of the variance parameter,
+     *                              at least 1.
+     * \param[in] varianceDenominator the denominator of the variance
+     *                                parameter, at least 1.
+     * \returns SHAREMIND_RANDOM_OK on success, an error code otherwise.
+     */
+    SharemindRandomEngineCtorError (* const fillDiscreteGaussian)(
+            SharemindRandomEngine * rng,
+            int64_t * values,
+            size_t count,
+            uint32_t varianceNumerator,
+            uint32_t varianceDenominator);
+
+    /**
+     * \brief Fills the given memory regions with random bytes in order,
+     *        consuming the same random bytes as calling fillBytes for each of
+     *        them in turn would.
+     * \param[in] rng pointer to this RNG engine.
+     * \param[in] iov the memory regions to randomize.
+     * \param[in] iovcnt the number of memory regions.
+     */
+    void (* const fillBytesV)(SharemindRandomEngine * rng,
+                              struct iovec const * iov,
+                              size_t iovcnt);
+
+    /**
+     * \brief Hints that the next size random bytes will be requested from
+     *        this engine within the given time.
+     *
+     * Buffering engines pre-generate these bytes as soon as possible and, if
+     * their buffer is adaptive, temporarily grow it up to bufferSize to hold
+     * them. The hint expires after the given time. It does not change the
+     * random bytes served, and engines without a filler ignore it.
+     * \param[in] rng pointer to this RNG engine.
+     * \param[in] size the number of bytes about to be requested.
+     * \param[in] withinNanoseconds the time in nanoseconds from now by which
+     *                              the bytes are expected to be requested.
+     */
+    void (* const reserve)(SharemindRandomEngine * rng,
+                           size_t size,
+                           uint64_t withinNanoseconds);
+
 };
 
 
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/*
+ * Tests that every stream of the batch engine equals the stream of a
+ * ChaCha20RandomEngine with the same seed, for every kernel up to the level
+ * of the host, and reports the throughput of drawing a few bytes from many
+ * fresh streams using the batch engine and using individual engines.
+ */
+
+#include "../src/ChaCha20BatchEngine.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sharemind/TestAssert.h>
+#include <vector>
+#include "../src/ChaCha20RandomEngine.h"
+#include "../src/CpuFeatures.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+constexpr std::size_t const SeedSize = ChaCha20BatchEngine::SeedSize;
+
+std::vector<std::uint8_t> makeSeeds(std::size_t const streamCount) {
+    std::vector<std::uint8_t> seeds(streamCount * SeedSize);
+    std::mt19937 rng(7u);
+    for (auto & b : seeds)
+        b = static_cast<std::uint8_t>(rng());
+    return seeds;
+}
+
+void testLevel(CpuFeatures::Level const level,
+               std::size_t const streamCount)
+{
+    auto const seeds(makeSeeds(streamCount));
+    ChaCha20BatchEngine batch(seeds.data(), streamCount, level);
+    SHAREMIND_TESTASSERT(batch.streamCount() == streamCount);
+
+    std::vector<std::unique_ptr<ChaCha20RandomEngine> > engines;
+    for (std::size_t s = 0u; s < streamCount; ++s)
+        engines.emplace_back(
+                    new ChaCha20RandomEngine(&seeds[s * SeedSize]));
+
+    std::mt19937 rng(11u);
+    std::vector<std::uint8_t> actual;
+    std::vector<std::uint8_t> expected;
+    for (std::size_t round = 0u; round < 40u; ++round) {
+        auto const size = static_cast<std::size_t>(rng() % 700u);
+        actual.assign(streamCount * size, 0u);
+        batch.fillBytes(actual.data(), size);
+        for (std::size_t s = 0u; s < streamCount; ++s) {
+            expected.resize(size);
+            engines[s]->fillBytes(expected.data(), size);
+            SHAREMIND_TESTASSERT(std::memcmp(&actual[s * size],
+                                             expected.data(),
+                                             size) == 0);
+        }
+
+        // Consume some bytes through the spans:
+        auto const available = batch.acquire();
+        SHAREMIND_TESTASSERT(available > 0u);
+        SHAREMIND_TESTASSERT(available <= ChaCha20BatchEngine::GroupSize);
+        auto const n = static_cast<std::size_t>(rng() % (available + 1u));
+        expected.resize(n);
+        for (std::size_t s = 0u; s < streamCount; ++s) {
+            engines[s]->fillBytes(expected.data(), n);
+            SHAREMIND_TESTASSERT(
+                    std::memcmp(batch.span(s), expected.data(), n) == 0);
+        }
+        batch.consume(n);
+    }
+}
+
+double seconds(std::chrono::steady_clock::time_point const start) {
+    return std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+}
+
+/* Draws a few bytes from each of many fresh streams, e.g. one per row: */
+void benchmark() {
+    constexpr std::size_t const streamCount = 4096u;
+    constexpr std::size_t const size = 64u;
+    constexpr std::size_t const rounds = 64u;
+    constexpr double const mib =
+            streamCount * size * rounds / (1024.0 * 1024.0);
+    auto const seeds(makeSeeds(streamCount));
+    std::vector<std::uint8_t> out(streamCount * size);
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t r = 0u; r < rounds; ++r) {
+        ChaCha20BatchEngine batch(seeds.data(), streamCount);
+        batch.fillBytes(out.data(), size);
+    }
+    std::cout << "batch: " << mib / seconds(start) << " MiB/s" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    for (std::size_t r = 0u; r < rounds; ++r) {
+        for (std::size_t s = 0u; s < streamCount; ++s) {
+            ChaCha20RandomEngine engine(&seeds[s * SeedSize]);
+            engine.fillBytes(&out[s * size], size);
+        }
+    }
+    std::cout << "individual: " << mib / seconds(start) << " MiB/s"
+              << std::endl;
+}
+
+} // anonymous namespace
+
+int main() {
+    auto const host = CpuFeatures::instance().level();
+    for (auto const level : { CpuFeatures::Level::Generic,
+                              CpuFeatures::Level::Sse2,
+                              CpuFeatures::Level::Ssse3,
+                              CpuFeatures::Level::Avx2,
+                              CpuFeatures::Level::Avx512 })
+    {
+        if (level > host)
+            break;
+        for (std::size_t const streamCount : { 0u, 1u, 5u, 16u, 37u })
+            testLevel(level, streamCount);
+    }
+    benchmark();
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/CpuFeatures.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../src/ChaCha20Kernels.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+struct KernelInfo {
+    CpuFeatures::Level level;
+    ChaCha20Kernel kernel;
+};
+
+KernelInfo const kernels[] = {
+    #if defined(__x86_64__) || defined(__i386__)
+    { CpuFeatures::Level::Sse2, &chaCha20KernelSse2 },
+    { CpuFeatures::Level::Ssse3, &chaCha20KernelSsse3 },
+    { CpuFeatures::Level::Avx2, &chaCha20KernelAvx2 },
+    { CpuFeatures::Level::Avx512, &chaCha20KernelAvx512 },
+    #endif
+    { CpuFeatures::Level::Generic, &chaCha20KernelGeneric }
+};
+
+constexpr std::size_t const OutputSize = ChaCha20KernelBlocks * 64u;
+
+void initState(std::uint32_t * state, std::uint64_t const counter) {
+    for (unsigned i = 0u; i < 16u; ++i)
+        state[i] = 0x01020304u * (i + 1u);
+    state[12u] = static_cast<std::uint32_t>(counter);
+    state[13u] = static_cast<std::uint32_t>(counter >> 32u);
+}
+
+void testKernels() {
+    auto const level = CpuFeatures::instance().level();
+    SHAREMIND_TESTASSERT(chaCha20Kernel(CpuFeatures::Level::Generic)
+                         == &chaCha20KernelGeneric);
+
+    for (std::uint64_t const counter : { UINT64_C(0),
+                                         UINT64_C(4),
+                                         UINT64_C(0xfffffff8),
+                                         UINT64_C(0x123456789abcdef0),
+                                         UINT64_C(0xfffffffffffffff0) })
+    {
+        std::uint32_t expectedState[16u];
+        std::uint8_t expected[OutputSize];
+        initState(expectedState, counter);
+        chaCha20KernelGeneric(expectedState, expected);
+        auto const next = counter + ChaCha20KernelBlocks;
+        SHAREMIND_TESTASSERT(expectedState[12u]
+                             == static_cast<std::uint32_t>(next));
+        SHAREMIND_TESTASSERT(expectedState[13u]
+                             == static_cast<std::uint32_t>(next >> 32u));
+
+        for (auto const & k : kernels) {
+            if (k.level > level)
+                continue;
+            std::uint32_t state[16u];
+            std::uint8_t out[OutputSize + 1u];
+            initState(state, counter);
+            out[OutputSize] = 0x42u;
+            k.kernel(state, out);
+            SHAREMIND_TESTASSERT(std::memcmp(out, expected, OutputSize) == 0);
+            SHAREMIND_TESTASSERT(out[OutputSize] == 0x42u);
+            SHAREMIND_TESTASSERT(std::memcmp(state,
+                                             expectedState,
+                                             sizeof(state)) == 0);
+        }
+    }
+}
+
+void testLevelNames() {
+    for (auto const level : { CpuFeatures::Level::Generic,
+                              CpuFeatures::Level::Sse2,
+                              CpuFeatures::Level::Ssse3,
+                              CpuFeatures::Level::Avx2,
+                              CpuFeatures::Level::Avx512 })
+    {
+        auto parsed = CpuFeatures::Level::Avx512;
+        if (level == parsed)
+            parsed = CpuFeatures::Level::Generic;
+        SHAREMIND_TESTASSERT(CpuFeatures::parseLevel(
+                                 CpuFeatures::levelName(level),
+                                 parsed));
+        SHAREMIND_TESTASSERT(parsed == level);
+    }
+    auto parsed = CpuFeatures::Level::Sse2;
+    SHAREMIND_TESTASSERT(!CpuFeatures::parseLevel("avx9000", parsed));
+    SHAREMIND_TESTASSERT(!CpuFeatures::parseLevel("", parsed));
+    SHAREMIND_TESTASSERT(parsed == CpuFeatures::Level::Sse2);
+}
+
+void testOverride(char const * const self) {
+    auto const pid = ::fork();
+    SHAREMIND_TESTASSERT(pid >= 0);
+    if (pid == 0) {
+        ::setenv(CpuFeatures::LevelEnvironmentVariable, "generic", 1);
+        ::execl(self, self, "--expect-generic", static_cast<char *>(nullptr));
+        ::_exit(2);
+    }
+    int status;
+    SHAREMIND_TESTASSERT(::waitpid(pid, &status, 0) == pid);
+    SHAREMIND_TESTASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+} // anonymous namespace
+
+int main(int argc, char * argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--expect-generic") {
+        auto const & cpu = CpuFeatures::instance();
+        return (cpu.level() == CpuFeatures::Level::Generic
+                && !cpu.has(CpuFeatures::Sse2)
+                && !cpu.has(CpuFeatures::Avx2))
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+    }
+    testKernels();
+    testLevelNames();
+    testOverride("/proc/self/exe");
+}
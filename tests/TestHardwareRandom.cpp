@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/HardwareRandom.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <sharemind/TestAssert.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../src/CryptographicRandom.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+using HealthTests = HardwareRandom::HealthTests;
+using Block = std::array<std::uint8_t, 48u>;
+
+bool feedAll(HealthTests & tests, std::uint8_t const sample, std::size_t n) {
+    bool r = true;
+    while (n-- > 0u)
+        r = tests.feed(sample) && r;
+    return r;
+}
+
+void testHealthTests() {
+    {
+        HealthTests tests;
+        for (std::size_t i = 0u; i < 100000u; ++i)
+            SHAREMIND_TESTASSERT(tests.feed(static_cast<std::uint8_t>(i * 7u)));
+    }{
+        // Repetition count test:
+        HealthTests tests;
+        SHAREMIND_TESTASSERT(tests.feed(1u));
+        SHAREMIND_TESTASSERT(feedAll(tests, 2u,
+                                     HealthTests::RepetitionCutoff - 1u));
+        SHAREMIND_TESTASSERT(tests.feed(1u));
+        SHAREMIND_TESTASSERT(!feedAll(tests, 2u,
+                                      HealthTests::RepetitionCutoff));
+        SHAREMIND_TESTASSERT(tests.failed());
+        // Failures are permanent:
+        SHAREMIND_TESTASSERT(!tests.feed(3u));
+    }{
+        // Adaptive proportion test, first with the most matches allowed:
+        HealthTests tests;
+        std::size_t matches = 0u;
+        for (std::size_t i = 0u; i < HealthTests::ProportionWindow; ++i) {
+            std::uint8_t sample = static_cast<std::uint8_t>(1u + i % 200u);
+            if (i % 2u == 0u
+                && matches < HealthTests::ProportionCutoff - 1u)
+            {
+                sample = 0u;
+                ++matches;
+            }
+            SHAREMIND_TESTASSERT(tests.feed(sample));
+        }
+        for (std::size_t i = 0u; i < HealthTests::ProportionWindow; ++i) {
+            auto const sample = (i % 2u == 0u)
+                                ? std::uint8_t(0u)
+                                : static_cast<std::uint8_t>(1u + i % 200u);
+            if (!tests.feed(sample))
+                break;
+        }
+        SHAREMIND_TESTASSERT(tests.failed());
+    }
+}
+
+void testHardwareRandom() {
+    if (!HardwareRandom::supported()) {
+        Block b;
+        SHAREMIND_TESTASSERT(!HardwareRandom::fill(b.data(), b.size()));
+        return;
+    }
+    Block a;
+    Block b;
+    SHAREMIND_TESTASSERT(HardwareRandom::fill(a.data(), a.size()));
+    SHAREMIND_TESTASSERT(HardwareRandom::fill(b.data(), b.size()));
+    SHAREMIND_TESTASSERT(a != b);
+}
+
+Block mixed() {
+    Block r;
+    cryptographicMixedURandom(r.data(), r.size());
+    return r;
+}
+
+// After fork() the child must not continue from the key of the parent:
+void testMixedFork() {
+    mixed();
+    int fds[2u];
+    SHAREMIND_TESTASSERT(::pipe(fds) == 0);
+    auto const pid = ::fork();
+    SHAREMIND_TESTASSERT(pid >= 0);
+    if (pid == 0) {
+        ::close(fds[0u]);
+        auto const block = mixed();
+        auto const ok = ::write(fds[1u], block.data(), block.size())
+                        == static_cast<ssize_t>(block.size());
+        ::_exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    ::close(fds[1u]);
+    Block childBlock;
+    SHAREMIND_TESTASSERT(::read(fds[0u], childBlock.data(), childBlock.size())
+                         == static_cast<ssize_t>(childBlock.size()));
+    ::close(fds[0u]);
+    int status;
+    SHAREMIND_TESTASSERT(::waitpid(pid, &status, 0) == pid);
+    SHAREMIND_TESTASSERT(WIFEXITED(status)
+                         && WEXITSTATUS(status) == EXIT_SUCCESS);
+    SHAREMIND_TESTASSERT(mixed() != childBlock);
+}
+
+template <typename F>
+double nanosecondsPerCall(F && f) {
+    constexpr unsigned const calls = 20000u;
+    Block b;
+    auto const start = std::chrono::steady_clock::now();
+    for (unsigned i = 0u; i < calls; ++i)
+        f(b.data(), b.size());
+    return std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count() / calls;
+}
+
+void testMixed() {
+    auto const first = mixed();
+    auto const second = mixed();
+    SHAREMIND_TESTASSERT(first != second);
+    testMixedFork();
+
+    // Seeding many engines:
+    std::cout << "Hardware entropy source: "
+              << (HardwareRandom::supported() ? "yes" : "no") << std::endl
+              << "getrandom(2): "
+              << nanosecondsPerCall(&::sharemindCryptographicURandom)
+              << " ns per seed" << std::endl
+              << "Mixed: "
+              << nanosecondsPerCall(&::sharemindCryptographicMixedURandom)
+              << " ns per seed" << std::endl;
+}
+
+} // anonymous namespace
+
+int main() {
+    testHealthTests();
+    testHardwareRandom();
+    testMixed();
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+
+/*
+ * Tests the alias table sampler. The throughput of the construction and the
+ * sampling of a large table is reported as well. By default the large table
+ * has DefaultLargeSize entries, another size can be given as an argument,
+ * e.g.
+ *
+ *     TestRandomAliasTable 100000000
+ */
+
+#include "../src/RandomAliasTable.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <sharemind/TestAssert.h>
+#include <vector>
+#include "../src/ChaCha20RandomEngine.h"
+#include "../src/RandomEngineFacade.h"
+#include "../src/RandomFacility.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+constexpr std::size_t const DefaultLargeSize = 3u * 1024u * 1024u + 5u;
+
+/* The bound on the absolute z-scores of the frequencies: */
+constexpr double const MaxZ = 6.0;
+
+std::vector<std::uint8_t> testSeed(std::uint8_t const salt) {
+    std::vector<std::uint8_t> seed(ChaCha20RandomEngine::SeedSize);
+    for (std::size_t i = 0u; i < seed.size(); ++i)
+        seed[i] = static_cast<std::uint8_t>(i * 11u + salt);
+    return seed;
+}
+
+/** \brief Checks the frequencies of the draws against the weights. */
+void checkFrequencies(std::vector<double> const & weights,
+                      std::vector<std::uint64_t> const & draws)
+{
+    double total = 0.0;
+    for (auto const w : weights)
+        total += w;
+    std::vector<double> observed(weights.size());
+    for (auto const d : draws) {
+        SHAREMIND_TESTASSERT(d < weights.size());
+        ++observed[d];
+    }
+    auto const n = static_cast<double>(draws.size());
+    for (std::size_t i = 0u; i < weights.size(); ++i) {
+        auto const p = weights[i] / total;
+        if (p <= 0.0) {
+            SHAREMIND_TESTASSERT(observed[i] == 0.0);
+        } else if (p >= 1.0) {
+            SHAREMIND_TESTASSERT(observed[i] == n);
+        } else {
+            SHAREMIND_TESTASSERT(std::fabs(observed[i] - n * p)
+                                 / std::sqrt(n * p * (1.0 - p)) < MaxZ);
+        }
+    }
+}
+
+void testSmall() {
+    auto const seed(testSeed(1u));
+    ChaCha20RandomEngine engine(seed.data());
+    for (auto const & weights : { std::vector<double>{ 1.0 },
+                                  std::vector<double>{ 0.0, 5.0 },
+                                  std::vector<double>{ 1.0, 2.0, 3.0, 0.0 },
+                                  std::vector<double>{ 1e-300, 1.0, 1e300 } })
+    {
+        RandomAliasTable const table(weights.data(), weights.size());
+        SHAREMIND_TESTASSERT(table.size() == weights.size());
+        std::vector<std::uint64_t> draws(1000003u);
+        table.sample(engine, draws.data(), draws.size());
+        checkFrequencies(weights, draws);
+    }
+
+    // Many weights of different magnitudes:
+    std::vector<double> weights(1000u);
+    for (std::size_t i = 0u; i < weights.size(); ++i)
+        weights[i] = static_cast<double>((i * 7919u) % 1000u + 1u);
+    RandomAliasTable const table(weights.data(), weights.size());
+    std::vector<std::uint64_t> draws(4000000u);
+    table.sample(engine, draws.data(), draws.size());
+    checkFrequencies(weights, draws);
+}
+
+void testInvalid() {
+    auto const nan = std::numeric_limits<double>::quiet_NaN();
+    auto const inf = std::numeric_limits<double>::infinity();
+    for (auto const & weights : { std::vector<double>{},
+                                  std::vector<double>{ 0.0, 0.0 },
+                                  std::vector<double>{ 1.0, -1.0 },
+                                  std::vector<double>{ 1.0, nan },
+                                  std::vector<double>{ 1.0, inf },
+                                  std::vector<double>{ 1e308, 1e308 } })
+    {
+        bool thrown = false;
+        try {
+            RandomAliasTable const table(weights.data(), weights.size());
+        } catch (RandomAliasTable::InvalidWeightsException const &) {
+            thrown = true;
+        }
+        SHAREMIND_TESTASSERT(thrown);
+    }
+}
+
+/* Two-level tables must not depend on the number of threads, and must draw
+   the blocks and the entries in them with the right frequencies: */
+void testLarge(std::size_t const size) {
+    std::vector<double> weights(size);
+    for (std::size_t i = 0u; i < size; ++i)
+        weights[i] = static_cast<double>(i % 3u) + ((i % 1000u == 0u) ? 1e3
+                                                                      : 0.0);
+    auto const start = std::chrono::steady_clock::now();
+    RandomAliasTable const parallel(weights.data(), weights.size(), 0u);
+    auto const built = std::chrono::steady_clock::now();
+    RandomAliasTable const sequential(weights.data(), weights.size());
+    std::cout << "Constructed " << size << " entries in "
+              << std::chrono::duration<double>(built - start).count()
+              << " s" << std::endl;
+
+    auto const seed(testSeed(2u));
+    ChaCha20RandomEngine a(seed.data());
+    ChaCha20RandomEngine b(seed.data());
+    std::vector<std::uint64_t> x(4000000u);
+    std::vector<std::uint64_t> y(x.size());
+    auto const sampleStart = std::chrono::steady_clock::now();
+    parallel.sample(a, x.data(), x.size());
+    auto const seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - sampleStart).count();
+    std::cout << "Sampled "
+              << static_cast<double>(x.size()) / std::max(seconds, 1e-9) / 1e6
+              << " M draws/s" << std::endl;
+    sequential.sample(b, y.data(), y.size());
+    SHAREMIND_TESTASSERT(x == y);
+
+    // The frequencies of the classes of entries:
+    std::vector<double> classWeights(4u);
+    for (std::size_t i = 0u; i < size; ++i)
+        classWeights[(i % 1000u == 0u) ? 3u : i % 3u] += weights[i];
+    std::vector<std::uint64_t> classes(x.size());
+    for (std::size_t i = 0u; i < x.size(); ++i)
+        classes[i] = (x[i] % 1000u == 0u) ? 3u : x[i] % 3u;
+    checkFrequencies(classWeights, classes);
+
+    // The frequencies of the blocks:
+    auto const numBlocks = (size - 1u) / RandomAliasTable::BlockSize + 1u;
+    std::vector<double> blockWeights(numBlocks);
+    for (std::size_t i = 0u; i < size; ++i)
+        blockWeights[i / RandomAliasTable::BlockSize] += weights[i];
+    for (auto & d : x)
+        d /= RandomAliasTable::BlockSize;
+    checkFrequencies(blockWeights, x);
+}
+
+void testFacade() {
+    RandomFacility facility(SharemindRandomEngineConf{
+                                SHAREMIND_RANDOM_CHACHA20,
+                                SHAREMIND_RANDOM_BUFFERING_NONE,
+                                0u,
+                                SHAREMIND_RANDOM_NUMA_NONE,
+                                0u,
+                                0u,
+                                0u,
+                                nullptr,
+                                nullptr});
+    auto const seed(testSeed(3u));
+    auto const rng(facility.createRandomEngineWithSeed(
+                       facility.defaultFactoryConfiguration(),
+                       seed.data(),
+                       seed.size()));
+    RandomEngineFacade facade(rng.get());
+    ChaCha20RandomEngine reference(seed.data());
+
+    std::vector<double> const weights{ 3.0, 1.0, 4.0, 1.0, 5.0 };
+    RandomAliasTable const table(weights.data(), weights.size());
+    std::vector<std::uint64_t> x(10000u);
+    std::vector<std::uint64_t> y(x.size());
+    table.sample(facade, x.data(), x.size());
+    table.sample(reference, y.data(), y.size());
+    SHAREMIND_TESTASSERT(x == y);
+}
+
+} // anonymous namespace
+
+int main(int argc, char * argv[]) {
+    std::size_t largeSize = DefaultLargeSize;
+    if (argc > 1) {
+        largeSize = std::strtoul(argv[1], nullptr, 10);
+        SHAREMIND_TESTASSERT(largeSize > 0u);
+    }
+    testSmall();
+    testInvalid();
+    testLarge(largeSize);
+    testFacade();
+}
@@ -0,0 +1,295 @@
+#include "../src/ChaCha20RandomEngine.h"
+#include "../src/RandomBufferAgent.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <sharemind/TestAssert.h>
+#include <thread>
+#include <vector>
+#include "../src/librandom.h"
+
+
+using namespace sharemind;
+
+using Seed = std::array<uint8_t, ChaCha20RandomEngine::SeedSize>;
+
+// The buffered stream must be identical to the stream of the inner engine:
+void testSameStream(std::size_t const bufferSize, unsigned const flags) {
+    Seed seed;
+    for (std::size_t i = 0u; i < seed.size(); ++i)
+        seed[i] = static_cast<uint8_t>(i);
+
+    ChaCha20RandomEngine reference{seed.data()};
+    RandomBufferAgent agent{std::make_shared<ChaCha20RandomEngine>(seed.data()),
+                            bufferSize,
+                            RandomBufferAgent::NoNumaNode,
+                            flags};
+
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> actual;
+    std::size_t requestSize = 1u;
+    for (unsigned i = 0u; i < 200u; ++i) {
+        expected.resize(requestSize);
+        actual.resize(requestSize);
+        reference.fillBytes(expected.data(), requestSize);
+        agent.fillBytes(actual.data(), requestSize);
+        SHAREMIND_TESTASSERT(expected == actual);
+        requestSize = (requestSize * 7u + 13u) % (3u * bufferSize + 1u);
+    }
+}
+
+// An adaptive buffer must stay within its bounds and keep the stream intact
+// while it is resized. Whether and when it resizes depends on the timing of
+// the filler and the consumer, hence it is not asserted:
+void testAdaptiveBounds() {
+    Seed seed;
+    seed.fill(42u);
+    constexpr std::size_t minSize = 4096u;
+    constexpr std::size_t maxSize = 1024u * 1024u;
+
+    ChaCha20RandomEngine reference{seed.data()};
+    RandomBufferAgent agent{std::make_shared<ChaCha20RandomEngine>(seed.data()),
+                            maxSize,
+                            RandomBufferAgent::NoNumaNode,
+                            0u,
+                            minSize};
+    SHAREMIND_TESTASSERT(agent.bufferSize() == minSize);
+
+    std::vector<uint8_t> expected(65536u);
+    std::vector<uint8_t> actual(65536u);
+    for (unsigned i = 0u; i < 256u; ++i) {
+        reference.fillBytes(expected.data(), expected.size());
+        agent.fillBytes(actual.data(), actual.size());
+        SHAREMIND_TESTASSERT(expected == actual);
+        auto const size = agent.bufferSize();
+        SHAREMIND_TESTASSERT(size >= minSize);
+        SHAREMIND_TESTASSERT(size <= maxSize);
+    }
+}
+
+/// Sleeps on every request, so that the consumer of its buffer always stalls:
+class SlowEngine: public RandomEngine {
+
+public: /* Methods: */
+
+    SlowEngine(void const * const seed) noexcept : m_engine(seed) {}
+
+    void fillBytes(void * buffer, std::size_t size) noexcept override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        m_engine.fillBytes(buffer, size);
+    }
+
+private: /* Fields: */
+
+    ChaCha20RandomEngine m_engine;
+
+};
+
+// An adaptive buffer must grow when the consumer keeps stalling on it:
+void testAdaptiveGrowth() {
+    Seed seed;
+    seed.fill(43u);
+    constexpr std::size_t minSize = 4096u;
+    constexpr std::size_t maxSize = 1024u * 1024u;
+
+    ChaCha20RandomEngine reference{seed.data()};
+    RandomBufferAgent agent{std::make_shared<SlowEngine>(seed.data()),
+                            maxSize,
+                            RandomBufferAgent::NoNumaNode,
+                            0u,
+                            minSize};
+
+    /* Every read takes at least 16 fills of the initial buffer, i.e. 16 ms,
+       hence the reads span many adaptation periods: */
+    std::vector<uint8_t> expected(65536u);
+    std::vector<uint8_t> actual(65536u);
+    for (unsigned i = 0u; i < 64u && agent.bufferSize() == minSize; ++i) {
+        reference.fillBytes(expected.data(), expected.size());
+        agent.fillBytes(actual.data(), actual.size());
+        SHAREMIND_TESTASSERT(expected == actual);
+    }
+    SHAREMIND_TESTASSERT(agent.bufferSize() > minSize);
+    SHAREMIND_TESTASSERT(agent.bufferSize() <= maxSize);
+}
+
+// The adaptation decisions, independent of timing:
+void testAdaptedTargetSize() {
+    constexpr std::size_t minSize = 4096u;
+    constexpr std::size_t maxSize = 65536u;
+    unsigned quiet = 3u;
+
+    // A stall doubles the size up to the maximum:
+    SHAREMIND_TESTASSERT(RandomBufferAgent::adaptedTargetSize(
+                             8192u, 8192u, minSize, maxSize, true, 0u, quiet)
+                         == 16384u);
+    SHAREMIND_TESTASSERT(quiet == 0u);
+    SHAREMIND_TESTASSERT(RandomBufferAgent::adaptedTargetSize(
+                             49152u, 49152u, minSize, maxSize, true, 0u, quiet)
+                         == maxSize);
+
+    // Sufficient usage keeps the size and resets the quiet periods:
+    quiet = 3u;
+    SHAREMIND_TESTASSERT(RandomBufferAgent::adaptedTargetSize(
+                             maxSize, maxSize, minSize, maxSize, false,
+                             maxSize / RandomBufferAgent::AdaptShrinkUsage,
+                             quiet)
+                         == maxSize);
+    SHAREMIND_TESTASSERT(quiet == 0u);
+
+    // Only enough consecutive quiet periods halve the size:
+    for (unsigned i = 1u; i < RandomBufferAgent::AdaptShrinkPeriods; ++i) {
+        SHAREMIND_TESTASSERT(RandomBufferAgent::adaptedTargetSize(
+                                 maxSize, maxSize, minSize, maxSize, false, 1u,
+                                 quiet)
+                             == maxSize);
+        SHAREMIND_TESTASSERT(quiet == i);
+    }
+    SHAREMIND_TESTASSERT(RandomBufferAgent::adaptedTargetSize(
+                             maxSize, maxSize, minSize, maxSize, false, 1u,
+                             quiet)
+                         == maxSize / 2u);
+    SHAREMIND_TESTASSERT(quiet == 0u);
+
+    // Down to the minimum:
+    quiet = RandomBufferAgent::AdaptShrinkPeriods - 1u;
+    SHAREMIND_TESTASSERT(RandomBufferAgent::adaptedTargetSize(
+                             6144u, 6144u, minSize, maxSize, false, 0u, quiet)
+                         == minSize);
+}
+
+// Request counters must describe the requests made to the buffered engine:
+void testStats() {
+    Seed seed;
+    seed.fill(7u);
+    RandomBufferAgent agent{std::make_shared<ChaCha20RandomEngine>(seed.data()),
+                            4096u};
+
+    std::array<uint8_t, 100u> buf;
+    for (unsigned i = 0u; i < 10u; ++i)
+        agent.fillBytes(buf.data(), buf.size());
+    agent.fillBytes(buf.data(), 1u);
+
+    SharemindRandomEngineStats stats;
+    agent.getStats(stats);
+    SHAREMIND_TESTASSERT(stats.fillRequests == 11u);
+    SHAREMIND_TESTASSERT(stats.requestSizeHistogram[0u] == 1u);
+    SHAREMIND_TESTASSERT(stats.requestSizeHistogram[6u] == 10u);
+    SHAREMIND_TESTASSERT(stats.bytesGenerated >= 1001u);
+    SHAREMIND_TESTASSERT(stats.fillerTotalNanoseconds
+                         >= stats.fillerBusyNanoseconds);
+}
+
+// Asynchronous requests must be completed, also when interleaved with
+// synchronous ones or pending on destruction:
+void testAsync() {
+    Seed seed;
+    seed.fill(3u);
+    std::vector<std::vector<uint8_t> > buffers;
+    buffers.emplace_back(1024u * 1024u, 0u);
+    buffers.emplace_back(100u, 0u);
+    buffers.emplace_back(200000u, 0u);
+    std::atomic<unsigned> completed{0u};
+    {
+        RandomBufferAgent agent{
+                std::make_shared<ChaCha20RandomEngine>(seed.data()),
+                4096u};
+        for (auto & buffer : buffers)
+            agent.fillBytesAsync(buffer.data(),
+                                 buffer.size(),
+                                 [&completed]() noexcept { ++completed; });
+
+        std::array<uint8_t, 1000u> buf;
+        for (unsigned i = 0u; i < 100u; ++i)
+            agent.fillBytes(buf.data(), buf.size());
+
+        auto const deadline =
+                std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (completed.load() < buffers.size()
+               && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::yield();
+        SHAREMIND_TESTASSERT(completed.load() == buffers.size());
+
+        SharemindRandomEngineStats stats;
+        agent.getStats(stats);
+        SHAREMIND_TESTASSERT(stats.fillRequests == buffers.size() + 100u);
+
+        // Pending requests are completed on destruction:
+        agent.fillBytesAsync(buffers[0u].data(),
+                             buffers[0u].size(),
+                             [&completed]() noexcept { ++completed; });
+    }
+    SHAREMIND_TESTASSERT(completed.load() == buffers.size() + 1u);
+    for (auto const & buffer : buffers)
+        SHAREMIND_TESTASSERT(std::any_of(buffer.begin(),
+                                         buffer.end(),
+                                         [](uint8_t const v) { return v; }));
+}
+
+// Reserving ahead of a round must grow an adaptive buffer to hold the round,
+// keeping the stream intact. The time the consumer spends in the rounds is
+// reported with and without the hint:
+void testReserve() {
+    Seed seed;
+    seed.fill(11u);
+    constexpr std::size_t minSize = 64u * 1024u;
+    constexpr std::size_t maxSize = 32u * 1024u * 1024u;
+    constexpr std::size_t roundSize = 16u * 1024u * 1024u;
+    constexpr unsigned rounds = 8u;
+    // The time between rounds, e.g. waiting for the messages of other parties:
+    constexpr std::chrono::milliseconds idle{40};
+
+    std::vector<uint8_t> expected(roundSize);
+    std::vector<uint8_t> actual(roundSize);
+    for (bool const hint : { false, true }) {
+        ChaCha20RandomEngine reference{seed.data()};
+        RandomBufferAgent agent{
+                std::make_shared<ChaCha20RandomEngine>(seed.data()),
+                maxSize,
+                RandomBufferAgent::NoNumaNode,
+                0u,
+                minSize};
+        std::chrono::nanoseconds busy{0};
+        for (unsigned i = 0u; i < rounds; ++i) {
+            if (hint)
+                agent.reserve(roundSize, std::chrono::seconds(10));
+            std::this_thread::sleep_for(idle);
+            auto const start = std::chrono::steady_clock::now();
+            agent.fillBytes(actual.data(), actual.size());
+            busy += std::chrono::steady_clock::now() - start;
+            reference.fillBytes(expected.data(), expected.size());
+            SHAREMIND_TESTASSERT(expected == actual);
+        }
+        if (hint)
+            SHAREMIND_TESTASSERT(agent.bufferSize() >= roundSize);
+
+        SharemindRandomEngineStats stats;
+        agent.getStats(stats);
+        std::cout << (hint ? "reserve" : "no hint") << ": "
+                  << std::chrono::duration<double, std::milli>(busy).count()
+                     / rounds
+                  << " ms per round, " << stats.consumerStalls
+                  << " stalls" << std::endl;
+    }
+}
+
+int main() {
+    testSameStream(1u, 0u);
+    testSameStream(4096u, 0u);
+    testSameStream(100000u, 0u);
+    testSameStream(100000u,
+                   SHAREMIND_RANDOM_BUFFER_HUGE_PAGES
+                   | SHAREMIND_RANDOM_BUFFER_LOCKED
+                   | SHAREMIND_RANDOM_BUFFER_NO_DUMP);
+    testAdaptiveBounds();
+    testAdaptiveGrowth();
+    testAdaptedTargetSize();
+    testStats();
+    testAsync();
+    testReserve();
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/AesRandomEngine.h"
+#include "../src/ChaCha20RandomEngine.h"
+#include "../src/RandomBufferAgent.h"
+#include "../src/RandomFacility.h"
+#include "../src/Snow2RandomEngine.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <sharemind/TestAssert.h>
+#include <vector>
+
+
+using namespace sharemind;
+
+namespace {
+
+template <typename T>
+std::vector<T> data(std::size_t const count) {
+    std::vector<T> r(count);
+    for (std::size_t i = 0u; i < count; ++i)
+        r[i] = static_cast<T>(i * 0x9e3779b97f4a7c15u);
+    return r;
+}
+
+/* Combining must give the same result as fillBytes followed by a separate
+   loop, also when elements straddle the internal blocks of the engine: */
+template <typename T>
+void testOps(RandomEngine & engine, RandomEngine & reference) {
+    for (std::size_t const count : {0u, 1u, 7u, 100u, 1001u}) {
+        // Misalign the stream relative to the internal blocks:
+        uint8_t skip[3u];
+        engine.fillBytes(skip, sizeof(skip));
+        reference.fillBytes(skip, sizeof(skip));
+
+        auto const original = data<T>(count);
+        std::vector<T> mask(count);
+
+        auto x = original;
+        engine.addInto(x.data(), x.data() + count);
+        reference.fillBlock(mask.data(), mask.data() + count);
+        for (std::size_t i = 0u; i < count; ++i)
+            SHAREMIND_TESTASSERT(x[i] == static_cast<T>(original[i] + mask[i]));
+
+        x = original;
+        engine.subFrom(x.data(), x.data() + count);
+        reference.fillBlock(mask.data(), mask.data() + count);
+        for (std::size_t i = 0u; i < count; ++i)
+            SHAREMIND_TESTASSERT(x[i] == static_cast<T>(original[i] - mask[i]));
+
+        x = original;
+        engine.xorBytesInto(x.data(), count * sizeof(T));
+        reference.fillBlock(mask.data(), mask.data() + count);
+        for (std::size_t i = 0u; i < count; ++i)
+            SHAREMIND_TESTASSERT(x[i] == (original[i] ^ mask[i]));
+    }
+}
+
+template <typename Engine>
+void testEngine() {
+    std::vector<uint8_t> seed(Engine::seedSize());
+    for (std::size_t i = 0u; i < seed.size(); ++i)
+        seed[i] = static_cast<uint8_t>(i * 3u);
+    Engine engine(seed.data());
+    Engine reference(seed.data());
+    testOps<uint8_t>(engine, reference);
+    testOps<uint16_t>(engine, reference);
+    testOps<uint32_t>(engine, reference);
+    testOps<uint64_t>(engine, reference);
+
+    // Combining from a buffered engine:
+    RandomBufferAgent buffered{std::make_shared<Engine>(seed.data()), 1000u};
+    Engine bufferedReference(seed.data());
+    testOps<uint64_t>(buffered, bufferedReference);
+    testOps<uint16_t>(buffered, bufferedReference);
+}
+
+struct ChaCha20: ChaCha20RandomEngine {
+    using ChaCha20RandomEngine::ChaCha20RandomEngine;
+    static std::size_t seedSize() noexcept { return SeedSize; }
+};
+
+struct Snow2: Snow2RandomEngine {
+    using Snow2RandomEngine::Snow2RandomEngine;
+    static std::size_t seedSize() noexcept { return SeedSize; }
+};
+
+// Invalid element sizes through the C interface must change nothing:
+void testInvalidElementSize() {
+    SharemindRandomEngineConf conf = {};
+    conf.coreEngine = SHAREMIND_RANDOM_CHACHA20;
+    RandomFacility facility(conf);
+    std::vector<uint8_t> seed(ChaCha20RandomEngine::SeedSize, 5u);
+    auto const rng(facility.createRandomEngineWithSeed(conf,
+                                                       seed.data(),
+                                                       seed.size()));
+    auto const original(data<uint8_t>(24u));
+    auto x(original);
+    for (std::size_t const elementSize : { 0u, 3u, 16u }) {
+        rng->addInto(rng.get(), x.data(), x.size(), elementSize);
+        rng->subFrom(rng.get(), x.data(), x.size(), elementSize);
+    }
+    rng->addInto(rng.get(), x.data(), 6u, 4u);
+    SHAREMIND_TESTASSERT(x == original);
+
+    // No randomness was consumed:
+    std::array<uint8_t, 16u> expected;
+    std::array<uint8_t, 16u> actual;
+    ChaCha20RandomEngine(seed.data()).fillBytes(expected.data(),
+                                                expected.size());
+    rng->fillBytes(rng.get(), actual.data(), actual.size());
+    SHAREMIND_TESTASSERT(actual == expected);
+}
+
+} // anonymous namespace
+
+int main() {
+    testEngine<ChaCha20>();
+    testEngine<Snow2>();
+    testEngine<AesRandomEngine>();
+    testInvalidElementSize();
+    return 0;
+}
@@ -0,0 +1,365 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/*
+ * Differential test of the code paths of every core engine: the stream of
+ * every path is generated with randomized request sizes biased towards the
+ * block and buffer boundaries of the engines, and must be byte-identical to
+ * the stream generated with a single request. The throughput of every path is
+ * reported as well.
+ *
+ * The paths are the SIMD kernels of ChaCha20 up to the level of the host,
+ * fillBytes, fillBytesV, fillBytesAsync interleaved with fillBytes, and
+ * combineInto on the unbuffered, thread-buffered and reservoir engines. The
+ * thread-buffered engines are also placed with the NUMA policies.
+ * fillBytesV is also tested through the C interface.
+ *
+ * By default every stream is DefaultMiB MiB long and the request sizes are
+ * drawn using a fixed seed. Both can be given as arguments, e.g.
+ *
+ *     TestRandomDifferential 1024 42
+ */
+
+#include "../src/RandomEngineFactory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <random>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <sys/uio.h>
+#include <thread>
+#include <vector>
+#include "../src/ChaCha20RandomEngine.h"
+#include "../src/CpuFeatures.h"
+#include "../src/NumaTopology.h"
+#include "../src/RandomEngine.h"
+#include "../src/RandomEngineFacade.h"
+#include "../src/RandomFacility.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+constexpr std::size_t const DefaultMiB = 4u;
+constexpr std::uint64_t const DefaultSizeSeed = 20151u;
+
+enum class Method { Fill, FillV, FillAsync, Xor, Add };
+
+struct Path {
+    std::string name;
+    std::function<std::shared_ptr<RandomEngine> ()> create;
+    Method method;
+};
+
+/** Generates request sizes, many of them around the boundaries of blocks. */
+class RequestSizes {
+
+public: /* Methods: */
+
+    explicit RequestSizes(std::uint64_t const seed) : m_rng(seed) {}
+
+    std::size_t next() {
+        static std::size_t const boundaries[] = {
+            16u, 64u, 256u, 1024u, 4096u, 65536u };
+        switch (m_rng() % 4u) {
+        case 0u:
+            return m_rng() % 17u;
+        case 1u: {
+            auto const b = boundaries[m_rng() % (sizeof(boundaries)
+                                                 / sizeof(boundaries[0u]))];
+            return b - 1u + m_rng() % 3u;
+        }
+        case 2u:
+            return m_rng() % 4096u;
+        default:
+            return m_rng() % 200000u;
+        }
+    }
+
+private: /* Fields: */
+
+    std::mt19937_64 m_rng;
+
+};
+
+void replay(RandomEngine & engine,
+            Method const method,
+            std::uint8_t * out,
+            std::size_t size,
+            std::uint64_t const sizeSeed)
+{
+    RequestSizes sizes(sizeSeed);
+    std::atomic<std::size_t> pending{0u};
+    std::size_t requests = 0u;
+    while (size > 0u) {
+        auto n = std::min(sizes.next(), size);
+        switch (method) {
+        case Method::Fill:
+            engine.fillBytes(out, n);
+            break;
+        case Method::FillV: {
+            // Split the request into three buffers, the first possibly empty:
+            struct iovec iov[3u];
+            iov[0u].iov_base = out;
+            iov[0u].iov_len = n / 3u;
+            iov[1u].iov_base = out + n / 3u;
+            iov[1u].iov_len = n / 2u - n / 3u;
+            iov[2u].iov_base = out + n / 2u;
+            iov[2u].iov_len = n - n / 2u;
+            engine.fillBytesV(iov, 3u);
+            break;
+        }
+        case Method::FillAsync:
+            // Every other request is synchronous, ordered after the others:
+            if (++requests % 2u) {
+                ++pending;
+                engine.fillBytesAsync(out,
+                                      n,
+                                      [&pending]() noexcept { --pending; });
+            } else {
+                engine.fillBytes(out, n);
+            }
+            break;
+        case Method::Xor:
+            std::fill(out, out + n, 0u);
+            engine.combineInto(out, n, RandomCombineOp::Xor, 1u);
+            break;
+        case Method::Add:
+            n -= n % 8u;
+            if (n == 0u)
+                n = std::min<std::size_t>(8u, size);
+            std::fill(out, out + n, 0u);
+            // Zero plus the random elements gives the random elements:
+            engine.combineInto(out, n, RandomCombineOp::Add, 8u);
+            break;
+        }
+        out += n;
+        size -= n;
+    }
+    while (pending.load() > 0u)
+        std::this_thread::yield();
+}
+
+std::shared_ptr<RandomEngine> createEngine(
+        SharemindCoreRandomEngineKind const kind,
+        SharemindRandomEngineBufferingMode const mode,
+        std::vector<std::uint8_t> const & seed,
+        SharemindRandomEngineNumaPolicy const numaPolicy =
+                SHAREMIND_RANDOM_NUMA_NONE)
+{
+    SharemindRandomEngineConf conf = {};
+    conf.coreEngine = kind;
+    conf.bufferMode = mode;
+    conf.numaPolicy = numaPolicy;
+    conf.numaNode = NumaTopology::instance().nodes().front();
+    // Reservoirs are meant to stay in the L1 or L2 cache:
+    conf.bufferSize = (mode == SHAREMIND_RANDOM_BUFFERING_RESERVOIR)
+                      ? 16u * 1024u
+                      : 256u * 1024u;
+    conf.minBufferSize = 4096u;
+    return RandomEngineFactory::createRandomEngineWithSeed(conf,
+                                                           seed.data(),
+                                                           seed.size());
+}
+
+void testKind(char const * const kindName,
+              SharemindCoreRandomEngineKind const kind,
+              std::size_t const size,
+              std::uint64_t const sizeSeed)
+{
+    std::vector<std::uint8_t> seed(RandomEngineFactory::getSeedSize(kind));
+    for (std::size_t i = 0u; i < seed.size(); ++i)
+        seed[i] = static_cast<std::uint8_t>(i * 13u + 5u);
+
+    std::vector<Path> paths;
+    if (kind == SHAREMIND_RANDOM_CHACHA20) {
+        auto const host = CpuFeatures::instance().level();
+        for (auto const level : { CpuFeatures::Level::Generic,
+                                  CpuFeatures::Level::Sse2,
+                                  CpuFeatures::Level::Ssse3,
+                                  CpuFeatures::Level::Avx2,
+                                  CpuFeatures::Level::Avx512 })
+        {
+            if (level > host)
+                break;
+            paths.push_back(Path{
+                    std::string("kernel-") + CpuFeatures::levelName(level),
+                    [level, &seed]() {
+                        return std::make_shared<ChaCha20RandomEngine>(
+                                    seed.data(),
+                                    level);
+                    },
+                    Method::Fill});
+        }
+    }
+    struct ModeInfo {
+        char const * name;
+        SharemindRandomEngineBufferingMode mode;
+        SharemindRandomEngineNumaPolicy numaPolicy;
+    };
+    std::vector<ModeInfo> modes{
+        { "none", SHAREMIND_RANDOM_BUFFERING_NONE, SHAREMIND_RANDOM_NUMA_NONE },
+        { "thread",
+          SHAREMIND_RANDOM_BUFFERING_THREAD,
+          SHAREMIND_RANDOM_NUMA_NONE },
+        { "thread-numa-node",
+          SHAREMIND_RANDOM_BUFFERING_THREAD,
+          SHAREMIND_RANDOM_NUMA_NODE },
+        { "adaptive",
+          SHAREMIND_RANDOM_BUFFERING_ADAPTIVE_THREAD,
+          SHAREMIND_RANDOM_NUMA_NONE },
+        { "reservoir",
+          SHAREMIND_RANDOM_BUFFERING_RESERVOIR,
+          SHAREMIND_RANDOM_NUMA_NONE } };
+    /* Replicas on several nodes are seeded from the core engine, hence they
+       only continue its stream on single node hosts: */
+    if (NumaTopology::instance().nodes().size() <= 1u)
+        modes.push_back({ "thread-numa-replicate",
+                          SHAREMIND_RANDOM_BUFFERING_THREAD,
+                          SHAREMIND_RANDOM_NUMA_REPLICATE });
+    for (auto const & mode : modes) {
+        auto const create = [kind, mode, &seed]() {
+            return createEngine(kind, mode.mode, seed, mode.numaPolicy);
+        };
+        std::string const name(mode.name);
+        paths.push_back(Path{ name + "-fill", create, Method::Fill });
+        paths.push_back(Path{ name + "-fillv", create, Method::FillV });
+        paths.push_back(Path{ name + "-xor", create, Method::Xor });
+        paths.push_back(Path{ name + "-add", create, Method::Add });
+        paths.push_back(Path{ name + "-async", create, Method::FillAsync });
+    }
+
+    std::vector<std::uint8_t> expected(size);
+    createEngine(kind, SHAREMIND_RANDOM_BUFFERING_NONE, seed)->fillBytes(
+                expected.data(),
+                expected.size());
+
+    std::vector<std::uint8_t> actual(size);
+    for (auto const & path : paths) {
+        auto const engine(path.create());
+        std::fill(actual.begin(), actual.end(), 0u);
+        auto const start = std::chrono::steady_clock::now();
+        replay(*engine, path.method, actual.data(), actual.size(), sizeSeed);
+        auto const seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count();
+
+        auto const mismatch =
+                std::mismatch(expected.begin(), expected.end(), actual.begin());
+        if (mismatch.first != expected.end())
+            std::cerr << kindName << '/' << path.name
+                      << ": streams differ at offset "
+                      << (mismatch.first - expected.begin()) << std::endl;
+        SHAREMIND_TESTASSERT(mismatch.first == expected.end());
+        std::cout << kindName << '/' << path.name << ": "
+                  << static_cast<double>(size) / (1024.0 * 1024.0)
+                     / std::max(seconds, 1e-9)
+                  << " MiB/s" << std::endl;
+    }
+}
+
+/* Rounding a reservoir size near SIZE_MAX up to the alignment must not wrap
+   around to a tiny reservoir: */
+void testHugeReservoir() {
+    std::vector<std::uint8_t> seed(
+                RandomEngineFactory::getSeedSize(SHAREMIND_RANDOM_CHACHA20));
+    SharemindRandomEngineConf conf = {};
+    conf.coreEngine = SHAREMIND_RANDOM_CHACHA20;
+    conf.bufferMode = SHAREMIND_RANDOM_BUFFERING_RESERVOIR;
+    for (auto const size : { std::numeric_limits<std::size_t>::max(),
+                             std::numeric_limits<std::size_t>::max() - 1u })
+    {
+        conf.bufferSize = size;
+        bool thrown = false;
+        try {
+            RandomEngineFactory::createRandomEngineWithSeed(conf,
+                                                            seed.data(),
+                                                            seed.size());
+        } catch (std::bad_alloc const &) {
+            thrown = true;
+        }
+        SHAREMIND_TESTASSERT(thrown);
+    }
+}
+
+/* fillBytesV and reserve through the C interface, from a thread-buffered
+   engine: */
+void testCInterface(std::size_t const size, std::uint64_t const sizeSeed) {
+    SharemindRandomEngineConf conf = {};
+    conf.coreEngine = SHAREMIND_RANDOM_CHACHA20;
+    conf.bufferMode = SHAREMIND_RANDOM_BUFFERING_THREAD;
+    conf.bufferSize = 256u * 1024u;
+    RandomFacility facility(conf);
+    std::vector<std::uint8_t> seed(ChaCha20RandomEngine::SeedSize, 7u);
+    auto const rng(facility.createRandomEngineWithSeed(conf,
+                                                       seed.data(),
+                                                       seed.size()));
+    RandomEngineFacade facade(rng.get());
+
+    std::vector<std::uint8_t> expected(size);
+    ChaCha20RandomEngine(seed.data()).fillBytes(expected.data(),
+                                                expected.size());
+
+    // The hint must not change the stream:
+    facade.reserve(size, 1000000000u);
+
+    // Many small buffers per call, as in a serialized message:
+    std::vector<std::uint8_t> actual(size);
+    RequestSizes sizes(sizeSeed);
+    std::vector<struct iovec> iov;
+    for (std::size_t offset = 0u; offset < size;) {
+        iov.clear();
+        for (std::size_t i = 0u; i < 64u && offset < size; ++i) {
+            auto const n = std::min(sizes.next() % 64u, size - offset);
+            iov.push_back(iovec{ &actual[offset], n });
+            offset += n;
+        }
+        facade.fillBytesV(iov.data(), iov.size());
+    }
+    SHAREMIND_TESTASSERT(actual == expected);
+}
+
+} // anonymous namespace
+
+int main(int argc, char * argv[]) {
+    std::size_t mib = DefaultMiB;
+    std::uint64_t sizeSeed = DefaultSizeSeed;
+    if (argc > 1) {
+        mib = std::strtoul(argv[1], nullptr, 10);
+        SHAREMIND_TESTASSERT(mib > 0u);
+    }
+    if (argc > 2)
+        sizeSeed = std::strtoull(argv[2], nullptr, 10);
+
+    auto const size = mib * 1024u * 1024u;
+    testKind("chacha20", SHAREMIND_RANDOM_CHACHA20, size, sizeSeed);
+    testKind("aes", SHAREMIND_RANDOM_AES, size, sizeSeed);
+    testKind("snow2", SHAREMIND_RANDOM_SNOW2, size, sizeSeed);
+    testCInterface(size, sizeSeed);
+    testHugeReservoir();
+}
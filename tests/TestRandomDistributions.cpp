@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+
+#include "../src/RandomEngine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <sharemind/TestAssert.h>
+#include <vector>
+#include "../src/ChaCha20RandomEngine.h"
+#include "../src/CpuFeatures.h"
+#include "../src/NormalKernels.h"
+#include "../src/RandomEngineFacade.h"
+#include "../src/RandomFacility.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+constexpr std::size_t const NormalCount = 1u << 20u;
+
+/* The bound on the absolute z-scores of the moment tests: */
+constexpr double const MaxZ = 6.0;
+
+std::vector<std::uint8_t> testSeed(std::uint8_t const salt) {
+    std::vector<std::uint8_t> seed(ChaCha20RandomEngine::SeedSize);
+    for (std::size_t i = 0u; i < seed.size(); ++i)
+        seed[i] = static_cast<std::uint8_t>(i * 7u + salt);
+    return seed;
+}
+
+void testUniform() {
+    auto const seed(testSeed(1u));
+    for (std::size_t const count : {0u, 1u, 5u, 1000u, 65537u}) {
+        ChaCha20RandomEngine engine(seed.data());
+        ChaCha20RandomEngine reference(seed.data());
+        std::vector<double> d(count);
+        std::vector<std::uint64_t> words(count);
+        engine.fillUniformDouble(d.data(), count);
+        reference.fillBlock(words.data(), words.data() + count);
+        for (std::size_t i = 0u; i < count; ++i) {
+            SHAREMIND_TESTASSERT(d[i] >= 0.0 && d[i] < 1.0);
+            SHAREMIND_TESTASSERT(
+                    d[i] == std::ldexp(static_cast<double>(words[i] >> 11u),
+                                       -53));
+        }
+
+        std::vector<float> f(count);
+        std::vector<std::uint32_t> halves(count);
+        engine.fillUniformFloat(f.data(), count);
+        reference.fillBlock(halves.data(), halves.data() + count);
+        for (std::size_t i = 0u; i < count; ++i) {
+            SHAREMIND_TESTASSERT(f[i] >= 0.0f && f[i] < 1.0f);
+            SHAREMIND_TESTASSERT(
+                    f[i] == std::ldexp(static_cast<float>(halves[i] >> 8u),
+                                       -24));
+        }
+    }
+}
+
+/* The kernels must agree bit for bit, including on the rejected words: */
+void testKernels() {
+    auto const seed(testSeed(2u));
+    ChaCha20RandomEngine engine(seed.data());
+    std::vector<std::uint64_t> words(4099u);
+    engine.fillBlock(words.data(), words.data() + words.size());
+    // Extreme samples, including INT32_MIN, in every layer:
+    for (std::size_t i = 0u; i < 256u; ++i)
+        words[i] = (static_cast<std::uint64_t>(
+                        (i % 2u) ? 0x80000000u : 0x7fffffffu) << 32u) | i;
+
+    std::vector<double> expected(words.size());
+    std::memcpy(expected.data(), words.data(), words.size() * sizeof(double));
+    std::vector<std::uint32_t> expectedRejected(words.size());
+    auto const n = normalKernelGeneric(expected.data(),
+                                       expected.size(),
+                                       expectedRejected.data());
+    SHAREMIND_TESTASSERT(n >= 256u);
+    SHAREMIND_TESTASSERT(n < words.size() / 10u);
+
+    for (auto const level : { CpuFeatures::Level::Sse2,
+                              CpuFeatures::Level::Ssse3,
+                              CpuFeatures::Level::Avx2,
+                              CpuFeatures::Level::Avx512 })
+    {
+        if (level > CpuFeatures::instance().level())
+            break;
+        std::vector<double> actual(words.size());
+        std::memcpy(actual.data(), words.data(), words.size() * sizeof(double));
+        std::vector<std::uint32_t> rejected(words.size());
+        SHAREMIND_TESTASSERT(normalKernel(level)(actual.data(),
+                                                 actual.size(),
+                                                 rejected.data()) == n);
+        SHAREMIND_TESTASSERT(std::memcmp(actual.data(),
+                                         expected.data(),
+                                         words.size() * sizeof(double)) == 0);
+        SHAREMIND_TESTASSERT(std::memcmp(rejected.data(),
+                                         expectedRejected.data(),
+                                         n * sizeof(std::uint32_t)) == 0);
+    }
+}
+
+void testNormalMoments() {
+    auto const seed(testSeed(3u));
+    ChaCha20RandomEngine engine(seed.data());
+    std::vector<double> x(NormalCount);
+    auto const start = std::chrono::steady_clock::now();
+    engine.fillNormal(x.data(), x.size());
+    auto const seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+    std::cout << "fillNormal: "
+              << static_cast<double>(x.size()) / std::max(seconds, 1e-9) / 1e6
+              << " M values/s" << std::endl;
+
+    double sum = 0.0;
+    double sum2 = 0.0;
+    double sum4 = 0.0;
+    std::size_t beyondR = 0u;
+    std::size_t withinOne = 0u;
+    for (auto const v : x) {
+        SHAREMIND_TESTASSERT(std::isfinite(v));
+        sum += v;
+        sum2 += v * v;
+        sum4 += v * v * v * v;
+        beyondR += (std::fabs(v) > ZigguratR);
+        withinOne += (std::fabs(v) < 1.0);
+    }
+    auto const n = static_cast<double>(x.size());
+    auto const zScore = [n](double const observed,
+                            double const expected,
+                            double const variance)
+            { return (observed - expected) / std::sqrt(variance / n); };
+    // The variances of z, z^2 and z^4 are 1, 2 and 105 - 9:
+    SHAREMIND_TESTASSERT(std::fabs(zScore(sum / n, 0.0, 1.0)) < MaxZ);
+    SHAREMIND_TESTASSERT(std::fabs(zScore(sum2 / n, 1.0, 2.0)) < MaxZ);
+    SHAREMIND_TESTASSERT(std::fabs(zScore(sum4 / n, 3.0, 96.0)) < MaxZ);
+
+    // The tail and the layers:
+    auto const sqrt2 = std::sqrt(2.0);
+    for (auto const & p : { std::make_pair(beyondR,
+                                           std::erfc(ZigguratR / sqrt2)),
+                            std::make_pair(withinOne, std::erf(1.0 / sqrt2)) })
+    {
+        auto const observed = static_cast<double>(p.first) / n;
+        SHAREMIND_TESTASSERT(
+                std::fabs(zScore(observed, p.second, p.second * (1 - p.second)))
+                < MaxZ);
+    }
+}
+
+void testNormalReproducible() {
+    auto const seed(testSeed(4u));
+    ChaCha20RandomEngine a(seed.data());
+    ChaCha20RandomEngine b(seed.data(), CpuFeatures::Level::Generic);
+    for (std::size_t const count : {0u, 1u, 3u, 1023u, 1024u, 1025u, 50000u}) {
+        std::vector<double> x(count);
+        std::vector<double> y(count);
+        a.fillNormal(x.data(), count);
+        b.fillNormal(y.data(), count, 5.0, 2.0);
+        for (std::size_t i = 0u; i < count; ++i)
+            SHAREMIND_TESTASSERT(y[i] == 5.0 + 2.0 * x[i]);
+    }
+}
+
+/**
+ * \brief Checks the frequencies of the values in [-limit, limit] and the
+ *        variance of the given samples against the given probabilities of the
+ *        absolute values, and prints the throughput.
+ */
+void checkDiscrete(char const * const name,
+                   std::vector<std::int64_t> const & x,
+                   double const seconds,
+                   std::vector<double> const & pAbs)
+{
+    std::cout << name << ": "
+              << static_cast<double>(x.size()) / std::max(seconds, 1e-9) / 1e6
+              << " M values/s" << std::endl;
+    auto const n = static_cast<double>(x.size());
+    auto const limit = static_cast<std::int64_t>(pAbs.size()) - 1;
+    std::vector<double> observed(pAbs.size());
+    double sum2 = 0.0;
+    for (auto const v : x) {
+        if (v >= -limit && v <= limit)
+            ++observed[static_cast<std::size_t>(std::llabs(v))];
+        sum2 += static_cast<double>(v) * static_cast<double>(v);
+    }
+    for (std::size_t i = 0u; i < pAbs.size(); ++i) {
+        auto const p = pAbs[i];
+        // The normal approximation only holds for frequent values:
+        if (n * p < 100.0 && n * p > 0.0)
+            continue;
+        if (p * (1.0 - p) <= 0.0) {
+            SHAREMIND_TESTASSERT(observed[i] == n * p);
+        } else {
+            SHAREMIND_TESTASSERT(std::fabs(observed[i] - n * p)
+                                 / std::sqrt(n * p * (1.0 - p)) < MaxZ);
+        }
+    }
+    // The variance, by the distribution of the absolute values far enough:
+    double variance = 0.0;
+    double fourth = 0.0;
+    for (std::size_t i = 0u; i < pAbs.size(); ++i) {
+        auto const z2 = static_cast<double>(i) * static_cast<double>(i);
+        variance += z2 * pAbs[i];
+        fourth += z2 * z2 * pAbs[i];
+    }
+    auto const spread = std::sqrt((fourth - variance * variance) / n);
+    if (spread <= 0.0) {
+        SHAREMIND_TESTASSERT(sum2 / n == variance);
+    } else {
+        SHAREMIND_TESTASSERT(std::fabs(sum2 / n - variance) / spread < MaxZ);
+    }
+}
+
+template <typename F>
+double timed(F && f) {
+    auto const start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+}
+
+void testDiscreteLaplace() {
+    auto const seed(testSeed(6u));
+    ChaCha20RandomEngine engine(seed.data());
+    for (auto const & scale : { std::make_pair(1u, 1u),
+                                std::make_pair(7u, 3u),
+                                std::make_pair(100u, 1u) })
+    {
+        std::vector<std::int64_t> x(1u << 18u);
+        auto const seconds = timed([&engine, &x, &scale]() {
+            engine.fillDiscreteLaplace(x.data(),
+                                       x.size(),
+                                       scale.first,
+                                       scale.second);
+        });
+        auto const q = std::exp(-static_cast<double>(scale.second)
+                                / static_cast<double>(scale.first));
+        std::vector<double> pAbs(200u * scale.first / scale.second + 1u);
+        pAbs[0u] = (1.0 - q) / (1.0 + q);
+        for (std::size_t i = 1u; i < pAbs.size(); ++i)
+            pAbs[i] = 2.0 * pAbs[0u] * std::pow(q, static_cast<double>(i));
+        std::string const name("discreteLaplace("
+                               + std::to_string(scale.first) + '/'
+                               + std::to_string(scale.second) + ')');
+        checkDiscrete(name.c_str(), x, seconds, pAbs);
+    }
+
+    // The tiniest scale gives zeros:
+    std::vector<std::int64_t> x(1000u, 1);
+    engine.fillDiscreteLaplace(x.data(), x.size(), 1u, 0xffffffffu);
+    for (auto const v : x)
+        SHAREMIND_TESTASSERT(v == 0);
+}
+
+void testDiscreteGaussian() {
+    auto const seed(testSeed(7u));
+    ChaCha20RandomEngine engine(seed.data());
+    for (auto const & variance : { std::make_pair(1u, 1u),
+                                   std::make_pair(10u, 3u),
+                                   std::make_pair(1u, 0xffffffffu),
+                                   std::make_pair(0xffffffffu, 1u) })
+    {
+        std::vector<std::int64_t> x(1u << 18u);
+        auto const seconds = timed([&engine, &x, &variance]() {
+            engine.fillDiscreteGaussian(x.data(),
+                                        x.size(),
+                                        variance.first,
+                                        variance.second);
+        });
+        auto const s = static_cast<double>(variance.first)
+                       / static_cast<double>(variance.second);
+        std::vector<double> pAbs(
+                    static_cast<std::size_t>(40.0 * std::sqrt(s)) + 2u);
+        double total = 0.0;
+        for (std::size_t i = 0u; i < pAbs.size(); ++i) {
+            auto const z = static_cast<double>(i);
+            pAbs[i] = ((i == 0u) ? 1.0 : 2.0) * std::exp(-z * z / (2.0 * s));
+            total += pAbs[i];
+        }
+        for (auto & p : pAbs)
+            p /= total;
+        std::string const name("discreteGaussian("
+                               + std::to_string(variance.first) + '/'
+                               + std::to_string(variance.second) + ')');
+        checkDiscrete(name.c_str(), x, seconds, pAbs);
+    }
+}
+
+void testDiscreteInvalid() {
+    auto const seed(testSeed(8u));
+    ChaCha20RandomEngine engine(seed.data());
+    std::int64_t x[4u];
+    for (auto const & p : { std::make_pair(0u, 1u), std::make_pair(1u, 0u) })
+    {
+        bool thrown = false;
+        try {
+            engine.fillDiscreteLaplace(x, 4u, p.first, p.second);
+        } catch (RandomEngine::InvalidParameterException const &) {
+            thrown = true;
+        }
+        SHAREMIND_TESTASSERT(thrown);
+        thrown = false;
+        try {
+            engine.fillDiscreteGaussian(x, 4u, p.first, p.second);
+        } catch (RandomEngine::InvalidParameterException const &) {
+            thrown = true;
+        }
+        SHAREMIND_TESTASSERT(thrown);
+    }
+}
+
+void testFacade() {
+    RandomFacility facility(SharemindRandomEngineConf{
+                                SHAREMIND_RANDOM_CHACHA20,
+                                SHAREMIND_RANDOM_BUFFERING_THREAD,
+                                64u * 1024u,
+                                SHAREMIND_RANDOM_NUMA_NONE,
+                                0u,
+                                0u,
+                                0u,
+                                nullptr,
+                                nullptr});
+    auto const seed(testSeed(5u));
+    auto const rng(facility.createRandomEngineWithSeed(
+                       facility.defaultFactoryConfiguration(),
+                       seed.data(),
+                       seed.size()));
+    RandomEngineFacade facade(rng.get());
+    ChaCha20RandomEngine reference(seed.data());
+
+    std::vector<double> d(3000u);
+    std::vector<double> expectedD(d.size());
+    facade.fillUniformDouble(d.data(), d.size());
+    reference.fillUniformDouble(expectedD.data(), expectedD.size());
+    SHAREMIND_TESTASSERT(d == expectedD);
+
+    std::vector<float> f(3000u);
+    std::vector<float> expectedF(f.size());
+    facade.fillUniformFloat(f.data(), f.size());
+    reference.fillUniformFloat(expectedF.data(), expectedF.size());
+    SHAREMIND_TESTASSERT(f == expectedF);
+
+    facade.fillNormal(d.data(), d.size(), -1.0, 0.5);
+    reference.fillNormal(expectedD.data(), expectedD.size(), -1.0, 0.5);
+    SHAREMIND_TESTASSERT(d == expectedD);
+
+    std::vector<std::int64_t> z(3000u);
+    std::vector<std::int64_t> expectedZ(z.size());
+    SHAREMIND_TESTASSERT(facade.fillDiscreteLaplace(z.data(), z.size(), 5u)
+                         == SHAREMIND_RANDOM_OK);
+    reference.fillDiscreteLaplace(expectedZ.data(), expectedZ.size(), 5u);
+    SHAREMIND_TESTASSERT(z == expectedZ);
+    SHAREMIND_TESTASSERT(facade.fillDiscreteGaussian(z.data(), z.size(), 9u, 2u)
+                         == SHAREMIND_RANDOM_OK);
+    reference.fillDiscreteGaussian(expectedZ.data(), expectedZ.size(), 9u, 2u);
+    SHAREMIND_TESTASSERT(z == expectedZ);
+    SHAREMIND_TESTASSERT(facade.fillDiscreteGaussian(z.data(), z.size(), 0u)
+                         == SHAREMIND_RANDOM_INVALID_PARAMETERS);
+}
+
+} // anonymous namespace
+
+int main() {
+    testUniform();
+    testKernels();
+    testNormalMoments();
+    testNormalReproducible();
+    testDiscreteLaplace();
+    testDiscreteGaussian();
+    testDiscreteInvalid();
+    testFacade();
+}
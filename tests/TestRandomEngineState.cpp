@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/RandomEngineFactory.h"
+
+#include <cstdint>
+#include <memory>
+#include <sharemind/TestAssert.h>
+#include <vector>
+#include "../src/RandomEngine.h"
+#include "../src/RandomEngineFacade.h"
+#include "../src/RandomFacility.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+SharemindRandomEngineConf conf(
+        SharemindCoreRandomEngineKind const kind,
+        SharemindRandomEngineBufferingMode const bufferMode =
+                SHAREMIND_RANDOM_BUFFERING_NONE)
+{
+    SharemindRandomEngineConf r = {};
+    r.coreEngine = kind;
+    r.bufferMode = bufferMode;
+    r.bufferSize = 4096u;
+    return r;
+}
+
+std::shared_ptr<RandomEngine> createEngine(
+        SharemindCoreRandomEngineKind const kind,
+        std::uint8_t const seedByte)
+{
+    std::vector<std::uint8_t> const seed(
+                RandomEngineFactory::getSeedSize(kind),
+                seedByte);
+    return RandomEngineFactory::createRandomEngineWithSeed(conf(kind),
+                                                           seed.data(),
+                                                           seed.size());
+}
+
+std::vector<std::uint8_t> generate(RandomEngine & engine,
+                                   std::size_t const size)
+{
+    std::vector<std::uint8_t> r(size);
+    engine.fillBytes(r.data(), r.size());
+    return r;
+}
+
+template <typename Exception, typename F>
+bool throws(F && f) {
+    try {
+        f();
+    } catch (Exception const &) {
+        return true;
+    }
+    return false;
+}
+
+void testKind(SharemindCoreRandomEngineKind const kind,
+              SharemindCoreRandomEngineKind const otherKind)
+{
+    for (std::size_t const offset : { 0u, 1u, 100u, 128u, 255u, 256u, 1000u,
+                                      1023u, 1024u, 1025u, 4097u, 100000u })
+    {
+        auto const engine(createEngine(kind, 1u));
+        generate(*engine, offset);
+        std::vector<std::uint8_t> state(engine->stateSize());
+        SHAREMIND_TESTASSERT(!state.empty());
+        engine->saveState(state.data());
+        auto const expected(generate(*engine, 5000u));
+
+        auto const restored(createEngine(kind, 2u));
+        restored->restoreState(state.data(), state.size());
+        SHAREMIND_TESTASSERT(generate(*restored, 5000u) == expected);
+
+        // Invalid states are rejected without modifying the engine:
+        auto const other(createEngine(kind, 3u));
+        auto const otherCopy(createEngine(kind, 3u));
+        generate(*other, offset);
+        generate(*otherCopy, offset);
+        SHAREMIND_TESTASSERT(throws<RandomEngine::InvalidStateException>(
+            [&]() { other->restoreState(state.data(), state.size() - 1u); }));
+        auto corrupted(state);
+        ++corrupted[0u];
+        SHAREMIND_TESTASSERT(throws<RandomEngine::InvalidStateException>(
+            [&]() { other->restoreState(corrupted.data(), corrupted.size()); }));
+        auto const otherKindEngine(createEngine(otherKind, 1u));
+        std::vector<std::uint8_t> otherState(otherKindEngine->stateSize());
+        otherKindEngine->saveState(otherState.data());
+        SHAREMIND_TESTASSERT(throws<RandomEngine::InvalidStateException>(
+            [&]() {
+                other->restoreState(otherState.data(), otherState.size());
+            }));
+        SHAREMIND_TESTASSERT(generate(*other, 1000u)
+                             == generate(*otherCopy, 1000u));
+    }
+}
+
+void testFacade() {
+    RandomFacility facility(conf(SHAREMIND_RANDOM_CHACHA20));
+    auto const & chachaConf = facility.defaultFactoryConfiguration();
+    std::vector<std::uint8_t> const seed(facility.getSeedSize(chachaConf), 1u);
+    auto const first(facility.createRandomEngineWithSeed(chachaConf,
+                                                         seed.data(),
+                                                         seed.size()));
+    auto const second(facility.createRandomEngineWithSeed(chachaConf,
+                                                          seed.data(),
+                                                          seed.size()));
+    RandomEngineFacade a(first.get());
+    RandomEngineFacade b(second.get());
+    a.randomValue<std::uint64_t>();
+
+    std::vector<std::uint8_t> state(a.stateSize());
+    SHAREMIND_TESTASSERT(a.saveState(state.data(), state.size() - 1u)
+                         == SHAREMIND_RANDOM_GENERAL_ERROR);
+    SHAREMIND_TESTASSERT(a.saveState(state.data(), state.size())
+                         == SHAREMIND_RANDOM_OK);
+    SHAREMIND_TESTASSERT(b.restoreState(state.data(), state.size() - 1u)
+                         == SHAREMIND_RANDOM_INVALID_STATE);
+    SHAREMIND_TESTASSERT(b.restoreState(state.data(), state.size())
+                         == SHAREMIND_RANDOM_OK);
+    SHAREMIND_TESTASSERT(a.randomValue<std::uint64_t>()
+                         == b.randomValue<std::uint64_t>());
+
+    // Buffered engines do not support saving their state:
+    auto const bufferedConf(conf(SHAREMIND_RANDOM_CHACHA20,
+                                 SHAREMIND_RANDOM_BUFFERING_THREAD));
+    auto const buffered(facility.createRandomEngineWithSeed(bufferedConf,
+                                                            seed.data(),
+                                                            seed.size()));
+    RandomEngineFacade c(buffered.get());
+    SHAREMIND_TESTASSERT(c.stateSize() == 0u);
+    SHAREMIND_TESTASSERT(c.saveState(state.data(), state.size())
+                         == SHAREMIND_RANDOM_STATE_NOT_SUPPORTED);
+    SHAREMIND_TESTASSERT(c.restoreState(state.data(), state.size())
+                         == SHAREMIND_RANDOM_STATE_NOT_SUPPORTED);
+}
+
+} // anonymous namespace
+
+int main() {
+    testKind(SHAREMIND_RANDOM_CHACHA20, SHAREMIND_RANDOM_SNOW2);
+    testKind(SHAREMIND_RANDOM_SNOW2, SHAREMIND_RANDOM_AES);
+    testKind(SHAREMIND_RANDOM_AES, SHAREMIND_RANDOM_CHACHA20);
+    testFacade();
+    return 0;
+}
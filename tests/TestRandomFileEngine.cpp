@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/RandomFileEngine.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "../src/ChaCha20RandomEngine.h"
+#include "../src/RandomEngineFactory.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+constexpr std::uint64_t const DataSize = 100000u;
+
+SharemindRandomEngineConf fileConf(char const * const path) {
+    SharemindRandomEngineConf conf = {};
+    conf.coreEngine = SHAREMIND_RANDOM_CHACHA20;
+    conf.bufferMode = SHAREMIND_RANDOM_BUFFERING_FILE;
+    conf.filePath = path;
+    return conf;
+}
+
+std::vector<uint8_t> seed(uint8_t const value)
+{ return std::vector<uint8_t>(ChaCha20RandomEngine::SeedSize, value); }
+
+template <typename Exception, typename F>
+bool throws(F && f) {
+    try {
+        f();
+    } catch (Exception const &) {
+        return true;
+    }
+    return false;
+}
+
+/// The stream a file engine must serve, i.e. the file and its continuation:
+struct Reference {
+
+    Reference(std::vector<uint8_t> const & seed)
+        : m_core(seed.data())
+        , m_continuationSeed(ChaCha20RandomEngine::SeedSize)
+    {
+        std::vector<uint8_t> fingerprint(RandomFileEngine::FingerprintSize);
+        m_core.fillBytes(fingerprint.data(), fingerprint.size());
+        m_core.fillBytes(m_continuationSeed.data(), m_continuationSeed.size());
+    }
+
+    void fillBytes(uint8_t * buffer, std::size_t size) {
+        for (; size > 0u; --size, ++buffer, ++m_offset) {
+            if (m_offset < DataSize) {
+                m_core.fillBytes(buffer, 1u);
+            } else {
+                auto const position = m_offset - DataSize;
+                if (position % RandomFileEngine::ContinuationStepSize == 0u)
+                    seek(position);
+                m_continuation->fillBytes(buffer, 1u);
+            }
+        }
+    }
+
+    /// Seeks to the given offset past the file, which starts a step:
+    void seek(std::uint64_t const position) {
+        auto const step = position / RandomFileEngine::ContinuationStepSize;
+        SHAREMIND_TESTASSERT(
+                    position % RandomFileEngine::ContinuationStepSize == 0u);
+        auto seed(m_continuationSeed);
+        std::uint64_t nonce;
+        std::memcpy(&nonce, seed.data() + 32u, sizeof(nonce));
+        nonce += step;
+        std::memcpy(seed.data() + 32u, &nonce, sizeof(nonce));
+        m_continuation.reset(new ChaCha20RandomEngine(seed.data()));
+        m_offset = DataSize + position;
+    }
+
+    ChaCha20RandomEngine m_core;
+    std::vector<uint8_t> m_continuationSeed;
+    std::unique_ptr<ChaCha20RandomEngine> m_continuation;
+    std::uint64_t m_offset = 0u;
+
+};
+
+void recordConsumed(char const * const path, std::uint64_t const consumed) {
+    auto const fd = ::open(path, O_WRONLY);
+    SHAREMIND_TESTASSERT(fd >= 0);
+    SHAREMIND_TESTASSERT(::pwrite(fd, &consumed, sizeof(consumed), 24)
+                         == sizeof(consumed));
+    ::close(fd);
+}
+
+std::uint64_t recordedConsumed(char const * const path) {
+    std::uint64_t r = 0u;
+    auto const fd = ::open(path, O_RDONLY);
+    SHAREMIND_TESTASSERT(fd >= 0);
+    SHAREMIND_TESTASSERT(::pread(fd, &r, sizeof(r), 24) == sizeof(r));
+    ::close(fd);
+    return r;
+}
+
+} // anonymous namespace
+
+int main() {
+    auto const pathString = "/tmp/TestRandomFileEngine."
+                            + std::to_string(::getpid());
+    auto const path = pathString.c_str();
+    auto const conf = fileConf(path);
+    auto const s = seed(1u);
+    ::unlink(path);
+
+    RandomEngineFactory::generateRandomFile(conf, s.data(), s.size(), DataSize);
+    // Existing files are never overwritten:
+    SHAREMIND_TESTASSERT(throws<RandomFileEngine::FileException>([&]() {
+        RandomEngineFactory::generateRandomFile(conf,
+                                                s.data(),
+                                                s.size(),
+                                                DataSize);
+    }));
+
+    Reference reference(s);
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> actual;
+    auto const check = [&](RandomEngine & engine, std::size_t const size) {
+        expected.resize(size);
+        actual.resize(size);
+        reference.fillBytes(expected.data(), size);
+        engine.fillBytes(actual.data(), size);
+        SHAREMIND_TESTASSERT(expected == actual);
+    };
+
+    {
+        auto const engine(RandomEngineFactory::createRandomEngineWithSeed(
+                              conf,
+                              s.data(),
+                              s.size()));
+        check(*engine, 1000u);
+        // The consumed offset is reserved ahead durably:
+        SHAREMIND_TESTASSERT(recordedConsumed(path)
+                             == RandomFileEngine::ReservationSize);
+
+        // The file is locked while in use:
+        SHAREMIND_TESTASSERT(throws<RandomFileEngine::FileException>([&]() {
+            RandomEngineFactory::createRandomEngineWithSeed(conf,
+                                                            s.data(),
+                                                            s.size());
+        }));
+    }
+    // A clean shutdown returns the unused reservation:
+    SHAREMIND_TESTASSERT(recordedConsumed(path) == 1000u);
+
+    {
+        // Restarting continues where the previous engine stopped, and the
+        // continuation engine takes over at the end of the file:
+        auto const engine(RandomEngineFactory::createRandomEngineWithSeed(
+                              conf,
+                              s.data(),
+                              s.size()));
+        check(*engine, 50000u);
+        check(*engine, 60000u);
+        check(*engine, 1000u);
+    }
+    {
+        // Also within the continuation:
+        auto const engine(RandomEngineFactory::createRandomEngineWithSeed(
+                              conf,
+                              s.data(),
+                              s.size()));
+        check(*engine, 5000u);
+        // Across steps of the continuation:
+        check(*engine, 3u * RandomFileEngine::ContinuationStepSize);
+    }
+    {
+        // Reopening far into the continuation seeks to its step instead of
+        // replaying the continuation:
+        auto const position =
+                (std::uint64_t(1u) << 40u)
+                + 5u * RandomFileEngine::ContinuationStepSize;
+        recordConsumed(path, DataSize + position);
+        reference.seek(position);
+        auto const engine(RandomEngineFactory::createRandomEngineWithSeed(
+                              conf,
+                              s.data(),
+                              s.size()));
+        check(*engine, RandomFileEngine::ContinuationStepSize + 1000u);
+    }
+
+    // Another seed does not match the file:
+    auto const s2 = seed(2u);
+    SHAREMIND_TESTASSERT(throws<RandomFileEngine::FileMismatchException>([&]() {
+        RandomEngineFactory::createRandomEngineWithSeed(conf,
+                                                        s2.data(),
+                                                        s2.size());
+    }));
+
+    ::unlink(path);
+    return 0;
+}
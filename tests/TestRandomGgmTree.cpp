@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/*
+ * Tests the expansion of GGM trees against a naive level by level expansion,
+ * the AES-NI kernel against the generic one, and reports the throughput of
+ * full-domain expansion. The depth of the benchmarked tree can be given as
+ * an argument, e.g.
+ *
+ *     TestRandomGgmTree 26
+ */
+
+#include "../src/RandomGgmTree.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sharemind/TestAssert.h>
+#include <vector>
+#include "../src/RandomEngine.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+constexpr std::size_t const SeedSize = RandomGgmTree::SeedSize;
+constexpr unsigned const DefaultDepth = 20u;
+
+using Bytes = std::vector<std::uint8_t>;
+
+Bytes randomBytes(std::size_t const size, std::uint32_t const seed) {
+    Bytes r(size);
+    std::mt19937 rng(seed);
+    for (auto & b : r)
+        b = static_cast<std::uint8_t>(rng());
+    return r;
+}
+
+/* FIPS-197 appendix C.1, the left child being AES_k(s) ^ s: */
+void testKnownAnswer(bool const hardwareAes) {
+    std::uint8_t keys[RandomGgmTree::KeysSize];
+    std::uint8_t seed[SeedSize];
+    for (std::size_t i = 0u; i < SeedSize; ++i) {
+        keys[i] = static_cast<std::uint8_t>(i);
+        keys[SeedSize + i] = static_cast<std::uint8_t>(i);
+        seed[i] = static_cast<std::uint8_t>(i * 0x11u);
+    }
+    static std::uint8_t const ciphertext[SeedSize] = {
+        0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+        0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a };
+
+    RandomGgmTree const tree(keys, hardwareAes);
+    std::uint8_t children[2u * SeedSize];
+    tree.expandLevel(seed, 1u, children);
+    for (std::size_t c = 0u; c < 2u; ++c)
+        for (std::size_t i = 0u; i < SeedSize; ++i)
+            SHAREMIND_TESTASSERT((children[c * SeedSize + i] ^ seed[i])
+                                 == ciphertext[i]);
+}
+
+void testLevels() {
+    RandomGgmTree const hardware;
+    RandomGgmTree const generic(RandomGgmTree::DefaultKeys, false);
+    for (std::size_t const count : { 1u, 2u, 3u, 4u, 5u, 7u, 8u, 9u, 100u }) {
+        auto const parents(randomBytes(count * SeedSize, count));
+        Bytes expected(2u * count * SeedSize);
+        generic.expandLevel(parents.data(), count, expected.data());
+
+        Bytes actual(2u * count * SeedSize);
+        hardware.expandLevel(parents.data(), count, actual.data());
+        SHAREMIND_TESTASSERT(actual == expected);
+
+        // In place:
+        std::memcpy(actual.data(), parents.data(), parents.size());
+        hardware.expandLevel(actual.data(), count, actual.data());
+        SHAREMIND_TESTASSERT(actual == expected);
+        std::memcpy(actual.data(), parents.data(), parents.size());
+        generic.expandLevel(actual.data(), count, actual.data());
+        SHAREMIND_TESTASSERT(actual == expected);
+
+        // Control bits:
+        Bytes bits(2u * count);
+        hardware.expandLevel(parents.data(), count, actual.data(), bits.data());
+        for (std::size_t i = 0u; i < 2u * count; ++i) {
+            SHAREMIND_TESTASSERT(bits[i] == (expected[i * SeedSize] & 1u));
+            SHAREMIND_TESTASSERT(actual[i * SeedSize]
+                                 == (expected[i * SeedSize] & 0xfeu));
+            SHAREMIND_TESTASSERT(std::memcmp(&actual[i * SeedSize + 1u],
+                                             &expected[i * SeedSize + 1u],
+                                             SeedSize - 1u) == 0);
+        }
+    }
+}
+
+void testFull(RandomGgmTree const & tree, unsigned const depth) {
+    auto const root(randomBytes(SeedSize, depth));
+
+    // Naive expansion, level by level into separate buffers:
+    Bytes level(root);
+    Bytes expectedSums(2u * depth * SeedSize, 0u);
+    for (unsigned d = 0u; d < depth; ++d) {
+        Bytes next(2u * level.size());
+        tree.expandLevel(level.data(), level.size() / SeedSize, next.data());
+        for (std::size_t i = 0u; i < next.size(); ++i)
+            expectedSums[(2u * d + (i / SeedSize) % 2u) * SeedSize
+                         + i % SeedSize] ^= next[i];
+        level.swap(next);
+    }
+
+    Bytes leaves((static_cast<std::size_t>(1u) << depth) * SeedSize);
+    Bytes sums(2u * depth * SeedSize);
+    tree.expandFull(root.data(), depth, leaves.data(), sums.data());
+    SHAREMIND_TESTASSERT(leaves == level);
+    SHAREMIND_TESTASSERT(sums == expectedSums);
+
+    std::fill(leaves.begin(), leaves.end(), 0u);
+    tree.expandFull(root.data(), depth, leaves.data());
+    SHAREMIND_TESTASSERT(leaves == level);
+}
+
+void benchmark(unsigned const depth) {
+    RandomGgmTree const tree;
+    auto const root(randomBytes(SeedSize, 1u));
+    std::size_t const count = static_cast<std::size_t>(1u) << depth;
+    Bytes leaves(count * SeedSize);
+    auto const start = std::chrono::steady_clock::now();
+    tree.expandFull(root.data(), depth, leaves.data());
+    auto const seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+    std::cout << "Expanded 2^" << depth << " leaves: "
+              << static_cast<double>(count) / seconds / 1e6
+              << " M leaves/s" << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char * argv[]) {
+    unsigned depth = DefaultDepth;
+    if (argc > 1) {
+        depth = static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10));
+        SHAREMIND_TESTASSERT(depth <= 34u);
+    }
+
+    testKnownAnswer(false);
+    testKnownAnswer(true);
+    testLevels();
+    for (bool const hardwareAes : { false, true }) {
+        RandomGgmTree const tree(RandomGgmTree::DefaultKeys, hardwareAes);
+        for (unsigned const d : { 0u, 1u, 2u, 5u, 14u, 15u, 17u })
+            testFull(tree, d);
+    }
+
+    bool thrown = false;
+    try {
+        std::uint8_t seed[SeedSize] = {};
+        RandomGgmTree().expandFull(seed, RandomGgmTree::MaxDepth + 1u, seed);
+    } catch (RandomEngine::InvalidParameterException const &) {
+        thrown = true;
+    }
+    SHAREMIND_TESTASSERT(thrown);
+
+    benchmark(depth);
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+
+#include "../src/RandomIndexSampling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <sharemind/TestAssert.h>
+#include <vector>
+#include "../src/ChaCha20RandomEngine.h"
+#include "../src/RandomEngineFacade.h"
+#include "../src/RandomFacility.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+/* The bound on the absolute z-scores of the frequencies: */
+constexpr double const MaxZ = 6.0;
+
+std::vector<std::uint8_t> testSeed(std::uint8_t const salt) {
+    std::vector<std::uint8_t> seed(ChaCha20RandomEngine::SeedSize);
+    for (std::size_t i = 0u; i < seed.size(); ++i)
+        seed[i] = static_cast<std::uint8_t>(i * 13u + salt);
+    return seed;
+}
+
+void checkSample(std::vector<std::uint64_t> const & x,
+                 std::uint64_t const n,
+                 RandomIndexOrder const order)
+{
+    for (auto const v : x)
+        SHAREMIND_TESTASSERT(v < n);
+    if (order == RandomIndexOrder::Sorted) {
+        for (std::size_t i = 1u; i < x.size(); ++i)
+            SHAREMIND_TESTASSERT(x[i - 1u] < x[i]);
+    } else {
+        auto sorted(x);
+        std::sort(sorted.begin(), sorted.end());
+        SHAREMIND_TESTASSERT(std::adjacent_find(sorted.begin(), sorted.end())
+                             == sorted.end());
+    }
+}
+
+void checkFrequencies(std::vector<double> const & observed,
+                      double const trials,
+                      double const p)
+{
+    for (auto const o : observed)
+        SHAREMIND_TESTASSERT(std::fabs(o - trials * p)
+                             / std::sqrt(trials * p * (1.0 - p)) < MaxZ);
+}
+
+/* Every index must be selected with probability k/n, every pair of indexes
+   with probability k(k-1)/(n(n-1)), and unsorted output must put every
+   index first with probability 1/n: */
+void testUniform(std::uint64_t const n, std::uint64_t const k) {
+    auto const seed(testSeed(static_cast<std::uint8_t>(n + k)));
+    ChaCha20RandomEngine engine(seed.data());
+    std::size_t const trials = 100000u;
+    for (auto const order : { RandomIndexOrder::Sorted,
+                              RandomIndexOrder::Unsorted })
+    {
+        std::vector<double> selected(n);
+        std::vector<double> pairs(n - 1u);
+        std::vector<double> first(n);
+        std::vector<std::uint64_t> x(k);
+        for (std::size_t t = 0u; t < trials; ++t) {
+            sampleIndices(engine, n, k, x.data(), order);
+            checkSample(x, n, order);
+            std::vector<bool> in(n);
+            for (auto const v : x) {
+                ++selected[v];
+                in[v] = true;
+            }
+            for (std::size_t i = 0u; i + 1u < n; ++i)
+                pairs[i] += (in[i] && in[i + 1u]);
+            if (k > 0u)
+                ++first[x[0u]];
+        }
+        auto const fn = static_cast<double>(n);
+        auto const fk = static_cast<double>(k);
+        if (k < n) {
+            checkFrequencies(selected, trials, fk / fn);
+            if (k > 1u)
+                checkFrequencies(pairs,
+                                 trials,
+                                 fk * (fk - 1.0) / (fn * (fn - 1.0)));
+        }
+        if (order == RandomIndexOrder::Unsorted && k > 0u)
+            checkFrequencies(first, trials, 1.0 / fn);
+    }
+}
+
+void testEdges() {
+    auto const seed(testSeed(1u));
+    ChaCha20RandomEngine engine(seed.data());
+    for (auto const order : { RandomIndexOrder::Sorted,
+                              RandomIndexOrder::Unsorted })
+    {
+        std::vector<std::uint64_t> x(1000u);
+        sampleIndices(engine, 1000u, 1000u, x.data(), order);
+        checkSample(x, 1000u, order);
+        sampleIndices(engine, 5u, 0u, x.data(), order);
+        sampleIndices(engine, 1u, 1u, x.data(), order);
+        SHAREMIND_TESTASSERT(x[0u] == 0u);
+
+        for (auto const & p : { std::make_pair<std::uint64_t>(3u, 4u),
+                                std::make_pair<std::uint64_t>(
+                                    std::uint64_t(1u) << 54u,
+                                    1u) })
+        {
+            bool thrown = false;
+            try {
+                sampleIndices(engine, p.first, p.second, x.data(), order);
+            } catch (RandomEngine::InvalidParameterException const &) {
+                thrown = true;
+            }
+            SHAREMIND_TESTASSERT(thrown);
+        }
+    }
+}
+
+/* Sparse samples of huge ranges must take time proportional to k: */
+void testSparse() {
+    auto const seed(testSeed(2u));
+    ChaCha20RandomEngine engine(seed.data());
+    std::uint64_t const n = std::uint64_t(1u) << 50u;
+    std::vector<std::uint64_t> x(1000000u);
+    for (auto const order : { RandomIndexOrder::Sorted,
+                              RandomIndexOrder::Unsorted })
+    {
+        auto const start = std::chrono::steady_clock::now();
+        sampleIndices(engine, n, x.size(), x.data(), order);
+        auto const seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count();
+        std::cout << ((order == RandomIndexOrder::Sorted) ? "Sorted: "
+                                                          : "Unsorted: ")
+                  << static_cast<double>(x.size())
+                     / std::max(seconds, 1e-9) / 1e6
+                  << " M indexes/s" << std::endl;
+        checkSample(x, n, order);
+
+        // The mean of the uniform indexes:
+        double sum = 0.0;
+        for (auto const v : x)
+            sum += static_cast<double>(v) / static_cast<double>(n);
+        auto const mean = sum / static_cast<double>(x.size());
+        SHAREMIND_TESTASSERT(std::fabs(mean - 0.5)
+                             / std::sqrt(1.0 / 12.0 / x.size()) < MaxZ);
+    }
+}
+
+void testFacade() {
+    RandomFacility facility(SharemindRandomEngineConf{
+                                SHAREMIND_RANDOM_CHACHA20,
+                                SHAREMIND_RANDOM_BUFFERING_NONE,
+                                0u,
+                                SHAREMIND_RANDOM_NUMA_NONE,
+                                0u,
+                                0u,
+                                0u,
+                                nullptr,
+                                nullptr});
+    auto const seed(testSeed(3u));
+    auto const rng(facility.createRandomEngineWithSeed(
+                       facility.defaultFactoryConfiguration(),
+                       seed.data(),
+                       seed.size()));
+    RandomEngineFacade facade(rng.get());
+    ChaCha20RandomEngine reference(seed.data());
+
+    for (auto const order : { RandomIndexOrder::Sorted,
+                              RandomIndexOrder::Unsorted })
+    {
+        std::vector<std::uint64_t> x(5000u);
+        std::vector<std::uint64_t> y(x.size());
+        sampleIndices(facade, 1000000u, x.size(), x.data(), order);
+        sampleIndices(reference, 1000000u, y.size(), y.data(), order);
+        SHAREMIND_TESTASSERT(x == y);
+    }
+}
+
+} // anonymous namespace
+
+int main() {
+    testUniform(20u, 1u);
+    testUniform(20u, 5u);
+    testUniform(100u, 7u);
+    testUniform(30u, 29u);
+    testEdges();
+    testSparse();
+    testFacade();
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/NumaTopology.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "../src/ChaCha20RandomEngine.h"
+#include "../src/NumaReplicatedRandomEngine.h"
+#include "../src/RandomBufferAgent.h"
+#include "../src/RandomEngineFactory.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+using Bytes = std::vector<std::uint8_t>;
+
+Bytes makeSeed(std::uint8_t const value) {
+    return Bytes(ChaCha20RandomEngine::SeedSize, value);
+}
+
+Bytes generate(RandomEngine & engine, std::size_t const size) {
+    Bytes r(size);
+    engine.fillBytes(r.data(), r.size());
+    return r;
+}
+
+void writeFile(std::string const & path, char const * const contents) {
+    std::ofstream f(path);
+    f << contents << '\n';
+    SHAREMIND_TESTASSERT(f.good());
+}
+
+// Without NUMA information the host is a single node 0:
+void testTopologyFallback() {
+    NumaTopology const topology("/nonexistent/devices/system/node");
+    SHAREMIND_TESTASSERT(topology.nodes() == std::vector<unsigned>{0u});
+    SHAREMIND_TESTASSERT(topology.hasNode(0u));
+    SHAREMIND_TESTASSERT(!topology.hasNode(1u));
+    SHAREMIND_TESTASSERT(topology.currentNode() == 0u);
+}
+
+// The topology is read from the sysfs layout, CPUs mapped to their nodes:
+void testTopologyFromDirectory() {
+    char dir[] = "/tmp/TestRandomNumaXXXXXX";
+    SHAREMIND_TESTASSERT(::mkdtemp(dir));
+    std::string const root(dir);
+    SHAREMIND_TESTASSERT(::mkdir((root + "/node0").c_str(), 0700) == 0);
+    SHAREMIND_TESTASSERT(::mkdir((root + "/node2").c_str(), 0700) == 0);
+    writeFile(root + "/online", "0,2");
+    // All CPUs are on node 2, hence the calling thread is as well:
+    writeFile(root + "/node0/cpulist", "");
+    writeFile(root + "/node2/cpulist", "0-1023");
+
+    NumaTopology const topology(root);
+    SHAREMIND_TESTASSERT(topology.nodes() == (std::vector<unsigned>{0u, 2u}));
+    SHAREMIND_TESTASSERT(topology.hasNode(2u));
+    SHAREMIND_TESTASSERT(!topology.hasNode(1u));
+    SHAREMIND_TESTASSERT(topology.currentNode() == 2u);
+
+    for (auto const * const name
+         : { "/node0/cpulist", "/node2/cpulist", "/online" })
+        ::unlink((root + name).c_str());
+    ::rmdir((root + "/node0").c_str());
+    ::rmdir((root + "/node2").c_str());
+    ::rmdir(dir);
+}
+
+std::shared_ptr<RandomEngine> createEngine(
+        SharemindRandomEngineNumaPolicy const numaPolicy,
+        Bytes const & seed)
+{
+    SharemindRandomEngineConf conf = {};
+    conf.coreEngine = SHAREMIND_RANDOM_CHACHA20;
+    conf.bufferMode = SHAREMIND_RANDOM_BUFFERING_THREAD;
+    conf.bufferSize = 64u * 1024u;
+    conf.numaPolicy = numaPolicy;
+    conf.numaNode = NumaTopology::instance().nodes().front();
+    return RandomEngineFactory::createRandomEngineWithSeed(conf,
+                                                           seed.data(),
+                                                           seed.size());
+}
+
+// Placement on a node must not change the stream:
+void testNodePolicy() {
+    auto const seed(makeSeed(1u));
+    auto const expected(
+            generate(*createEngine(SHAREMIND_RANDOM_NUMA_NONE, seed), 100000u));
+    auto const engine(createEngine(SHAREMIND_RANDOM_NUMA_NODE, seed));
+    SHAREMIND_TESTASSERT(std::dynamic_pointer_cast<RandomBufferAgent>(engine));
+    SHAREMIND_TESTASSERT(generate(*engine, expected.size()) == expected);
+}
+
+// On a single node host a single agent is created instead of replicas:
+void testReplicatePolicy() {
+    auto const seed(makeSeed(2u));
+    auto const engine(createEngine(SHAREMIND_RANDOM_NUMA_REPLICATE, seed));
+    if (NumaTopology::instance().nodes().size() > 1u) {
+        SHAREMIND_TESTASSERT(
+                std::dynamic_pointer_cast<NumaReplicatedRandomEngine>(engine));
+        return;
+    }
+    SHAREMIND_TESTASSERT(std::dynamic_pointer_cast<RandomBufferAgent>(engine));
+    auto const expected(
+            generate(*createEngine(SHAREMIND_RANDOM_NUMA_NONE, seed), 100000u));
+    SHAREMIND_TESTASSERT(generate(*engine, expected.size()) == expected);
+}
+
+// Requests are served by the replica of the current node, and the stats of
+// all replicas are summed up:
+void testReplicatedEngine() {
+    auto const & topology = NumaTopology::instance();
+    auto const node = topology.nodes().front();
+    topology.bindCurrentThreadToNode(node);
+    SHAREMIND_TESTASSERT(topology.currentNode() == node);
+
+    // A replica for every node and one for a node which does not exist:
+    std::vector<std::pair<unsigned, std::shared_ptr<RandomEngine> > > replicas;
+    std::uint8_t seedValue = 10u;
+    for (auto const n : topology.nodes()) {
+        auto const seed(makeSeed(seedValue++));
+        replicas.emplace_back(
+                    n,
+                    std::make_shared<ChaCha20RandomEngine>(seed.data()));
+    }
+    auto const otherSeed(makeSeed(seedValue));
+    replicas.emplace_back(
+                topology.nodes().back() + 2u,
+                std::make_shared<ChaCha20RandomEngine>(otherSeed.data()));
+    auto const local = replicas.front().second;
+    NumaReplicatedRandomEngine engine(std::move(replicas));
+
+    auto const localSeed(makeSeed(10u));
+    ChaCha20RandomEngine reference(localSeed.data());
+    SHAREMIND_TESTASSERT(generate(engine, 1000u) == generate(reference, 1000u));
+    SHAREMIND_TESTASSERT(generate(engine, 24u) == generate(reference, 24u));
+
+    SharemindRandomEngineStats stats;
+    engine.getStats(stats);
+    SHAREMIND_TESTASSERT(stats.fillRequests == 2u);
+    SHAREMIND_TESTASSERT(stats.bytesGenerated == 1024u);
+
+    SharemindRandomEngineStats localStats;
+    local->getStats(localStats);
+    SHAREMIND_TESTASSERT(localStats.bytesGenerated == 1024u);
+}
+
+} // anonymous namespace
+
+int main() {
+    testTopologyFallback();
+    testTopologyFromDirectory();
+    testNodePolicy();
+    testReplicatePolicy();
+    testReplicatedEngine();
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/*
+ * Tests the keyed functions against the streams of the engines and the AES
+ * test vector of FIPS-197, every kernel against the generic one, and reports
+ * the throughput of evaluating them at random indexes.
+ */
+
+#include "../src/RandomPrf.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sharemind/TestAssert.h>
+#include <vector>
+#include "../src/AesKernels.h"
+#include "../src/ChaCha20RandomEngine.h"
+#include "../src/CpuFeatures.h"
+#include "../src/RandomEngine.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+using Bytes = std::vector<std::uint8_t>;
+
+CpuFeatures::Level const levels[] = {
+    CpuFeatures::Level::Generic,
+    CpuFeatures::Level::Sse2,
+    CpuFeatures::Level::Ssse3,
+    CpuFeatures::Level::Avx2,
+    CpuFeatures::Level::Avx512 };
+
+Bytes makeKey(SharemindCoreRandomEngineKind const kind) {
+    Bytes key(RandomPrf::keySize(kind));
+    for (std::size_t i = 0u; i < key.size(); ++i)
+        key[i] = static_cast<std::uint8_t>(i * 7u + 3u);
+    return key;
+}
+
+std::vector<std::uint64_t> makeIndexes(std::size_t const count,
+                                       std::uint64_t const bound)
+{
+    std::mt19937_64 rng(count);
+    std::vector<std::uint64_t> indexes(count);
+    for (auto & i : indexes)
+        i = bound ? rng() % bound : rng();
+    return indexes;
+}
+
+void testAesKernels() {
+    std::uint8_t key[16u];
+    std::uint8_t block[16u];
+    for (std::size_t i = 0u; i < 16u; ++i) {
+        key[i] = static_cast<std::uint8_t>(i);
+        block[i] = static_cast<std::uint8_t>(i * 0x11u);
+    }
+    static std::uint8_t const ciphertext[16u] = {
+        0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+        0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a };
+    AesRoundKeys roundKeys;
+    aesExpandKey(key, roundKeys);
+    for (bool const hardwareAes : { false, true }) {
+        std::uint8_t out[16u];
+        aesBlocksKernel(hardwareAes)(roundKeys, block, 1u, out);
+        SHAREMIND_TESTASSERT(std::memcmp(out, ciphertext, 16u) == 0);
+    }
+}
+
+/* Block j of F_k(i) is AES_k(i || j): */
+void testAes() {
+    auto const key(makeKey(SHAREMIND_RANDOM_AES));
+    AesRoundKeys roundKeys;
+    aesExpandKey(key.data(), roundKeys);
+    auto const indexes(makeIndexes(77u, 0u));
+    for (std::size_t const width : { 1u, 16u, 17u, 40u, 64u }) {
+        Bytes out(indexes.size() * width);
+        RandomPrf(SHAREMIND_RANDOM_AES, key.data()).eval(indexes.data(),
+                                                        indexes.size(),
+                                                        out.data(),
+                                                        width);
+        for (std::size_t i = 0u; i < indexes.size(); ++i) {
+            for (std::size_t j = 0u; j * 16u < width; ++j) {
+                std::uint8_t block[16u];
+                for (std::size_t b = 0u; b < 8u; ++b) {
+                    block[b] = static_cast<std::uint8_t>(
+                                   indexes[i] >> (8u * b));
+                    block[8u + b] = static_cast<std::uint8_t>(j >> (8u * b));
+                }
+                aesEncryptBlock(roundKeys, block);
+                auto const n = std::min<std::size_t>(16u, width - j * 16u);
+                SHAREMIND_TESTASSERT(std::memcmp(&out[i * width + j * 16u],
+                                                 block,
+                                                 n) == 0);
+            }
+        }
+    }
+}
+
+/* F_k(i) is block i of the stream of an engine, whose words are interleaved
+   in groups of four blocks: */
+void testChaCha20() {
+    constexpr std::size_t const blocks = 64u;
+    auto const key(makeKey(SHAREMIND_RANDOM_CHACHA20));
+    Bytes stream(blocks * 64u);
+    ChaCha20RandomEngine(key.data()).fillBytes(stream.data(), stream.size());
+    auto const indexes(makeIndexes(blocks + 3u, blocks));
+
+    for (auto const level : levels) {
+        if (level > CpuFeatures::instance().level())
+            break;
+        RandomPrf const prf(SHAREMIND_RANDOM_CHACHA20, key.data(), level);
+        for (std::size_t const width : { 1u, 13u, 64u }) {
+            Bytes out(indexes.size() * width);
+            prf.eval(indexes.data(), indexes.size(), out.data(), width);
+            for (std::size_t i = 0u; i < indexes.size(); ++i) {
+                auto const block = indexes[i];
+                for (std::size_t b = 0u; b < width; ++b) {
+                    auto const word = b / 4u;
+                    auto const offset = (block / 4u) * 256u + word * 16u
+                                        + (block % 4u) * 4u + b % 4u;
+                    SHAREMIND_TESTASSERT(out[i * width + b] == stream[offset]);
+                }
+            }
+        }
+    }
+}
+
+void testLevels(SharemindCoreRandomEngineKind const kind) {
+    auto const key(makeKey(kind));
+    auto const indexes(makeIndexes(1000u, 0u));
+    constexpr std::size_t const width = 64u;
+    Bytes expected(indexes.size() * width);
+    RandomPrf(kind, key.data(), CpuFeatures::Level::Generic).eval(
+                indexes.data(),
+                indexes.size(),
+                expected.data(),
+                width);
+    for (auto const level : levels) {
+        if (level > CpuFeatures::instance().level())
+            break;
+        Bytes actual(indexes.size() * width);
+        RandomPrf(kind, key.data(), level).eval(indexes.data(),
+                                                indexes.size(),
+                                                actual.data(),
+                                                width);
+        SHAREMIND_TESTASSERT(actual == expected);
+    }
+
+    // The free function:
+    Bytes actual(indexes.size() * width);
+    prfEval(kind,
+            key.data(),
+            indexes.data(),
+            indexes.size(),
+            actual.data(),
+            width);
+    SHAREMIND_TESTASSERT(actual == expected);
+}
+
+void testInvalid() {
+    auto const key(makeKey(SHAREMIND_RANDOM_CHACHA20));
+    RandomPrf const prf(SHAREMIND_RANDOM_CHACHA20, key.data());
+    std::uint64_t const index = 0u;
+    std::uint8_t out[RandomPrf::MaxOutputWidth + 1u];
+    for (std::size_t const width : { std::size_t(0u),
+                                     RandomPrf::MaxOutputWidth + 1u })
+    {
+        bool thrown = false;
+        try {
+            prf.eval(&index, 1u, out, width);
+        } catch (RandomEngine::InvalidParameterException const &) {
+            thrown = true;
+        }
+        SHAREMIND_TESTASSERT(thrown);
+    }
+
+    SHAREMIND_TESTASSERT(RandomPrf::keySize(SHAREMIND_RANDOM_SNOW2) == 0u);
+    bool thrown = false;
+    try {
+        RandomPrf(SHAREMIND_RANDOM_SNOW2, key.data());
+    } catch (RandomEngine::GeneratorNotSupportedException const &) {
+        thrown = true;
+    }
+    SHAREMIND_TESTASSERT(thrown);
+}
+
+void benchmark(char const * const name,
+               SharemindCoreRandomEngineKind const kind)
+{
+    constexpr std::size_t const width = 16u;
+    auto const key(makeKey(kind));
+    auto const indexes(makeIndexes(1u << 20u, 0u));
+    Bytes out(indexes.size() * width);
+    auto const start = std::chrono::steady_clock::now();
+    prfEval(kind,
+            key.data(),
+            indexes.data(),
+            indexes.size(),
+            out.data(),
+            width);
+    auto const seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": "
+              << static_cast<double>(indexes.size()) / seconds / 1e6
+              << " M evaluations/s" << std::endl;
+}
+
+} // anonymous namespace
+
+int main() {
+    testAesKernels();
+    testAes();
+    testChaCha20();
+    testLevels(SHAREMIND_RANDOM_AES);
+    testLevels(SHAREMIND_RANDOM_CHACHA20);
+    testInvalid();
+    benchmark("aes", SHAREMIND_RANDOM_AES);
+    benchmark("chacha20", SHAREMIND_RANDOM_CHACHA20);
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/RandomPrssFacade.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <sharemind/TestAssert.h>
+#include <vector>
+#include "../src/RandomFacility.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+constexpr std::size_t const NumParties = 3u;
+
+struct Sessions {
+
+    Sessions(SharemindCoreRandomEngineKind const kind)
+        : facility(SharemindRandomEngineConf{
+                       kind,
+                       SHAREMIND_RANDOM_BUFFERING_NONE,
+                       0u,
+                       SHAREMIND_RANDOM_NUMA_NONE,
+                       0u,
+                       0u,
+                       0u,
+                       nullptr,
+                       nullptr})
+    {
+        auto const seedSize = facility.getSeedSize(
+                                  facility.defaultFactoryConfiguration());
+        // Seed i is shared between parties i and i+1:
+        std::array<std::vector<uint8_t>, NumParties> seeds;
+        for (std::size_t i = 0u; i < NumParties; ++i)
+            seeds[i].assign(seedSize, static_cast<uint8_t>(i + 1u));
+        for (std::size_t i = 0u; i < NumParties; ++i) {
+            auto const & conf = facility.defaultFactoryConfiguration();
+            auto const & prevSeed = seeds[(i + NumParties - 1u) % NumParties];
+            engines.emplace_back(
+                        facility.createRandomEngineWithSeed(conf,
+                                                            seeds[i].data(),
+                                                            seedSize));
+            engines.emplace_back(
+                        facility.createRandomEngineWithSeed(conf,
+                                                            prevSeed.data(),
+                                                            seedSize));
+            parties.emplace_back(
+                        RandomEngineFacade(engines[2u * i].get()),
+                        RandomEngineFacade(engines[2u * i + 1u].get()));
+        }
+    }
+
+    RandomFacility facility;
+    std::vector<std::shared_ptr<SharemindRandomEngine> > engines;
+    std::vector<RandomPrssFacade> parties;
+
+};
+
+void testKind(SharemindCoreRandomEngineKind const kind) {
+    Sessions sessions(kind);
+    auto & parties = sessions.parties;
+
+    // Sizes which are not multiples of the block size:
+    constexpr std::size_t const size = 3u * RandomPrssFacade::BlockSize + 5u;
+    std::array<std::vector<uint8_t>, NumParties> x;
+    for (std::size_t p = 0u; p < NumParties; ++p) {
+        x[p].resize(size);
+        parties[p].fillZeroShareXor(x[p].data(), size);
+    }
+    bool allZero = true;
+    for (std::size_t i = 0u; i < size; ++i) {
+        SHAREMIND_TESTASSERT((x[0u][i] ^ x[1u][i] ^ x[2u][i]) == 0u);
+        allZero = allZero && x[0u][i] == 0u;
+    }
+    if (kind != SHAREMIND_RANDOM_NULL)
+        SHAREMIND_TESTASSERT(!allZero);
+
+    std::array<std::vector<uint32_t>, NumParties> a;
+    for (std::size_t p = 0u; p < NumParties; ++p) {
+        a[p].resize(size);
+        parties[p].fillZeroShareAdd(a[p].data(), a[p].data() + size);
+    }
+    for (std::size_t i = 0u; i < size; ++i)
+        SHAREMIND_TESTASSERT(
+                static_cast<uint32_t>(a[0u][i] + a[1u][i] + a[2u][i]) == 0u);
+
+    std::array<std::vector<uint8_t>, NumParties> next;
+    std::array<std::vector<uint8_t>, NumParties> prev;
+    for (std::size_t p = 0u; p < NumParties; ++p) {
+        next[p].resize(size);
+        prev[p].resize(size);
+        parties[p].fillReplicatedShare(next[p].data(), prev[p].data(), size);
+    }
+    for (std::size_t p = 0u; p < NumParties; ++p)
+        SHAREMIND_TESTASSERT(next[p] == prev[(p + 1u) % NumParties]);
+}
+
+} // anonymous namespace
+
+int main() {
+    testKind(SHAREMIND_RANDOM_NULL);
+    testKind(SHAREMIND_RANDOM_CHACHA20);
+    testKind(SHAREMIND_RANDOM_AES);
+    testKind(SHAREMIND_RANDOM_SNOW2);
+    return 0;
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/RandomSharedPool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <signal.h>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <utility>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "../src/ChaCha20RandomEngine.h"
+#include "../src/NullRandomEngine.h"
+#include "../src/RandomEngineFactory.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+constexpr std::size_t const SlotCapacity = 64u * 1024u;
+constexpr std::size_t const ReadSize = 1024u * 1024u;
+
+/// Produces consecutive 64-bit counter values, which makes reuse detectable:
+class CountingEngine: public RandomEngine {
+
+public: /* Methods: */
+
+    void fillBytes(void * buffer, std::size_t size) noexcept override {
+        SHAREMIND_TESTASSERT(size % sizeof(m_next) == 0u);
+        for (auto out = static_cast<unsigned char *>(buffer);
+             size > 0u;
+             out += sizeof(m_next), size -= sizeof(m_next), ++m_next)
+            std::memcpy(out, &m_next, sizeof(m_next));
+    }
+
+private: /* Fields: */
+
+    std::uint64_t m_next = 1u;
+
+};
+
+std::shared_ptr<RandomEngine> nullEngine() {
+    return std::shared_ptr<RandomEngine>(&NullRandomEngine::instance(),
+                                         [](RandomEngine * const){});
+}
+
+std::vector<std::uint64_t> toValues(std::vector<unsigned char> const & bytes) {
+    std::vector<std::uint64_t> r(bytes.size() / sizeof(std::uint64_t));
+    std::memcpy(r.data(), bytes.data(), bytes.size());
+    return r;
+}
+
+/// Reads ReadSize bytes in a child process through the given pipe:
+std::vector<unsigned char> readChild(int const fd, ::pid_t const pid) {
+    std::vector<unsigned char> r(ReadSize);
+    std::size_t done = 0u;
+    while (done < r.size()) {
+        auto const n = ::read(fd, r.data() + done, r.size() - done);
+        SHAREMIND_TESTASSERT(n > 0);
+        done += static_cast<std::size_t>(n);
+    }
+    ::close(fd);
+    int status;
+    SHAREMIND_TESTASSERT(::waitpid(pid, &status, 0) == pid);
+    SHAREMIND_TESTASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    return r;
+}
+
+void testConsumerProcesses() {
+    auto const name = "/sharemind-random-test-" + std::to_string(::getpid());
+    RandomSharedPool pool(name.c_str(),
+                          4u,
+                          SlotCapacity,
+                          std::make_shared<CountingEngine>());
+
+    SharemindRandomEngineConf conf = {};
+    conf.coreEngine = SHAREMIND_RANDOM_CHACHA20;
+    conf.bufferMode = SHAREMIND_RANDOM_BUFFERING_SHARED_POOL;
+    conf.sharedPoolName = name.c_str();
+
+    std::vector<std::pair<int, ::pid_t> > children;
+    for (unsigned i = 0u; i < 3u; ++i) {
+        int fds[2];
+        SHAREMIND_TESTASSERT(::pipe(fds) == 0);
+        auto const pid = ::fork();
+        SHAREMIND_TESTASSERT(pid >= 0);
+        if (pid == 0) {
+            ::close(fds[0]);
+            std::vector<unsigned char> seed(ChaCha20RandomEngine::SeedSize);
+            auto const engine(RandomEngineFactory::createRandomEngineWithSeed(
+                                  conf,
+                                  seed.data(),
+                                  seed.size()));
+            std::vector<unsigned char> data(ReadSize);
+            for (std::size_t done = 0u, n = 8u; done < data.size();) {
+                if (n > data.size() - done)
+                    n = data.size() - done;
+                engine->fillBytes(data.data() + done, n);
+                done += n;
+                n = (n * 3u) % (SlotCapacity / 2u) + 8u;
+            }
+            for (std::size_t done = 0u; done < data.size();) {
+                auto const n = ::write(fds[1],
+                                       data.data() + done,
+                                       data.size() - done);
+                if (n <= 0)
+                    ::_exit(1);
+                done += static_cast<std::size_t>(n);
+            }
+            ::_exit(0);
+        }
+        ::close(fds[1]);
+        children.emplace_back(fds[0], pid);
+    }
+
+    std::vector<std::uint64_t> all;
+    for (auto const & child : children) {
+        auto const values(toValues(readChild(child.first, child.second)));
+        // Every slot is served in order:
+        SHAREMIND_TESTASSERT(std::is_sorted(values.begin(), values.end()));
+        all.insert(all.end(), values.begin(), values.end());
+    }
+    // No value was served to two consumers:
+    std::sort(all.begin(), all.end());
+    SHAREMIND_TESTASSERT(std::adjacent_find(all.begin(), all.end())
+                         == all.end());
+    SHAREMIND_TESTASSERT(all.front() > 0u);
+}
+
+void testPoolFull() {
+    RandomSharedPool pool(nullptr,
+                          1u,
+                          SlotCapacity,
+                          std::make_shared<CountingEngine>());
+    std::unique_ptr<RandomSharedPoolEngine> engine(
+                new RandomSharedPoolEngine(pool.fd(), nullEngine()));
+    SHAREMIND_TESTASSERT(engine->bufferSize() == SlotCapacity);
+    bool full = false;
+    try {
+        RandomSharedPoolEngine(pool.fd(), nullEngine());
+    } catch (RandomSharedPool::PoolFullException const &) {
+        full = true;
+    }
+    SHAREMIND_TESTASSERT(full);
+    // Detaching frees the slot:
+    engine.reset();
+    engine.reset(new RandomSharedPoolEngine(pool.fd(), nullEngine()));
+}
+
+/* The slot of a killed consumer is released by the kernel and can be claimed
+   again, but only once the consumer has died: */
+void testDeadConsumer() {
+    RandomSharedPool pool(nullptr,
+                          1u,
+                          SlotCapacity,
+                          std::make_shared<CountingEngine>());
+    int fds[2];
+    SHAREMIND_TESTASSERT(::pipe(fds) == 0);
+    auto const pid = ::fork();
+    SHAREMIND_TESTASSERT(pid >= 0);
+    if (pid == 0) {
+        ::close(fds[0]);
+        RandomSharedPoolEngine engine(pool.fd(), nullEngine());
+        char const c = 0;
+        if (::write(fds[1], &c, 1u) != 1)
+            ::_exit(1);
+        for (;;)
+            ::pause();
+    }
+    ::close(fds[1]);
+    char c;
+    SHAREMIND_TESTASSERT(::read(fds[0], &c, 1u) == 1);
+    ::close(fds[0]);
+
+    bool full = false;
+    try {
+        RandomSharedPoolEngine(pool.fd(), nullEngine());
+    } catch (RandomSharedPool::PoolFullException const &) {
+        full = true;
+    }
+    SHAREMIND_TESTASSERT(full);
+
+    SHAREMIND_TESTASSERT(::kill(pid, SIGKILL) == 0);
+    int status;
+    SHAREMIND_TESTASSERT(::waitpid(pid, &status, 0) == pid);
+    RandomSharedPoolEngine engine(pool.fd(), nullEngine());
+    std::uint64_t value;
+    engine.fillBytes(&value, sizeof(value));
+    SHAREMIND_TESTASSERT(value > 0u);
+}
+
+void testFallback() {
+    std::vector<unsigned char> const seed(ChaCha20RandomEngine::SeedSize, 1u);
+    std::unique_ptr<RandomSharedPool> pool(
+                new RandomSharedPool(nullptr,
+                                     2u,
+                                     SlotCapacity,
+                                     std::make_shared<CountingEngine>()));
+    RandomSharedPoolEngine engine(
+                pool->fd(),
+                std::make_shared<ChaCha20RandomEngine>(seed.data()));
+    std::vector<unsigned char> data(ReadSize);
+    engine.fillBytes(data.data(), 8u);
+    pool.reset();
+
+    // The rest of the slot is served before switching to the fallback:
+    engine.fillBytes(data.data(), data.size());
+    SHAREMIND_TESTASSERT(engine.detached());
+    std::vector<unsigned char> expected(data.size());
+    ChaCha20RandomEngine(seed.data()).fillBytes(expected.data(),
+                                                expected.size());
+    auto const start = std::search(data.begin(),
+                                   data.end(),
+                                   expected.begin(),
+                                   expected.begin() + 32);
+    SHAREMIND_TESTASSERT(start != data.end());
+    auto const prefix = static_cast<std::size_t>(start - data.begin());
+    SHAREMIND_TESTASSERT(prefix <= SlotCapacity && prefix % 8u == 0u);
+    SHAREMIND_TESTASSERT(std::equal(start, data.end(), expected.begin()));
+    std::vector<unsigned char> const pooled(data.begin(), start);
+    auto const values(toValues(pooled));
+    for (std::size_t i = 0u; i < values.size(); ++i)
+        SHAREMIND_TESTASSERT(values[i] == i + 2u);
+}
+
+/* Sizes which wrap around when computing the size of the shared memory must
+   be rejected both when creating a pool and when attaching to one: */
+void testSizeOverflow() {
+    using Size = std::pair<std::size_t, std::size_t>;
+    auto const max = std::numeric_limits<std::size_t>::max();
+    for (auto const & size : { Size(2u, max / 2u + 1u),
+                               Size(1u, max),
+                               Size(1u, max - 1u),
+                               Size(INT32_MAX, max / 2u) })
+    {
+        bool thrown = false;
+        try {
+            RandomSharedPool(nullptr,
+                             size.first,
+                             size.second,
+                             std::make_shared<CountingEngine>());
+        } catch (RandomSharedPool::PoolException const &) {
+            thrown = true;
+        }
+        SHAREMIND_TESTASSERT(thrown);
+    }
+
+    // A header claiming 2 slots of 2^63 bytes, which wraps to a single page:
+    auto const pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    auto const fd = ::memfd_create("sharemind-random-test", MFD_CLOEXEC);
+    SHAREMIND_TESTASSERT(fd >= 0);
+    std::vector<unsigned char> header(pageSize);
+    std::memcpy(header.data(), "SMRNDPOL", 8u);
+    std::uint32_t const version = 1u;
+    std::uint32_t const slotCount = 2u;
+    std::uint64_t const slotCapacity = std::uint64_t(1u) << 63u;
+    std::memcpy(header.data() + 8u, &version, sizeof(version));
+    std::memcpy(header.data() + 12u, &slotCount, sizeof(slotCount));
+    std::memcpy(header.data() + 16u, &slotCapacity, sizeof(slotCapacity));
+    SHAREMIND_TESTASSERT(::write(fd, header.data(), header.size())
+                         == static_cast<::ssize_t>(header.size()));
+    bool thrown = false;
+    try {
+        RandomSharedPoolEngine(fd, nullEngine());
+    } catch (RandomSharedPool::PoolException const &) {
+        thrown = true;
+    }
+    SHAREMIND_TESTASSERT(thrown);
+    ::close(fd);
+}
+
+} // anonymous namespace
+
+int main() {
+    testConsumerProcesses();
+    testPoolFull();
+    testDeadConsumer();
+    testFallback();
+    testSizeOverflow();
+    return 0;
+}
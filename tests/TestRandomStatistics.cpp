@@ -0,0 +1,491 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/*
+ * A battery of statistical tests run on the streams of every core engine and
+ * buffering mode, also measuring their throughput. Optimized kernels which
+ * break the stream in ways known-answer tests miss, e.g. by repeating lanes,
+ * are caught here.
+ *
+ * By default every stream is DefaultMiB MiB long. Longer runs are possible
+ * by giving the number of MiB per stream as an argument, e.g.
+ *
+ *     TestRandomStatistics 4096
+ *
+ * and the SIMD level can be chosen via the environment variable named by
+ * CpuFeatures::LevelEnvironmentVariable.
+ */
+
+#include "../src/RandomEngineFactory.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sharemind/TestAssert.h>
+#include <vector>
+#include "../src/CpuFeatures.h"
+#include "../src/RandomEngine.h"
+
+
+using namespace sharemind;
+
+namespace {
+
+constexpr std::size_t const DefaultMiB = 8u;
+/* Pairs of bytes and birthdays never straddle chunks of this size: */
+constexpr std::size_t const ChunkSize = 64u * 1024u - (64u * 1024u) % 6u;
+
+/* Every statistic is normalized to a z-score, which is required to stay below
+   this bound. The streams are deterministic, so this does not make the test
+   flaky, but it still catches any gross defect: */
+constexpr double const MaxZ = 6.0;
+
+bool acceptable(double const z) { return std::fabs(z) < MaxZ; }
+
+/** \returns the z-score of a chi-square statistic. */
+double chiSquareZ(double const chiSquare, double const degreesOfFreedom)
+{ return (chiSquare - degreesOfFreedom) / std::sqrt(2.0 * degreesOfFreedom); }
+
+double chiSquare(std::vector<std::uint64_t> const & observed,
+                 std::vector<double> const & expected)
+{
+    double r = 0.0;
+    for (std::size_t i = 0u; i < observed.size(); ++i) {
+        auto const d = static_cast<double>(observed[i]) - expected[i];
+        r += d * d / expected[i];
+    }
+    return r;
+}
+
+/** Frequency of bits (monobit) and bytes. */
+class FrequencyTest {
+
+public: /* Methods: */
+
+    void update(std::uint8_t const * data, std::size_t size) {
+        for (std::size_t i = 0u; i < size; ++i) {
+            ++m_bytes[data[i]];
+            m_ones += static_cast<unsigned>(__builtin_popcount(data[i]));
+        }
+        m_count += size;
+    }
+
+    void check() const {
+        auto const bits = static_cast<double>(m_count) * 8.0;
+        auto const z = (static_cast<double>(m_ones) - bits / 2.0)
+                       / std::sqrt(bits / 4.0);
+        SHAREMIND_TESTASSERT(acceptable(z));
+
+        std::vector<double> const expected(
+                    m_bytes.size(),
+                    static_cast<double>(m_count) / 256.0);
+        SHAREMIND_TESTASSERT(acceptable(
+                chiSquareZ(chiSquare(m_bytes, expected), 255.0)));
+    }
+
+private: /* Fields: */
+
+    std::vector<std::uint64_t> m_bytes = std::vector<std::uint64_t>(256u);
+    std::uint64_t m_ones = 0u;
+    std::uint64_t m_count = 0u;
+
+};
+
+/** Frequency of non-overlapping pairs of bytes. */
+class SerialTest {
+
+public: /* Methods: */
+
+    void update(std::uint8_t const * data, std::size_t size) {
+        for (std::size_t i = 0u; i + 1u < size; i += 2u)
+            ++m_pairs[static_cast<unsigned>(data[i]) << 8u | data[i + 1u]];
+        m_count += size / 2u;
+    }
+
+    void check() const {
+        std::vector<double> const expected(
+                    m_pairs.size(),
+                    static_cast<double>(m_count) / 65536.0);
+        SHAREMIND_TESTASSERT(acceptable(
+                chiSquareZ(chiSquare(m_pairs, expected), 65535.0)));
+    }
+
+private: /* Fields: */
+
+    std::vector<std::uint64_t> m_pairs = std::vector<std::uint64_t>(65536u);
+    std::uint64_t m_count = 0u;
+
+};
+
+/** Lengths of gaps between bytes below 32, i.e. events of probability 1/8. */
+class GapTest {
+
+public: /* Methods: */
+
+    void update(std::uint8_t const * data, std::size_t size) {
+        for (std::size_t i = 0u; i < size; ++i) {
+            if (data[i] < 32u) {
+                ++m_gaps[std::min(m_gap, MaxGap)];
+                m_gap = 0u;
+            } else {
+                ++m_gap;
+            }
+        }
+    }
+
+    void check() const {
+        std::uint64_t gaps = 0u;
+        for (auto const n : m_gaps)
+            gaps += n;
+        std::vector<double> expected(m_gaps.size());
+        double q = 1.0;
+        for (std::size_t r = 0u; r < MaxGap; ++r) {
+            expected[r] = static_cast<double>(gaps) * q / 8.0;
+            q *= 7.0 / 8.0;
+        }
+        expected[MaxGap] = static_cast<double>(gaps) * q;
+        SHAREMIND_TESTASSERT(acceptable(
+                chiSquareZ(chiSquare(m_gaps, expected),
+                           static_cast<double>(MaxGap))));
+    }
+
+private: /* Fields: */
+
+    static constexpr std::size_t const MaxGap = 32u;
+
+    std::vector<std::uint64_t> m_gaps =
+            std::vector<std::uint64_t>(MaxGap + 1u);
+    std::size_t m_gap = 0u;
+
+};
+
+constexpr std::size_t const GapTest::MaxGap;
+
+/**
+ * Marsaglia's birthday spacings test with 512 birthdays in a year of 2^24
+ * days, for which the number of duplicate spacings is Poisson distributed
+ * with a mean of 2.
+ */
+class BirthdaySpacingsTest {
+
+public: /* Methods: */
+
+    void update(std::uint8_t const * data, std::size_t size) {
+        for (std::size_t i = 0u; i + 2u < size; i += 3u) {
+            m_days.push_back(static_cast<std::uint32_t>(data[i])
+                             | static_cast<std::uint32_t>(data[i + 1u]) << 8u
+                             | static_cast<std::uint32_t>(data[i + 2u])
+                               << 16u);
+            if (m_days.size() == Birthdays)
+                trial();
+        }
+    }
+
+    void check() const {
+        auto const mean = 2.0 * static_cast<double>(m_trials);
+        auto const z = (static_cast<double>(m_duplicates) - mean)
+                       / std::sqrt(mean);
+        SHAREMIND_TESTASSERT(acceptable(z));
+    }
+
+private: /* Methods: */
+
+    void trial() {
+        std::sort(m_days.begin(), m_days.end());
+        std::vector<std::uint32_t> spacings(Birthdays);
+        spacings[0u] = m_days[0u];
+        for (std::size_t i = 1u; i < Birthdays; ++i)
+            spacings[i] = m_days[i] - m_days[i - 1u];
+        std::sort(spacings.begin(), spacings.end());
+        for (std::size_t i = 1u; i < Birthdays; ++i)
+            if (spacings[i] == spacings[i - 1u])
+                ++m_duplicates;
+        ++m_trials;
+        m_days.clear();
+    }
+
+private: /* Fields: */
+
+    static constexpr std::size_t const Birthdays = 512u;
+
+    std::vector<std::uint32_t> m_days;
+    std::uint64_t m_duplicates = 0u;
+    std::uint64_t m_trials = 0u;
+
+};
+
+constexpr std::size_t const BirthdaySpacingsTest::Birthdays;
+
+/**
+ * The NIST SP 800-22 linear complexity test on blocks of 512 bits, with the
+ * complexity computed by the Berlekamp-Massey algorithm. Only MaxBlocks
+ * blocks are tested, as the algorithm is quadratic.
+ */
+class LinearComplexityTest {
+
+public: /* Methods: */
+
+    void update(std::uint8_t const * data, std::size_t size) {
+        for (; size >= BlockBytes && m_blocks < MaxBlocks;
+             data += BlockBytes, size -= BlockBytes)
+        {
+            auto const t = static_cast<int>(complexity(data)) - 256;
+            ++m_classes[static_cast<std::size_t>(std::max(-3, std::min(t, 3))
+                                                 + 3)];
+            ++m_blocks;
+        }
+    }
+
+    void check() const {
+        SHAREMIND_TESTASSERT(m_blocks > 0u);
+        static double const probabilities[] = {
+            0.010417, 0.03125, 0.125, 0.5, 0.25, 0.0625, 0.020833 };
+        std::vector<double> expected;
+        for (auto const p : probabilities)
+            expected.push_back(static_cast<double>(m_blocks) * p);
+        SHAREMIND_TESTASSERT(acceptable(
+                chiSquareZ(chiSquare(m_classes, expected), 6.0)));
+    }
+
+private: /* Methods: */
+
+    static std::size_t complexity(std::uint8_t const * const data) {
+        constexpr std::size_t const n = BlockBytes * 8u;
+        auto const bit = [data](std::size_t const i)
+                { return (data[i / 8u] >> (i % 8u)) & 1u; };
+        std::array<std::uint8_t, n> b{};
+        std::array<std::uint8_t, n> c{};
+        std::array<std::uint8_t, n> t;
+        b[0u] = c[0u] = 1u;
+        std::size_t l = 0u;
+        std::size_t m = 1u;
+        for (std::size_t i = 0u; i < n; ++i) {
+            unsigned d = bit(i);
+            for (std::size_t j = 1u; j <= l; ++j)
+                d ^= c[j] & bit(i - j);
+            if (d == 0u) {
+                ++m;
+            } else if (2u * l <= i) {
+                t = c;
+                for (std::size_t j = 0u; j + m < n; ++j)
+                    c[j + m] ^= b[j];
+                l = i + 1u - l;
+                b = t;
+                m = 1u;
+            } else {
+                for (std::size_t j = 0u; j + m < n; ++j)
+                    c[j + m] ^= b[j];
+                ++m;
+            }
+        }
+        return l;
+    }
+
+private: /* Fields: */
+
+    static constexpr std::size_t const BlockBytes = 64u;
+    static constexpr std::size_t const MaxBlocks = 1024u;
+
+    std::vector<std::uint64_t> m_classes = std::vector<std::uint64_t>(7u);
+    std::size_t m_blocks = 0u;
+
+};
+
+constexpr std::size_t const LinearComplexityTest::BlockBytes;
+constexpr std::size_t const LinearComplexityTest::MaxBlocks;
+
+/**
+ * Correlation between 32-bit words at the distances of the lanes, blocks and
+ * groups of blocks of the kernels: equal words are virtually impossible, and
+ * the words must differ in half of their bits on average.
+ */
+class CrossLaneTest {
+
+public: /* Methods: */
+
+    void update(std::uint8_t const * data, std::size_t size) {
+        std::vector<std::uint32_t> words(size / 4u);
+        for (std::size_t i = 0u; i < words.size(); ++i)
+            words[i] = static_cast<std::uint32_t>(data[4u * i])
+                       | static_cast<std::uint32_t>(data[4u * i + 1u]) << 8u
+                       | static_cast<std::uint32_t>(data[4u * i + 2u]) << 16u
+                       | static_cast<std::uint32_t>(data[4u * i + 3u]) << 24u;
+        for (std::size_t s = 0u; s < Distances.size(); ++s) {
+            auto const d = Distances[s];
+            for (std::size_t i = 0u; i + d < words.size(); ++i) {
+                auto const x = words[i] ^ words[i + d];
+                m_equal[s] += (x == 0u);
+                m_differingBits[s] +=
+                        static_cast<unsigned>(__builtin_popcount(x));
+                ++m_pairs[s];
+            }
+        }
+    }
+
+    void check() const {
+        for (std::size_t s = 0u; s < Distances.size(); ++s) {
+            SHAREMIND_TESTASSERT(m_pairs[s] > 0u);
+            SHAREMIND_TESTASSERT(m_equal[s] <= 2u + (m_pairs[s] >> 32u));
+            auto const bits = static_cast<double>(m_pairs[s]) * 32.0;
+            auto const z = (static_cast<double>(m_differingBits[s])
+                            - bits / 2.0) / std::sqrt(bits / 4.0);
+            SHAREMIND_TESTASSERT(acceptable(z));
+        }
+    }
+
+private: /* Fields: */
+
+    static constexpr std::array<std::size_t, 10u> Distances{{
+        1u, 2u, 3u, 4u, 8u, 16u, 64u, 128u, 192u, 256u }};
+
+    std::array<std::uint64_t, Distances.size()> m_equal{};
+    std::array<std::uint64_t, Distances.size()> m_differingBits{};
+    std::array<std::uint64_t, Distances.size()> m_pairs{};
+
+};
+
+constexpr std::array<std::size_t, 10u> CrossLaneTest::Distances;
+
+class Battery {
+
+public: /* Methods: */
+
+    void update(std::uint8_t const * data, std::size_t size) {
+        m_frequency.update(data, size);
+        m_serial.update(data, size);
+        m_gap.update(data, size);
+        m_birthdaySpacings.update(data, size);
+        m_linearComplexity.update(data, size);
+        m_crossLane.update(data, size);
+    }
+
+    void check() const {
+        m_frequency.check();
+        m_serial.check();
+        m_gap.check();
+        m_birthdaySpacings.check();
+        m_linearComplexity.check();
+        m_crossLane.check();
+    }
+
+private: /* Fields: */
+
+    FrequencyTest m_frequency;
+    SerialTest m_serial;
+    GapTest m_gap;
+    BirthdaySpacingsTest m_birthdaySpacings;
+    LinearComplexityTest m_linearComplexity;
+    CrossLaneTest m_crossLane;
+
+};
+
+char const * kindName(SharemindCoreRandomEngineKind const kind) {
+    switch (kind) {
+    case SHAREMIND_RANDOM_SNOW2:    return "snow2";
+    case SHAREMIND_RANDOM_CHACHA20: return "chacha20";
+    case SHAREMIND_RANDOM_AES:      return "aes";
+    default:                        return "unknown";
+    }
+}
+
+char const * modeName(SharemindRandomEngineBufferingMode const mode) {
+    switch (mode) {
+    case SHAREMIND_RANDOM_BUFFERING_NONE:            return "none";
+    case SHAREMIND_RANDOM_BUFFERING_THREAD:          return "thread";
+    case SHAREMIND_RANDOM_BUFFERING_ADAPTIVE_THREAD: return "adaptive";
+    case SHAREMIND_RANDOM_BUFFERING_RESERVOIR:       return "reservoir";
+    default:                                         return "unknown";
+    }
+}
+
+void testStream(SharemindCoreRandomEngineKind const kind,
+                SharemindRandomEngineBufferingMode const mode,
+                std::size_t const size)
+{
+    SharemindRandomEngineConf conf = {};
+    conf.coreEngine = kind;
+    conf.bufferMode = mode;
+    // Reservoirs are meant to stay in the L1 or L2 cache:
+    conf.bufferSize = (mode == SHAREMIND_RANDOM_BUFFERING_RESERVOIR)
+                      ? 16u * 1024u
+                      : 1024u * 1024u;
+    conf.minBufferSize = 64u * 1024u;
+    std::vector<std::uint8_t> seed(RandomEngineFactory::getSeedSize(kind));
+    for (std::size_t i = 0u; i < seed.size(); ++i)
+        seed[i] = static_cast<std::uint8_t>(i * 7u + 1u);
+    auto const engine(RandomEngineFactory::createRandomEngineWithSeed(
+                          conf,
+                          seed.data(),
+                          seed.size()));
+
+    /* The stream is requested in pieces of varying sizes to exercise the
+       buffering, but only the time spent generating it is measured: */
+    std::vector<std::uint8_t> chunk(ChunkSize);
+    Battery battery;
+    std::chrono::steady_clock::duration elapsed{};
+    std::uint32_t requestSize = 1u;
+    for (std::size_t left = size; left > 0u;) {
+        auto const n = std::min(left, ChunkSize);
+        auto const start = std::chrono::steady_clock::now();
+        for (std::size_t offset = 0u; offset < n;) {
+            auto const r = std::min<std::size_t>(n - offset, requestSize);
+            engine->fillBytes(chunk.data() + offset, r);
+            offset += r;
+            requestSize = (requestSize * 1103515245u + 12345u) % 8191u + 1u;
+        }
+        elapsed += std::chrono::steady_clock::now() - start;
+        battery.update(chunk.data(), n);
+        left -= n;
+    }
+    battery.check();
+
+    auto const seconds =
+            std::chrono::duration<double>(elapsed).count();
+    std::cout << kindName(kind) << '/' << modeName(mode) << ": "
+              << static_cast<double>(size) / (1024.0 * 1024.0)
+                 / std::max(seconds, 1e-9)
+              << " MiB/s" << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char * argv[]) {
+    std::size_t mib = DefaultMiB;
+    if (argc > 1) {
+        mib = std::strtoul(argv[1], nullptr, 10);
+        SHAREMIND_TESTASSERT(mib > 0u);
+    }
+    std::cout << "SIMD level: "
+              << CpuFeatures::levelName(CpuFeatures::instance().level())
+              << std::endl;
+
+    for (auto const kind : { SHAREMIND_RANDOM_CHACHA20,
+                             SHAREMIND_RANDOM_AES,
+                             SHAREMIND_RANDOM_SNOW2 })
+        for (auto const mode : { SHAREMIND_RANDOM_BUFFERING_NONE,
+                                 SHAREMIND_RANDOM_BUFFERING_THREAD,
+                                 SHAREMIND_RANDOM_BUFFERING_ADAPTIVE_THREAD,
+                                 SHAREMIND_RANDOM_BUFFERING_RESERVOIR })
+            testStream(kind, mode, mib * 1024u * 1024u);
+}
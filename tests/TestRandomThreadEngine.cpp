@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/RandomFacility.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <sharemind/TestAssert.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+
+using namespace sharemind;
+
+namespace {
+
+using Block = std::array<std::uint8_t, 64u>;
+
+SharemindRandomEngineConf conf(
+        SharemindRandomEngineBufferingMode const bufferMode =
+                SHAREMIND_RANDOM_BUFFERING_NONE)
+{
+    SharemindRandomEngineConf r = {};
+    r.coreEngine = SHAREMIND_RANDOM_CHACHA20;
+    r.bufferMode = bufferMode;
+    r.bufferSize = 64u * 1024u;
+    return r;
+}
+
+SharemindRandomEngine * threadEngine(RandomFacility & facility,
+                                     SharemindRandomEngineConf const * c)
+{
+    auto & f = facility.facility();
+    SharemindRandomEngineCtorError error = SHAREMIND_RANDOM_OK;
+    auto * const engine = f.threadEngine(&f, c, &error);
+    SHAREMIND_TESTASSERT(engine);
+    SHAREMIND_TESTASSERT(error == SHAREMIND_RANDOM_OK);
+    return engine;
+}
+
+Block generate(SharemindRandomEngine * const engine) {
+    Block r;
+    engine->fillBytes(engine, r.data(), r.size());
+    return r;
+}
+
+void testSameThread() {
+    RandomFacility facility(conf());
+    auto const defaultEngine = threadEngine(facility, nullptr);
+    SHAREMIND_TESTASSERT(threadEngine(facility, nullptr) == defaultEngine);
+    SHAREMIND_TESTASSERT(&facility.threadEngine() == defaultEngine);
+
+    // Configurations are compared by value:
+    auto const c = conf();
+    SHAREMIND_TESTASSERT(threadEngine(facility, &c) == defaultEngine);
+    auto const bufferedConf = conf(SHAREMIND_RANDOM_BUFFERING_THREAD);
+    auto const bufferedEngine = threadEngine(facility, &bufferedConf);
+    SHAREMIND_TESTASSERT(bufferedEngine != defaultEngine);
+    auto const bufferedConfCopy = bufferedConf;
+    SHAREMIND_TESTASSERT(threadEngine(facility, &bufferedConfCopy)
+                         == bufferedEngine);
+
+    // Every engine is seeded separately:
+    SHAREMIND_TESTASSERT(generate(defaultEngine) != generate(bufferedEngine));
+
+    // Every facility has its own engines:
+    RandomFacility otherFacility(conf());
+    SHAREMIND_TESTASSERT(threadEngine(otherFacility, nullptr)
+                         != defaultEngine);
+
+    // Thread engines count towards the stats of the facility:
+    SharemindRandomEngineStats stats;
+    facility.getStats(stats);
+    SHAREMIND_TESTASSERT(stats.fillRequests == 2u);
+
+    // Engines are replaced after clear():
+    facility.clear();
+    facility.getStats(stats);
+    SHAREMIND_TESTASSERT(stats.fillRequests == 0u);
+    generate(threadEngine(facility, nullptr));
+    facility.getStats(stats);
+    SHAREMIND_TESTASSERT(stats.fillRequests == 1u);
+}
+
+void testOtherThreads() {
+    RandomFacility facility(conf(SHAREMIND_RANDOM_BUFFERING_THREAD));
+    auto const engine = threadEngine(facility, nullptr);
+    SharemindRandomEngine * otherEngines[2u] = {};
+    Block otherBlocks[2u];
+    for (unsigned i = 0u; i < 2u; ++i) {
+        std::thread([&, i]() {
+            otherEngines[i] = threadEngine(facility, nullptr);
+            otherBlocks[i] = generate(otherEngines[i]);
+        }).join();
+    }
+    SHAREMIND_TESTASSERT(otherEngines[0u] != engine);
+    SHAREMIND_TESTASSERT(otherBlocks[0u] != otherBlocks[1u]);
+    SHAREMIND_TESTASSERT(generate(engine) != otherBlocks[0u]);
+}
+
+bool readFully(int const fd, void * buffer, std::size_t size) {
+    while (size > 0u) {
+        auto const r = ::read(fd, buffer, size);
+        if (r <= 0)
+            return false;
+        buffer = static_cast<char *>(buffer) + r;
+        size -= static_cast<std::size_t>(r);
+    }
+    return true;
+}
+
+// After fork() the child must not continue the streams of the parent:
+void testFork(SharemindRandomEngineBufferingMode const bufferMode) {
+    RandomFacility facility(conf(bufferMode));
+    auto const engine = threadEngine(facility, nullptr);
+    generate(engine);
+
+    int fds[2u];
+    SHAREMIND_TESTASSERT(::pipe(fds) == 0);
+    auto const pid = ::fork();
+    SHAREMIND_TESTASSERT(pid >= 0);
+    if (pid == 0) {
+        // Buffered engines of the parent would hang without their threads:
+        ::alarm(30u);
+        ::close(fds[0u]);
+        auto const block = generate(threadEngine(facility, nullptr));
+        auto const ok = ::write(fds[1u], block.data(), block.size())
+                        == static_cast<ssize_t>(block.size());
+        ::exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    ::close(fds[1u]);
+    Block childBlock;
+    SHAREMIND_TESTASSERT(readFully(fds[0u],
+                                   childBlock.data(),
+                                   childBlock.size()));
+    ::close(fds[0u]);
+    int status;
+    SHAREMIND_TESTASSERT(::waitpid(pid, &status, 0) == pid);
+    SHAREMIND_TESTASSERT(WIFEXITED(status)
+                         && WEXITSTATUS(status) == EXIT_SUCCESS);
+
+    SHAREMIND_TESTASSERT(threadEngine(facility, nullptr) == engine);
+    SHAREMIND_TESTASSERT(generate(engine) != childBlock);
+}
+
+// The child must be able to create engines even if another thread of the
+// parent was using the facility during fork():
+void testForkWhileLocked() {
+    RandomFacility facility(conf());
+    std::atomic<bool> stop{false};
+    std::thread other([&facility, &stop]() {
+        std::vector<std::uint8_t> seed(facility.getSeedSize(conf()));
+        SharemindRandomEngineStats stats;
+        while (!stop.load()) {
+            facility.getStats(stats);
+            facility.createRandomEngineWithSeed(conf(),
+                                                seed.data(),
+                                                seed.size());
+        }
+    });
+    for (unsigned i = 0u; i < 50u; ++i) {
+        auto const pid = ::fork();
+        SHAREMIND_TESTASSERT(pid >= 0);
+        if (pid == 0) {
+            ::alarm(30u);
+            generate(threadEngine(facility, nullptr));
+            ::_exit(EXIT_SUCCESS);
+        }
+        int status;
+        SHAREMIND_TESTASSERT(::waitpid(pid, &status, 0) == pid);
+        SHAREMIND_TESTASSERT(WIFEXITED(status)
+                             && WEXITSTATUS(status) == EXIT_SUCCESS);
+    }
+    stop = true;
+    other.join();
+}
+
+// Files match a single seed, hence they can not back thread engines:
+void testFileRejected() {
+    RandomFacility facility(conf());
+    auto c = conf(SHAREMIND_RANDOM_BUFFERING_FILE);
+    c.filePath = "/nonexistent";
+    auto & f = facility.facility();
+    SharemindRandomEngineCtorError error = SHAREMIND_RANDOM_OK;
+    SHAREMIND_TESTASSERT(!f.threadEngine(&f, &c, &error));
+    SHAREMIND_TESTASSERT(error == SHAREMIND_RANDOM_GENERAL_ERROR);
+}
+
+} // anonymous namespace
+
+int main() {
+    testSameThread();
+    testOtherThreads();
+    testFork(SHAREMIND_RANDOM_BUFFERING_NONE);
+    testFork(SHAREMIND_RANDOM_BUFFERING_THREAD);
+    testForkWhileLocked();
+    testFileRejected();
+}